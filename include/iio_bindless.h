@@ -0,0 +1,143 @@
+#ifndef IIO_BINDLESS_H
+#define IIO_BINDLESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+#include "cglm/cglm.h"
+#include "iio_eng_typedef.h"
+#include "iio_descriptors.h"
+#include "iio_memory.h"
+#include "iio_resource_loaders.h"
+
+//  bindless materials: one update after bind descriptor set holding every sampled image, every sampler
+//  and a storage buffer of MaterialUniformBufferData. draws select their material with a push constant,
+//  so the set is bound once per frame instead of once per material
+
+#define IIO_BINDLESS_INVALID_INDEX UINT32_MAX
+
+#define IIO_BINDLESS_DEFAULT_TEXTURE_CAPACITY 4096
+#define IIO_BINDLESS_DEFAULT_SAMPLER_CAPACITY 64
+#define IIO_BINDLESS_DEFAULT_MATERIAL_CAPACITY 4096
+
+typedef enum IIOBindlessBinding_E {
+  iio_bindless_binding_textures,            // SAMPLED_IMAGE [textureCapacity]
+  iio_bindless_binding_samplers,            // SAMPLER [samplerCapacity]
+  iio_bindless_binding_materials,           // STORAGE_BUFFER of MaterialUniformBufferData
+
+  iio_bindless_binding_count
+} IIOBindlessBinding;
+
+//  push constants of a bindless draw, pushed once per material. model matrices come from the instance binding
+typedef struct IIOBindlessDrawConstants_S {
+  uint32_t                                  materialIndex;
+} IIOBindlessDrawConstants;
+
+//  slot released in frame, reusable once the frames in flight that could still read it have retired
+typedef struct IIOBindlessFreeSlot_S {
+  uint32_t                                  index;
+  uint64_t                                  frame;
+} IIOBindlessFreeSlot;
+
+#define T deque_BindlessFree, IIOBindlessFreeSlot
+#include "stc/deque.h"
+
+#define T hmap_BindlessSlot, uint64_t, uint32_t
+#include "stc/hmap.h"
+
+//  one array of a bindless table. keys are handles for textures and samplers and content hashes for materials
+typedef struct IIOBindlessSlots_S {
+  uint32_t                                  capacity;
+  uint32_t                                  highWater; // slots below it have been written at least once
+  uint32_t *                                refCounts;
+  uint64_t *                                keys;
+  hmap_BindlessSlot                         lookup; // key to slot index
+  deque_BindlessFree                        freed; // oldest first
+} IIOBindlessSlots;
+
+typedef struct IIOBindlessTable_S {
+  bool                                      isInitialized;
+
+  IIODescriptorPoolManager                  poolManager;
+  VkDescriptorSet                           descriptorSet;
+  IIODescriptorSetWriter                    writer;
+
+  IIOBindlessSlots                          textures;
+  IIOBindlessSlots                          samplers;
+  IIOBindlessSlots                          materials;
+
+  VkBuffer                                  materialBuffer;
+  IIOAllocation                             materialBufferMemory;
+  MaterialUniformBufferData *               materialData; // persistently mapped, indexed by material slot
+
+  uint64_t                                  frame;
+  uint32_t                                  framesInFlight;
+} IIOBindlessTable;
+
+//  capacities are clamped by the caller to the device's update after bind limits
+void iio_create_bindless_table(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  uint32_t                                  textureCapacity,
+  uint32_t                                  samplerCapacity,
+  uint32_t                                  materialCapacity,
+  uint32_t                                  framesInFlight,
+  IIOBindlessTable *                        table);
+
+void iio_destroy_bindless_table(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOBindlessTable *                        table);
+
+//  call once per frame after the frame's fence has been waited on, released slots become reusable
+//  framesInFlight frames later
+void iio_bindless_begin_frame(
+  IIOBindlessTable *                        table);
+
+//  returns the slot of view, writing it on first use. IIO_BINDLESS_INVALID_INDEX when the array is full
+uint32_t iio_bindless_acquire_texture(
+  VkDevice                                  device,
+  IIOBindlessTable *                        table,
+  VkImageView                               view);
+
+void iio_bindless_release_texture(
+  IIOBindlessTable *                        table,
+  uint32_t                                  index);
+
+uint32_t iio_bindless_acquire_sampler(
+  VkDevice                                  device,
+  IIOBindlessTable *                        table,
+  VkSampler                                 sampler);
+
+void iio_bindless_release_sampler(
+  IIOBindlessTable *                        table,
+  uint32_t                                  index);
+
+//  material's factors in the MaterialUniformBufferData layout with the texture and sampler indices zeroed,
+//  shared with the descriptor set fallback that binds the textures themselves
+void iio_material_uniform_data(
+  const IIOMaterial *                       material,
+  MaterialUniformBufferData *               data);
+
+//  returns the slot holding material's factors and texture indices, identical materials share a slot
+uint32_t iio_bindless_acquire_material(
+  VkDevice                                  device,
+  IIOBindlessTable *                        table,
+  const IIOMaterial *                       material);
+
+//  also releases the textures and samplers the material referenced
+void iio_bindless_release_material(
+  IIOBindlessTable *                        table,
+  uint32_t                                  index);
+
+//  registers the material of every primitive and stores its slot in material.bindlessIndex
+void iio_bindless_acquire_model_materials(
+  VkDevice                                  device,
+  IIOBindlessTable *                        table,
+  IIOModel *                                model);
+
+void iio_bindless_release_model_materials(
+  IIOBindlessTable *                        table,
+  IIOModel *                                model);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef IIO_DESCRIPTORS_H
 #define IIO_DESCRIPTORS_H
 
+#include <string.h>
 #include <vulkan/vulkan.h>
 
 #define IIO_MAX_SETS 4092
@@ -24,6 +25,7 @@ typedef struct IIODescriptorLayoutElement_S {
   VkDescriptorType                type;
   uint32_t                        count;
   VkShaderStageFlags              stageFlags; // Shader stages this descriptor is used in
+  VkDescriptorBindingFlags        bindingFlags; // 0, or descriptor indexing flags such as PARTIALLY_BOUND / UPDATE_AFTER_BIND
 } IIODescriptorLayoutElement;
 
 #define T vec_DLE, IIODescriptorLayoutElement
@@ -41,8 +43,38 @@ typedef struct IIODescriptorPoolManager_S {
   size_t                          setsPerPool; // Number of sets per pool
 
   vec_Write                       writes;
+
+  VkDescriptorUpdateTemplate      updateTemplate; // VK_NULL_HANDLE for partially bound layouts
+  size_t *                        templateOffsets; // byte offset of each binding's infos in template data
+  size_t                          templateDataSize;
 } IIODescriptorPoolManager;
 
+typedef struct IIOSizedDescriptorPool_S {
+  VkDescriptorPool                pool;
+  uint32_t                        setCount; // sets the pool was created for
+} IIOSizedDescriptorPool;
+
+#define T vec_SizedPool, IIOSizedDescriptorPool
+#include "stc/vec.h"
+
+//  pools of one frame in flight, filled front to back and reset together
+typedef struct IIODescriptorFrame_S {
+  vec_SizedPool                   pools;
+  uint32_t                        currentPool;
+  uint32_t                        currentPoolUsed; // sets handed out from pools[currentPool]
+} IIODescriptorFrame;
+
+//  transient sets of a manager's layout that live for one frame. the frame's pools are reset in bulk
+//  once its fence has signaled, so sets are never freed individually
+typedef struct IIOFrameDescriptorAllocator_S {
+  bool                            isInitialized;
+  IIODescriptorPoolManager *      manager; // layout and descriptor ratios of the sets
+  size_t                          setsPerPool; // size of the next pool, doubles up to IIO_MAX_SETS
+  uint32_t                        frameCount;
+  IIODescriptorFrame *            frames;
+  VkDescriptorSetLayout *         layouts; // IIO_MAX_SETS copies of the manager's layout
+} IIOFrameDescriptorAllocator;
+
 typedef enum {
   iio_writer_type_buffer,
   iio_writer_type_image
@@ -66,6 +98,54 @@ typedef struct IIODescriptorSetWriter_S {
   vec_WriteInfo                   writeInfos;
 } IIODescriptorSetWriter;
 
+//  packed infos of every binding of a manager's layout, written in place and applied with the manager's
+//  update template, or with descriptor writes when it could not be created. the data outlives updates,
+//  so only changed descriptors need to be rewritten
+typedef struct IIODescriptorTemplateWriter_S {
+  const IIODescriptorPoolManager *  manager;
+  uint8_t *                         data;
+} IIODescriptorTemplateWriter;
+
+//  a write as the descriptor cache compares it, padding is zeroed so records can be hashed as bytes
+typedef struct IIOCachedDescriptorWrite_S {
+  uint32_t                        binding;
+  uint32_t                        arrayElement;
+  uint32_t                        descriptorCount;
+  VkDescriptorType                descriptorType;
+  IIODescriptorWriteInfo          info;
+} IIOCachedDescriptorWrite;
+
+typedef struct IIODescriptorCacheKey_S {
+  VkDescriptorSetLayout           layout;
+  uint64_t                        hash; // of the IIOCachedDescriptorWrite records
+} IIODescriptorCacheKey;
+
+typedef struct IIOCachedDescriptorSet_S {
+  VkDescriptorSet                 descriptorSet;
+  uint32_t                        writeCount;
+  IIOCachedDescriptorWrite *      writes;
+} IIOCachedDescriptorSet;
+
+#define i_eq(x, y) (memcmp((x), (y), sizeof(IIODescriptorCacheKey)) == 0)
+#define T hmap_DescriptorCache, IIODescriptorCacheKey, IIOCachedDescriptorSet
+#include "stc/hmap.h"
+
+typedef struct IIORecycledDescriptorSet_S {
+  VkDescriptorSetLayout           layout;
+  VkDescriptorSet                 descriptorSet;
+} IIORecycledDescriptorSet;
+
+#define T vec_RecycledSet, IIORecycledDescriptorSet
+#include "stc/vec.h"
+
+//  sets with identical contents are written once and shared. the sets come from the managers' pools,
+//  so a manager whose pools are cleared or destroyed has to be evicted first
+typedef struct IIODescriptorCache_S {
+  bool                            isInitialized;
+  hmap_DescriptorCache            sets;
+  vec_RecycledSet                 recycled; // sets of evicted entries, rewritten before they are handed out again
+} IIODescriptorCache;
+
 void iio_create_descriptor_pool_manager(
   VkDevice                        device, 
   size_t                          elementCount, 
@@ -78,6 +158,11 @@ void iio_create_descriptor_set_layout(
   VkDevice                        device, 
   IIODescriptorPoolManager *      manager);
 
+//  leaves updateTemplate VK_NULL_HANDLE when a binding is partially bound
+void iio_create_descriptor_update_template(
+  VkDevice                        device, 
+  IIODescriptorPoolManager *      manager);
+
 VkDescriptorPool iio_create_descriptor_pool(
   VkDevice                        device, 
   IIODescriptorPoolManager *      manager);
@@ -102,6 +187,30 @@ void iio_destroy_descriptor_pool_manager(
   VkDevice                        device,
   IIODescriptorPoolManager *      manager);
 
+void iio_create_frame_descriptor_allocator(
+  IIODescriptorPoolManager *      manager,
+  size_t                          framesInFlight,
+  size_t                          initialSetCount,
+  IIOFrameDescriptorAllocator *   allocator);
+
+//  call after the fence of frameIndex has signaled, every set it handed out for that frame becomes invalid
+void iio_reset_frame_descriptor_allocator(
+  VkDevice                        device,
+  IIOFrameDescriptorAllocator *   allocator,
+  uint32_t                        frameIndex);
+
+//  allocates count sets for frameIndex with one vkAllocateDescriptorSets call per pool they span
+VkResult iio_allocate_frame_descriptor_sets(
+  VkDevice                        device,
+  IIOFrameDescriptorAllocator *   allocator,
+  uint32_t                        frameIndex,
+  uint32_t                        count,
+  VkDescriptorSet *               descriptorSets);
+
+void iio_destroy_frame_descriptor_allocator(
+  VkDevice                        device,
+  IIOFrameDescriptorAllocator *   allocator);
+
 void iio_create_descriptor_set_writer(
   IIODescriptorSetWriter *        writer);
 
@@ -114,6 +223,16 @@ void iio_write_image_descriptor(
   VkImageLayout                   imageLayout, 
   IIODescriptorSetWriter *        writer);
 
+//  writes a single element of an arrayed binding
+void iio_write_image_array_descriptor(
+  uint32_t                        binding,
+  uint32_t                        arrayElement,
+  VkDescriptorType                descriptorType,
+  VkSampler                       sampler,
+  VkImageView                     imageView,
+  VkImageLayout                   imageLayout,
+  IIODescriptorSetWriter *        writer);
+
 void iio_write_buffer_descriptor(
   uint32_t                        binding,
   uint32_t                        descriptorCount,
@@ -128,6 +247,67 @@ void iio_update_set(
   VkDescriptorSet                 descriptorSet,
   IIODescriptorSetWriter *        writer);
 
+void iio_create_descriptor_template_writer(
+  const IIODescriptorPoolManager *  manager,
+  IIODescriptorTemplateWriter *     writer);
+
+void iio_template_write_image(
+  uint32_t                          binding,
+  uint32_t                          arrayElement,
+  VkSampler                         sampler,
+  VkImageView                       imageView,
+  VkImageLayout                     imageLayout,
+  IIODescriptorTemplateWriter *     writer);
+
+void iio_template_write_buffer(
+  uint32_t                          binding,
+  uint32_t                          arrayElement,
+  VkBuffer                          buffer,
+  VkDeviceSize                      offset,
+  VkDeviceSize                      range,
+  IIODescriptorTemplateWriter *     writer);
+
+//  every descriptor of the layout is written, so each one must have been given a valid info
+void iio_update_set_with_template(
+  VkDevice                          device,
+  VkDescriptorSet                   descriptorSet,
+  IIODescriptorTemplateWriter *     writer);
+
+void iio_destroy_descriptor_template_writer(
+  IIODescriptorTemplateWriter *     writer);
+
+void iio_create_descriptor_cache(
+  IIODescriptorCache *            cache);
+
+void iio_destroy_descriptor_cache(
+  IIODescriptorCache *            cache);
+
+//  returns a set of manager's layout holding the writes in writer, updating a set only when no cached
+//  set has the same contents. the writer is cleared either way
+VkDescriptorSet iio_get_cached_descriptor_set(
+  VkDevice                        device,
+  IIODescriptorPoolManager *      manager,
+  IIODescriptorSetWriter *        writer,
+  IIODescriptorCache *            cache);
+
+//  drop every cached set referencing the resource, call before destroying it
+void iio_evict_cached_descriptor_buffer(
+  IIODescriptorCache *            cache,
+  VkBuffer                        buffer);
+
+void iio_evict_cached_descriptor_image_view(
+  IIODescriptorCache *            cache,
+  VkImageView                     imageView);
+
+void iio_evict_cached_descriptor_sampler(
+  IIODescriptorCache *            cache,
+  VkSampler                       sampler);
+
+//  drop every cached set of manager's layout, call before clearing or destroying its pools
+void iio_evict_cached_descriptor_layout(
+  IIODescriptorCache *            cache,
+  VkDescriptorSetLayout           layout);
+
 void iio_clear_descriptor_set_writer(
   IIODescriptorSetWriter *        writer);
 
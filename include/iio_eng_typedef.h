@@ -23,6 +23,8 @@ typedef struct MaterialUniformBufferData_S {
   vec4 metallicRoughnessNormalOcclusionScale;
   alignas(16) float alphaCutoff;
   alignas(16) int   texCoordIndex;
+  uint32_t          textureIndices [5]; // bindless slots: base color, metallic roughness, normal, occlusion, emissive
+  uint32_t          samplerIndices [5];
 } MaterialUniformBufferData;
 
 typedef struct Vertex_S {
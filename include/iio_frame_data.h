@@ -0,0 +1,61 @@
+#ifndef IIO_FRAME_DATA_H
+#define IIO_FRAME_DATA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+#include "iio_memory.h"
+
+#define IIO_DEFAULT_FRAME_DATA_SIZE (4ull * 1024ull * 1024ull)
+
+//  per draw data for dynamic uniform or storage buffer descriptors: one persistently mapped buffer split
+//  into a region per frame in flight, sub-allocated linearly and rewound when the frame's fence signals.
+//  a single descriptor set covering rangeSize bytes serves every draw through its dynamic offset.
+//  the buffer can also be bound as a vertex buffer for per instance data
+typedef struct IIOFrameDataRing_S {
+  bool                                      isInitialized;
+  VkBuffer                                  buffer;
+  IIOAllocation                             memory;
+  VkDeviceSize                              alignment; // of every dynamic offset
+  VkDeviceSize                              frameSize; // bytes of each frame's region
+  VkDeviceSize                              rangeSize; // bytes the descriptors cover, the largest single push
+  uint32_t                                  frameCount;
+  uint32_t                                  frame;
+  VkDeviceSize                              head; // bytes used of the current frame's region
+} IIOFrameDataRing;
+
+void iio_create_frame_data_ring(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  VkDeviceSize                              alignment,
+  VkDeviceSize                              frameSize,
+  VkDeviceSize                              rangeSize,
+  uint32_t                                  framesInFlight,
+  IIOFrameDataRing *                        ring);
+
+void iio_destroy_frame_data_ring(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOFrameDataRing *                        ring);
+
+//  call after the fence of frameIndex has signaled, rewinds that frame's region
+void iio_frame_data_ring_begin_frame(
+  IIOFrameDataRing *                        ring,
+  uint32_t                                  frameIndex);
+
+//  copies size (at most rangeSize) bytes into the current frame's region and returns their dynamic offset
+bool iio_frame_data_ring_push(
+  IIOFrameDataRing *                        ring,
+  const void *                              data,
+  VkDeviceSize                              size,
+  uint32_t *                                dynamicOffset);
+
+//  copies size bytes into the current frame's region for reads that do not go through the descriptors,
+//  such as per instance vertex data, and returns their offset in buffer
+bool iio_frame_data_ring_write(
+  IIOFrameDataRing *                        ring,
+  const void *                              data,
+  VkDeviceSize                              size,
+  VkDeviceSize *                            offset);
+
+#endif
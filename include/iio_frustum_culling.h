@@ -0,0 +1,49 @@
+#ifndef IIO_FRUSTUM_CULLING_H
+#define IIO_FRUSTUM_CULLING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cglm/cglm.h"
+
+//  CPU frustum culling: world space spheres and boxes in struct of arrays layout, tested against the six
+//  planes 4 (SSE) or 8 (AVX) at a time. a volume is visible when both its sphere and its box pass
+
+#define IIO_CULLING_BATCH_SIZE 8 // widest batch, the arrays are padded to a multiple of it
+
+typedef struct IIOCullingBounds_S {
+  uint32_t                                  count;
+  uint32_t                                  capacity; // multiple of IIO_CULLING_BATCH_SIZE
+  float *                                   centerX; // box center, also the sphere center
+  float *                                   centerY;
+  float *                                   centerZ;
+  float *                                   radius;
+  float *                                   extentX; // box half size
+  float *                                   extentY;
+  float *                                   extentZ;
+  uint8_t *                                 visible; // written by iio_cull_bounds, one per volume
+} IIOCullingBounds;
+
+void iio_create_culling_bounds(
+  IIOCullingBounds *                        bounds);
+
+void iio_destroy_culling_bounds(
+  IIOCullingBounds *                        bounds);
+
+//  keeps the capacity, so after the first frames adding no longer allocates
+void iio_culling_bounds_clear(
+  IIOCullingBounds *                        bounds);
+
+//  transforms an object space box and sphere to world space and appends them, false when out of memory
+bool iio_culling_bounds_add(
+  IIOCullingBounds *                        bounds,
+  vec3                                      boxMin,
+  vec3                                      boxMax,
+  float                                     sphereRadius,
+  mat4                                      transform);
+
+//  planes as made by glm_frustum_planes, normalized and facing inwards. returns how many volumes are visible
+uint32_t iio_cull_bounds(
+  IIOCullingBounds *                        bounds,
+  vec4                                      planes [6]);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef IIO_GEOMETRY_POOL_H
+#define IIO_GEOMETRY_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+#include "iio_memory.h"
+#include "iio_upload.h"
+
+#define IIO_DEFAULT_GEOMETRY_POOL_VERTEX_SIZE (64ull * 1024ull * 1024ull)
+#define IIO_DEFAULT_GEOMETRY_POOL_INDEX_SIZE (16ull * 1024ull * 1024ull)
+
+//  shared vertex and index megabuffers: primitives are appended linearly and drawn with their firstIndex
+//  and vertexOffset, so a whole scene binds one vertex and one index buffer. every vertex in a pool has
+//  the stride of the first primitive added, as one binding has one stride. ranges are not freed one by
+//  one, the pool is reset or destroyed together with the models placed in it.
+//  with a dedicated transfer queue the buffers are shared concurrently by both families, so appending
+//  never has to take ownership back from the queue drawing the earlier ranges
+typedef struct IIOGeometryPool_S {
+  bool                                      isInitialized;
+  VkBuffer                                  vertexBuffer;
+  IIOAllocation                             vertexMemory;
+  VkDeviceSize                              vertexCapacity;
+  VkDeviceSize                              vertexHead; // bytes used
+  uint32_t                                  vertexStride; // of every vertex in the pool, 0 until the first add
+  VkBuffer                                  indexBuffer;
+  IIOAllocation                             indexMemory;
+  VkDeviceSize                              indexCapacity;
+  VkDeviceSize                              indexHead; // bytes used
+  VkIndexType                               indexType; // of every index in the pool, narrower sources are widened
+} IIOGeometryPool;
+
+//  upload is the context every add goes through, its queue families decide the sharing mode
+void iio_create_geometry_pool(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  const IIOUploadContext *                  upload,
+  VkDeviceSize                              vertexCapacity,
+  VkDeviceSize                              indexCapacity,
+  VkIndexType                               indexType,
+  IIOGeometryPool *                         pool);
+
+void iio_destroy_geometry_pool(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOGeometryPool *                         pool);
+
+//  forgets every range and the vertex stride, only once the GPU no longer reads them
+void iio_reset_geometry_pool(
+  IIOGeometryPool *                         pool);
+
+//  records the upload of a primitive's vertices and indices (indexData may be NULL) into the current upload
+//  batch. returns false without writing anything when the pool is full, vertexStride differs from the pool's
+//  or indexType is wider than the pool's, the caller then gives the primitive buffers of its own
+bool iio_geometry_pool_add(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOUploadContext *                        upload,
+  IIOGeometryPool *                         pool,
+  const void *                              vertexData,
+  uint32_t                                  vertexCount,
+  uint32_t                                  vertexStride,
+  const void *                              indexData,
+  uint32_t                                  indexCount,
+  VkIndexType                               indexType,
+  int32_t *                                 vertexOffset,
+  uint32_t *                                firstIndex);
+
+#endif
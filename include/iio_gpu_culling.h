@@ -0,0 +1,127 @@
+#ifndef IIO_GPU_CULLING_H
+#define IIO_GPU_CULLING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+#include "cglm/cglm.h"
+#include "iio_descriptors.h"
+#include "iio_pipeline.h"
+#include "iio_memory.h"
+#include "iio_resource_loaders.h"
+
+//  gpu driven drawing: a compute pass culls every instance against the frustum and compacts the survivors
+//  into VkDrawIndexedIndirectCommands, one region and one count per pipeline. the graphics pass draws each
+//  region with a single vkCmdDrawIndexedIndirectCount, so recording costs the same for any instance count.
+//  instances must live in the geometry pool, the draws bind its buffers once
+
+#define IIO_GPU_CULLING_WORKGROUP_SIZE 64 // local_size_x of src/shaders/gpucull.glsl
+#define IIO_GPU_CULLING_DEFAULT_CAPACITY 131072
+#define IIO_GPU_CULLING_MAX_PIPELINES 8
+
+typedef enum IIOGpuCullingBinding_E {
+  iio_gpu_culling_binding_instances,        // STORAGE_BUFFER of IIOGpuInstance, read by culling and vertex shading
+  iio_gpu_culling_binding_draws,            // STORAGE_BUFFER of VkDrawIndexedIndirectCommand [pipelineCount][capacity]
+  iio_gpu_culling_binding_counts,           // STORAGE_BUFFER of uint32_t [pipelineCount]
+
+  iio_gpu_culling_binding_count
+} IIOGpuCullingBinding;
+
+//  std430 layout shared with gpucull.glsl and gpudrivenvertex.glsl. a draw's firstInstance is its instance index
+typedef struct IIOGpuInstance_S {
+  mat4                                      model;
+  vec4                                      boundsMin; // object space, w unused
+  vec4                                      boundsMax; // object space, w unused
+  uint32_t                                  indexCount;
+  uint32_t                                  firstIndex;
+  int32_t                                   vertexOffset;
+  uint32_t                                  materialIndex;
+  uint32_t                                  pipelineIndex;
+  uint32_t                                  padding [3];
+} IIOGpuInstance;
+
+typedef struct IIOGpuCullingConstants_S {
+  vec4                                      frustumPlanes [6];
+  uint32_t                                  instanceCount;
+  uint32_t                                  drawCapacity; // commands per pipeline region
+} IIOGpuCullingConstants;
+
+//  written by the GPU every frame, so each frame in flight has its own
+typedef struct IIOGpuCullingFrame_S {
+  VkBuffer                                  drawBuffer;
+  IIOAllocation                             drawMemory;
+  VkBuffer                                  countBuffer;
+  IIOAllocation                             countMemory;
+  VkDescriptorSet                           descriptorSet;
+} IIOGpuCullingFrame;
+
+typedef struct IIOGpuCulling_S {
+  bool                                      isInitialized;
+  uint32_t                                  capacity; // instances, also commands per pipeline
+  uint32_t                                  instanceCount;
+  uint32_t                                  pipelineCount;
+
+  VkBuffer                                  instanceBuffer;
+  IIOAllocation                             instanceMemory;
+  IIOGpuInstance *                          instances; // persistently mapped
+
+  IIODescriptorPoolManager                  poolManager;
+  IIODescriptorSetWriter                    writer;
+  IIOGraphicsPipelineManager                cullPipeline;
+
+  uint32_t                                  frameCount;
+  IIOGpuCullingFrame *                      frames;
+} IIOGpuCulling;
+
+//  cullShader is the module of gpucull.glsl, it can be destroyed once this returns
+void iio_create_gpu_culling(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  VkShaderModule                            cullShader,
+  uint32_t                                  capacity,
+  uint32_t                                  pipelineCount,
+  uint32_t                                  framesInFlight,
+  IIOGpuCulling *                           culling);
+
+void iio_destroy_gpu_culling(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOGpuCulling *                           culling);
+
+//  the instance buffer is shared by the frames in flight, only rebuild it while none of them is pending
+void iio_gpu_culling_clear(
+  IIOGpuCulling *                           culling);
+
+//  adds every pooled, indexed primitive of model with a bindless material and returns how many were left out
+uint32_t iio_gpu_culling_add_model(
+  IIOGpuCulling *                           culling,
+  const IIOModel *                          model,
+  uint32_t                                  pipelineIndex);
+
+//  adds every drawable primitive of model once per transform, model->modelMatrix is ignored.
+//  returns how many primitive and transform pairs were left out
+uint32_t iio_gpu_culling_add_instances(
+  IIOGpuCulling *                           culling,
+  const IIOModel *                          model,
+  const mat4 *                              transforms,
+  uint32_t                                  transformCount,
+  uint32_t                                  pipelineIndex);
+
+//  records the culling dispatch of frameIndex, outside of any render pass
+void iio_record_gpu_culling(
+  VkCommandBuffer                           commandBuffer,
+  IIOGpuCulling *                           culling,
+  uint32_t                                  frameIndex,
+  mat4                                      viewProjection);
+
+//  binds the instances at setIndex of layout and draws every pipeline's region with one indirect count draw.
+//  the vertex and index buffers of the geometry pool have to be bound already
+void iio_record_gpu_culled_draws(
+  VkCommandBuffer                           commandBuffer,
+  IIOGpuCulling *                           culling,
+  uint32_t                                  frameIndex,
+  VkPipelineLayout                          layout,
+  uint32_t                                  setIndex,
+  const VkPipeline *                        pipelines);
+
+#endif
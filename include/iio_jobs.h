@@ -0,0 +1,48 @@
+#ifndef IIO_JOBS_H
+#define IIO_JOBS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+//  index is in [0, jobCount) of the iio_job_pool_parallel_for call that scheduled the job
+typedef void (* IIOJobFunc) (void * userData, uint32_t index);
+
+typedef struct IIOJobPool_S {
+  bool                                      isInitialized;
+
+  pthread_t *                               threads;
+  uint32_t                                  threadCount; // workers, the submitting thread also runs jobs
+
+  pthread_mutex_t                           mutex;
+  pthread_mutex_t                           submitMutex; // one parallel_for at a time
+  pthread_cond_t                            wake;
+  pthread_cond_t                            finished;
+  uint64_t                                  generation; // bumped for every batch
+  uint32_t                                  busyWorkers;
+  bool                                      shuttingDown;
+
+  IIOJobFunc                                func;
+  void *                                    userData;
+  uint32_t                                  jobCount;
+  atomic_uint                               nextJob;
+  atomic_uint                               remainingJobs;
+} IIOJobPool;
+
+//  threadCount of 0 uses one worker per online core minus the calling thread
+void iio_create_job_pool(
+  uint32_t                                  threadCount,
+  IIOJobPool *                              pool);
+
+void iio_destroy_job_pool(
+  IIOJobPool *                              pool);
+
+//  runs func for every index in [0, jobCount) across the pool and returns once all have finished
+void iio_job_pool_parallel_for(
+  IIOJobPool *                              pool,
+  uint32_t                                  jobCount,
+  IIOJobFunc                                func,
+  void *                                    userData);
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef IIO_MEMORY_H
+#define IIO_MEMORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+
+#define IIO_DEFAULT_MEMORY_BLOCK_SIZE (64ull * 1024ull * 1024ull)
+#define IIO_SMALL_HEAP_MAX_SIZE (1024ull * 1024ull * 1024ull)
+
+static inline VkDeviceSize iio_align_up(VkDeviceSize value, VkDeviceSize alignment) {
+  if (alignment <= 1) return value;
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+typedef enum IIOAllocationType_E {
+  iio_allocation_type_free,
+  iio_allocation_type_linear,       // buffers and linear tiled images
+  iio_allocation_type_optimal,      // optimal tiled images
+
+  iio_allocation_type_maxenum
+} IIOAllocationType;
+
+typedef struct IIOMemoryRange_S {
+  VkDeviceSize                              offset;
+  VkDeviceSize                              size;
+  IIOAllocationType                         type;
+} IIOMemoryRange;
+
+#define T vec_MemRange, IIOMemoryRange
+#include "stc/vec.h"
+
+typedef struct IIOMemoryBlock_S {
+  VkDeviceMemory                            memory;
+  VkDeviceSize                              size;
+  VkDeviceSize                              usedBytes;
+  uint32_t                                  allocationCount;
+  void *                                    mapped;
+  vec_MemRange                              ranges; // sorted by offset, covers the whole block
+} IIOMemoryBlock;
+
+#define T vec_MemBlock, IIOMemoryBlock
+#include "stc/vec.h"
+
+typedef struct IIOAllocation_S {
+  VkDeviceMemory                            memory;
+  VkDeviceSize                              offset;
+  VkDeviceSize                              size;
+  void *                                    mapped; // NULL unless the memory type is host visible
+  uint32_t                                  memoryTypeIndex;
+  bool                                      dedicated;
+} IIOAllocation;
+
+typedef struct IIOMemoryAllocator_S {
+  bool                                      isInitialized;
+
+  VkPhysicalDeviceMemoryProperties          memoryProperties;
+  VkDeviceSize                              bufferImageGranularity;
+  VkDeviceSize                              blockSizes [VK_MAX_MEMORY_TYPES];
+
+  vec_MemBlock                              blocks [VK_MAX_MEMORY_TYPES];
+
+  uint32_t                                  dedicatedAllocationCount;
+  VkDeviceSize                              dedicatedBytes;
+} IIOMemoryAllocator;
+
+typedef struct IIOMemoryStats_S {
+  uint32_t                                  blockCount;
+  uint32_t                                  dedicatedAllocationCount;
+  uint32_t                                  allocationCount;
+  VkDeviceSize                              bytesAllocated; // device memory reserved from the driver
+  VkDeviceSize                              bytesInUse; // device memory handed out to resources
+  VkDeviceSize                              bytesFree;
+  VkDeviceSize                              largestFreeRange;
+  float                                     fragmentation; // 0 = all free memory is contiguous, 1 = fully scattered
+} IIOMemoryStats;
+
+void iio_create_memory_allocator(
+  VkPhysicalDevice                          physicalDevice,
+  VkDeviceSize                              preferredBlockSize,
+  IIOMemoryAllocator *                      allocator);
+
+void iio_destroy_memory_allocator(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator);
+
+uint32_t iio_find_allocator_memory_type(
+  const IIOMemoryAllocator *                allocator,
+  uint32_t                                  typeFilter,
+  VkMemoryPropertyFlags                     properties);
+
+VkResult iio_allocate_memory(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  const VkMemoryRequirements *              requirements,
+  VkMemoryPropertyFlags                     properties,
+  IIOAllocationType                         type,
+  const VkMemoryDedicatedAllocateInfo *     dedicatedInfo,
+  IIOAllocation *                           allocation);
+
+VkResult iio_allocate_buffer_memory(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  VkBuffer                                  buffer,
+  VkMemoryPropertyFlags                     properties,
+  IIOAllocation *                           allocation);
+
+VkResult iio_allocate_image_memory(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  VkImage                                   image,
+  VkImageTiling                             tiling,
+  VkMemoryPropertyFlags                     properties,
+  IIOAllocation *                           allocation);
+
+void iio_free_memory(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOAllocation *                           allocation);
+
+void iio_get_memory_stats(
+  const IIOMemoryAllocator *                allocator,
+  IIOMemoryStats *                          stats);
+
+void iio_print_memory_stats(
+  const IIOMemoryAllocator *                allocator);
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef IIO_MESH_CACHE_H
+#define IIO_MESH_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+//  baked models: GPU ready vertex and index streams, materials and image sources of a glTF file,
+//  laid out so a mapping of the file can be uploaded without any parsing
+
+#define IIO_MESH_CACHE_MAGIC 0x4d4f4949u // "IIOM"
+#define IIO_MESH_CACHE_VERSION 7
+#define IIO_MESH_CACHE_ALIGNMENT 16
+#define IIO_MESH_CACHE_SETTING_COUNT 4
+
+#ifndef IIO_PATH_TO_MESH_CACHE
+#define IIO_PATH_TO_MESH_CACHE "resources/cache/"
+#endif
+
+//  a cache file is only used when every field matches the source it is loaded for
+typedef struct IIOMeshCacheKey_S {
+  uint64_t                                  sourceMtime; // nanoseconds
+  uint64_t                                  sourceSize;
+  uint64_t                                  sourceHash; // FNV-1a over the whole source file
+  uint64_t                                  dependencyHash; // path, size and mtime of every external buffer
+  uint32_t                                  settings [IIO_MESH_CACHE_SETTING_COUNT]; // loader settings that change the baked data
+} IIOMeshCacheKey;
+
+typedef struct IIOMeshCacheHeader_S {
+  uint32_t                                  magic;
+  uint32_t                                  version;
+  IIOMeshCacheKey                           key;
+  uint64_t                                  fileSize;
+  uint32_t                                  meshCount;
+  uint32_t                                  primitiveCount;
+  uint32_t                                  imageCount;
+  uint32_t                                  reserved;
+  uint64_t                                  meshesOffset;
+  uint64_t                                  primitivesOffset;
+  uint64_t                                  imagesOffset;
+} IIOMeshCacheHeader;
+
+typedef struct IIOMeshCacheMesh_S {
+  uint32_t                                  firstPrimitive;
+  uint32_t                                  primitiveCount;
+} IIOMeshCacheMesh;
+
+typedef enum IIOMeshCacheTextureSlot_E {
+  iio_mesh_cache_texture_base_color,
+  iio_mesh_cache_texture_metallic_roughness,
+  iio_mesh_cache_texture_normal,
+  iio_mesh_cache_texture_occlusion,
+  iio_mesh_cache_texture_emissive,
+
+  iio_mesh_cache_texture_maxenum
+} IIOMeshCacheTextureSlot;
+
+typedef struct IIOMeshCacheMaterial_S {
+  float                                     baseColorFactor [4];
+  float                                     emissiveFactor [4]; // w unused
+  float                                     metallicFactor;
+  float                                     roughnessFactor;
+  float                                     normalScale;
+  float                                     occlusionStrength;
+  float                                     alphaCutoff;
+  uint32_t                                  alphaMode;
+  uint32_t                                  doubleSided;
+  int32_t                                   images [iio_mesh_cache_texture_maxenum]; // -1 keeps the default texture
+  uint32_t                                  texCoords [iio_mesh_cache_texture_maxenum];
+  int32_t                                   samplers [iio_mesh_cache_texture_maxenum][4]; // glTF mag filter, min filter, wrap s, wrap t
+} IIOMeshCacheMaterial;
+
+typedef struct IIOMeshCachePrimitive_S {
+  uint32_t                                  vertexCount;
+  uint32_t                                  vertexLayout;
+  uint32_t                                  vertexAttributes;
+  uint32_t                                  vertexStride; // stride of vertexLayout
+  uint32_t                                  indexCount; // 0 for non-indexed primitives
+  int32_t                                   indexType;
+  uint32_t                                  mode;
+  uint32_t                                  reserved;
+  float                                     boundsMin [4]; // w unused
+  float                                     boundsMax [4]; // w unused
+  float                                     boundsSphere [4]; // center, w is the radius
+  uint64_t                                  vertexDataOffset;
+  uint64_t                                  vertexDataSize;
+  uint64_t                                  indexDataOffset;
+  uint64_t                                  indexDataSize;
+  IIOMeshCacheMaterial                      material;
+} IIOMeshCachePrimitive;
+
+typedef enum IIOMeshCacheImageSource_E {
+  iio_mesh_cache_image_none,
+  iio_mesh_cache_image_uri,      // data is a NUL terminated uri relative to IIO_PATH_TO_TEXTURES
+  iio_mesh_cache_image_embedded, // data is the encoded image
+
+  iio_mesh_cache_image_maxenum
+} IIOMeshCacheImageSource;
+
+typedef struct IIOMeshCacheImage_S {
+  uint32_t                                  source;
+  uint32_t                                  reserved;
+  uint64_t                                  dataOffset;
+  uint64_t                                  dataSize;
+} IIOMeshCacheImage;
+
+typedef struct IIOMeshCacheBlob_S {
+  const void *                              data;
+  uint64_t                                  size;
+} IIOMeshCacheBlob;
+
+typedef struct IIOMappedMeshCache_S {
+  const uint8_t *                           base;
+  size_t                                    size;
+  const IIOMeshCacheHeader *                header;
+  const IIOMeshCacheMesh *                  meshes;
+  const IIOMeshCachePrimitive *             primitives;
+  const IIOMeshCacheImage *                 images;
+} IIOMappedMeshCache;
+
+//  FNV-1a, used for the source hash of the cache key and for image contents
+uint64_t iio_hash_bytes(
+  const uint8_t *                           bytes,
+  size_t                                    size);
+
+//  path of a file in IIO_PATH_TO_MESH_CACHE derived from name, which may contain directories
+bool iio_cache_file_path(
+  const char *                              name,
+  const char *                              extension,
+  char *                                    path,
+  size_t                                    size);
+
+bool iio_create_cache_directory();
+
+//  path of the cache file for a model filename relative to IIO_PATH_TO_MODELS
+bool iio_mesh_cache_path(
+  const char *                              filename,
+  char *                                    path,
+  size_t                                    size);
+
+//  dependencyPaths are the files the source references, such as .bin buffers, a missing one fails the key
+bool iio_compute_mesh_cache_key(
+  const char *                              sourcePath,
+  const char * const *                      dependencyPaths,
+  uint32_t                                  dependencyCount,
+  const uint32_t *                          settings, // IIO_MESH_CACHE_SETTING_COUNT values
+  IIOMeshCacheKey *                         key);
+
+//  maps the cache file and validates it against key. returns false on a miss, mapped is left empty
+bool iio_map_mesh_cache(
+  const char *                              cachePath,
+  const IIOMeshCacheKey *                   key,
+  IIOMappedMeshCache *                      mapped);
+
+void iio_unmap_mesh_cache(
+  IIOMappedMeshCache *                      mapped);
+
+//  writes the cache through a temporary file that replaces cachePath once complete.
+//  the data offsets and sizes in primitives and images are filled in from the blobs
+bool iio_write_mesh_cache(
+  const char *                              cachePath,
+  const IIOMeshCacheKey *                   key,
+  const IIOMeshCacheMesh *                  meshes,
+  uint32_t                                  meshCount,
+  IIOMeshCachePrimitive *                   primitives,
+  const IIOMeshCacheBlob *                  vertexBlobs,
+  const IIOMeshCacheBlob *                  indexBlobs,
+  uint32_t                                  primitiveCount,
+  IIOMeshCacheImage *                       images,
+  const IIOMeshCacheBlob *                  imageBlobs,
+  uint32_t                                  imageCount);
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef IIO_MESH_OPTIMIZER_H
+#define IIO_MESH_OPTIMIZER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+//  size of the FIFO cache used for optimizing and for the reported metrics
+#define IIO_VERTEX_CACHE_SIZE 16
+
+typedef enum IIOMeshOptimizeBits_E {
+  IIO_MESH_OPTIMIZE_DEDUPLICATE_BIT         = 1 << 0,
+  IIO_MESH_OPTIMIZE_VERTEX_CACHE_BIT        = 1 << 1,
+  IIO_MESH_OPTIMIZE_OVERDRAW_BIT            = 1 << 2, // reorders the clusters found by the vertex cache pass
+  IIO_MESH_OPTIMIZE_VERTEX_FETCH_BIT        = 1 << 3,
+  IIO_MESH_OPTIMIZE_ALL                     = (1 << 4) - 1
+} IIOMeshOptimizeBits;
+typedef uint32_t IIOMeshOptimizeFlags;
+
+typedef struct IIOVertexCacheStats_S {
+  uint32_t                                  triangleCount;
+  uint32_t                                  vertexCount;
+  uint32_t                                  cacheMisses; // vertex shader invocations
+} IIOVertexCacheStats;
+
+typedef struct IIOMeshOptimizeStats_S {
+  IIOVertexCacheStats                       before;
+  IIOVertexCacheStats                       after;
+} IIOMeshOptimizeStats;
+
+//  average cache miss ratio, misses per triangle. 0.5 is the best case for large regular meshes, 3 the worst
+float iio_vertex_cache_acmr(const IIOVertexCacheStats * stats);
+
+//  average transformed to vertex ratio, misses per vertex. 1 is optimal
+float iio_vertex_cache_atvr(const IIOVertexCacheStats * stats);
+
+void iio_analyze_vertex_cache(
+  const uint32_t *                          indices,
+  size_t                                    indexCount,
+  size_t                                    vertexCount,
+  IIOVertexCacheStats *                     stats);
+
+//  fills remap with the new index of every vertex, bitwise identical vertices share one.
+//  returns the number of unique vertices
+size_t iio_generate_vertex_remap(
+  uint32_t *                                remap,
+  const uint32_t *                          indices, // NULL for non-indexed geometry
+  size_t                                    indexCount,
+  const void *                              vertices,
+  size_t                                    vertexCount,
+  size_t                                    vertexSize);
+
+//  vertices that are not referenced by remap (~0u) are dropped
+void iio_remap_vertex_buffer(
+  void *                                    dst,
+  const void *                              vertices,
+  size_t                                    vertexCount,
+  size_t                                    vertexSize,
+  const uint32_t *                          remap);
+
+//  dst may alias indices. indices NULL remaps the implicit 0..indexCount-1 sequence
+void iio_remap_index_buffer(
+  uint32_t *                                dst,
+  const uint32_t *                          indices,
+  size_t                                    indexCount,
+  const uint32_t *                          remap);
+
+//  Tipsify (Sander et al. 2007). Writes the reordered triangle list to dst, which may not alias indices.
+//  when clusters is not NULL it receives the first index of every run that starts from an empty cache,
+//  clusterCount receives their number. clusters must hold indexCount / 3 entries
+void iio_optimize_vertex_cache(
+  uint32_t *                                dst,
+  const uint32_t *                          indices,
+  size_t                                    indexCount,
+  size_t                                    vertexCount,
+  uint32_t *                                clusters,
+  size_t *                                  clusterCount);
+
+//  sorts the clusters of a cache optimized index buffer so outward facing ones are drawn first.
+//  dst may not alias indices, positions are three floats at the start of every vertex. indices past
+//  vertexCount leave the order unchanged
+void iio_optimize_overdraw(
+  uint32_t *                                dst,
+  const uint32_t *                          indices,
+  size_t                                    indexCount,
+  const uint32_t *                          clusters,
+  size_t                                    clusterCount,
+  const void *                              vertices,
+  size_t                                    vertexCount,
+  size_t                                    vertexSize);
+
+//  remap that orders vertices by first use in indices. returns the number of referenced vertices
+size_t iio_optimize_vertex_fetch_remap(
+  uint32_t *                                remap,
+  const uint32_t *                          indices,
+  size_t                                    indexCount,
+  size_t                                    vertexCount);
+
+//  runs the passes selected in flags on a triangle list. vertices and indices are reallocated when they
+//  change size, a NULL *pIndices is replaced by a generated index buffer. returns false when out of memory,
+//  the mesh is left untouched in that case
+bool iio_optimize_mesh(
+  void **                                   pVertices,
+  uint32_t *                                pVertexCount,
+  size_t                                    vertexSize,
+  uint32_t **                               pIndices,
+  uint32_t *                                pIndexCount,
+  IIOMeshOptimizeFlags                      flags,
+  IIOMeshOptimizeStats *                    stats);
+
+#endif
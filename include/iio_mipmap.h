@@ -0,0 +1,37 @@
+#ifndef IIO_MIPMAP_H
+#define IIO_MIPMAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+//  CPU side mip chain generation, used when the GPU can not blit the format or the upload queue can not blit at all
+
+//  levels of a full chain down to 1x1
+uint32_t iio_mip_level_count(
+  uint32_t                                  width,
+  uint32_t                                  height);
+
+static inline uint32_t iio_mip_extent(uint32_t extent, uint32_t level) {
+  return extent >> level ? extent >> level : 1;
+}
+
+//  bytes of the first levelCount levels packed back to back
+size_t iio_mip_chain_size(
+  uint32_t                                  width,
+  uint32_t                                  height,
+  uint32_t                                  levelCount,
+  size_t                                    texelSize);
+
+//  chain holds level 0 of an 8 bit image with channelCount channels on entry, levels 1..levelCount-1 are
+//  written behind it with a 2x2 box filter. srgb averages the first three channels in linear space,
+//  the fourth (alpha) is always linear
+void iio_generate_mip_chain_unorm8(
+  uint8_t *                                 chain,
+  uint32_t                                  width,
+  uint32_t                                  height,
+  uint32_t                                  levelCount,
+  uint32_t                                  channelCount,
+  bool                                      srgb);
+
+#endif
@@ -136,6 +136,12 @@ void iio_create_graphics_pipeline(
   uint32_t                                  subpass,
   IIOGraphicsPipelineStates *               state);
 
+//  the layout is created with iio_create_graphics_pipeline_layout, both are destroyed with iio_destroy_graphics_pipeline
+void iio_create_compute_pipeline(
+  VkDevice                                  device,
+  IIOGraphicsPipelineManager *              manager,
+  VkShaderModule                            module);
+
 void iio_destroy_graphics_pipeline(
   VkDevice                                  device,
   IIOGraphicsPipelineManager *              manager);
@@ -1,4 +1,114 @@
 #ifndef IIO_RENDERER_H
 #define IIO_RENDERER_H
 
-#endif
\ No newline at end of file
+#include <stdint.h>
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+#include "cglm/cglm.h"
+#include "iio_resource_loaders.h"
+#include "iio_frustum_culling.h"
+
+//  draw lists: the visible primitives of a frame, sorted by a 64 bit state key so consecutive draws
+//  share as much bound state as possible, then recorded without the binds that would repeat the last one.
+//  every draw is instanced, its model matrices are read from a per instance vertex binding
+
+//  key layout, most significant first: pipeline 8 | material 20 | vertex buffer 20 | depth 16.
+//  the top pipeline bit marks blended draws, which sort after the opaque ones and back to front
+#define IIO_DRAW_KEY_PIPELINE_SHIFT 56
+#define IIO_DRAW_KEY_MATERIAL_SHIFT 36
+#define IIO_DRAW_KEY_VERTEX_BUFFER_SHIFT 16
+#define IIO_DRAW_KEY_MATERIAL_MASK 0xfffffull
+#define IIO_DRAW_KEY_VERTEX_BUFFER_MASK 0xfffffull
+#define IIO_DRAW_KEY_DEPTH_MASK 0xffffull
+#define IIO_DRAW_KEY_BLENDED_BIT 0x80u
+#define IIO_MAX_DRAW_PIPELINES 0x80u
+
+//  set index materials without a bindless slot bind their descriptor set at
+#define IIO_DRAW_MATERIAL_SET 1
+
+typedef struct IIODrawItem_S {
+  uint64_t                                  sortKey;
+  const IIOPrimitive *                      primitive;
+  uint32_t                                  firstInstance; // into the list's transforms
+  uint32_t                                  instanceCount;
+  uint32_t                                  pipelineIndex;
+} IIODrawItem;
+
+//  mat4 is an array type, the wrapper lets it live in a vec
+typedef struct IIODrawTransform_S {
+  mat4                                      matrix;
+} IIODrawTransform;
+
+#define T vec_DrawItem, IIODrawItem
+#include "stc/vec.h"
+
+#define T vec_DrawTransform, IIODrawTransform
+#include "stc/vec.h"
+
+//  commands the last recording issued and the ones it filtered as redundant
+typedef struct IIODrawListStats_S {
+  uint32_t                                  draws;
+  uint32_t                                  instances;
+  uint32_t                                  culled; // instances outside the frustum
+  uint32_t                                  pipelineBinds;
+  uint32_t                                  materialPushes;
+  uint32_t                                  materialBinds; // descriptor sets of fallback materials
+  uint32_t                                  vertexBufferBinds;
+  uint32_t                                  indexBufferBinds;
+  uint32_t                                  skippedBinds;
+} IIODrawListStats;
+
+typedef struct IIODrawList_S {
+  vec_DrawItem                              items;
+  vec_DrawTransform                         transforms; // per instance data, ranges of it belong to the items
+  mat4                                      view;
+  vec4                                      frustumPlanes [6];
+  IIOCullingBounds                          bounds; // volumes of the model being added
+  IIODrawListStats                          stats;
+} IIODrawList;
+
+void iio_create_draw_list(
+  IIODrawList *                             list);
+
+void iio_destroy_draw_list(
+  IIODrawList *                             list);
+
+//  empties the list for a new frame, depth is measured along view and culling uses viewProjection
+void iio_draw_list_begin(
+  IIODrawList *                             list,
+  mat4                                      view,
+  mat4                                      viewProjection);
+
+//  adds every primitive of model that has geometry, a bindless slot or material set and a bounding sphere and box inside the frustum.
+//  false when it could not be culled, as for iio_draw_list_add_instances
+bool iio_draw_list_add_model(
+  IIODrawList *                             list,
+  const IIOModel *                          model,
+  uint32_t                                  pipelineIndex);
+
+//  draws model once per transform, model->modelMatrix is ignored. each primitive becomes one instanced
+//  draw of the transforms that place it inside the frustum. false when the culling bounds do not fit in memory,
+//  nothing of model is added then
+bool iio_draw_list_add_instances(
+  IIODrawList *                             list,
+  const IIOModel *                          model,
+  const mat4 *                              transforms,
+  uint32_t                                  transformCount,
+  uint32_t                                  pipelineIndex);
+
+void iio_draw_list_sort(
+  IIODrawList *                             list);
+
+//  records the sorted list. pipelines is indexed by the items' pipelineIndex, a bindless material index is
+//  pushed as IIOBindlessDrawConstants to layout, any other material binds its set at IIO_DRAW_MATERIAL_SET.
+//  the list's transforms must have been copied to instanceBuffer at instanceOffset, it is bound once at
+//  IIO_INSTANCE_BINDING
+void iio_record_draw_list(
+  VkCommandBuffer                           commandBuffer,
+  VkPipelineLayout                          layout,
+  const VkPipeline *                        pipelines,
+  VkBuffer                                  instanceBuffer,
+  VkDeviceSize                              instanceOffset,
+  IIODrawList *                             list);
+
+#endif
@@ -6,8 +6,16 @@
 #include "cgltf.h"
 
 #include "iio_string_wrapper.h"
+#include "iio_memory.h"
+#include "iio_jobs.h"
+#include "iio_mesh_optimizer.h"
+#include "iio_texture_compression.h"
 
 #define IIOVERTEX_ATTRIBUTE_COUNT 8
+#define IIO_INSTANCE_BINDING 1
+#define IIO_INSTANCE_ATTRIBUTE_LOCATION IIOVERTEX_ATTRIBUTE_COUNT
+#define IIO_INSTANCE_ATTRIBUTE_COUNT 4
+#define IIO_MATERIAL_TEXTURE_COUNT 5
 
 #ifndef IIO_PATH_TO_TEXTURES
 #define IIO_PATH_TO_TEXTURES "resources/textures/"
@@ -27,7 +35,7 @@ typedef enum {
 typedef struct IIOTextureInfo_S {
   VkImage                                   image;
   VkImageView                               imageView;
-  VkDeviceMemory                            imageMemory;
+  IIOAllocation                             imageMemory;
   VkSampler                                 sampler;
   uint32_t                                  texCoord;
 } IIOTextureInfo;
@@ -59,6 +67,8 @@ typedef struct IIOMaterial_S {
   gltfAlphaMode                             alphaMode;
   float                                     alphaCutoff;
   bool                                      doubleSided;
+  uint32_t                                  bindlessIndex; // slot in the bindless material buffer, UINT32_MAX when not registered
+  VkDescriptorSet                           descriptorSet; // textures and factors when drawn without bindless, VK_NULL_HANDLE otherwise
 } IIOMaterial;
 
 typedef struct IIOVertex_S {
@@ -71,14 +81,67 @@ typedef struct IIOVertex_S {
   vec4                                      weights;
 } IIOVertex;
 
+//  bit i is the attribute at shader location i, in both vertex layouts
+typedef enum IIOVertexAttributeBits_E {
+  IIO_VERTEX_ATTRIBUTE_POSITION_BIT         = 1 << 0,
+  IIO_VERTEX_ATTRIBUTE_NORMAL_BIT           = 1 << 1,
+  IIO_VERTEX_ATTRIBUTE_TANGENT_BIT          = 1 << 2,
+  IIO_VERTEX_ATTRIBUTE_TEXCOORD0_BIT        = 1 << 3,
+  IIO_VERTEX_ATTRIBUTE_TEXCOORD1_BIT        = 1 << 4,
+  IIO_VERTEX_ATTRIBUTE_COLOR_BIT            = 1 << 5,
+  IIO_VERTEX_ATTRIBUTE_JOINTS_BIT           = 1 << 6,
+  IIO_VERTEX_ATTRIBUTE_WEIGHTS_BIT          = 1 << 7,
+  IIO_VERTEX_ATTRIBUTE_ALL                  = (1 << IIOVERTEX_ATTRIBUTE_COUNT) - 1
+} IIOVertexAttributeBits;
+typedef uint32_t IIOVertexAttributeFlags;
+
+typedef enum IIOVertexLayout_E {
+  iio_vertex_layout_full,   // IIOVertex as is, every attribute as floats
+  iio_vertex_layout_packed, // every attribute quantized, IIO_PACKED_VERTEX_SIZE bytes
+
+  iio_vertex_layout_maxenum
+} IIOVertexLayout;
+
+//  packed layout per attribute, one fixed format so a single pipeline draws every packed primitive.
+//  the hardware expands all of them to floats except the octahedral normal and tangent, which shaders
+//  reading them have to decode
+//    position  R32G32B32_SFLOAT
+//    normal    R16G16_SNORM          octahedral
+//    tangent   R16G16B16A16_SNORM    octahedral xy, bitangent sign in w
+//    texCoord  R16G16_SFLOAT
+//    color     R8G8B8A8_UNORM
+//    joints    R16G16B16A16_UINT
+//    weights   R16G16B16A16_UNORM
+#define IIO_PACKED_VERTEX_SIZE 52
+
+typedef struct IIOVertexFormat_S {
+  IIOVertexLayout                           layout;
+  uint32_t                                  stride;
+  uint32_t                                  offsets [IIOVERTEX_ATTRIBUTE_COUNT];
+  VkFormat                                  formats [IIOVERTEX_ATTRIBUTE_COUNT];
+} IIOVertexFormat;
+
 typedef struct IIOPrimitive_S {
-  IIOVertex *                               vertices;
+  IIOVertex *                               vertices; // NULL when loaded from the mesh cache
   uint32_t                                  vertexCount;
+  IIOVertexAttributeFlags                   vertexAttributes; // attributes present in the source
+  IIOVertexLayout                           vertexLayout; // layout of the uploaded vertices
+  void *                                    vertexData; // packed vertices, NULL for the full layout
   uint32_t *                                indices;
   uint32_t                                  indexCount;
+  VkIndexType                               indexType; // width of indexBuffer, indices stay 32 bit on the CPU
   VkBuffer                                  vertexBuffer;
+  IIOAllocation                             vertexBufferMemory;
   VkBuffer                                  indexBuffer;
+  IIOAllocation                             indexBufferMemory;
+  bool                                      pooledGeometry; // the buffers are shared and owned by a geometry pool
+  int32_t                                   vertexOffset; // where the primitive starts in its buffers, 0 unless pooled
+  uint32_t                                  firstIndex;
   IIOMaterial                               material;
+  vec3                                      boundsMin; // object space bounds of the positions
+  vec3                                      boundsMax;
+  vec3                                      sphereCenter; // object space bounding sphere, centered on the box
+  float                                     sphereRadius;
   uint8_t                                   mode; // default is 4 (GL_TRIANGLES)
   // TODO: targets
 } IIOPrimitive;
@@ -89,9 +152,16 @@ typedef struct IIOMesh_S {
   // TODO: weights
 } IIOMesh;
 
+typedef struct IIOImageHandle_S IIOImageHandle;
+
 typedef struct IIOModel_S {
   IIOMesh *                                 meshes;
   uint32_t                                  meshCount;
+  IIOImageHandle *                          images; // indexed like the source glTF images
+  char **                                   imageNames; // keys of images in the resource manager, NULL where loading failed
+  uint32_t                                  imageCount;
+  VkSampler *                               samplers; // distinct samplers the materials use, one reference each
+  uint32_t                                  samplerCount;
   mat4                                      modelMatrix;
 } IIOModel;
 
@@ -114,13 +184,67 @@ typedef struct IIOModel2_S {
   VkBuffer                                  groupMaterialUBOBuffer;
 } IIOModel2;
 
-typedef struct IIOImageHandle_S {
+struct IIOImageHandle_S {
   VkImage                                   data;
   VkImageView                               view;
   VkSampler                                 sampler;
-  VkDeviceMemory                            memory;
+  IIOAllocation                             memory;
   VkDescriptorSet                           descriptor;
-} IIOImageHandle;
+  uint32_t                                  refCount; // of the copy in the resource manager, one per holder
+};
+
+//  sampler of a glTF texture, GL enums as in the file. undefined filters leave the choice to the loader
+typedef struct IIOTextureSampler_S {
+  int32_t                                   magFilter;
+  int32_t                                   minFilter;
+  int32_t                                   wrapS;
+  int32_t                                   wrapT;
+} IIOTextureSampler;
+
+//  the fields of VkSamplerCreateInfo samplers are shared by, pNext chains are not part of it
+typedef struct IIOSamplerKey_S {
+  VkSamplerCreateFlags                      flags;
+  VkFilter                                  magFilter;
+  VkFilter                                  minFilter;
+  VkSamplerMipmapMode                       mipmapMode;
+  VkSamplerAddressMode                      addressModeU;
+  VkSamplerAddressMode                      addressModeV;
+  VkSamplerAddressMode                      addressModeW;
+  float                                     mipLodBias;
+  VkBool32                                  anisotropyEnable;
+  float                                     maxAnisotropy;
+  VkBool32                                  compareEnable;
+  VkCompareOp                               compareOp;
+  float                                     minLod;
+  float                                     maxLod;
+  VkBorderColor                             borderColor;
+  VkBool32                                  unnormalizedCoordinates;
+} IIOSamplerKey;
+
+typedef struct IIOCachedSampler_S {
+  VkSampler                                 sampler;
+  uint32_t                                  refCount;
+} IIOCachedSampler;
+
+//  how materials sample an image, decides the format it is uploaded in
+typedef enum IIOTextureUsageBits_E {
+  IIO_TEXTURE_USAGE_COLOR_BIT               = 1 << 0, // base color and emissive
+  IIO_TEXTURE_USAGE_NORMAL_BIT              = 1 << 1,
+  IIO_TEXTURE_USAGE_METALLIC_ROUGHNESS_BIT  = 1 << 2,
+  IIO_TEXTURE_USAGE_OCCLUSION_BIT           = 1 << 3,
+} IIOTextureUsageBits;
+typedef uint32_t IIOTextureUsageFlags;
+
+//  storage of an image for a set of usages. only the channels the usages read are stored,
+//  the view swizzle puts them back where the glTF channel conventions expect them
+typedef struct IIOTextureFormat_S {
+  VkFormat                                  format;
+  VkFormat                                  compressedFormat; // used when texture compression is enabled
+  uint32_t                                  channelCount; // of format
+  uint8_t                                   sourceChannels [4]; // source RGBA channel stored in each channel
+  VkComponentMapping                        components;
+  const char *                              bakedExtension; // of the baked compressed copy
+} IIOTextureFormat;
 
 typedef enum IIOImageType_E {
   iio_image_type_path,
@@ -138,15 +262,27 @@ typedef IIOModel * IIOModelPtr;
 #define T hmap_strImg, IIOStringWrapper, IIOImageHandle, (c_keypro)
 #include "stc/hmap.h"
 
+//  the key has no padding, so the default hash over its bytes is stable
+#define T hmap_Sampler, IIOSamplerKey, IIOCachedSampler
+#define i_eq(x, y) (memcmp(x, y, sizeof(IIOSamplerKey)) == 0)
+#include "stc/hmap.h"
+
 typedef struct IIOResourceManager_S {
   hmap_strModel modelMap;
   hmap_strImg imageMap;
+  hmap_Sampler samplerMap;
+  IIOJobPool jobPool;
 } IIOResourceManager;
 
-typedef void (* IIOCreateTextureImageFunc) (const char * path, VkImage * image, VkDeviceMemory * imageMemory, VkImageView * imageView);
-typedef void (* IIOCreateTextureImageFromMemoryFunc) (const uint8_t * data, size_t size, VkImage * image, VkDeviceMemory * imageMemory, VkImageView * imageView);
-typedef void (* IIOCreateTextureImageFromPixelsFunc) (const uint8_t * pixels, size_t width, size_t height, VkImage * image, VkDeviceMemory * imageMemory, VkImageView * imageView);
+typedef void (* IIOCreateTextureImageFunc) (const char * path, VkImage * image, IIOAllocation * imageMemory, VkImageView * imageView);
+typedef void (* IIOCreateTextureImageFromMemoryFunc) (const uint8_t * data, size_t size, VkImage * image, IIOAllocation * imageMemory, VkImageView * imageView);
+typedef void (* IIOCreateTextureImageFromPixelsFunc) (const uint8_t * pixels, size_t width, size_t height, VkFormat format, VkComponentMapping components, VkImage * image, IIOAllocation * imageMemory, VkImageView * imageView);
+typedef void (* IIOCreateTextureImageFromCompressedFunc) (const IIOCompressedTexture * texture, VkComponentMapping components, VkImage * image, IIOAllocation * imageMemory, VkImageView * imageView);
 typedef void (* IIOCreateImageSamplerFunc) (const VkSamplerCreateInfo * samplerInfo, VkSampler * sampler);
+typedef void (* IIOFreeMemoryFunc) (IIOAllocation * allocation);
+typedef void (* IIOCreateGeometryBufferFunc) (const void * data, size_t size, VkBufferUsageFlags usage, VkBuffer * buffer, IIOAllocation * bufferMemory);
+//  places a primitive in shared buffers, returns false to have it uploaded with IIOCreateGeometryBufferFunc instead
+typedef bool (* IIOAllocatePooledGeometryFunc) (const void * vertexData, uint32_t vertexCount, uint32_t vertexStride, const void * indexData, uint32_t indexCount, VkIndexType indexType, VkBuffer * vertexBuffer, VkBuffer * indexBuffer, int32_t * vertexOffset, uint32_t * firstIndex);
 
 extern const char * testModelPath;
 
@@ -158,16 +294,100 @@ void iio_set_create_texture_image_from_memory_func(IIOCreateTextureImageFromMemo
 
 void iio_set_create_texture_image_from_pixels_func(IIOCreateTextureImageFromPixelsFunc func);
 
+void iio_set_create_texture_image_from_compressed_func(IIOCreateTextureImageFromCompressedFunc func);
+
 void iio_set_create_image_sampler_func(IIOCreateImageSamplerFunc func);
 
+void iio_set_free_memory_func(IIOFreeMemoryFunc func);
+
+void iio_set_create_geometry_buffer_func(IIOCreateGeometryBufferFunc func);
+
+void iio_set_allocate_pooled_geometry_func(IIOAllocatePooledGeometryFunc func);
+
+//  select before loading models and creating the pipelines that draw them
+void iio_set_vertex_layout(IIOVertexLayout layout);
+
+const IIOVertexFormat * iio_get_vertex_format(IIOVertexLayout layout);
+
+//  0 disables the load time optimization, which is the default
+void iio_set_mesh_optimization(IIOMeshOptimizeFlags flags);
+
+//  enabled by default. Models are baked to IIO_PATH_TO_MESH_CACHE after their first load
+void iio_set_mesh_cache_enabled(bool enabled);
+
+//  enable once the device samples BC4, BC5 and BC7. glTF PNG and JPEG textures are then encoded to the
+//  compressedFormat of their usage on first load and baked to IIO_PATH_TO_MESH_CACHE as KTX2
+void iio_set_texture_compression_enabled(bool enabled);
+
+//  sRGB RGBA only for color. normal maps keep XY and metallic-roughness maps their G and B channels as RG8,
+//  occlusion keeps R as R8. images shared by several linear usages stay RGBA
+IIOTextureFormat iio_select_texture_format(IIOTextureUsageFlags usage);
+
+//  lets primitives with fewer than 256 vertices use VK_INDEX_TYPE_UINT8
+void iio_set_index_type_uint8_supported(bool supported);
+
+//  narrowest index type that can address vertexCount vertices without producing the restart value
+VkIndexType iio_select_index_type(uint32_t vertexCount);
+
+size_t iio_index_type_size(VkIndexType indexType);
+
+//  dst must hold indexCount * iio_index_type_size(indexType) bytes
+void iio_narrow_indices(
+  const uint32_t *                          indices,
+  uint32_t                                  indexCount,
+  VkIndexType                               indexType,
+  void *                                    dst
+);
+
+//  both describe the layout selected with iio_set_vertex_layout
 VkVertexInputBindingDescription iio_get_iiovertex_binding_description();
 
 VkVertexInputAttributeDescription * iio_get_iiovertex_attribute_descriptions(int * count);
 
+//  second binding of instanced pipelines: one mat4 model matrix per instance, as four vec4 columns
+//  at locations IIO_INSTANCE_ATTRIBUTE_LOCATION and up
+VkVertexInputBindingDescription iio_get_instance_binding_description();
+
+VkVertexInputAttributeDescription * iio_get_instance_attribute_descriptions(int * count);
+
+//  dst must hold vertexCount * IIO_PACKED_VERTEX_SIZE bytes
+void iio_pack_vertices(
+  const IIOVertex *                         vertices,
+  uint32_t                                  vertexCount,
+  void *                                    dst
+);
+
 void iio_initialize_default_texture_resources(IIOResourceManager * manager);
 
 void iio_initialize_resource_manager(IIOResourceManager * manager);
 
+//  anisotropy glTF samplers with linear mipmapped minification get, 1 disables it
+void iio_set_max_sampler_anisotropy(float maxAnisotropy);
+
+//  returns the shared sampler for samplerInfo, creating it on first use. every call holds one reference
+VkSampler iio_acquire_sampler(
+  IIOResourceManager *                      manager,
+  const VkSamplerCreateInfo *               samplerInfo
+);
+
+//  drops one reference, the sampler is destroyed with the last one
+void iio_release_sampler(
+  VkDevice                                  device,
+  IIOResourceManager *                      manager,
+  VkSampler                                 sampler
+);
+
+//  destroys every cached sampler regardless of references, for shutdown
+void iio_destroy_samplers(
+  VkDevice                                  device,
+  IIOResourceManager *                      manager
+);
+
+void iio_sampler_create_info_from_gltf(
+  const IIOTextureSampler *                 textureSampler,
+  VkSamplerCreateInfo *                     samplerInfo
+);
+
 void iio_load_model(
   IIOResourceManager *                      manager,
   const char *                              path, 
@@ -189,7 +409,8 @@ void iio_extract_cgltf_vertices(
   cgltf_attribute *                         cgltfAttributes, 
   cgltf_size                                cgltfAttributeCount, 
   IIOVertex **                              pVertices, 
-  uint32_t *                                pVertexCount
+  uint32_t *                                pVertexCount,
+  IIOVertexAttributeFlags *                 pAttributes
 );
 
 void iio_extract_cgltf_primitive(
@@ -197,15 +418,49 @@ void iio_extract_cgltf_primitive(
   IIOPrimitive *                            iioPrimitive
 );
 
+//  optimizes, picks the index width and, with the packed layout selected, packs the vertices of an
+//  extracted primitive
+void iio_finalize_primitive_geometry(
+  IIOPrimitive *                            iioPrimitive,
+  IIOMeshOptimizeStats *                    stats
+);
+
 void iio_extract_cgltf_material(
   cgltf_material *                          cgltfMaterial, 
   IIOMaterial *                             iioMaterial
 );
 
+//  image indices per texture slot: base color, metallic roughness, normal, occlusion, emissive. -1 for none
+void iio_cgltf_material_image_indices(
+  const cgltf_data *                        cgltfData,
+  const cgltf_material *                    cgltfMaterial,
+  int32_t *                                 imageIndices
+);
+
+//  sampler settings per texture slot, in the order of iio_cgltf_material_image_indices
+void iio_cgltf_material_samplers(
+  const cgltf_material *                    cgltfMaterial,
+  IIOTextureSampler *                       textureSamplers
+);
+
+//  adds the usage of every texture slot to the flags of the image it references
+void iio_accumulate_material_image_usages(
+  const int32_t *                           imageIndices,
+  IIOTextureUsageFlags *                    imageUsages
+);
+
+//  samplers per texture slot, NULL or a null handle keeps the sampler of the image
+void iio_bind_material_images(
+  const int32_t *                           imageIndices,
+  const VkSampler *                         samplers,
+  const IIOImageHandle *                    images,
+  IIOMaterial *                             iioMaterial
+);
+
 void iio_extract_cgltf_texture(
   cgltf_texture *                           cgltfTexture, 
   VkImage *                                 image, 
-  VkDeviceMemory *                          imageMemory, 
+  IIOAllocation *                           imageMemory, 
   VkImageView *                             imageView
 );
 
@@ -213,14 +468,24 @@ void iio_destroy_resources(VkDevice device);
 
 void iio_destroy_model(IIOModel * model);
 
+//  drops one reference, the image is destroyed with the last one
 void iio_destroy_image(
   VkDevice                                  device, 
   const char *                              name, 
   IIOResourceManager *                      manager
 );
 
+//  drops the references the model holds on its images and samplers
+void iio_release_model_resources(
+  VkDevice                                  device,
+  IIOModel *                                model,
+  IIOResourceManager *                      manager
+);
+
 void iio_destroy_material(IIOMaterial * material);
 
+void iio_destroy_resource_manager(IIOResourceManager * manager);
+
 void iio_load_test_model();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef IIO_TEXTURE_COMPRESSION_H
+#define IIO_TEXTURE_COMPRESSION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+
+//  block compressed textures: KTX2 and DDS containers holding BC1/BC3/BC4/BC5/BC7 mip chains,
+//  and a CPU encoder producing BC7 for color and BC5 for normal maps
+
+#define IIO_MAX_TEXTURE_LEVELS 16
+
+typedef struct IIOCompressedTextureLevel_S {
+  size_t                                    offset; // into data, a multiple of the block size
+  size_t                                    size;
+} IIOCompressedTextureLevel;
+
+typedef struct IIOCompressedTexture_S {
+  VkFormat                                  format;
+  uint32_t                                  width;
+  uint32_t                                  height;
+  uint32_t                                  levelCount;
+  uint32_t                                  blockSize; // bytes per 4x4 block
+  IIOCompressedTextureLevel                 levels [IIO_MAX_TEXTURE_LEVELS]; // level 0 first
+  uint8_t *                                 data;
+  size_t                                    dataSize;
+} IIOCompressedTexture;
+
+//  bytes per 4x4 block, 0 for formats this module does not handle
+uint32_t iio_compressed_format_block_size(VkFormat format);
+
+//  true when path names a .ktx2 or .dds file
+bool iio_is_compressed_texture_path(
+  const char *                              path);
+
+//  true when bytes start with a KTX2 or DDS identifier
+bool iio_is_compressed_texture_container(
+  const uint8_t *                           bytes,
+  size_t                                    size);
+
+//  parses a KTX2 (without supercompression) or DDS container, the level data is copied into texture
+bool iio_load_compressed_texture_from_memory(
+  const uint8_t *                           bytes,
+  size_t                                    size,
+  IIOCompressedTexture *                    texture);
+
+bool iio_load_compressed_texture(
+  const char *                              path,
+  IIOCompressedTexture *                    texture);
+
+//  writes texture as KTX2 through a temporary file that replaces path once complete
+bool iio_write_ktx2(
+  const char *                              path,
+  const IIOCompressedTexture *              texture);
+
+void iio_free_compressed_texture(
+  IIOCompressedTexture *                    texture);
+
+//  block is 4x4 RGBA8 texels in row order
+void iio_encode_bc7_block(
+  const uint8_t *                           block,
+  uint8_t *                                 out);
+
+//  encodes the red and green channels of the block
+void iio_encode_bc5_block(
+  const uint8_t *                           block,
+  uint8_t *                                 out);
+
+//  builds the full mip chain of the RGBA8 pixels and encodes every level. format is one of the BC7 formats,
+//  VK_FORMAT_BC5_UNORM_BLOCK (red and green) or VK_FORMAT_BC4_UNORM_BLOCK (red). the sRGB BC7 format
+//  filters the chain in linear space
+bool iio_compress_texture_rgba8(
+  const uint8_t *                           pixels,
+  uint32_t                                  width,
+  uint32_t                                  height,
+  VkFormat                                  format,
+  IIOCompressedTexture *                    texture);
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef IIO_UPLOAD_H
+#define IIO_UPLOAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+#include "iio_memory.h"
+
+#define IIO_UPLOAD_BATCH_COUNT 4
+#define IIO_DEFAULT_STAGING_RING_SIZE (32ull * 1024ull * 1024ull)
+
+//  timeline value the upload batch signals when it completes on the GPU. 0 is always complete
+typedef uint64_t IIOUploadTicket;
+
+typedef struct IIOUploadDeferredBuffer_S {
+  IIOUploadTicket                           ticket;
+  VkBuffer                                  buffer;
+  IIOAllocation                             allocation;
+} IIOUploadDeferredBuffer;
+
+#define T vec_UploadDeferred, IIOUploadDeferredBuffer
+#include "stc/vec.h"
+
+//  bytes of the staging ring handed out while recording the batch that signals ticket
+typedef struct IIOStagingRetirement_S {
+  IIOUploadTicket                           ticket;
+  VkDeviceSize                              bytes;
+} IIOStagingRetirement;
+
+#define T deque_StagingRetire, IIOStagingRetirement
+#include "stc/deque.h"
+
+#define T vec_BufferBarrier, VkBufferMemoryBarrier
+#include "stc/vec.h"
+
+#define T vec_ImageBarrier, VkImageMemoryBarrier
+#include "stc/vec.h"
+
+typedef struct IIOStagingRegion_S {
+  VkBuffer                                  buffer;
+  VkDeviceSize                              offset;
+  VkDeviceSize                              size;
+  void *                                    mapped; // already offset to the start of the region
+} IIOStagingRegion;
+
+typedef struct IIOUploadBatch_S {
+  VkCommandBuffer                           commandBuffer;
+  VkCommandBuffer                           acquireCommandBuffer; // only used with a dedicated transfer queue
+  IIOUploadTicket                           ticket; // signaled when the last submission of this buffer retires
+  bool                                      recording;
+} IIOUploadBatch;
+
+typedef struct IIOUploadContext_S {
+  bool                                      isInitialized;
+
+  VkQueue                                   queue;
+  uint32_t                                  queueFamilyIndex;
+  VkCommandPool                             commandPool;
+  VkSemaphore                               timeline;
+
+  //  queue that consumes the uploads. When its family differs from the upload family every resource
+  //  is handed over with a release barrier here and an acquire barrier submitted on dstQueue
+  VkQueue                                   dstQueue;
+  uint32_t                                  dstQueueFamilyIndex;
+  bool                                      ownershipTransfer;
+  VkCommandPool                             acquireCommandPool;
+  VkSemaphore                               transferTimeline; // signaled by the upload queue, waited on by the acquire
+  vec_BufferBarrier                         pendingBufferAcquires;
+  vec_ImageBarrier                          pendingImageAcquires;
+  VkPipelineStageFlags                      pendingAcquireStages;
+
+  IIOUploadBatch                            batches [IIO_UPLOAD_BATCH_COUNT];
+  uint32_t                                  currentBatch;
+  uint32_t                                  recordedCommands; // commands in the batch being recorded
+  IIOUploadTicket                           nextTicket; // value the batch being recorded will signal
+
+  vec_UploadDeferred                        deferredBuffers;
+
+  VkBuffer                                  stagingBuffer;
+  IIOAllocation                             stagingMemory;
+  VkDeviceSize                              stagingSize;
+  VkDeviceSize                              stagingHead; // next write offset
+  VkDeviceSize                              stagingUsed; // bytes not yet retired, including wrap padding
+  deque_StagingRetire                       stagingInFlight; // oldest first
+  uint32_t                                  stagingFallbackCount; // oversized payloads given their own buffer
+} IIOUploadContext;
+
+void iio_create_upload_context(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  uint32_t                                  queueFamilyIndex,
+  VkQueue                                   queue,
+  uint32_t                                  dstQueueFamilyIndex,
+  VkQueue                                   dstQueue,
+  VkDeviceSize                              stagingSize, // 0 selects IIO_DEFAULT_STAGING_RING_SIZE
+  IIOUploadContext *                        context);
+
+void iio_destroy_upload_context(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOUploadContext *                        context);
+
+//  returns the command buffer of the batch being recorded, beginning a new one from the ring if needed
+VkCommandBuffer iio_upload_begin(
+  VkDevice                                  device,
+  IIOUploadContext *                        context);
+
+//  ticket that will be signaled by the batch currently being recorded
+IIOUploadTicket iio_upload_current_ticket(
+  const IIOUploadContext *                  context);
+
+//  destroys the buffer and frees its memory once the current batch has completed
+void iio_upload_defer_buffer_destroy(
+  IIOUploadContext *                        context,
+  VkBuffer                                  buffer,
+  IIOAllocation *                           allocation);
+
+//  reserves staging memory for the batch being recorded and copies data into it when data is not NULL.
+//  payloads larger than half the ring get a temporary buffer that is destroyed with the batch
+void iio_upload_stage(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOUploadContext *                        context,
+  const void *                              data,
+  VkDeviceSize                              size,
+  VkDeviceSize                              alignment,
+  IIOStagingRegion *                        region);
+
+//  makes a buffer written by the batch visible to dstStage on the consumer queue
+void iio_upload_release_buffer(
+  VkDevice                                  device,
+  IIOUploadContext *                        context,
+  VkBuffer                                  buffer,
+  VkAccessFlags                             dstAccessMask,
+  VkPipelineStageFlags                      dstStageMask);
+
+//  moves an image written by the batch from TRANSFER_DST_OPTIMAL to newLayout for dstStage on the consumer queue
+void iio_upload_release_image(
+  VkDevice                                  device,
+  IIOUploadContext *                        context,
+  VkImage                                   image,
+  VkImageSubresourceRange                   subresourceRange,
+  VkImageLayout                             newLayout,
+  VkAccessFlags                             dstAccessMask,
+  VkPipelineStageFlags                      dstStageMask);
+
+//  submits everything recorded so far and returns its ticket
+IIOUploadTicket iio_upload_submit(
+  VkDevice                                  device,
+  IIOUploadContext *                        context);
+
+bool iio_upload_poll(
+  VkDevice                                  device,
+  const IIOUploadContext *                  context,
+  IIOUploadTicket                           ticket);
+
+void iio_upload_wait(
+  VkDevice                                  device,
+  const IIOUploadContext *                  context,
+  IIOUploadTicket                           ticket);
+
+//  releases deferred resources and staging ranges whose batches have completed
+void iio_upload_collect(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOUploadContext *                        context);
+
+#endif
@@ -6,10 +6,18 @@
 #include "iio_eng_typedef.h"
 #include "iio_resource_loaders.h"
 #include "iio_descriptors.h"
+#include "iio_memory.h"
+#include "iio_upload.h"
+#include "iio_bindless.h"
+#include "iio_frame_data.h"
+#include "iio_renderer.h"
+#include "iio_geometry_pool.h"
+#include "iio_gpu_culling.h"
 
 #define DEFAULT_WINDOW_WIDTH 640
 #define DEFAULT_WINDOW_HEIGHT 480
 #define MAX_FRAMES_IN_FLIGHT 2
+#define IIO_VULKAN_API_VERSION VK_MAKE_API_VERSION(0, 1, 3, 0) // requested by the instance, caps the core features used
 
 #define clamp(x, min, max) ((x) < (min) ? (min) : ((x) > (max) ? (max) : (x)))
 #define min(x,y) ((x) < (y) ? (x) : (y))
@@ -20,21 +28,18 @@ typedef struct TestCubeData_S {
 
   Vertex                                    vertices [8];
   VkBuffer                                  vertexBuffer;
-  VkDeviceMemory                            vertexBufferMemory;
+  IIOAllocation                             vertexBufferMemory;
   
   uint32_t                                  indices [36];
+  VkIndexType                               indexType;
   VkBuffer                                  indexBuffer;
-  VkDeviceMemory                            indexBufferMemory;
+  IIOAllocation                             indexBufferMemory;
 
   IIOImageHandle                            textureImage;
   VkDescriptorSet                           texSamplerDescriptorSets [MAX_FRAMES_IN_FLIGHT];
 
   
-  ModelUniformBufferData                    modelUniformBufferData [MAX_FRAMES_IN_FLIGHT];
-  VkBuffer                                  modelUniformBuffer [MAX_FRAMES_IN_FLIGHT];
-  VkDeviceMemory                            modelUniformBufferMemory [MAX_FRAMES_IN_FLIGHT];
-  void *                                    modelUniformBufferMapped [MAX_FRAMES_IN_FLIGHT];
-  VkDescriptorSet                           modelUniformBufferDescriptorSets [MAX_FRAMES_IN_FLIGHT];
+  VkDescriptorSet                           modelDescriptorSet; // dynamic uniform buffer over the frame data ring
 } TestCubeData;
 
 typedef struct DataBuffer_S {
@@ -49,6 +54,9 @@ typedef struct IIOVulkanState_S {
   VkPhysicalDevice * physicalDevices;
   VkPhysicalDevice selectedDevice;
   VkDevice device;
+  IIOMemoryAllocator memoryAllocator;
+  IIOUploadContext uploadContext;
+  IIOFrameDataRing frameDataRing;
   VkSwapchainKHR swapChain;
   uint32_t swapChainImageCount;
   VkImage * swapChainImages;
@@ -58,21 +66,24 @@ typedef struct IIOVulkanState_S {
   VkCommandBuffer * commandBuffers;
 
   VkBuffer globalUniformBuffers [2];
-  VkDeviceMemory globalUniformBuffersMemory [2];
+  IIOAllocation globalUniformBuffersMemory [2];
   void * globalUniformBuffersMapped [2];
   VkDescriptorSet cameraDescriptorSets [2];
+  CameraUniformBufferData cameraData; // as last written, for culling and sorting on the CPU
 
   IIOGraphicsPipelineManager graphicsPipelineManger;
 
   uint32_t descriptorPoolManagerCount;
   IIODescriptorPoolManager * descriptorPoolMangers;
+  IIOFrameDescriptorAllocator frameDescriptorAllocator; // transient camera sets of the application path
+  IIODescriptorTemplateWriter cameraTemplateWriter;
 
   VkSemaphore * imageAvailableSemaphores;
   VkSemaphore * renderFinishedSemaphores;
   VkFence * inFlightFences;
 
   VkImage depthImage;
-  VkDeviceMemory depthImageMemory;
+  IIOAllocation depthImageMemory;
   VkImageView depthImageView;
 
   VkSurfaceFormatKHR surfaceFormat;
@@ -81,17 +92,33 @@ typedef struct IIOVulkanState_S {
   VkExtent2D swapChainImageExtent;
   uint32_t graphicsQueueFamilyIndex;
   uint32_t presentQueueFamilyIndex;
+  uint32_t transferQueueFamilyIndex;
   VkQueue graphicsQueue;
   VkQueue presentQueue;
+  VkQueue transferQueue;
+  bool indexTypeUint8Supported;
+  bool textureCompressionBCSupported;
+  bool bindlessSupported;
+  bool useBindless;
+  bool gpuDrivenSupported;
+  bool useGpuDriven;
+
+  IIOBindlessTable bindlessTable;
+  IIOGpuCulling gpuCulling;
 
   uint32_t currentFrame;
   uint8_t framebufferResized;
 
   IIODescriptorSetWriter descriptorSetWriter;
+  IIODescriptorCache descriptorCache;
 
   IIOResourceManager resourceManager;
 
+  IIOGeometryPool geometryPool; // vertices and indices of the application scene
   IIOModel testModel;
+  VkBuffer materialUniformBuffer; // factors of the descriptor set fallback's materials, one aligned slot each
+  IIOAllocation materialUniformBufferMemory;
+  IIODrawList drawList;
 
 } IIOVulkanState;
 
@@ -109,18 +136,32 @@ void iio_select_physical_device();
 
 void iio_create_device();
 
+void iio_create_memory_allocator_api();
+
+void iio_create_upload_context_api();
+
+void iio_create_frame_data_ring_api();
+
 void iio_create_swapchain();
 
 void iio_create_swapchain_image_views();
 
 void iio_create_application_descriptor_pool_managers();
 
+void iio_create_application_bindless_table();
+
+void iio_create_application_gpu_culling();
+
 void iio_create_descriptor_pool_managers_testcube();
 
 void iio_initialize_testcube();
 
 void iio_initialize_camera();
 
+void iio_initialize_application_scene();
+
+void iio_create_application_material_sets();
+
 void iio_create_application_graphics_pipeline();
 
 void iio_create_graphics_pipeline_testtriangle();
@@ -139,7 +180,7 @@ void iio_create_index_buffer_testcube();
 
 void iio_create_uniform_buffers();
 
-void iio_create_uniform_buffer(VkDevice device, VkDeviceSize bufferSize, VkBuffer * buffer, VkDeviceMemory * bufferMemory, void ** bufferMapped);
+void iio_create_uniform_buffer(VkDevice device, VkDeviceSize bufferSize, VkBuffer * buffer, IIOAllocation * bufferMemory, void ** bufferMapped);
 
 void iio_create_descriptor_pool_api();
 
@@ -151,14 +192,22 @@ void iio_create_synchronization_objects();
 
 void iio_initialize_resource_loader();
 
-void iio_create_texture_image_func(const char * path, VkImage * image, VkDeviceMemory * imageMemory, VkImageView * imageView);
+void iio_create_texture_image_func(const char * path, VkImage * image, IIOAllocation * imageMemory, VkImageView * imageView);
+
+void iio_create_texture_image_from_memory_func(const uint8_t * data, size_t dataSize, VkImage * image, IIOAllocation * imageMemory, VkImageView * imageView);
 
-void iio_create_texture_image_from_memory_func(const uint8_t * data, size_t dataSize, VkImage * image, VkDeviceMemory * imageMemory, VkImageView * imageView);
+void iio_create_texture_image_from_pixels_func(const uint8_t * pixels, size_t width, size_t height, VkFormat format, VkComponentMapping components, VkImage * image, IIOAllocation * imageMemory, VkImageView * imageView);
 
-void iio_create_texture_image_from_pixels_func(const uint8_t * pixels, size_t width, size_t height, VkImage * image, VkDeviceMemory * imageMemory, VkImageView * imageView);
+void iio_create_texture_image_from_compressed_func(const IIOCompressedTexture * texture, VkComponentMapping components, VkImage * image, IIOAllocation * imageMemory, VkImageView * imageView);
 
 void iio_create_image_sampler_func(const VkSamplerCreateInfo * createInfo, VkSampler * sampler);
 
+void iio_free_memory_func(IIOAllocation * allocation);
+
+bool iio_allocate_pooled_geometry_func(const void * vertexData, uint32_t vertexCount, uint32_t vertexStride, const void * indexData, uint32_t indexCount, VkIndexType indexType, VkBuffer * vertexBuffer, VkBuffer * indexBuffer, int32_t * vertexOffset, uint32_t * firstIndex);
+
+void iio_create_geometry_buffer_func(const void * data, size_t size, VkBufferUsageFlags usage, VkBuffer * buffer, IIOAllocation * bufferMemory);
+
 DataBuffer * iio_read_shader_file_to_buffer(const char * path);
 
 VkShaderModule iio_create_shader_module(const DataBuffer * shaderCode);
@@ -170,6 +219,7 @@ void iio_select_physical_device_properties (
   VkSurfaceCapabilitiesKHR * surfaceCapabilities,
   uint32_t * graphicsQueueIndex,
   uint32_t * presentQueueIndex,
+  uint32_t * transferQueueIndex,
   VkPhysicalDeviceType * deviceType
 );
 
@@ -184,10 +234,12 @@ void iio_create_buffer(
   VkBufferUsageFlags usage,
   VkMemoryPropertyFlags properties,
   VkBuffer * buffer,
-  VkDeviceMemory * bufferMemory
+  IIOAllocation * bufferMemory
 );
 
-void iio_copy_buffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+void iio_copy_buffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize size);
+
+void iio_upload_buffer_data(const void * data, VkDeviceSize size, VkBuffer dstBuffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
 
 VkCommandBuffer iio_begin_single_time_commands();
 
@@ -195,36 +247,49 @@ void iio_end_single_time_commands(VkCommandBuffer commandBuffer);
 
 void iio_update_camera_uniform_buffer(uint32_t currentFrame);
 
-void iio_create_texture_image(const char * path, VkImage * textureImage, VkDeviceMemory * textureImageMemory);
+void iio_create_texture_image(const char * path, VkImage * textureImage, IIOAllocation * textureImageMemory, uint32_t * mipLevels);
 
-void iio_create_texture_image_from_memory(const uint8_t * data, int size, VkImage * textureImage, VkDeviceMemory * textureImageMemory);
+void iio_create_texture_image_from_memory(const uint8_t * data, int size, VkImage * textureImage, IIOAllocation * textureImageMemory, uint32_t * mipLevels);
 
-void iio_create_texture_image_from_pixels(const uint8_t * pixels, int width, int height, VkImage * textureImage, VkDeviceMemory * textureImageMemory);
+//  uploads pixels with a full mip chain and returns its level count in mipLevels.
+//  format is VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM or one of the R8G8B8A8 formats, pixels are packed to match
+void iio_create_texture_image_from_pixels(const uint8_t * pixels, int width, int height, VkFormat format, VkImage * textureImage, IIOAllocation * textureImageMemory, uint32_t * mipLevels);
 
-void iio_create_texture_image_view(VkImage textureImage, VkImageView * textureImageView);
+//  true when format can be uploaded to and sampled with linear filtering from optimal tiling images
+bool iio_texture_format_supported(VkFormat format);
+
+//  uploads every level of a block compressed texture, textureImage is VK_NULL_HANDLE when the device can not sample its format
+void iio_create_texture_image_from_compressed(const IIOCompressedTexture * texture, VkImage * textureImage, IIOAllocation * textureImageMemory);
+
+//  records blits filling levels 1..mipLevels-1 from level 0 and leaves every level in SHADER_READ_ONLY_OPTIMAL.
+//  all levels have to be in TRANSFER_DST_OPTIMAL, needs a graphics capable upload queue
+void iio_generate_mipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels);
+
+void iio_create_texture_image_view(VkImage textureImage, VkImageView * textureImageView, VkFormat format, VkComponentMapping components, uint32_t mipLevels);
 
 void iio_create_texture_sampler(VkSampler * textureSampler);
 
 void iio_create_image(
   uint32_t width,
   uint32_t height,
+  uint32_t mipLevels,
   VkImage * textureImage,
-  VkDeviceMemory * textureImageMemory,
+  IIOAllocation * textureImageMemory,
   VkFormat format,
   VkImageTiling tiling,
   VkImageUsageFlags usage,
   VkMemoryPropertyFlags properties
 );
 
-void iio_create_image_view(VkImage image, VkImageView * imageView, VkFormat format, VkImageAspectFlags aspectMask);
+void iio_create_image_view(VkImage image, VkImageView * imageView, VkFormat format, VkImageAspectFlags aspectMask, uint32_t mipLevels);
 
 void iio_create_image_sampler(VkSampler * textureSampler);
 
-void iio_transition_image_layout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
+void iio_transition_image_layout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
 
 VkFormat iio_find_supported_format(const VkFormat * candidates, uint32_t count, VkImageTiling tiling, VkFormatFeatureFlags features);
 
-void iio_copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+void iio_copy_buffer_to_image(VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, uint32_t mipLevel, uint32_t width, uint32_t height);
 
 void iio_framebuffer_size_callback(GLFWwindow * window, int width, int height);
 
@@ -246,12 +311,13 @@ void iio_record_testtriangle_command_buffer(VkCommandBuffer commandBuffer, uint3
 
 void iio_record_testcube_command_buffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame);
 
-void iio_record_primitive_command_buffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame, IIOPrimitive * primitive);
 
 void iio_recreate_swapchain();
 
 void iio_cleanup();
 
+void iio_destroy_application_scene();
+
 void iio_cleanup_device();
 
 void iio_cleanup_swapchain();
@@ -0,0 +1,415 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+#include "iio_bindless.h"
+#include "iio_mesh_cache.h"
+#include "iio_eng_errors.h"
+
+/*****************************
+ *      slot bookkeeping     *
+ *****************************/
+
+static uint64_t iio_bindless_handle_key(
+  const void *                              handle,
+  size_t                                    size)
+
+{
+  uint64_t key = 0;
+  memcpy(&key, handle, size);
+  return key;
+}
+
+static void iio_bindless_slots_init(
+  IIOBindlessSlots *                        slots,
+  uint32_t                                  capacity)
+
+{
+  memset(slots, 0, sizeof(IIOBindlessSlots));
+  slots->capacity = capacity;
+  slots->refCounts = calloc(capacity, sizeof(uint32_t));
+  slots->keys = calloc(capacity, sizeof(uint64_t));
+  slots->lookup = hmap_BindlessSlot_init();
+  slots->freed = deque_BindlessFree_init();
+}
+
+static void iio_bindless_slots_drop(
+  IIOBindlessSlots *                        slots)
+
+{
+  free(slots->refCounts);
+  free(slots->keys);
+  hmap_BindlessSlot_drop(&slots->lookup);
+  deque_BindlessFree_drop(&slots->freed);
+  memset(slots, 0, sizeof(IIOBindlessSlots));
+}
+
+static uint32_t iio_bindless_slots_find(
+  const IIOBindlessSlots *                  slots,
+  uint64_t                                  key)
+
+{
+  const hmap_BindlessSlot_value * entry = hmap_BindlessSlot_get(&slots->lookup, key);
+  return entry ? entry->second : IIO_BINDLESS_INVALID_INDEX;
+}
+
+//  prefers a retired slot over growing the written range, the caller fills the slot
+static uint32_t iio_bindless_slots_allocate(
+  IIOBindlessSlots *                        slots,
+  uint64_t                                  key,
+  uint64_t                                  frame,
+  uint32_t                                  framesInFlight)
+
+{
+  uint32_t index = IIO_BINDLESS_INVALID_INDEX;
+  if (!deque_BindlessFree_is_empty(&slots->freed) && deque_BindlessFree_front(&slots->freed)->frame + framesInFlight <= frame) {
+    index = deque_BindlessFree_front(&slots->freed)->index;
+    deque_BindlessFree_pop_front(&slots->freed);
+  } else if (slots->highWater < slots->capacity) {
+    index = slots->highWater++;
+  } else {
+    return IIO_BINDLESS_INVALID_INDEX;
+  }
+
+  slots->refCounts[index] = 1;
+  slots->keys[index] = key;
+  //  a material hash collision keeps the existing lookup entry, the new slot is just not shared
+  hmap_BindlessSlot_insert(&slots->lookup, key, index);
+  return index;
+}
+
+//  true when the last reference was dropped
+static bool iio_bindless_slots_release(
+  IIOBindlessSlots *                        slots,
+  uint32_t                                  index,
+  uint64_t                                  frame)
+
+{
+  if (index >= slots->highWater || slots->refCounts[index] == 0) {
+    fprintf(stderr, "Tried to release unused bindless slot %u\n", index);
+    return false;
+  }
+  if (--slots->refCounts[index] > 0) return false;
+
+  hmap_BindlessSlot_iter it = hmap_BindlessSlot_find(&slots->lookup, slots->keys[index]);
+  if (it.ref && it.ref->second == index) {
+    hmap_BindlessSlot_erase_at(&slots->lookup, it);
+  }
+  deque_BindlessFree_push_back(&slots->freed, (IIOBindlessFreeSlot) {.index = index, .frame = frame});
+  return true;
+}
+
+/*****************************
+ *       table lifetime      *
+ *****************************/
+
+void iio_create_bindless_table(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  uint32_t                                  textureCapacity,
+  uint32_t                                  samplerCapacity,
+  uint32_t                                  materialCapacity,
+  uint32_t                                  framesInFlight,
+  IIOBindlessTable *                        table)
+
+{
+  memset(table, 0, sizeof(IIOBindlessTable));
+  if (!textureCapacity || !samplerCapacity || !materialCapacity) {
+    fprintf(stderr, "Tried to create a bindless table with a zero capacity\n");
+    return;
+  }
+
+  //  the arrays are written while in flight command buffers use other elements of them
+  const VkDescriptorBindingFlags arrayFlags =
+    VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+    VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+    VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+  IIODescriptorLayoutElement elements [iio_bindless_binding_count] = {
+    [iio_bindless_binding_textures] = {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, textureCapacity, VK_SHADER_STAGE_FRAGMENT_BIT, arrayFlags},
+    [iio_bindless_binding_samplers] = {VK_DESCRIPTOR_TYPE_SAMPLER, samplerCapacity, VK_SHADER_STAGE_FRAGMENT_BIT, arrayFlags},
+    [iio_bindless_binding_materials] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 0},
+  };
+  iio_create_descriptor_pool_manager(device, iio_bindless_binding_count, elements, framesInFlight, 1, &table->poolManager);
+  if (!table->poolManager.isInitialized) {
+    fprintf(stderr, "Failed to create the bindless descriptor pool manager\n");
+    return;
+  }
+
+  table->descriptorSet = iio_allocate_descriptor_set(device, &table->poolManager);
+  if (table->descriptorSet == VK_NULL_HANDLE) {
+    fprintf(stderr, "Failed to allocate the bindless descriptor set\n");
+    iio_destroy_descriptor_pool_manager(device, &table->poolManager);
+    return;
+  }
+
+  VkDeviceSize materialBufferSize = (VkDeviceSize) materialCapacity * sizeof(MaterialUniformBufferData);
+
+  VkBufferCreateInfo bufferCreateInfo = {0};
+  bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCreateInfo.size = materialBufferSize;
+  bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  VkResult result = vkCreateBuffer(device, &bufferCreateInfo, NULL, &table->materialBuffer);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+  result = iio_allocate_buffer_memory(
+    device, allocator, table->materialBuffer,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    &table->materialBufferMemory
+  );
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+  table->materialData = table->materialBufferMemory.mapped;
+
+  iio_create_descriptor_set_writer(&table->writer);
+  iio_write_buffer_descriptor(
+    iio_bindless_binding_materials, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    table->materialBuffer, 0, (uint32_t) materialBufferSize, &table->writer
+  );
+  iio_update_set(device, table->descriptorSet, &table->writer);
+
+  iio_bindless_slots_init(&table->textures, textureCapacity);
+  iio_bindless_slots_init(&table->samplers, samplerCapacity);
+  iio_bindless_slots_init(&table->materials, materialCapacity);
+  table->framesInFlight = framesInFlight;
+  table->isInitialized = true;
+}
+
+void iio_destroy_bindless_table(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOBindlessTable *                        table)
+
+{
+  if (!table->isInitialized) return;
+
+  if (table->materialBuffer) vkDestroyBuffer(device, table->materialBuffer, NULL);
+  iio_free_memory(device, allocator, &table->materialBufferMemory);
+  iio_destroy_descriptor_set_writer(&table->writer);
+  iio_destroy_descriptor_pool_manager(device, &table->poolManager);
+  iio_bindless_slots_drop(&table->textures);
+  iio_bindless_slots_drop(&table->samplers);
+  iio_bindless_slots_drop(&table->materials);
+  memset(table, 0, sizeof(IIOBindlessTable));
+}
+
+void iio_bindless_begin_frame(
+  IIOBindlessTable *                        table)
+
+{
+  table->frame++;
+}
+
+/*****************************
+ *     textures, samplers    *
+ *****************************/
+
+uint32_t iio_bindless_acquire_texture(
+  VkDevice                                  device,
+  IIOBindlessTable *                        table,
+  VkImageView                               view)
+
+{
+  uint64_t key = iio_bindless_handle_key(&view, sizeof(view));
+  uint32_t index = iio_bindless_slots_find(&table->textures, key);
+  if (index != IIO_BINDLESS_INVALID_INDEX) {
+    table->textures.refCounts[index]++;
+    return index;
+  }
+
+  index = iio_bindless_slots_allocate(&table->textures, key, table->frame, table->framesInFlight);
+  if (index == IIO_BINDLESS_INVALID_INDEX) {
+    fprintf(stderr, "Bindless texture array is full (%u textures)\n", table->textures.capacity);
+    return index;
+  }
+  iio_write_image_array_descriptor(
+    iio_bindless_binding_textures, index, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+    VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, &table->writer
+  );
+  iio_update_set(device, table->descriptorSet, &table->writer);
+  return index;
+}
+
+void iio_bindless_release_texture(
+  IIOBindlessTable *                        table,
+  uint32_t                                  index)
+
+{
+  iio_bindless_slots_release(&table->textures, index, table->frame);
+}
+
+uint32_t iio_bindless_acquire_sampler(
+  VkDevice                                  device,
+  IIOBindlessTable *                        table,
+  VkSampler                                 sampler)
+
+{
+  uint64_t key = iio_bindless_handle_key(&sampler, sizeof(sampler));
+  uint32_t index = iio_bindless_slots_find(&table->samplers, key);
+  if (index != IIO_BINDLESS_INVALID_INDEX) {
+    table->samplers.refCounts[index]++;
+    return index;
+  }
+
+  index = iio_bindless_slots_allocate(&table->samplers, key, table->frame, table->framesInFlight);
+  if (index == IIO_BINDLESS_INVALID_INDEX) {
+    fprintf(stderr, "Bindless sampler array is full (%u samplers)\n", table->samplers.capacity);
+    return index;
+  }
+  iio_write_image_array_descriptor(
+    iio_bindless_binding_samplers, index, VK_DESCRIPTOR_TYPE_SAMPLER,
+    sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED, &table->writer
+  );
+  iio_update_set(device, table->descriptorSet, &table->writer);
+  return index;
+}
+
+void iio_bindless_release_sampler(
+  IIOBindlessTable *                        table,
+  uint32_t                                  index)
+
+{
+  iio_bindless_slots_release(&table->samplers, index, table->frame);
+}
+
+/*****************************
+ *         materials         *
+ *****************************/
+
+static void iio_bindless_release_material_references(
+  IIOBindlessTable *                        table,
+  const MaterialUniformBufferData *         data,
+  int                                       count)
+
+{
+  for (int i = 0; i < count; i++) {
+    iio_bindless_release_texture(table, data->textureIndices[i]);
+    iio_bindless_release_sampler(table, data->samplerIndices[i]);
+  }
+}
+
+void iio_material_uniform_data(
+  const IIOMaterial *                       material,
+  MaterialUniformBufferData *               data)
+
+{
+  //  zeroed padding keeps identical materials byte identical
+  memset(data, 0, sizeof(MaterialUniformBufferData));
+  glm_vec4_copy((float *) material->pbrMetallicRoughness.baseColorFactor, data->baseColorFactor);
+  glm_vec3_copy((float *) material->emissiveFactor, data->emissiveFactor);
+  data->metallicRoughnessNormalOcclusionScale[0] = material->pbrMetallicRoughness.metallicFactor;
+  data->metallicRoughnessNormalOcclusionScale[1] = material->pbrMetallicRoughness.roughnessFactor;
+  data->metallicRoughnessNormalOcclusionScale[2] = material->normalTexture.scale;
+  data->metallicRoughnessNormalOcclusionScale[3] = material->occlusionTexture.strength;
+  data->alphaCutoff = material->alphaMode == GLTF_AM_MASK ? material->alphaCutoff : 0.0f;
+  data->texCoordIndex = (int) material->pbrMetallicRoughness.baseColorTextureInfo.texCoord;
+}
+
+//  packs material into the storage buffer layout, acquiring a reference to every texture and sampler
+static bool iio_bindless_material_data(
+  VkDevice                                  device,
+  IIOBindlessTable *                        table,
+  const IIOMaterial *                       material,
+  MaterialUniformBufferData *               data)
+
+{
+  iio_material_uniform_data(material, data);
+
+  const IIOTextureInfo * infos [IIO_MATERIAL_TEXTURE_COUNT] = {
+    &material->pbrMetallicRoughness.baseColorTextureInfo,
+    &material->pbrMetallicRoughness.metallicRoughnessTextureInfo,
+    &material->normalTexture.textureInfo,
+    &material->occlusionTexture.textureInfo,
+    &material->emissiveTexture,
+  };
+
+  for (int i = 0; i < IIO_MATERIAL_TEXTURE_COUNT; i++) {
+    data->textureIndices[i] = iio_bindless_acquire_texture(device, table, infos[i]->imageView);
+    data->samplerIndices[i] = iio_bindless_acquire_sampler(device, table, infos[i]->sampler);
+    if (data->textureIndices[i] == IIO_BINDLESS_INVALID_INDEX || data->samplerIndices[i] == IIO_BINDLESS_INVALID_INDEX) {
+      if (data->textureIndices[i] != IIO_BINDLESS_INVALID_INDEX) iio_bindless_release_texture(table, data->textureIndices[i]);
+      if (data->samplerIndices[i] != IIO_BINDLESS_INVALID_INDEX) iio_bindless_release_sampler(table, data->samplerIndices[i]);
+      iio_bindless_release_material_references(table, data, i);
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t iio_bindless_acquire_material(
+  VkDevice                                  device,
+  IIOBindlessTable *                        table,
+  const IIOMaterial *                       material)
+
+{
+  MaterialUniformBufferData data;
+  if (!iio_bindless_material_data(device, table, material, &data)) {
+    return IIO_BINDLESS_INVALID_INDEX;
+  }
+
+  uint64_t key = iio_hash_bytes((const uint8_t *) &data, sizeof(data));
+  uint32_t index = iio_bindless_slots_find(&table->materials, key);
+  if (index != IIO_BINDLESS_INVALID_INDEX && memcmp(&table->materialData[index], &data, sizeof(data)) == 0) {
+    //  the shared slot already holds references to the same textures and samplers
+    table->materials.refCounts[index]++;
+    iio_bindless_release_material_references(table, &data, IIO_MATERIAL_TEXTURE_COUNT);
+    return index;
+  }
+
+  index = iio_bindless_slots_allocate(&table->materials, key, table->frame, table->framesInFlight);
+  if (index == IIO_BINDLESS_INVALID_INDEX) {
+    fprintf(stderr, "Bindless material buffer is full (%u materials)\n", table->materials.capacity);
+    iio_bindless_release_material_references(table, &data, IIO_MATERIAL_TEXTURE_COUNT);
+    return index;
+  }
+  memcpy(&table->materialData[index], &data, sizeof(data));
+  return index;
+}
+
+void iio_bindless_release_material(
+  IIOBindlessTable *                        table,
+  uint32_t                                  index)
+
+{
+  if (iio_bindless_slots_release(&table->materials, index, table->frame)) {
+    iio_bindless_release_material_references(table, &table->materialData[index], IIO_MATERIAL_TEXTURE_COUNT);
+  }
+}
+
+void iio_bindless_acquire_model_materials(
+  VkDevice                                  device,
+  IIOBindlessTable *                        table,
+  IIOModel *                                model)
+
+{
+  for (uint32_t m = 0; m < model->meshCount; m++) {
+    IIOMesh * mesh = &model->meshes[m];
+    for (uint32_t p = 0; p < mesh->primitiveCount; p++) {
+      IIOMaterial * material = &mesh->primitives[p].material;
+      if (material->bindlessIndex != IIO_BINDLESS_INVALID_INDEX) continue;
+      material->bindlessIndex = iio_bindless_acquire_material(device, table, material);
+    }
+  }
+}
+
+void iio_bindless_release_model_materials(
+  IIOBindlessTable *                        table,
+  IIOModel *                                model)
+
+{
+  for (uint32_t m = 0; m < model->meshCount; m++) {
+    IIOMesh * mesh = &model->meshes[m];
+    for (uint32_t p = 0; p < mesh->primitiveCount; p++) {
+      IIOMaterial * material = &mesh->primitives[p].material;
+      if (material->bindlessIndex == IIO_BINDLESS_INVALID_INDEX) continue;
+      iio_bindless_release_material(table, material->bindlessIndex);
+      material->bindlessIndex = IIO_BINDLESS_INVALID_INDEX;
+    }
+  }
+}
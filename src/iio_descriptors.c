@@ -60,6 +60,8 @@ void iio_create_descriptor_pool_manager(
     return;
   }
 
+  iio_create_descriptor_update_template(device, manager);
+
   //  Create the initial descriptor pool and push it to the deque
   VkDescriptorPool pool = iio_create_descriptor_pool(device, manager);
   if (pool == VK_NULL_HANDLE) {
@@ -70,6 +72,19 @@ void iio_create_descriptor_pool_manager(
   deque_Pool_push_back(&manager->readyPools, pool);
 }
 
+//  update after bind bindings need their layout and pools created with the matching flags
+static bool iio_descriptor_pool_manager_updates_after_bind(
+  const IIODescriptorPoolManager * manager)
+
+{
+  for (size_t i = 0; i < vec_DLE_size(&manager->iioDescriptorLayoutElements); i++) {
+    if (vec_DLE_at(&manager->iioDescriptorLayoutElements, i)->bindingFlags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void iio_create_descriptor_set_layout(
   VkDevice                        device, 
   IIODescriptorPoolManager *      manager) 
@@ -89,6 +104,8 @@ void iio_create_descriptor_set_layout(
   //  Create the descriptor set layout based on the iioDescriptorLayoutElements vector
   size_t ratioCount = vec_DLE_size(&manager->iioDescriptorLayoutElements);
   VkDescriptorSetLayoutBinding bindings [ratioCount];
+  VkDescriptorBindingFlags bindingFlags [ratioCount];
+  bool anyBindingFlags = false;
   for (size_t i = 0; i < ratioCount; i++) {
     const IIODescriptorLayoutElement * elem = vec_DLE_at(&manager->iioDescriptorLayoutElements, i);
     bindings[i].binding = (uint32_t) i;
@@ -96,12 +113,20 @@ void iio_create_descriptor_set_layout(
     bindings[i].descriptorCount = elem->count;
     bindings[i].stageFlags = elem->stageFlags;
     bindings[i].pImmutableSamplers = NULL; // No immutable samplers for now
+    bindingFlags[i] = elem->bindingFlags;
+    anyBindingFlags |= elem->bindingFlags != 0;
   }
 
+  //  Descriptor indexing flags are only chained when a binding asks for them
+  VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo = {0};
+  bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  bindingFlagsCreateInfo.bindingCount = (uint32_t) ratioCount;
+  bindingFlagsCreateInfo.pBindingFlags = bindingFlags;
+
   VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {0};
   layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-  layoutCreateInfo.pNext = NULL;
-  layoutCreateInfo.flags = 0;
+  layoutCreateInfo.pNext = anyBindingFlags ? &bindingFlagsCreateInfo : NULL;
+  layoutCreateInfo.flags = iio_descriptor_pool_manager_updates_after_bind(manager) ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0;
   layoutCreateInfo.bindingCount = (uint32_t) ratioCount;
   layoutCreateInfo.pBindings = bindings;
 
@@ -112,10 +137,94 @@ void iio_create_descriptor_set_layout(
   }
 }
 
-VkDescriptorPool iio_create_descriptor_pool(
-  VkDevice                        device, 
-  IIODescriptorPoolManager *      manager) 
-  
+static size_t iio_descriptor_info_size(
+  VkDescriptorType                type)
+
+{
+  switch (type) {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+      return sizeof(VkDescriptorImageInfo);
+    case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+    case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+      return sizeof(VkBufferView);
+    default:
+      return sizeof(VkDescriptorBufferInfo);
+  }
+}
+
+static IIOWriterType iio_descriptor_writer_type(
+  VkDescriptorType                type)
+
+{
+  switch (type) {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+      return iio_writer_type_image;
+    default:
+      return iio_writer_type_buffer;
+  }
+}
+
+//  one template entry per binding, each binding's infos packed after the previous binding's
+void iio_create_descriptor_update_template(
+  VkDevice                        device,
+  IIODescriptorPoolManager *      manager)
+
+{
+  size_t elementCount = vec_DLE_size(&manager->iioDescriptorLayoutElements);
+  VkDescriptorUpdateTemplateEntry entries [elementCount];
+  manager->templateOffsets = malloc(sizeof(size_t) * elementCount);
+  manager->templateDataSize = 0;
+  for (size_t i = 0; i < elementCount; i++) {
+    const IIODescriptorLayoutElement * elem = vec_DLE_at(&manager->iioDescriptorLayoutElements, i);
+    //  a template writes every element, which partially bound arrays are not meant to have
+    if (elem->bindingFlags & VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT) {
+      free(manager->templateOffsets);
+      manager->templateOffsets = NULL;
+      manager->templateDataSize = 0;
+      return;
+    }
+    size_t infoSize = iio_descriptor_info_size(elem->type);
+    entries[i].dstBinding = (uint32_t) i;
+    entries[i].dstArrayElement = 0;
+    entries[i].descriptorCount = elem->count;
+    entries[i].descriptorType = elem->type;
+    entries[i].offset = manager->templateDataSize;
+    entries[i].stride = infoSize;
+    manager->templateOffsets[i] = manager->templateDataSize;
+    manager->templateDataSize += infoSize * elem->count;
+  }
+
+  VkDescriptorUpdateTemplateCreateInfo templateCreateInfo = {0};
+  templateCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+  templateCreateInfo.pNext = NULL;
+  templateCreateInfo.flags = 0;
+  templateCreateInfo.descriptorUpdateEntryCount = (uint32_t) elementCount;
+  templateCreateInfo.pDescriptorUpdateEntries = entries;
+  templateCreateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+  templateCreateInfo.descriptorSetLayout = manager->descriptorSetLayout;
+
+  VkResult result = vkCreateDescriptorUpdateTemplate(device, &templateCreateInfo, NULL, &manager->updateTemplate);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    fprintf(stderr, "Failed to create descriptor update template, falling back to descriptor writes\n");
+    manager->updateTemplate = VK_NULL_HANDLE;
+  }
+}
+
+//  pool for setCount sets of the manager's layout
+static VkDescriptorPool iio_create_sized_descriptor_pool(
+  VkDevice                        device,
+  IIODescriptorPoolManager *      manager,
+  size_t                          setCount)
+
 {
   VkDescriptorPool newPool = {0};
   if (!device) {
@@ -148,7 +257,7 @@ VkDescriptorPool iio_create_descriptor_pool(
   size_t i = 0;
   for (c_each_kv(key, value, hmap_Di, poolRatios)) {
     poolSizes[i].type = *key;
-    poolSizes[i].descriptorCount = (uint32_t) *value * manager->setsPerPool;
+    poolSizes[i].descriptorCount = (uint32_t) (*value * setCount);
     i++;
   }
 
@@ -156,8 +265,8 @@ VkDescriptorPool iio_create_descriptor_pool(
   VkDescriptorPoolCreateInfo poolCreateInfo = {0};
   poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   poolCreateInfo.pNext = NULL;
-  poolCreateInfo.flags = 0;
-  poolCreateInfo.maxSets = (uint32_t) (manager->setsPerPool);
+  poolCreateInfo.flags = iio_descriptor_pool_manager_updates_after_bind(manager) ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0;
+  poolCreateInfo.maxSets = (uint32_t) setCount;
   poolCreateInfo.poolSizeCount = (uint32_t) poolSizeCount;
   poolCreateInfo.pPoolSizes = poolSizes;
 
@@ -167,13 +276,21 @@ VkDescriptorPool iio_create_descriptor_pool(
     fprintf(stderr, "Failed to create descriptor pool\n");
   }
 
-  manager->setsPerPool = manager->setsPerPool * 2 > IIO_MAX_SETS ? IIO_MAX_SETS : manager->setsPerPool * 2;
-
   hmap_Di_drop(&poolRatios);
 
   return newPool;
 }
 
+VkDescriptorPool iio_create_descriptor_pool(
+  VkDevice                        device, 
+  IIODescriptorPoolManager *      manager) 
+  
+{
+  VkDescriptorPool newPool = iio_create_sized_descriptor_pool(device, manager, manager->setsPerPool);
+  manager->setsPerPool = manager->setsPerPool * 2 > IIO_MAX_SETS ? IIO_MAX_SETS : manager->setsPerPool * 2;
+  return newPool;
+}
+
 VkDescriptorPool iio_get_descriptor_pool(
   VkDevice                        device, 
   IIODescriptorPoolManager *      manager) 
@@ -289,6 +406,10 @@ void iio_destroy_descriptor_pool_manager(
   vec_DLE_drop(&manager->iioDescriptorLayoutElements);
   deque_Pool_drop(&manager->readyPools);
   deque_Pool_drop(&manager->usedPools);
+  if (manager->updateTemplate != VK_NULL_HANDLE) {
+    vkDestroyDescriptorUpdateTemplate(device, manager->updateTemplate, NULL);
+  }
+  free(manager->templateOffsets);
   if (manager->descriptorSetLayout != VK_NULL_HANDLE) {
     vkDestroyDescriptorSetLayout(device, manager->descriptorSetLayout, NULL);
   }
@@ -296,6 +417,133 @@ void iio_destroy_descriptor_pool_manager(
   memset(manager, 0, sizeof(IIODescriptorPoolManager));
 }
 
+/*******************************************
+ * per frame descriptor allocator functions *
+ ********************************************/
+
+void iio_create_frame_descriptor_allocator(
+  IIODescriptorPoolManager *      manager,
+  size_t                          framesInFlight,
+  size_t                          initialSetCount,
+  IIOFrameDescriptorAllocator *   allocator)
+
+{
+  if (!manager || !manager->isInitialized) {
+    fprintf(stderr, "Tried to create frame descriptor allocator with an uninitialized manager\n");
+    return;
+  } else if (!framesInFlight || !initialSetCount) {
+    fprintf(stderr, "Tried to create frame descriptor allocator with zero frames or zero initial set count\n");
+    return;
+  } else if (!allocator) {
+    fprintf(stderr, "Tried to return to a NULL IIOFrameDescriptorAllocator pointer\n");
+    return;
+  }
+
+  memset(allocator, 0, sizeof(IIOFrameDescriptorAllocator));
+  allocator->isInitialized = true;
+  allocator->manager = manager;
+  allocator->setsPerPool = initialSetCount > IIO_MAX_SETS ? IIO_MAX_SETS : initialSetCount;
+  allocator->frameCount = (uint32_t) framesInFlight;
+  allocator->frames = calloc(framesInFlight, sizeof(IIODescriptorFrame));
+  for (size_t i = 0; i < framesInFlight; i++) {
+    allocator->frames[i].pools = vec_SizedPool_init();
+  }
+
+  //  a batch never spans more than one pool, so IIO_MAX_SETS layouts cover every vkAllocateDescriptorSets call
+  allocator->layouts = malloc(sizeof(VkDescriptorSetLayout) * IIO_MAX_SETS);
+  for (size_t i = 0; i < IIO_MAX_SETS; i++) {
+    allocator->layouts[i] = manager->descriptorSetLayout;
+  }
+}
+
+void iio_reset_frame_descriptor_allocator(
+  VkDevice                        device,
+  IIOFrameDescriptorAllocator *   allocator,
+  uint32_t                        frameIndex)
+
+{
+  IIODescriptorFrame * frame = &allocator->frames[frameIndex];
+  for (c_each(it, vec_SizedPool, frame->pools)) {
+    vkResetDescriptorPool(device, it.ref->pool, 0);
+  }
+  frame->currentPool = 0;
+  frame->currentPoolUsed = 0;
+}
+
+VkResult iio_allocate_frame_descriptor_sets(
+  VkDevice                        device,
+  IIOFrameDescriptorAllocator *   allocator,
+  uint32_t                        frameIndex,
+  uint32_t                        count,
+  VkDescriptorSet *               descriptorSets)
+
+{
+  IIODescriptorFrame * frame = &allocator->frames[frameIndex];
+  uint32_t allocated = 0;
+  while (allocated < count) {
+    //  every pool of the frame is full, add a bigger one
+    if (frame->currentPool == vec_SizedPool_size(&frame->pools)) {
+      IIOSizedDescriptorPool sizedPool = {
+        .pool = iio_create_sized_descriptor_pool(device, allocator->manager, allocator->setsPerPool),
+        .setCount = (uint32_t) allocator->setsPerPool,
+      };
+      if (sizedPool.pool == VK_NULL_HANDLE) {
+        return VK_ERROR_OUT_OF_POOL_MEMORY;
+      }
+      vec_SizedPool_push(&frame->pools, sizedPool);
+      allocator->setsPerPool = allocator->setsPerPool * 2 > IIO_MAX_SETS ? IIO_MAX_SETS : allocator->setsPerPool * 2;
+    }
+
+    const IIOSizedDescriptorPool * sizedPool = vec_SizedPool_at(&frame->pools, frame->currentPool);
+    uint32_t available = sizedPool->setCount - frame->currentPoolUsed;
+    uint32_t batch = count - allocated < available ? count - allocated : available;
+    if (batch == 0) {
+      frame->currentPool++;
+      frame->currentPoolUsed = 0;
+      continue;
+    }
+
+    VkDescriptorSetAllocateInfo allocateInfo = {0};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.pNext = NULL;
+    allocateInfo.descriptorPool = sizedPool->pool;
+    allocateInfo.descriptorSetCount = batch;
+    allocateInfo.pSetLayouts = allocator->layouts;
+
+    VkResult result = vkAllocateDescriptorSets(device, &allocateInfo, descriptorSets + allocated);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+      //  the pool ran out before its set count, move on to the next one
+      frame->currentPool++;
+      frame->currentPoolUsed = 0;
+      continue;
+    } else if (result != VK_SUCCESS) {
+      iio_vk_error(result, __LINE__, __FILE__);
+      return result;
+    }
+    frame->currentPoolUsed += batch;
+    allocated += batch;
+  }
+  return VK_SUCCESS;
+}
+
+void iio_destroy_frame_descriptor_allocator(
+  VkDevice                        device,
+  IIOFrameDescriptorAllocator *   allocator)
+
+{
+  if (!allocator->isInitialized) return;
+
+  for (uint32_t i = 0; i < allocator->frameCount; i++) {
+    for (c_each(it, vec_SizedPool, allocator->frames[i].pools)) {
+      vkDestroyDescriptorPool(device, it.ref->pool, NULL);
+    }
+    vec_SizedPool_drop(&allocator->frames[i].pools);
+  }
+  free(allocator->frames);
+  free(allocator->layouts);
+  memset(allocator, 0, sizeof(IIOFrameDescriptorAllocator));
+}
+
 /****************************
  *     Writer functions     *
  ****************************/
@@ -345,6 +593,20 @@ void iio_write_image_descriptor(
   vec_Write_push_back(&writer->writes, write);
 }
 
+void iio_write_image_array_descriptor(
+  uint32_t                        binding,
+  uint32_t                        arrayElement,
+  VkDescriptorType                descriptorType,
+  VkSampler                       sampler,
+  VkImageView                     imageView,
+  VkImageLayout                   imageLayout,
+  IIODescriptorSetWriter *        writer)
+
+{
+  iio_write_image_descriptor(binding, 1, descriptorType, sampler, imageView, imageLayout, writer);
+  vec_Write_back_mut(&writer->writes)->dstArrayElement = arrayElement;
+}
+
 void iio_write_buffer_descriptor(
   uint32_t                        binding,
   uint32_t                        descriptorCount,
@@ -430,3 +692,334 @@ void iio_destroy_descriptor_set_writer(
   vec_Write_drop(&writer->writes);
   vec_WriteInfo_drop(&writer->writeInfos);
 }
+
+/***************************************
+ * descriptor template writer functions *
+ ****************************************/
+
+void iio_create_descriptor_template_writer(
+  const IIODescriptorPoolManager *  manager,
+  IIODescriptorTemplateWriter *     writer)
+
+{
+  memset(writer, 0, sizeof(IIODescriptorTemplateWriter));
+  //  the offsets outlive a failed template creation, updates then fall back to descriptor writes
+  if (manager->templateOffsets == NULL) {
+    fprintf(stderr, "iio_create_descriptor_template_writer failed: manager layout has no template data\n");
+    return;
+  }
+  writer->data = calloc(1, manager->templateDataSize);
+  if (!writer->data) {
+    fprintf(stderr, "iio_create_descriptor_template_writer failed: could not allocate template data\n");
+    return;
+  }
+  writer->manager = manager;
+}
+
+//  info of one descriptor in the template data, NULL when the layout has no such descriptor
+static void * iio_template_info(
+  uint32_t                          binding,
+  uint32_t                          arrayElement,
+  IIOWriterType                     writerType,
+  IIODescriptorTemplateWriter *     writer)
+
+{
+  if (!writer->data) {
+    fprintf(stderr, "iio_template_write failed: uninitialized template writer\n");
+    return NULL;
+  }
+  const vec_DLE * elements = &writer->manager->iioDescriptorLayoutElements;
+  if (binding >= vec_DLE_size(elements)) {
+    fprintf(stderr, "iio_template_write failed: binding %u is not in the layout\n", binding);
+    return NULL;
+  }
+  const IIODescriptorLayoutElement * elem = vec_DLE_at(elements, binding);
+  if (arrayElement >= elem->count) {
+    fprintf(stderr, "iio_template_write failed: element %u is past the %u descriptors of binding %u\n", arrayElement, elem->count, binding);
+    return NULL;
+  } else if (iio_descriptor_info_size(elem->type) == sizeof(VkBufferView) || iio_descriptor_writer_type(elem->type) != writerType) {
+    fprintf(stderr, "iio_template_write failed: binding %u has a different descriptor type\n", binding);
+    return NULL;
+  }
+  return writer->data + writer->manager->templateOffsets[binding] + arrayElement * iio_descriptor_info_size(elem->type);
+}
+
+void iio_template_write_image(
+  uint32_t                          binding,
+  uint32_t                          arrayElement,
+  VkSampler                         sampler,
+  VkImageView                       imageView,
+  VkImageLayout                     imageLayout,
+  IIODescriptorTemplateWriter *     writer)
+
+{
+  VkDescriptorImageInfo * info = iio_template_info(binding, arrayElement, iio_writer_type_image, writer);
+  if (!info) return;
+  info->sampler = sampler;
+  info->imageView = imageView;
+  info->imageLayout = imageLayout;
+}
+
+void iio_template_write_buffer(
+  uint32_t                          binding,
+  uint32_t                          arrayElement,
+  VkBuffer                          buffer,
+  VkDeviceSize                      offset,
+  VkDeviceSize                      range,
+  IIODescriptorTemplateWriter *     writer)
+
+{
+  VkDescriptorBufferInfo * info = iio_template_info(binding, arrayElement, iio_writer_type_buffer, writer);
+  if (!info) return;
+  info->buffer = buffer;
+  info->offset = offset;
+  info->range = range;
+}
+
+void iio_update_set_with_template(
+  VkDevice                          device,
+  VkDescriptorSet                   descriptorSet,
+  IIODescriptorTemplateWriter *     writer)
+
+{
+  if (!writer->data) {
+    fprintf(stderr, "iio_update_set_with_template failed: uninitialized template writer\n");
+    return;
+  } else if (descriptorSet == VK_NULL_HANDLE) {
+    fprintf(stderr, "iio_update_set_with_template failed: Tried to update NULL descriptor set handle\n");
+    return;
+  }
+  const IIODescriptorPoolManager * manager = writer->manager;
+  if (manager->updateTemplate != VK_NULL_HANDLE) {
+    vkUpdateDescriptorSetWithTemplate(device, descriptorSet, manager->updateTemplate, writer->data);
+    return;
+  }
+
+  //  no template could be created, the same data is written one binding at a time
+  uint32_t elementCount = (uint32_t) vec_DLE_size(&manager->iioDescriptorLayoutElements);
+  VkWriteDescriptorSet writes [elementCount];
+  for (uint32_t i = 0; i < elementCount; i++) {
+    const IIODescriptorLayoutElement * elem = vec_DLE_at(&manager->iioDescriptorLayoutElements, i);
+    void * infos = writer->data + manager->templateOffsets[i];
+    writes[i] = (VkWriteDescriptorSet) {0};
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet = descriptorSet;
+    writes[i].dstBinding = i;
+    writes[i].dstArrayElement = 0;
+    writes[i].descriptorCount = elem->count;
+    writes[i].descriptorType = elem->type;
+    if (iio_descriptor_info_size(elem->type) == sizeof(VkBufferView)) writes[i].pTexelBufferView = infos;
+    else if (iio_descriptor_writer_type(elem->type) == iio_writer_type_image) writes[i].pImageInfo = infos;
+    else writes[i].pBufferInfo = infos;
+  }
+  vkUpdateDescriptorSets(device, elementCount, writes, 0, NULL);
+}
+
+void iio_destroy_descriptor_template_writer(
+  IIODescriptorTemplateWriter *     writer)
+
+{
+  free(writer->data);
+  memset(writer, 0, sizeof(IIODescriptorTemplateWriter));
+}
+
+/******************************
+ * descriptor cache functions *
+ ******************************/
+
+void iio_create_descriptor_cache(
+  IIODescriptorCache *            cache)
+
+{
+  if (cache == NULL) {
+    fprintf(stderr, "iio_create_descriptor_cache failed: cache null\n");
+    return;
+  }
+
+  cache->sets = hmap_DescriptorCache_init();
+  cache->recycled = vec_RecycledSet_init();
+  cache->isInitialized = true;
+}
+
+void iio_destroy_descriptor_cache(
+  IIODescriptorCache *            cache)
+
+{
+  if (!cache->isInitialized) return;
+
+  for (c_each(it, hmap_DescriptorCache, cache->sets)) {
+    free(it.ref->second.writes);
+  }
+  hmap_DescriptorCache_drop(&cache->sets);
+  vec_RecycledSet_drop(&cache->recycled);
+  memset(cache, 0, sizeof(IIODescriptorCache));
+}
+
+VkDescriptorSet iio_get_cached_descriptor_set(
+  VkDevice                        device,
+  IIODescriptorPoolManager *      manager,
+  IIODescriptorSetWriter *        writer,
+  IIODescriptorCache *            cache)
+
+{
+  uint32_t writeCount = (uint32_t) vec_Write_size(&writer->writes);
+  if (writeCount == 0) {
+    fprintf(stderr, "iio_get_cached_descriptor_set failed: empty writer\n");
+    return VK_NULL_HANDLE;
+  }
+
+  //  copy the fields that matter into zeroed records so equal contents hash equal
+  IIOCachedDescriptorWrite * writes = calloc(writeCount, sizeof(IIOCachedDescriptorWrite));
+  for (uint32_t i = 0; i < writeCount; i++) {
+    const VkWriteDescriptorSet * write = vec_Write_at(&writer->writes, i);
+    const IIODescriptorWriteInfo * writeInfo = vec_WriteInfo_at(&writer->writeInfos, i);
+    writes[i].binding = write->dstBinding;
+    writes[i].arrayElement = write->dstArrayElement;
+    writes[i].descriptorCount = write->descriptorCount;
+    writes[i].descriptorType = write->descriptorType;
+    writes[i].info.type = writeInfo->type;
+    if (writeInfo->type == iio_writer_type_buffer) {
+      writes[i].info.objectInfo.bufferInfo.buffer = writeInfo->objectInfo.bufferInfo.buffer;
+      writes[i].info.objectInfo.bufferInfo.offset = writeInfo->objectInfo.bufferInfo.offset;
+      writes[i].info.objectInfo.bufferInfo.range = writeInfo->objectInfo.bufferInfo.range;
+    } else {
+      writes[i].info.objectInfo.imageInfo.sampler = writeInfo->objectInfo.imageInfo.sampler;
+      writes[i].info.objectInfo.imageInfo.imageView = writeInfo->objectInfo.imageInfo.imageView;
+      writes[i].info.objectInfo.imageInfo.imageLayout = writeInfo->objectInfo.imageInfo.imageLayout;
+    }
+  }
+
+  IIODescriptorCacheKey key = {0};
+  key.layout = manager->descriptorSetLayout;
+  key.hash = (uint64_t) c_hash_n(writes, (isize) (writeCount * sizeof(IIOCachedDescriptorWrite)));
+
+  const hmap_DescriptorCache_value * entry = hmap_DescriptorCache_get(&cache->sets, key);
+  bool collision = false;
+  if (entry) {
+    if (entry->second.writeCount == writeCount && memcmp(entry->second.writes, writes, writeCount * sizeof(IIOCachedDescriptorWrite)) == 0) {
+      free(writes);
+      iio_clear_descriptor_set_writer(writer);
+      return entry->second.descriptorSet;
+    }
+    collision = true;
+  }
+
+  //  reuse an evicted set of the same layout before growing the pools
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  for (size_t i = 0; i < vec_RecycledSet_size(&cache->recycled); i++) {
+    const IIORecycledDescriptorSet * recycled = vec_RecycledSet_at(&cache->recycled, i);
+    if (recycled->layout != key.layout) continue;
+    descriptorSet = recycled->descriptorSet;
+    vec_RecycledSet_erase_n(&cache->recycled, (isize) i, 1);
+    break;
+  }
+  if (descriptorSet == VK_NULL_HANDLE) {
+    descriptorSet = iio_allocate_descriptor_set(device, manager);
+  }
+  if (descriptorSet == VK_NULL_HANDLE) {
+    free(writes);
+    iio_clear_descriptor_set_writer(writer);
+    return VK_NULL_HANDLE;
+  }
+  iio_update_set(device, descriptorSet, writer);
+
+  //  a hash collision keeps the existing entry, the new set is returned without being cached
+  if (collision) {
+    free(writes);
+    return descriptorSet;
+  }
+  hmap_DescriptorCache_insert(&cache->sets, key, (IIOCachedDescriptorSet) {
+    .descriptorSet = descriptorSet,
+    .writeCount = writeCount,
+    .writes = writes,
+  });
+  return descriptorSet;
+}
+
+static bool iio_cached_write_references(
+  const IIOCachedDescriptorWrite *  write,
+  VkBuffer                          buffer,
+  VkImageView                       imageView,
+  VkSampler                         sampler)
+
+{
+  if (write->info.type == iio_writer_type_buffer) {
+    return buffer && write->info.objectInfo.bufferInfo.buffer == buffer;
+  }
+  return (imageView && write->info.objectInfo.imageInfo.imageView == imageView) ||
+         (sampler && write->info.objectInfo.imageInfo.sampler == sampler);
+}
+
+static void iio_evict_cached_descriptor_sets(
+  IIODescriptorCache *            cache,
+  VkDescriptorSetLayout           layout,
+  VkBuffer                        buffer,
+  VkImageView                     imageView,
+  VkSampler                       sampler)
+
+{
+  if (!cache->isInitialized) return;
+
+  hmap_DescriptorCache_iter it = hmap_DescriptorCache_begin(&cache->sets);
+  while (it.ref) {
+    const IIOCachedDescriptorSet * cached = &it.ref->second;
+    bool evict = layout && it.ref->first.layout == layout;
+    for (uint32_t i = 0; !evict && i < cached->writeCount; i++) {
+      evict = iio_cached_write_references(&cached->writes[i], buffer, imageView, sampler);
+    }
+    if (!evict) {
+      hmap_DescriptorCache_next(&it);
+      continue;
+    }
+
+    //  sets of an evicted layout go back with their pools
+    if (!layout) {
+      vec_RecycledSet_push(&cache->recycled, (IIORecycledDescriptorSet) {
+        .layout = it.ref->first.layout,
+        .descriptorSet = cached->descriptorSet,
+      });
+    }
+    free(cached->writes);
+    it = hmap_DescriptorCache_erase_at(&cache->sets, it);
+  }
+
+  if (layout) {
+    for (size_t i = vec_RecycledSet_size(&cache->recycled); i-- > 0; ) {
+      if (vec_RecycledSet_at(&cache->recycled, i)->layout == layout) {
+        vec_RecycledSet_erase_n(&cache->recycled, (isize) i, 1);
+      }
+    }
+  }
+}
+
+void iio_evict_cached_descriptor_buffer(
+  IIODescriptorCache *            cache,
+  VkBuffer                        buffer)
+
+{
+  iio_evict_cached_descriptor_sets(cache, VK_NULL_HANDLE, buffer, VK_NULL_HANDLE, VK_NULL_HANDLE);
+}
+
+void iio_evict_cached_descriptor_image_view(
+  IIODescriptorCache *            cache,
+  VkImageView                     imageView)
+
+{
+  iio_evict_cached_descriptor_sets(cache, VK_NULL_HANDLE, VK_NULL_HANDLE, imageView, VK_NULL_HANDLE);
+}
+
+void iio_evict_cached_descriptor_sampler(
+  IIODescriptorCache *            cache,
+  VkSampler                       sampler)
+
+{
+  iio_evict_cached_descriptor_sets(cache, VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE, sampler);
+}
+
+void iio_evict_cached_descriptor_layout(
+  IIODescriptorCache *            cache,
+  VkDescriptorSetLayout           layout)
+
+{
+  iio_evict_cached_descriptor_sets(cache, layout, VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE);
+}
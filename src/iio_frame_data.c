@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+#include "iio_frame_data.h"
+#include "iio_eng_errors.h"
+
+void iio_create_frame_data_ring(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  VkDeviceSize                              alignment,
+  VkDeviceSize                              frameSize,
+  VkDeviceSize                              rangeSize,
+  uint32_t                                  framesInFlight,
+  IIOFrameDataRing *                        ring)
+
+{
+  memset(ring, 0, sizeof(IIOFrameDataRing));
+  if (!framesInFlight || !rangeSize || rangeSize > frameSize) {
+    fprintf(stderr, "Tried to create a frame data ring with %u frames of %llu bytes and a range of %llu bytes\n",
+      framesInFlight, (unsigned long long) frameSize, (unsigned long long) rangeSize);
+    return;
+  }
+  ring->alignment = alignment ? alignment : 1;
+  ring->frameSize = iio_align_up(frameSize, ring->alignment);
+  ring->rangeSize = rangeSize;
+  ring->frameCount = framesInFlight;
+
+  //  the descriptors read rangeSize bytes from every offset, the tail keeps the last frame's reads in bounds
+  VkBufferCreateInfo bufferCreateInfo = {0};
+  bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCreateInfo.size = ring->frameSize * framesInFlight + rangeSize;
+  bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  VkResult result = vkCreateBuffer(device, &bufferCreateInfo, NULL, &ring->buffer);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+  result = iio_allocate_buffer_memory(
+    device, allocator, ring->buffer,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    &ring->memory
+  );
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+  ring->isInitialized = true;
+}
+
+void iio_destroy_frame_data_ring(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOFrameDataRing *                        ring)
+
+{
+  if (!ring->isInitialized) return;
+  vkDestroyBuffer(device, ring->buffer, NULL);
+  iio_free_memory(device, allocator, &ring->memory);
+  memset(ring, 0, sizeof(IIOFrameDataRing));
+}
+
+void iio_frame_data_ring_begin_frame(
+  IIOFrameDataRing *                        ring,
+  uint32_t                                  frameIndex)
+
+{
+  ring->frame = frameIndex % ring->frameCount;
+  ring->head = 0;
+}
+
+static bool iio_frame_data_ring_allocate(
+  IIOFrameDataRing *                        ring,
+  const void *                              data,
+  VkDeviceSize                              size,
+  VkDeviceSize *                            bufferOffset)
+
+{
+  VkDeviceSize offset = iio_align_up(ring->head, ring->alignment);
+  if (offset + size > ring->frameSize) {
+    fprintf(stderr, "Frame data ring is out of space (%llu of %llu bytes used)\n",
+      (unsigned long long) ring->head, (unsigned long long) ring->frameSize);
+    return false;
+  }
+  *bufferOffset = ring->frameSize * ring->frame + offset;
+  memcpy((uint8_t *) ring->memory.mapped + *bufferOffset, data, size);
+  ring->head = offset + size;
+  return true;
+}
+
+bool iio_frame_data_ring_push(
+  IIOFrameDataRing *                        ring,
+  const void *                              data,
+  VkDeviceSize                              size,
+  uint32_t *                                dynamicOffset)
+
+{
+  if (size > ring->rangeSize) {
+    fprintf(stderr, "Tried to push %llu bytes to a frame data ring with a range of %llu bytes\n",
+      (unsigned long long) size, (unsigned long long) ring->rangeSize);
+    return false;
+  }
+  VkDeviceSize bufferOffset;
+  if (!iio_frame_data_ring_allocate(ring, data, size, &bufferOffset)) return false;
+  *dynamicOffset = (uint32_t) bufferOffset;
+  return true;
+}
+
+bool iio_frame_data_ring_write(
+  IIOFrameDataRing *                        ring,
+  const void *                              data,
+  VkDeviceSize                              size,
+  VkDeviceSize *                            offset)
+
+{
+  return iio_frame_data_ring_allocate(ring, data, size, offset);
+}
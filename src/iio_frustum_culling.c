@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "iio_frustum_culling.h"
+
+#define IIO_CULLING_FLOAT_ARRAYS 7
+
+void iio_create_culling_bounds(
+  IIOCullingBounds *                        bounds)
+
+{
+  memset(bounds, 0, sizeof(IIOCullingBounds));
+}
+
+void iio_destroy_culling_bounds(
+  IIOCullingBounds *                        bounds)
+
+{
+  //  every array lives in the block centerX starts
+  free(bounds->centerX);
+  memset(bounds, 0, sizeof(IIOCullingBounds));
+}
+
+void iio_culling_bounds_clear(
+  IIOCullingBounds *                        bounds)
+
+{
+  bounds->count = 0;
+}
+
+static bool iio_culling_bounds_reserve(
+  IIOCullingBounds *                        bounds,
+  uint32_t                                  capacity)
+
+{
+  if (capacity <= bounds->capacity) return true;
+  if (capacity < bounds->capacity * 2) capacity = bounds->capacity * 2;
+  capacity = (capacity + IIO_CULLING_BATCH_SIZE - 1) & ~(uint32_t) (IIO_CULLING_BATCH_SIZE - 1);
+
+  float * block = malloc((size_t) capacity * (IIO_CULLING_FLOAT_ARRAYS * sizeof(float) + sizeof(uint8_t)));
+  if (!block) {
+    fprintf(stderr, "Failed to grow culling bounds to %u volumes\n", capacity);
+    return false;
+  }
+  float ** arrays [IIO_CULLING_FLOAT_ARRAYS] = {
+    &bounds->centerX, &bounds->centerY, &bounds->centerZ, &bounds->radius,
+    &bounds->extentX, &bounds->extentY, &bounds->extentZ,
+  };
+  float * old = bounds->centerX;
+  for (int a = 0; a < IIO_CULLING_FLOAT_ARRAYS; a++) {
+    float * array = block + (size_t) a * capacity;
+    if (bounds->count) memcpy(array, *arrays[a], bounds->count * sizeof(float));
+    *arrays[a] = array;
+  }
+  bounds->visible = (uint8_t *) (block + (size_t) IIO_CULLING_FLOAT_ARRAYS * capacity);
+  bounds->capacity = capacity;
+  free(old);
+  return true;
+}
+
+bool iio_culling_bounds_add(
+  IIOCullingBounds *                        bounds,
+  vec3                                      boxMin,
+  vec3                                      boxMax,
+  float                                     sphereRadius,
+  mat4                                      transform)
+
+{
+  if (!iio_culling_bounds_reserve(bounds, bounds->count + 1)) return false;
+
+  vec3 center, extent, worldCenter;
+  glm_vec3_center(boxMin, boxMax, center);
+  glm_vec3_sub(boxMax, center, extent);
+  glm_mat4_mulv3(transform, center, 1.0f, worldCenter);
+
+  //  the world box of a transformed box reaches |M| * extent from its center, the sphere grows with the
+  //  largest axis scale
+  float scale = 0.0f;
+  uint32_t i = bounds->count++;
+  bounds->centerX[i] = worldCenter[0];
+  bounds->centerY[i] = worldCenter[1];
+  bounds->centerZ[i] = worldCenter[2];
+  bounds->extentX[i] = fabsf(transform[0][0]) * extent[0] + fabsf(transform[1][0]) * extent[1] + fabsf(transform[2][0]) * extent[2];
+  bounds->extentY[i] = fabsf(transform[0][1]) * extent[0] + fabsf(transform[1][1]) * extent[1] + fabsf(transform[2][1]) * extent[2];
+  bounds->extentZ[i] = fabsf(transform[0][2]) * extent[0] + fabsf(transform[1][2]) * extent[1] + fabsf(transform[2][2]) * extent[2];
+  for (int c = 0; c < 3; c++) {
+    scale = fmaxf(scale, glm_vec3_norm2(transform[c]));
+  }
+  bounds->radius[i] = sphereRadius * sqrtf(scale);
+  return true;
+}
+
+/*****************************
+ *       plane testing       *
+ *****************************/
+
+//  a volume is outside when its center lies farther than the radius, or than the box's projected
+//  extent, behind any plane
+
+static void iio_cull_bounds_scalar(
+  IIOCullingBounds *                        bounds,
+  vec4                                      planes [6],
+  uint32_t                                  first)
+
+{
+  for (uint32_t i = first; i < bounds->count; i++) {
+    bool inside = true;
+    for (int p = 0; p < 6 && inside; p++) {
+      float distance = planes[p][0] * bounds->centerX[i] + planes[p][1] * bounds->centerY[i] + planes[p][2] * bounds->centerZ[i] + planes[p][3];
+      float projected = fabsf(planes[p][0]) * bounds->extentX[i] + fabsf(planes[p][1]) * bounds->extentY[i] + fabsf(planes[p][2]) * bounds->extentZ[i];
+      inside = distance >= -bounds->radius[i] && distance >= -projected;
+    }
+    bounds->visible[i] = inside;
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+static uint32_t iio_cull_bounds_sse(
+  IIOCullingBounds *                        bounds,
+  vec4                                      planes [6])
+
+{
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+  uint32_t i = 0;
+  for (; i + 4 <= bounds->count; i += 4) {
+    __m128 cx = _mm_loadu_ps(bounds->centerX + i);
+    __m128 cy = _mm_loadu_ps(bounds->centerY + i);
+    __m128 cz = _mm_loadu_ps(bounds->centerZ + i);
+    __m128 negRadius = _mm_xor_ps(_mm_loadu_ps(bounds->radius + i), signMask);
+    __m128 ex = _mm_loadu_ps(bounds->extentX + i);
+    __m128 ey = _mm_loadu_ps(bounds->extentY + i);
+    __m128 ez = _mm_loadu_ps(bounds->extentZ + i);
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p = 0; p < 6; p++) {
+      __m128 nx = _mm_set1_ps(planes[p][0]);
+      __m128 ny = _mm_set1_ps(planes[p][1]);
+      __m128 nz = _mm_set1_ps(planes[p][2]);
+      __m128 distance = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+        _mm_add_ps(_mm_mul_ps(nz, cz), _mm_set1_ps(planes[p][3]))
+      );
+      __m128 projected = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, nx), ex), _mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)),
+        _mm_mul_ps(_mm_andnot_ps(signMask, nz), ez)
+      );
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_xor_ps(projected, signMask)));
+    }
+    int mask = _mm_movemask_ps(inside);
+    for (int lane = 0; lane < 4; lane++) bounds->visible[i + lane] = (mask >> lane) & 1;
+  }
+  return i;
+}
+
+__attribute__((target("avx")))
+static uint32_t iio_cull_bounds_avx(
+  IIOCullingBounds *                        bounds,
+  vec4                                      planes [6])
+
+{
+  const __m256 signMask = _mm256_set1_ps(-0.0f);
+  uint32_t i = 0;
+  for (; i + 8 <= bounds->count; i += 8) {
+    __m256 cx = _mm256_loadu_ps(bounds->centerX + i);
+    __m256 cy = _mm256_loadu_ps(bounds->centerY + i);
+    __m256 cz = _mm256_loadu_ps(bounds->centerZ + i);
+    __m256 negRadius = _mm256_xor_ps(_mm256_loadu_ps(bounds->radius + i), signMask);
+    __m256 ex = _mm256_loadu_ps(bounds->extentX + i);
+    __m256 ey = _mm256_loadu_ps(bounds->extentY + i);
+    __m256 ez = _mm256_loadu_ps(bounds->extentZ + i);
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int p = 0; p < 6; p++) {
+      __m256 nx = _mm256_set1_ps(planes[p][0]);
+      __m256 ny = _mm256_set1_ps(planes[p][1]);
+      __m256 nz = _mm256_set1_ps(planes[p][2]);
+      __m256 distance = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(nx, cx), _mm256_mul_ps(ny, cy)),
+        _mm256_add_ps(_mm256_mul_ps(nz, cz), _mm256_set1_ps(planes[p][3]))
+      );
+      __m256 projected = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, nx), ex), _mm256_mul_ps(_mm256_andnot_ps(signMask, ny), ey)),
+        _mm256_mul_ps(_mm256_andnot_ps(signMask, nz), ez)
+      );
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_xor_ps(projected, signMask), _CMP_GE_OQ));
+    }
+    int mask = _mm256_movemask_ps(inside);
+    for (int lane = 0; lane < 8; lane++) bounds->visible[i + lane] = (mask >> lane) & 1;
+  }
+  return i;
+}
+
+#endif
+
+uint32_t iio_cull_bounds(
+  IIOCullingBounds *                        bounds,
+  vec4                                      planes [6])
+
+{
+  uint32_t tested = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  if (__builtin_cpu_supports("avx")) tested = iio_cull_bounds_avx(bounds, planes);
+  else                               tested = iio_cull_bounds_sse(bounds, planes);
+#endif
+  //  the tail that does not fill a batch
+  iio_cull_bounds_scalar(bounds, planes, tested);
+
+  uint32_t visibleCount = 0;
+  for (uint32_t i = 0; i < bounds->count; i++) visibleCount += bounds->visible[i];
+  return visibleCount;
+}
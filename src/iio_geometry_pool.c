@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+#include "iio_geometry_pool.h"
+#include "iio_resource_loaders.h"
+#include "iio_eng_errors.h"
+
+static void iio_create_geometry_pool_buffer(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  const IIOUploadContext *                  upload,
+  VkDeviceSize                              size,
+  VkBufferUsageFlags                        usage,
+  VkBuffer *                                buffer,
+  IIOAllocation *                           memory)
+
+{
+  VkBufferCreateInfo bufferCreateInfo = {0};
+  bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCreateInfo.size = size;
+  bufferCreateInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  uint32_t queueFamilyIndices [2] = {upload->queueFamilyIndex, upload->dstQueueFamilyIndex};
+  if (upload->ownershipTransfer) {
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    bufferCreateInfo.queueFamilyIndexCount = 2;
+    bufferCreateInfo.pQueueFamilyIndices = queueFamilyIndices;
+  }
+
+  VkResult result = vkCreateBuffer(device, &bufferCreateInfo, NULL, buffer);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+  result = iio_allocate_buffer_memory(device, allocator, *buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+}
+
+void iio_create_geometry_pool(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  const IIOUploadContext *                  upload,
+  VkDeviceSize                              vertexCapacity,
+  VkDeviceSize                              indexCapacity,
+  VkIndexType                               indexType,
+  IIOGeometryPool *                         pool)
+
+{
+  memset(pool, 0, sizeof(IIOGeometryPool));
+  if (!vertexCapacity || !indexCapacity) {
+    fprintf(stderr, "Tried to create a geometry pool of %llu vertex and %llu index bytes\n",
+      (unsigned long long) vertexCapacity, (unsigned long long) indexCapacity);
+    return;
+  }
+  pool->vertexCapacity = vertexCapacity;
+  pool->indexCapacity = indexCapacity;
+  pool->indexType = indexType;
+  iio_create_geometry_pool_buffer(device, allocator, upload, vertexCapacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &pool->vertexBuffer, &pool->vertexMemory);
+  iio_create_geometry_pool_buffer(device, allocator, upload, indexCapacity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &pool->indexBuffer, &pool->indexMemory);
+  pool->isInitialized = true;
+}
+
+void iio_destroy_geometry_pool(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOGeometryPool *                         pool)
+
+{
+  if (!pool->isInitialized) return;
+  vkDestroyBuffer(device, pool->vertexBuffer, NULL);
+  iio_free_memory(device, allocator, &pool->vertexMemory);
+  vkDestroyBuffer(device, pool->indexBuffer, NULL);
+  iio_free_memory(device, allocator, &pool->indexMemory);
+  memset(pool, 0, sizeof(IIOGeometryPool));
+}
+
+void iio_reset_geometry_pool(
+  IIOGeometryPool *                         pool)
+
+{
+  pool->vertexHead = 0;
+  pool->indexHead = 0;
+  pool->vertexStride = 0;
+}
+
+//  widens src into dst, which holds count indices of dstType
+static void iio_widen_indices(
+  const void *                              src,
+  VkIndexType                               srcType,
+  uint32_t                                  count,
+  VkIndexType                               dstType,
+  void *                                    dst)
+
+{
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t index;
+    switch (srcType) {
+      case VK_INDEX_TYPE_UINT8_EXT: index = ((const uint8_t *) src)[i]; break;
+      case VK_INDEX_TYPE_UINT16:    index = ((const uint16_t *) src)[i]; break;
+      default:                      index = ((const uint32_t *) src)[i]; break;
+    }
+    if (dstType == VK_INDEX_TYPE_UINT16) {
+      ((uint16_t *) dst)[i] = (uint16_t) index;
+    } else {
+      ((uint32_t *) dst)[i] = index;
+    }
+  }
+}
+
+//  no ownership moves: on a shared queue the barrier ending the batch makes the copy visible, with a
+//  transfer queue the consumer waits on the batch's semaphore and the buffers are concurrent
+static void iio_geometry_pool_copy(
+  VkDevice                                  device,
+  IIOUploadContext *                        upload,
+  const IIOStagingRegion *                  region,
+  VkBuffer                                  dstBuffer,
+  VkDeviceSize                              dstOffset)
+
+{
+  VkCommandBuffer commandBuffer = iio_upload_begin(device, upload);
+  VkBufferCopy copyRegion = {
+    .srcOffset = region->offset,
+    .dstOffset = dstOffset,
+    .size = region->size,
+  };
+  vkCmdCopyBuffer(commandBuffer, region->buffer, dstBuffer, 1, &copyRegion);
+}
+
+bool iio_geometry_pool_add(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOUploadContext *                        upload,
+  IIOGeometryPool *                         pool,
+  const void *                              vertexData,
+  uint32_t                                  vertexCount,
+  uint32_t                                  vertexStride,
+  const void *                              indexData,
+  uint32_t                                  indexCount,
+  VkIndexType                               indexType,
+  int32_t *                                 vertexOffset,
+  uint32_t *                                firstIndex)
+
+{
+  if (!pool->isInitialized || !vertexData || !vertexCount || !vertexStride) return false;
+  if (pool->vertexStride && pool->vertexStride != vertexStride) return false;
+  size_t poolIndexSize = iio_index_type_size(pool->indexType);
+  if (indexData && indexCount && iio_index_type_size(indexType) > poolIndexSize) return false;
+
+  //  vertexOffset counts in vertices of the pool's stride, so the range starts on a multiple of it
+  VkDeviceSize vertexSize = (VkDeviceSize) vertexCount * vertexStride;
+  VkDeviceSize vertexStart = iio_align_up(pool->vertexHead, vertexStride);
+  VkDeviceSize indexSize = indexData ? (VkDeviceSize) indexCount * poolIndexSize : 0;
+  VkDeviceSize indexStart = pool->indexHead;
+  if (vertexStart + vertexSize > pool->vertexCapacity || indexStart + indexSize > pool->indexCapacity) return false;
+  if (vertexStart / vertexStride > INT32_MAX) return false;
+
+  IIOStagingRegion region;
+  iio_upload_stage(device, allocator, upload, vertexData, vertexSize, 4, &region);
+  iio_geometry_pool_copy(device, upload, &region, pool->vertexBuffer, vertexStart);
+  pool->vertexHead = vertexStart + vertexSize;
+  pool->vertexStride = vertexStride;
+  *vertexOffset = (int32_t) (vertexStart / vertexStride);
+
+  *firstIndex = 0;
+  if (indexSize) {
+    if (indexType == pool->indexType) {
+      iio_upload_stage(device, allocator, upload, indexData, indexSize, 4, &region);
+    } else {
+      iio_upload_stage(device, allocator, upload, NULL, indexSize, 4, &region);
+      iio_widen_indices(indexData, indexType, indexCount, pool->indexType, region.mapped);
+    }
+    iio_geometry_pool_copy(device, upload, &region, pool->indexBuffer, indexStart);
+    pool->indexHead = indexStart + indexSize;
+    *firstIndex = (uint32_t) (indexStart / poolIndexSize);
+  }
+  return true;
+}
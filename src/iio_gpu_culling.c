@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+#include "iio_gpu_culling.h"
+#include "iio_bindless.h"
+#include "iio_eng_errors.h"
+
+static void iio_create_gpu_culling_buffer(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  VkDeviceSize                              size,
+  VkBufferUsageFlags                        usage,
+  VkMemoryPropertyFlags                     properties,
+  VkBuffer *                                buffer,
+  IIOAllocation *                           memory)
+
+{
+  VkBufferCreateInfo bufferCreateInfo = {0};
+  bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCreateInfo.size = size;
+  bufferCreateInfo.usage = usage;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  VkResult result = vkCreateBuffer(device, &bufferCreateInfo, NULL, buffer);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+  result = iio_allocate_buffer_memory(device, allocator, *buffer, properties, memory);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+}
+
+void iio_create_gpu_culling(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  VkShaderModule                            cullShader,
+  uint32_t                                  capacity,
+  uint32_t                                  pipelineCount,
+  uint32_t                                  framesInFlight,
+  IIOGpuCulling *                           culling)
+
+{
+  memset(culling, 0, sizeof(IIOGpuCulling));
+  if (!capacity || !pipelineCount || pipelineCount > IIO_GPU_CULLING_MAX_PIPELINES || !framesInFlight) {
+    fprintf(stderr, "Tried to create gpu culling for %u instances, %u pipelines and %u frames\n", capacity, pipelineCount, framesInFlight);
+    return;
+  }
+  culling->capacity = capacity;
+  culling->pipelineCount = pipelineCount;
+  culling->frameCount = framesInFlight;
+
+  IIODescriptorLayoutElement elements [iio_gpu_culling_binding_count] = {
+    [iio_gpu_culling_binding_instances] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0},
+    [iio_gpu_culling_binding_draws] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0},
+    [iio_gpu_culling_binding_counts] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0},
+  };
+  iio_create_descriptor_pool_manager(device, iio_gpu_culling_binding_count, elements, framesInFlight, framesInFlight, &culling->poolManager);
+  if (!culling->poolManager.isInitialized) {
+    fprintf(stderr, "Failed to create the gpu culling descriptor pool manager\n");
+    return;
+  }
+
+  VkDeviceSize instanceSize = (VkDeviceSize) capacity * sizeof(IIOGpuInstance);
+  VkDeviceSize drawSize = (VkDeviceSize) capacity * pipelineCount * sizeof(VkDrawIndexedIndirectCommand);
+  VkDeviceSize countSize = (VkDeviceSize) pipelineCount * sizeof(uint32_t);
+  iio_create_gpu_culling_buffer(
+    device, allocator, instanceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    &culling->instanceBuffer, &culling->instanceMemory
+  );
+  culling->instances = culling->instanceMemory.mapped;
+
+  culling->frames = calloc(framesInFlight, sizeof(IIOGpuCullingFrame));
+  if (!culling->frames) {
+    iio_oom_error(NULL, __LINE__, __FILE__);
+    exit(1);
+  }
+  iio_create_descriptor_set_writer(&culling->writer);
+  for (uint32_t i = 0; i < framesInFlight; i++) {
+    IIOGpuCullingFrame * frame = &culling->frames[i];
+    iio_create_gpu_culling_buffer(
+      device, allocator, drawSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &frame->drawBuffer, &frame->drawMemory
+    );
+    iio_create_gpu_culling_buffer(
+      device, allocator, countSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &frame->countBuffer, &frame->countMemory
+    );
+    frame->descriptorSet = iio_allocate_descriptor_set(device, &culling->poolManager);
+    iio_write_buffer_descriptor(iio_gpu_culling_binding_instances, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, culling->instanceBuffer, 0, (uint32_t) instanceSize, &culling->writer);
+    iio_write_buffer_descriptor(iio_gpu_culling_binding_draws, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame->drawBuffer, 0, (uint32_t) drawSize, &culling->writer);
+    iio_write_buffer_descriptor(iio_gpu_culling_binding_counts, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame->countBuffer, 0, (uint32_t) countSize, &culling->writer);
+    iio_update_set(device, frame->descriptorSet, &culling->writer);
+  }
+
+  VkPushConstantRange pushConstantRange = {
+    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+    .offset = 0,
+    .size = sizeof(IIOGpuCullingConstants),
+  };
+  iio_create_graphics_pipeline_layout(device, 1, &culling->poolManager.descriptorSetLayout, 1, &pushConstantRange, &culling->cullPipeline);
+  iio_create_compute_pipeline(device, &culling->cullPipeline, cullShader);
+  if (culling->cullPipeline.pipeline == VK_NULL_HANDLE) {
+    fprintf(stderr, "Failed to create the gpu culling pipeline\n");
+    iio_destroy_gpu_culling(device, allocator, culling);
+    return;
+  }
+  culling->isInitialized = true;
+}
+
+void iio_destroy_gpu_culling(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOGpuCulling *                           culling)
+
+{
+  iio_destroy_graphics_pipeline(device, &culling->cullPipeline);
+  for (uint32_t i = 0; i < culling->frameCount && culling->frames; i++) {
+    IIOGpuCullingFrame * frame = &culling->frames[i];
+    if (frame->drawBuffer) vkDestroyBuffer(device, frame->drawBuffer, NULL);
+    iio_free_memory(device, allocator, &frame->drawMemory);
+    if (frame->countBuffer) vkDestroyBuffer(device, frame->countBuffer, NULL);
+    iio_free_memory(device, allocator, &frame->countMemory);
+  }
+  free(culling->frames);
+  if (culling->instanceBuffer) vkDestroyBuffer(device, culling->instanceBuffer, NULL);
+  iio_free_memory(device, allocator, &culling->instanceMemory);
+  iio_destroy_descriptor_set_writer(&culling->writer);
+  if (culling->poolManager.isInitialized) iio_destroy_descriptor_pool_manager(device, &culling->poolManager);
+  memset(culling, 0, sizeof(IIOGpuCulling));
+}
+
+void iio_gpu_culling_clear(
+  IIOGpuCulling *                           culling)
+
+{
+  culling->instanceCount = 0;
+}
+
+uint32_t iio_gpu_culling_add_model(
+  IIOGpuCulling *                           culling,
+  const IIOModel *                          model,
+  uint32_t                                  pipelineIndex)
+
+{
+  return iio_gpu_culling_add_instances(culling, model, (const mat4 *) &model->modelMatrix, 1, pipelineIndex);
+}
+
+uint32_t iio_gpu_culling_add_instances(
+  IIOGpuCulling *                           culling,
+  const IIOModel *                          model,
+  const mat4 *                              transforms,
+  uint32_t                                  transformCount,
+  uint32_t                                  pipelineIndex)
+
+{
+  uint32_t skipped = 0;
+  for (uint32_t m = 0; m < model->meshCount; m++) {
+    const IIOMesh * mesh = &model->meshes[m];
+    for (uint32_t p = 0; p < mesh->primitiveCount; p++) {
+      const IIOPrimitive * primitive = &mesh->primitives[p];
+      bool drawable =
+        primitive->pooledGeometry && primitive->indexBuffer && primitive->indexCount &&
+        primitive->material.bindlessIndex != IIO_BINDLESS_INVALID_INDEX && pipelineIndex < culling->pipelineCount;
+      for (uint32_t t = 0; t < transformCount; t++) {
+        if (!drawable || culling->instanceCount >= culling->capacity) {
+          skipped++;
+          continue;
+        }
+
+        //  each transform is culled on its own, the survivors of one primitive share its geometry
+        IIOGpuInstance * instance = &culling->instances[culling->instanceCount++];
+        memset(instance, 0, sizeof(IIOGpuInstance));
+        glm_mat4_copy((vec4 *) transforms[t], instance->model);
+        glm_vec4((float *) primitive->boundsMin, 0.0f, instance->boundsMin);
+        glm_vec4((float *) primitive->boundsMax, 0.0f, instance->boundsMax);
+        instance->indexCount = primitive->indexCount;
+        instance->firstIndex = primitive->firstIndex;
+        instance->vertexOffset = primitive->vertexOffset;
+        instance->materialIndex = primitive->material.bindlessIndex;
+        instance->pipelineIndex = pipelineIndex;
+      }
+    }
+  }
+  return skipped;
+}
+
+void iio_record_gpu_culling(
+  VkCommandBuffer                           commandBuffer,
+  IIOGpuCulling *                           culling,
+  uint32_t                                  frameIndex,
+  mat4                                      viewProjection)
+
+{
+  IIOGpuCullingFrame * frame = &culling->frames[frameIndex % culling->frameCount];
+
+  //  the previous use of this frame's buffers was the indirect read of its draws
+  vkCmdFillBuffer(commandBuffer, frame->countBuffer, 0, VK_WHOLE_SIZE, 0);
+  VkMemoryBarrier barrier = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+    .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+  };
+  vkCmdPipelineBarrier(
+    commandBuffer,
+    VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    0, 1, &barrier, 0, NULL, 0, NULL
+  );
+
+  IIOGpuCullingConstants constants = {
+    .instanceCount = culling->instanceCount,
+    .drawCapacity = culling->capacity,
+  };
+  glm_frustum_planes(viewProjection, constants.frustumPlanes);
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling->cullPipeline.pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling->cullPipeline.layout, 0, 1, &frame->descriptorSet, 0, NULL);
+  vkCmdPushConstants(commandBuffer, culling->cullPipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+  if (culling->instanceCount) {
+    vkCmdDispatch(commandBuffer, (culling->instanceCount + IIO_GPU_CULLING_WORKGROUP_SIZE - 1) / IIO_GPU_CULLING_WORKGROUP_SIZE, 1, 1);
+  }
+
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+  vkCmdPipelineBarrier(
+    commandBuffer,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+    0, 1, &barrier, 0, NULL, 0, NULL
+  );
+}
+
+void iio_record_gpu_culled_draws(
+  VkCommandBuffer                           commandBuffer,
+  IIOGpuCulling *                           culling,
+  uint32_t                                  frameIndex,
+  VkPipelineLayout                          layout,
+  uint32_t                                  setIndex,
+  const VkPipeline *                        pipelines)
+
+{
+  IIOGpuCullingFrame * frame = &culling->frames[frameIndex % culling->frameCount];
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, setIndex, 1, &frame->descriptorSet, 0, NULL);
+  for (uint32_t i = 0; i < culling->pipelineCount; i++) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[i]);
+    vkCmdDrawIndexedIndirectCount(
+      commandBuffer,
+      frame->drawBuffer, (VkDeviceSize) i * culling->capacity * sizeof(VkDrawIndexedIndirectCommand),
+      frame->countBuffer, (VkDeviceSize) i * sizeof(uint32_t),
+      culling->capacity, sizeof(VkDrawIndexedIndirectCommand)
+    );
+  }
+}
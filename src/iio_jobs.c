@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vulkan/vulkan.h>
+#include "iio_jobs.h"
+#include "iio_eng_errors.h"
+
+/*****************************
+ *      worker threads       *
+ *****************************/
+
+static void iio_job_pool_run_batch(IIOJobPool * pool, IIOJobFunc func, void * userData, uint32_t jobCount) {
+  for (;;) {
+    uint32_t index = atomic_fetch_add(&pool->nextJob, 1);
+    if (index >= jobCount) break;
+    func(userData, index);
+    if (atomic_fetch_sub(&pool->remainingJobs, 1) == 1) {
+      pthread_mutex_lock(&pool->mutex);
+      pthread_cond_broadcast(&pool->finished);
+      pthread_mutex_unlock(&pool->mutex);
+    }
+  }
+}
+
+static void * iio_job_pool_worker(void * arg) {
+  IIOJobPool * pool = arg;
+  uint64_t seenGeneration = 0;
+
+  pthread_mutex_lock(&pool->mutex);
+  for (;;) {
+    while (!pool->shuttingDown && pool->generation == seenGeneration) {
+      pthread_cond_wait(&pool->wake, &pool->mutex);
+    }
+    if (pool->shuttingDown) break;
+
+    //  snapshot the batch under the lock, the submitter waits for busy workers before starting another
+    seenGeneration = pool->generation;
+    IIOJobFunc func = pool->func;
+    void * userData = pool->userData;
+    uint32_t jobCount = pool->jobCount;
+    pool->busyWorkers++;
+    pthread_mutex_unlock(&pool->mutex);
+
+    iio_job_pool_run_batch(pool, func, userData, jobCount);
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->busyWorkers--;
+    if (pool->busyWorkers == 0) {
+      pthread_cond_broadcast(&pool->finished);
+    }
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+/*****************************
+ *      pool lifetime        *
+ *****************************/
+
+void iio_create_job_pool(
+  uint32_t                                  threadCount,
+  IIOJobPool *                              pool)
+
+{
+  memset(pool, 0, sizeof(IIOJobPool));
+  if (threadCount == 0) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    threadCount = cores > 1 ? (uint32_t) cores - 1 : 0;
+  }
+
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_mutex_init(&pool->submitMutex, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  pthread_cond_init(&pool->finished, NULL);
+  atomic_init(&pool->nextJob, 0);
+  atomic_init(&pool->remainingJobs, 0);
+
+  if (threadCount > 0) {
+    pool->threads = malloc(threadCount * sizeof(pthread_t));
+    if (!pool->threads) {
+      iio_oom_error(NULL, __LINE__, __FILE__);
+      threadCount = 0;
+    }
+  }
+  for (uint32_t i = 0; i < threadCount; i++) {
+    if (pthread_create(&pool->threads[i], NULL, iio_job_pool_worker, pool) != 0) {
+      fprintf(stderr, "iio_create_job_pool: only %u of %u worker threads started\n", i, threadCount);
+      threadCount = i;
+      break;
+    }
+  }
+  pool->threadCount = threadCount;
+  pool->isInitialized = true;
+}
+
+void iio_destroy_job_pool(
+  IIOJobPool *                              pool)
+
+{
+  if (!pool->isInitialized) return;
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->shuttingDown = true;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->mutex);
+
+  for (uint32_t i = 0; i < pool->threadCount; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  free(pool->threads);
+
+  pthread_cond_destroy(&pool->finished);
+  pthread_cond_destroy(&pool->wake);
+  pthread_mutex_destroy(&pool->submitMutex);
+  pthread_mutex_destroy(&pool->mutex);
+  memset(pool, 0, sizeof(IIOJobPool));
+}
+
+/*****************************
+ *        scheduling         *
+ *****************************/
+
+void iio_job_pool_parallel_for(
+  IIOJobPool *                              pool,
+  uint32_t                                  jobCount,
+  IIOJobFunc                                func,
+  void *                                    userData)
+
+{
+  if (jobCount == 0) return;
+  if (!pool || !pool->isInitialized || pool->threadCount == 0 || jobCount == 1) {
+    for (uint32_t i = 0; i < jobCount; i++) {
+      func(userData, i);
+    }
+    return;
+  }
+
+  pthread_mutex_lock(&pool->submitMutex);
+
+  pthread_mutex_lock(&pool->mutex);
+  //  a worker that woke late for the previous batch may still be draining its empty counter
+  while (pool->busyWorkers > 0) {
+    pthread_cond_wait(&pool->finished, &pool->mutex);
+  }
+  pool->func = func;
+  pool->userData = userData;
+  pool->jobCount = jobCount;
+  atomic_store(&pool->nextJob, 0);
+  atomic_store(&pool->remainingJobs, jobCount);
+  pool->generation++;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->mutex);
+
+  iio_job_pool_run_batch(pool, func, userData, jobCount);
+
+  pthread_mutex_lock(&pool->mutex);
+  while (atomic_load(&pool->remainingJobs) > 0 || pool->busyWorkers > 0) {
+    pthread_cond_wait(&pool->finished, &pool->mutex);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+
+  pthread_mutex_unlock(&pool->submitMutex);
+}
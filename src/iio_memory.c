@@ -0,0 +1,562 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+#include "iio_memory.h"
+#include "iio_eng_errors.h"
+
+/*****************************
+ *      helper functions     *
+ *****************************/
+
+//  linear and optimal resources may not share a bufferImageGranularity "page"
+static bool iio_allocation_types_conflict(IIOAllocationType a, IIOAllocationType b) {
+  return a != iio_allocation_type_free && b != iio_allocation_type_free && a != b;
+}
+
+static bool iio_on_same_page(VkDeviceSize endOfFirst, VkDeviceSize startOfSecond, VkDeviceSize pageSize) {
+  return (endOfFirst & ~(pageSize - 1)) == (startOfSecond & ~(pageSize - 1));
+}
+
+/*************************************
+ *     memory block sub-allocation   *
+ *************************************/
+
+static bool iio_block_find_range(
+  const IIOMemoryBlock *                    block,
+  VkDeviceSize                              size,
+  VkDeviceSize                              alignment,
+  IIOAllocationType                         type,
+  VkDeviceSize                              granularity,
+  isize *                                   rangeIndex,
+  VkDeviceSize *                            offset)
+
+{
+  //  best fit: pick the smallest free range that can hold the aligned allocation
+  bool found = false;
+  VkDeviceSize bestSize = (VkDeviceSize) -1;
+  isize rangeCount = vec_MemRange_size(&block->ranges);
+  for (isize i = 0; i < rangeCount; i++) {
+    const IIOMemoryRange * range = vec_MemRange_at(&block->ranges, i);
+    if (range->type != iio_allocation_type_free || range->size < size || range->size >= bestSize) {
+      continue;
+    }
+
+    VkDeviceSize candidate = iio_align_up(range->offset, alignment);
+    if (i > 0) {
+      const IIOMemoryRange * prev = vec_MemRange_at(&block->ranges, i - 1);
+      if (iio_allocation_types_conflict(prev->type, type) &&
+          iio_on_same_page(prev->offset + prev->size - 1, candidate, granularity)) {
+        candidate = iio_align_up(candidate, granularity);
+      }
+    }
+    if (candidate + size > range->offset + range->size) {
+      continue;
+    }
+    if (i + 1 < rangeCount) {
+      const IIOMemoryRange * next = vec_MemRange_at(&block->ranges, i + 1);
+      if (iio_allocation_types_conflict(type, next->type) &&
+          iio_on_same_page(candidate + size - 1, next->offset, granularity)) {
+        continue;
+      }
+    }
+
+    found = true;
+    bestSize = range->size;
+    *rangeIndex = i;
+    *offset = candidate;
+  }
+  return found;
+}
+
+static void iio_block_split_range(
+  IIOMemoryBlock *                          block,
+  isize                                     rangeIndex,
+  VkDeviceSize                              offset,
+  VkDeviceSize                              size,
+  IIOAllocationType                         type)
+
+{
+  IIOMemoryRange freeRange = *vec_MemRange_at(&block->ranges, rangeIndex);
+  VkDeviceSize headSize = offset - freeRange.offset;
+  VkDeviceSize tailSize = freeRange.offset + freeRange.size - (offset + size);
+
+  //  the used range replaces the free range, the padding before and after stays free
+  *vec_MemRange_at_mut(&block->ranges, rangeIndex) = (IIOMemoryRange) {offset, size, type};
+  if (tailSize > 0) {
+    vec_MemRange_insert_uninit(&block->ranges, rangeIndex + 1, 1);
+    *vec_MemRange_at_mut(&block->ranges, rangeIndex + 1) = (IIOMemoryRange) {offset + size, tailSize, iio_allocation_type_free};
+  }
+  if (headSize > 0) {
+    vec_MemRange_insert_uninit(&block->ranges, rangeIndex, 1);
+    *vec_MemRange_at_mut(&block->ranges, rangeIndex) = (IIOMemoryRange) {freeRange.offset, headSize, iio_allocation_type_free};
+  }
+}
+
+static bool iio_block_release_range(
+  IIOMemoryBlock *                          block,
+  VkDeviceSize                              offset)
+
+{
+  //  binary search for the range starting at offset
+  isize low = 0;
+  isize high = vec_MemRange_size(&block->ranges) - 1;
+  isize index = -1;
+  while (low <= high) {
+    isize mid = (low + high) / 2;
+    VkDeviceSize midOffset = vec_MemRange_at(&block->ranges, mid)->offset;
+    if (midOffset == offset) {
+      index = mid;
+      break;
+    } else if (midOffset < offset) {
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+  if (index < 0 || vec_MemRange_at(&block->ranges, index)->type == iio_allocation_type_free) {
+    return false;
+  }
+
+  IIOMemoryRange * range = vec_MemRange_at_mut(&block->ranges, index);
+  range->type = iio_allocation_type_free;
+  block->usedBytes -= range->size;
+  block->allocationCount--;
+
+  //  coalesce with the following and preceding free ranges
+  if (index + 1 < vec_MemRange_size(&block->ranges)) {
+    const IIOMemoryRange * next = vec_MemRange_at(&block->ranges, index + 1);
+    if (next->type == iio_allocation_type_free) {
+      range->size += next->size;
+      vec_MemRange_erase_n(&block->ranges, index + 1, 1);
+    }
+  }
+  if (index > 0) {
+    IIOMemoryRange * prev = vec_MemRange_at_mut(&block->ranges, index - 1);
+    if (prev->type == iio_allocation_type_free) {
+      prev->size += vec_MemRange_at(&block->ranges, index)->size;
+      vec_MemRange_erase_n(&block->ranges, index, 1);
+    }
+  }
+  return true;
+}
+
+static VkResult iio_create_memory_block(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  uint32_t                                  memoryTypeIndex,
+  VkDeviceSize                              minimumSize,
+  IIOMemoryBlock **                         block)
+
+{
+  VkDeviceSize blockSize = allocator->blockSizes[memoryTypeIndex];
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkResult result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+  //  if the full block size cannot be allocated, retry with smaller blocks
+  while (blockSize >= minimumSize) {
+    VkMemoryAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = blockSize;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+    result = vkAllocateMemory(device, &allocInfo, NULL, &memory);
+    if (result == VK_SUCCESS) break;
+    if (blockSize / 2 < minimumSize) break;
+    blockSize /= 2;
+  }
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+
+  IIOMemoryBlock newBlock = {0};
+  newBlock.memory = memory;
+  newBlock.size = blockSize;
+  newBlock.ranges = vec_MemRange_init();
+  vec_MemRange_push(&newBlock.ranges, (IIOMemoryRange) {0, blockSize, iio_allocation_type_free});
+
+  //  host visible blocks stay mapped for their whole lifetime
+  VkMemoryPropertyFlags flags = allocator->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+  if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    result = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &newBlock.mapped);
+    if (result != VK_SUCCESS) {
+      vec_MemRange_drop(&newBlock.ranges);
+      vkFreeMemory(device, memory, NULL);
+      return result;
+    }
+  }
+
+  *block = vec_MemBlock_push(&allocator->blocks[memoryTypeIndex], newBlock);
+  return VK_SUCCESS;
+}
+
+static VkResult iio_allocate_dedicated_memory(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  const VkMemoryRequirements *              requirements,
+  uint32_t                                  memoryTypeIndex,
+  const VkMemoryDedicatedAllocateInfo *     dedicatedInfo,
+  IIOAllocation *                           allocation)
+
+{
+  VkMemoryAllocateInfo allocInfo = {0};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.pNext = dedicatedInfo;
+  allocInfo.allocationSize = requirements->size;
+  allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+  VkResult result = vkAllocateMemory(device, &allocInfo, NULL, &allocation->memory);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+
+  allocation->offset = 0;
+  allocation->size = requirements->size;
+  allocation->memoryTypeIndex = memoryTypeIndex;
+  allocation->dedicated = true;
+  allocation->mapped = NULL;
+
+  VkMemoryPropertyFlags flags = allocator->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+  if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    result = vkMapMemory(device, allocation->memory, 0, VK_WHOLE_SIZE, 0, &allocation->mapped);
+    if (result != VK_SUCCESS) {
+      vkFreeMemory(device, allocation->memory, NULL);
+      allocation->memory = VK_NULL_HANDLE;
+      return result;
+    }
+  }
+
+  allocator->dedicatedAllocationCount++;
+  allocator->dedicatedBytes += requirements->size;
+  return VK_SUCCESS;
+}
+
+/*************************************
+ *        allocator functions        *
+ *************************************/
+
+void iio_create_memory_allocator(
+  VkPhysicalDevice                          physicalDevice,
+  VkDeviceSize                              preferredBlockSize,
+  IIOMemoryAllocator *                      allocator)
+
+{
+  if (!physicalDevice) {
+    fprintf(stderr, "Tried to create memory allocator with a NULL physical device\n");
+    return;
+  } else if (!allocator) {
+    fprintf(stderr, "Tried to return to a NULL IIOMemoryAllocator pointer\n");
+    return;
+  }
+
+  memset(allocator, 0, sizeof(IIOMemoryAllocator));
+
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &allocator->memoryProperties);
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  allocator->bufferImageGranularity = properties.limits.bufferImageGranularity > 0 ? properties.limits.bufferImageGranularity : 1;
+
+  if (preferredBlockSize == 0) {
+    preferredBlockSize = IIO_DEFAULT_MEMORY_BLOCK_SIZE;
+  }
+
+  for (uint32_t i = 0; i < allocator->memoryProperties.memoryTypeCount; i++) {
+    //  small heaps (integrated gpus, host visible device local windows) get proportionally smaller blocks
+    uint32_t heapIndex = allocator->memoryProperties.memoryTypes[i].heapIndex;
+    VkDeviceSize heapSize = allocator->memoryProperties.memoryHeaps[heapIndex].size;
+    allocator->blockSizes[i] = heapSize <= IIO_SMALL_HEAP_MAX_SIZE ? iio_align_up(heapSize / 8, 32) : preferredBlockSize;
+    allocator->blocks[i] = vec_MemBlock_init();
+  }
+
+  allocator->isInitialized = true;
+}
+
+void iio_destroy_memory_allocator(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator)
+
+{
+  if (!device) {
+    fprintf(stderr, "Tried to destroy memory allocator with a NULL device\n");
+    return;
+  } else if (!allocator || !allocator->isInitialized) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < allocator->memoryProperties.memoryTypeCount; i++) {
+    for (c_each(block, vec_MemBlock, allocator->blocks[i])) {
+      if (block.ref->allocationCount > 0) {
+        fprintf(stderr, "iio_destroy_memory_allocator: %u allocations still alive in memory type %u\n", block.ref->allocationCount, i);
+      }
+      if (block.ref->mapped) vkUnmapMemory(device, block.ref->memory);
+      vkFreeMemory(device, block.ref->memory, NULL);
+      vec_MemRange_drop(&block.ref->ranges);
+    }
+    vec_MemBlock_drop(&allocator->blocks[i]);
+  }
+  if (allocator->dedicatedAllocationCount > 0) {
+    fprintf(stderr, "iio_destroy_memory_allocator: %u dedicated allocations still alive\n", allocator->dedicatedAllocationCount);
+  }
+
+  memset(allocator, 0, sizeof(IIOMemoryAllocator));
+}
+
+uint32_t iio_find_allocator_memory_type(
+  const IIOMemoryAllocator *                allocator,
+  uint32_t                                  typeFilter,
+  VkMemoryPropertyFlags                     properties)
+
+{
+  for (uint32_t i = 0; i < allocator->memoryProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) &&
+        (allocator->memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+      return i;
+    }
+  }
+  return UINT32_MAX;
+}
+
+VkResult iio_allocate_memory(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  const VkMemoryRequirements *              requirements,
+  VkMemoryPropertyFlags                     properties,
+  IIOAllocationType                         type,
+  const VkMemoryDedicatedAllocateInfo *     dedicatedInfo,
+  IIOAllocation *                           allocation)
+
+{
+  if (!device || !allocator || !allocator->isInitialized || !requirements || !allocation) {
+    fprintf(stderr, "iio_allocate_memory failed: invalid arguments\n");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  memset(allocation, 0, sizeof(IIOAllocation));
+
+  uint32_t memoryTypeIndex = iio_find_allocator_memory_type(allocator, requirements->memoryTypeBits, properties);
+  if (memoryTypeIndex == UINT32_MAX) {
+    fprintf(stderr, "Failed to find suitable memory type\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  //  large resources and resources the driver wants on their own go into dedicated allocations
+  VkDeviceSize blockSize = allocator->blockSizes[memoryTypeIndex];
+  if (dedicatedInfo || requirements->size > blockSize / 2) {
+    return iio_allocate_dedicated_memory(device, allocator, requirements, memoryTypeIndex, dedicatedInfo, allocation);
+  }
+
+  IIOMemoryBlock * block = NULL;
+  isize rangeIndex = 0;
+  VkDeviceSize offset = 0;
+  for (c_each(it, vec_MemBlock, allocator->blocks[memoryTypeIndex])) {
+    if (it.ref->size - it.ref->usedBytes < requirements->size) continue;
+    if (iio_block_find_range(it.ref, requirements->size, requirements->alignment, type, allocator->bufferImageGranularity, &rangeIndex, &offset)) {
+      block = it.ref;
+      break;
+    }
+  }
+
+  if (!block) {
+    VkResult result = iio_create_memory_block(device, allocator, memoryTypeIndex, requirements->size, &block);
+    if (result != VK_SUCCESS) {
+      //  the heap may still have room for a single exact fit allocation
+      return iio_allocate_dedicated_memory(device, allocator, requirements, memoryTypeIndex, NULL, allocation);
+    }
+    if (!iio_block_find_range(block, requirements->size, requirements->alignment, type, allocator->bufferImageGranularity, &rangeIndex, &offset)) {
+      fprintf(stderr, "iio_allocate_memory failed: new block cannot hold the allocation\n");
+      return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+  }
+
+  iio_block_split_range(block, rangeIndex, offset, requirements->size, type);
+  block->usedBytes += requirements->size;
+  block->allocationCount++;
+
+  allocation->memory = block->memory;
+  allocation->offset = offset;
+  allocation->size = requirements->size;
+  allocation->memoryTypeIndex = memoryTypeIndex;
+  allocation->dedicated = false;
+  allocation->mapped = block->mapped ? (uint8_t *) block->mapped + offset : NULL;
+  return VK_SUCCESS;
+}
+
+VkResult iio_allocate_buffer_memory(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  VkBuffer                                  buffer,
+  VkMemoryPropertyFlags                     properties,
+  IIOAllocation *                           allocation)
+
+{
+  VkMemoryDedicatedRequirements dedicatedRequirements = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS,
+  };
+  VkMemoryRequirements2 memoryRequirements = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+    .pNext = &dedicatedRequirements,
+  };
+  VkBufferMemoryRequirementsInfo2 requirementsInfo = {
+    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2,
+    .buffer = buffer,
+  };
+  vkGetBufferMemoryRequirements2(device, &requirementsInfo, &memoryRequirements);
+
+  VkMemoryDedicatedAllocateInfo dedicatedInfo = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+    .buffer = buffer,
+  };
+  bool useDedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+
+  VkResult result = iio_allocate_memory(
+    device, allocator,
+    &memoryRequirements.memoryRequirements,
+    properties,
+    iio_allocation_type_linear,
+    useDedicated ? &dedicatedInfo : NULL,
+    allocation
+  );
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  return vkBindBufferMemory(device, buffer, allocation->memory, allocation->offset);
+}
+
+VkResult iio_allocate_image_memory(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  VkImage                                   image,
+  VkImageTiling                             tiling,
+  VkMemoryPropertyFlags                     properties,
+  IIOAllocation *                           allocation)
+
+{
+  VkMemoryDedicatedRequirements dedicatedRequirements = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS,
+  };
+  VkMemoryRequirements2 memoryRequirements = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+    .pNext = &dedicatedRequirements,
+  };
+  VkImageMemoryRequirementsInfo2 requirementsInfo = {
+    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2,
+    .image = image,
+  };
+  vkGetImageMemoryRequirements2(device, &requirementsInfo, &memoryRequirements);
+
+  VkMemoryDedicatedAllocateInfo dedicatedInfo = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+    .image = image,
+  };
+  bool useDedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+
+  VkResult result = iio_allocate_memory(
+    device, allocator,
+    &memoryRequirements.memoryRequirements,
+    properties,
+    tiling == VK_IMAGE_TILING_OPTIMAL ? iio_allocation_type_optimal : iio_allocation_type_linear,
+    useDedicated ? &dedicatedInfo : NULL,
+    allocation
+  );
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  return vkBindImageMemory(device, image, allocation->memory, allocation->offset);
+}
+
+void iio_free_memory(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOAllocation *                           allocation)
+
+{
+  if (!allocation || allocation->memory == VK_NULL_HANDLE) {
+    return;
+  } else if (!device || !allocator || !allocator->isInitialized) {
+    fprintf(stderr, "iio_free_memory failed: invalid allocator\n");
+    return;
+  }
+
+  if (allocation->dedicated) {
+    if (allocation->mapped) vkUnmapMemory(device, allocation->memory);
+    vkFreeMemory(device, allocation->memory, NULL);
+    allocator->dedicatedAllocationCount--;
+    allocator->dedicatedBytes -= allocation->size;
+    memset(allocation, 0, sizeof(IIOAllocation));
+    return;
+  }
+
+  vec_MemBlock * blocks = &allocator->blocks[allocation->memoryTypeIndex];
+  isize blockCount = vec_MemBlock_size(blocks);
+  for (isize i = 0; i < blockCount; i++) {
+    IIOMemoryBlock * block = vec_MemBlock_at_mut(blocks, i);
+    if (block->memory != allocation->memory) continue;
+
+    if (!iio_block_release_range(block, allocation->offset)) {
+      fprintf(stderr, "iio_free_memory failed: no allocation at offset %llu\n", (unsigned long long) allocation->offset);
+      return;
+    }
+
+    //  keep one empty block per memory type around to avoid thrashing the driver
+    bool otherBlockEmpty = false;
+    for (isize j = 0; j < blockCount && !otherBlockEmpty && block->allocationCount == 0; j++) {
+      otherBlockEmpty = j != i && vec_MemBlock_at(blocks, j)->allocationCount == 0;
+    }
+    if (otherBlockEmpty) {
+      if (block->mapped) vkUnmapMemory(device, block->memory);
+      vkFreeMemory(device, block->memory, NULL);
+      vec_MemRange_drop(&block->ranges);
+      vec_MemBlock_erase_n(blocks, i, 1);
+    }
+    memset(allocation, 0, sizeof(IIOAllocation));
+    return;
+  }
+  fprintf(stderr, "iio_free_memory failed: allocation does not belong to this allocator\n");
+}
+
+/*****************************
+ *        statistics         *
+ *****************************/
+
+void iio_get_memory_stats(
+  const IIOMemoryAllocator *                allocator,
+  IIOMemoryStats *                          stats)
+
+{
+  memset(stats, 0, sizeof(IIOMemoryStats));
+  if (!allocator || !allocator->isInitialized) return;
+
+  for (uint32_t i = 0; i < allocator->memoryProperties.memoryTypeCount; i++) {
+    for (c_each(block, vec_MemBlock, allocator->blocks[i])) {
+      stats->blockCount++;
+      stats->allocationCount += block.ref->allocationCount;
+      stats->bytesAllocated += block.ref->size;
+      stats->bytesInUse += block.ref->usedBytes;
+      for (c_each(range, vec_MemRange, block.ref->ranges)) {
+        if (range.ref->type != iio_allocation_type_free) continue;
+        stats->bytesFree += range.ref->size;
+        if (range.ref->size > stats->largestFreeRange) stats->largestFreeRange = range.ref->size;
+      }
+    }
+  }
+
+  stats->dedicatedAllocationCount = allocator->dedicatedAllocationCount;
+  stats->allocationCount += allocator->dedicatedAllocationCount;
+  stats->bytesAllocated += allocator->dedicatedBytes;
+  stats->bytesInUse += allocator->dedicatedBytes;
+  stats->fragmentation = stats->bytesFree > 0 ? 1.0f - (float) stats->largestFreeRange / (float) stats->bytesFree : 0.0f;
+}
+
+void iio_print_memory_stats(
+  const IIOMemoryAllocator *                allocator)
+
+{
+  IIOMemoryStats stats;
+  iio_get_memory_stats(allocator, &stats);
+  fprintf(stdout, "memory allocator: %u blocks, %u dedicated, %u allocations\n", stats.blockCount, stats.dedicatedAllocationCount, stats.allocationCount);
+  fprintf(stdout, "  %llu bytes allocated, %llu bytes in use, %llu bytes free (largest range %llu)\n",
+    (unsigned long long) stats.bytesAllocated,
+    (unsigned long long) stats.bytesInUse,
+    (unsigned long long) stats.bytesFree,
+    (unsigned long long) stats.largestFreeRange);
+  fprintf(stdout, "  fragmentation: %.2f%%\n", stats.fragmentation * 100.0f);
+}
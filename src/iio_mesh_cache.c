@@ -0,0 +1,302 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "iio_mesh_cache.h"
+
+/*****************************
+ *      helper functions     *
+ *****************************/
+
+static uint64_t iio_cache_align(uint64_t value) {
+  return (value + IIO_MESH_CACHE_ALIGNMENT - 1) & ~(uint64_t) (IIO_MESH_CACHE_ALIGNMENT - 1);
+}
+
+static bool iio_cache_range_valid(uint64_t offset, uint64_t size, size_t fileSize) {
+  return offset <= fileSize && size <= fileSize - offset;
+}
+
+static bool iio_write_padding(FILE * file, uint64_t * position) {
+  static const uint8_t zeros [IIO_MESH_CACHE_ALIGNMENT] = {0};
+  uint64_t aligned = iio_cache_align(*position);
+  if (aligned != *position && fwrite(zeros, 1, aligned - *position, file) != aligned - *position) return false;
+  *position = aligned;
+  return true;
+}
+
+static bool iio_write_bytes(FILE * file, const void * data, uint64_t size, uint64_t * position) {
+  if (size && fwrite(data, 1, size, file) != size) return false;
+  *position += size;
+  return true;
+}
+
+static uint64_t iio_hash_append(
+  uint64_t                                  hash,
+  const void *                              bytes,
+  size_t                                    size)
+
+{
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ ((const uint8_t *) bytes)[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+uint64_t iio_hash_bytes(
+  const uint8_t *                           bytes,
+  size_t                                    size)
+
+{
+  return iio_hash_append(14695981039346656037ull, bytes, size); // FNV-1a
+}
+
+/*****************************
+ *          lookup           *
+ *****************************/
+
+bool iio_cache_file_path(
+  const char *                              name,
+  const char *                              extension,
+  char *                                    path,
+  size_t                                    size)
+
+{
+  //  nested paths are flattened so every cache file lives directly in the cache directory
+  int len = snprintf(path, size, "%s%s%s", IIO_PATH_TO_MESH_CACHE, name, extension);
+  if (len < 0 || (size_t) len >= size) return false;
+  for (char * c = path + strlen(IIO_PATH_TO_MESH_CACHE); *c; c++) {
+    if (*c == '/') *c = '_';
+  }
+  return true;
+}
+
+bool iio_create_cache_directory() {
+  if (mkdir(IIO_PATH_TO_MESH_CACHE, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "could not create %s\n", IIO_PATH_TO_MESH_CACHE);
+    return false;
+  }
+  return true;
+}
+
+bool iio_mesh_cache_path(
+  const char *                              filename,
+  char *                                    path,
+  size_t                                    size)
+
+{
+  return iio_cache_file_path(filename, ".iiomesh", path, size);
+}
+
+bool iio_compute_mesh_cache_key(
+  const char *                              sourcePath,
+  const char * const *                      dependencyPaths,
+  uint32_t                                  dependencyCount,
+  const uint32_t *                          settings,
+  IIOMeshCacheKey *                         key)
+
+{
+  memset(key, 0, sizeof(IIOMeshCacheKey));
+
+  //  buffers are not hashed byte by byte, they are large and rewritten as a whole by exporters
+  uint64_t dependencyHash = 14695981039346656037ull;
+  for (uint32_t i = 0; i < dependencyCount; i++) {
+    struct stat dependency;
+    if (stat(dependencyPaths[i], &dependency) != 0) return false;
+    uint64_t mtime = (uint64_t) dependency.st_mtim.tv_sec * 1000000000ull + (uint64_t) dependency.st_mtim.tv_nsec;
+    uint64_t size = (uint64_t) dependency.st_size;
+    dependencyHash = iio_hash_append(dependencyHash, dependencyPaths[i], strlen(dependencyPaths[i]));
+    dependencyHash = iio_hash_append(dependencyHash, &size, sizeof(size));
+    dependencyHash = iio_hash_append(dependencyHash, &mtime, sizeof(mtime));
+  }
+  key->dependencyHash = dependencyHash;
+
+  int fd = open(sourcePath, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return false;
+  }
+
+  key->sourceMtime = (uint64_t) info.st_mtim.tv_sec * 1000000000ull + (uint64_t) info.st_mtim.tv_nsec;
+  key->sourceSize = (uint64_t) info.st_size;
+  memcpy(key->settings, settings, sizeof(key->settings));
+  if (info.st_size > 0) {
+    void * source = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (source == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    key->sourceHash = iio_hash_bytes(source, (size_t) info.st_size);
+    munmap(source, (size_t) info.st_size);
+  }
+  close(fd);
+  return true;
+}
+
+bool iio_map_mesh_cache(
+  const char *                              cachePath,
+  const IIOMeshCacheKey *                   key,
+  IIOMappedMeshCache *                      mapped)
+
+{
+  memset(mapped, 0, sizeof(IIOMappedMeshCache));
+  int fd = open(cachePath, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(IIOMeshCacheHeader)) {
+    close(fd);
+    return false;
+  }
+  void * base = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) return false;
+
+  mapped->base = base;
+  mapped->size = (size_t) info.st_size;
+  mapped->header = base;
+
+  const IIOMeshCacheHeader * header = mapped->header;
+  bool valid =
+    header->magic == IIO_MESH_CACHE_MAGIC &&
+    header->version == IIO_MESH_CACHE_VERSION &&
+    header->fileSize == mapped->size &&
+    memcmp(&header->key, key, sizeof(IIOMeshCacheKey)) == 0 &&
+    iio_cache_range_valid(header->meshesOffset, (uint64_t) header->meshCount * sizeof(IIOMeshCacheMesh), mapped->size) &&
+    iio_cache_range_valid(header->primitivesOffset, (uint64_t) header->primitiveCount * sizeof(IIOMeshCachePrimitive), mapped->size) &&
+    iio_cache_range_valid(header->imagesOffset, (uint64_t) header->imageCount * sizeof(IIOMeshCacheImage), mapped->size);
+  if (!valid) {
+    iio_unmap_mesh_cache(mapped);
+    return false;
+  }
+
+  mapped->meshes = (const IIOMeshCacheMesh *) (mapped->base + header->meshesOffset);
+  mapped->primitives = (const IIOMeshCachePrimitive *) (mapped->base + header->primitivesOffset);
+  mapped->images = (const IIOMeshCacheImage *) (mapped->base + header->imagesOffset);
+
+  //  everything the loader dereferences has to be inside the mapping
+  for (uint32_t i = 0; i < header->meshCount && valid; i++) {
+    const IIOMeshCacheMesh * mesh = &mapped->meshes[i];
+    valid = mesh->firstPrimitive <= header->primitiveCount && mesh->primitiveCount <= header->primitiveCount - mesh->firstPrimitive;
+  }
+  for (uint32_t i = 0; i < header->primitiveCount && valid; i++) {
+    const IIOMeshCachePrimitive * primitive = &mapped->primitives[i];
+    valid =
+      primitive->vertexDataSize == (uint64_t) primitive->vertexCount * primitive->vertexStride &&
+      iio_cache_range_valid(primitive->vertexDataOffset, primitive->vertexDataSize, mapped->size) &&
+      iio_cache_range_valid(primitive->indexDataOffset, primitive->indexDataSize, mapped->size);
+    for (int t = 0; t < iio_mesh_cache_texture_maxenum && valid; t++) {
+      valid = primitive->material.images[t] >= -1 && primitive->material.images[t] < (int32_t) header->imageCount;
+    }
+  }
+  for (uint32_t i = 0; i < header->imageCount && valid; i++) {
+    const IIOMeshCacheImage * image = &mapped->images[i];
+    valid = image->source < iio_mesh_cache_image_maxenum && iio_cache_range_valid(image->dataOffset, image->dataSize, mapped->size);
+    if (valid && image->source == iio_mesh_cache_image_uri) {
+      valid = image->dataSize > 0 && mapped->base[image->dataOffset + image->dataSize - 1] == '\0';
+    }
+  }
+  if (!valid) {
+    fprintf(stderr, "iio_map_mesh_cache: %s is corrupt, ignoring it\n", cachePath);
+    iio_unmap_mesh_cache(mapped);
+    return false;
+  }
+  return true;
+}
+
+void iio_unmap_mesh_cache(
+  IIOMappedMeshCache *                      mapped)
+
+{
+  if (mapped->base) munmap((void *) mapped->base, mapped->size);
+  memset(mapped, 0, sizeof(IIOMappedMeshCache));
+}
+
+/*****************************
+ *          baking           *
+ *****************************/
+
+bool iio_write_mesh_cache(
+  const char *                              cachePath,
+  const IIOMeshCacheKey *                   key,
+  const IIOMeshCacheMesh *                  meshes,
+  uint32_t                                  meshCount,
+  IIOMeshCachePrimitive *                   primitives,
+  const IIOMeshCacheBlob *                  vertexBlobs,
+  const IIOMeshCacheBlob *                  indexBlobs,
+  uint32_t                                  primitiveCount,
+  IIOMeshCacheImage *                       images,
+  const IIOMeshCacheBlob *                  imageBlobs,
+  uint32_t                                  imageCount)
+
+{
+  if (!iio_create_cache_directory()) return false;
+
+  //  lay out the tables first, the blobs follow in the order they are written
+  IIOMeshCacheHeader header = {
+    .magic = IIO_MESH_CACHE_MAGIC,
+    .version = IIO_MESH_CACHE_VERSION,
+    .key = *key,
+    .meshCount = meshCount,
+    .primitiveCount = primitiveCount,
+    .imageCount = imageCount,
+  };
+  uint64_t offset = iio_cache_align(sizeof(IIOMeshCacheHeader));
+  header.meshesOffset = offset;
+  offset = iio_cache_align(offset + (uint64_t) meshCount * sizeof(IIOMeshCacheMesh));
+  header.primitivesOffset = offset;
+  offset = iio_cache_align(offset + (uint64_t) primitiveCount * sizeof(IIOMeshCachePrimitive));
+  header.imagesOffset = offset;
+  offset = iio_cache_align(offset + (uint64_t) imageCount * sizeof(IIOMeshCacheImage));
+
+  for (uint32_t i = 0; i < primitiveCount; i++) {
+    primitives[i].vertexDataOffset = offset;
+    primitives[i].vertexDataSize = vertexBlobs[i].size;
+    offset = iio_cache_align(offset + vertexBlobs[i].size);
+    primitives[i].indexDataOffset = offset;
+    primitives[i].indexDataSize = indexBlobs[i].size;
+    offset = iio_cache_align(offset + indexBlobs[i].size);
+  }
+  for (uint32_t i = 0; i < imageCount; i++) {
+    images[i].dataOffset = offset;
+    images[i].dataSize = imageBlobs[i].size;
+    offset = iio_cache_align(offset + imageBlobs[i].size);
+  }
+  header.fileSize = offset;
+
+  char tempPath [512];
+  int len = snprintf(tempPath, sizeof(tempPath), "%s.%ld.tmp", cachePath, (long) getpid());
+  if (len < 0 || (size_t) len >= sizeof(tempPath)) return false;
+  FILE * file = fopen(tempPath, "wb");
+  if (!file) {
+    fprintf(stderr, "iio_write_mesh_cache: could not open %s\n", tempPath);
+    return false;
+  }
+
+  uint64_t position = 0;
+  bool ok =
+    iio_write_bytes(file, &header, sizeof(header), &position) && iio_write_padding(file, &position) &&
+    iio_write_bytes(file, meshes, (uint64_t) meshCount * sizeof(IIOMeshCacheMesh), &position) && iio_write_padding(file, &position) &&
+    iio_write_bytes(file, primitives, (uint64_t) primitiveCount * sizeof(IIOMeshCachePrimitive), &position) && iio_write_padding(file, &position) &&
+    iio_write_bytes(file, images, (uint64_t) imageCount * sizeof(IIOMeshCacheImage), &position) && iio_write_padding(file, &position);
+  for (uint32_t i = 0; i < primitiveCount && ok; i++) {
+    ok =
+      iio_write_bytes(file, vertexBlobs[i].data, vertexBlobs[i].size, &position) && iio_write_padding(file, &position) &&
+      iio_write_bytes(file, indexBlobs[i].data, indexBlobs[i].size, &position) && iio_write_padding(file, &position);
+  }
+  for (uint32_t i = 0; i < imageCount && ok; i++) {
+    ok = iio_write_bytes(file, imageBlobs[i].data, imageBlobs[i].size, &position) && iio_write_padding(file, &position);
+  }
+  ok = fclose(file) == 0 && ok && position == header.fileSize;
+
+  if (!ok || rename(tempPath, cachePath) != 0) {
+    fprintf(stderr, "iio_write_mesh_cache: failed to write %s\n", cachePath);
+    remove(tempPath);
+    return false;
+  }
+  return true;
+}
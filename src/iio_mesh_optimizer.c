@@ -0,0 +1,467 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "iio_mesh_optimizer.h"
+
+/*****************************
+ *          metrics          *
+ *****************************/
+
+float iio_vertex_cache_acmr(
+  const IIOVertexCacheStats *               stats)
+
+{
+  return stats->triangleCount ? (float) stats->cacheMisses / (float) stats->triangleCount : 0.0f;
+}
+
+float iio_vertex_cache_atvr(
+  const IIOVertexCacheStats *               stats)
+
+{
+  return stats->vertexCount ? (float) stats->cacheMisses / (float) stats->vertexCount : 0.0f;
+}
+
+void iio_analyze_vertex_cache(
+  const uint32_t *                          indices,
+  size_t                                    indexCount,
+  size_t                                    vertexCount,
+  IIOVertexCacheStats *                     stats)
+
+{
+  memset(stats, 0, sizeof(IIOVertexCacheStats));
+  stats->triangleCount = (uint32_t) (indexCount / 3);
+  stats->vertexCount = (uint32_t) vertexCount;
+
+  //  FIFO: a vertex is cached while fewer than IIO_VERTEX_CACHE_SIZE misses happened since its own
+  uint32_t * insertedAt = calloc(vertexCount ? vertexCount : 1, sizeof(uint32_t));
+  if (!insertedAt) return;
+  uint32_t time = IIO_VERTEX_CACHE_SIZE + 1;
+  for (size_t i = 0; i < indexCount; i++) {
+    uint32_t v = indices[i];
+    if (v >= vertexCount) continue;
+    if (time - insertedAt[v] > IIO_VERTEX_CACHE_SIZE) {
+      insertedAt[v] = time++;
+      stats->cacheMisses++;
+    }
+  }
+  free(insertedAt);
+}
+
+/*****************************
+ *      deduplication        *
+ *****************************/
+
+static uint32_t iio_hash_vertex(const uint8_t * vertex, size_t vertexSize) {
+  uint32_t hash = 2166136261u; // FNV-1a
+  for (size_t i = 0; i < vertexSize; i++) {
+    hash = (hash ^ vertex[i]) * 16777619u;
+  }
+  return hash;
+}
+
+size_t iio_generate_vertex_remap(
+  uint32_t *                                remap,
+  const uint32_t *                          indices,
+  size_t                                    indexCount,
+  const void *                              vertices,
+  size_t                                    vertexCount,
+  size_t                                    vertexSize)
+
+{
+  const uint8_t * bytes = vertices;
+  memset(remap, 0xff, vertexCount * sizeof(uint32_t));
+
+  size_t tableSize = 1;
+  while (tableSize < vertexCount * 2) tableSize <<= 1;
+  uint32_t * table = malloc(tableSize * sizeof(uint32_t));
+  if (!table) {
+    //  no deduplication, only drop unreferenced vertices
+    size_t next = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+      uint32_t v = indices ? indices[i] : (uint32_t) i;
+      if (v < vertexCount && remap[v] == ~0u) remap[v] = (uint32_t) next++;
+    }
+    return next;
+  }
+  memset(table, 0xff, tableSize * sizeof(uint32_t));
+
+  size_t next = 0;
+  for (size_t i = 0; i < indexCount; i++) {
+    uint32_t v = indices ? indices[i] : (uint32_t) i;
+    if (v >= vertexCount || remap[v] != ~0u) continue;
+
+    //  linear probing, the table stores the first original vertex of every unique value
+    const uint8_t * vertex = bytes + v * vertexSize;
+    size_t slot = iio_hash_vertex(vertex, vertexSize) & (tableSize - 1);
+    while (table[slot] != ~0u && memcmp(bytes + table[slot] * vertexSize, vertex, vertexSize) != 0) {
+      slot = (slot + 1) & (tableSize - 1);
+    }
+    if (table[slot] == ~0u) {
+      table[slot] = v;
+      remap[v] = (uint32_t) next++;
+    } else {
+      remap[v] = remap[table[slot]];
+    }
+  }
+
+  free(table);
+  return next;
+}
+
+void iio_remap_vertex_buffer(
+  void *                                    dst,
+  const void *                              vertices,
+  size_t                                    vertexCount,
+  size_t                                    vertexSize,
+  const uint32_t *                          remap)
+
+{
+  for (size_t v = 0; v < vertexCount; v++) {
+    if (remap[v] == ~0u) continue;
+    memcpy((uint8_t *) dst + remap[v] * vertexSize, (const uint8_t *) vertices + v * vertexSize, vertexSize);
+  }
+}
+
+void iio_remap_index_buffer(
+  uint32_t *                                dst,
+  const uint32_t *                          indices,
+  size_t                                    indexCount,
+  const uint32_t *                          remap)
+
+{
+  for (size_t i = 0; i < indexCount; i++) {
+    dst[i] = remap[indices ? indices[i] : (uint32_t) i];
+  }
+}
+
+/*****************************
+ *       vertex cache        *
+ *****************************/
+
+typedef struct IIOTipsifyState_S {
+  const uint32_t *                          indices;
+  size_t                                    vertexCount;
+  uint32_t *                                adjacencyOffsets; // vertexCount + 1 entries into adjacency
+  uint32_t *                                adjacency; // triangles using each vertex
+  uint32_t *                                liveTriangles;
+  uint32_t *                                cacheTime;
+  uint32_t *                                deadEnds; // stack of recently emitted vertices
+  size_t                                    deadEndCount;
+  uint32_t *                                candidates;
+  size_t                                    candidateCount;
+  uint32_t                                  time;
+  size_t                                    cursor; // next vertex to try once the dead-end stack is empty
+} IIOTipsifyState;
+
+static int64_t iio_tipsify_skip_dead_end(IIOTipsifyState * ts) {
+  while (ts->deadEndCount > 0) {
+    uint32_t d = ts->deadEnds[--ts->deadEndCount];
+    if (ts->liveTriangles[d] > 0) return d;
+  }
+  while (ts->cursor < ts->vertexCount) {
+    if (ts->liveTriangles[ts->cursor] > 0) return (int64_t) ts->cursor;
+    ts->cursor++;
+  }
+  return -1;
+}
+
+//  prefers candidates that are still in the cache after their remaining triangles are emitted. candidates
+//  that would fall out of it have priority 0 and never win, the dead-end stack picks the next vertex then
+static int64_t iio_tipsify_next_vertex(IIOTipsifyState * ts, bool * restarted) {
+  int64_t best = -1;
+  int64_t bestPriority = 0;
+  for (size_t i = 0; i < ts->candidateCount; i++) {
+    uint32_t v = ts->candidates[i];
+    if (ts->liveTriangles[v] == 0) continue;
+    int64_t priority = 0;
+    int64_t age = (int64_t) ts->time - (int64_t) ts->cacheTime[v];
+    if (age + 2 * (int64_t) ts->liveTriangles[v] <= IIO_VERTEX_CACHE_SIZE) priority = age;
+    if (priority > bestPriority) {
+      bestPriority = priority;
+      best = v;
+    }
+  }
+  *restarted = best < 0;
+  return best >= 0 ? best : iio_tipsify_skip_dead_end(ts);
+}
+
+void iio_optimize_vertex_cache(
+  uint32_t *                                dst,
+  const uint32_t *                          indices,
+  size_t                                    indexCount,
+  size_t                                    vertexCount,
+  uint32_t *                                clusters,
+  size_t *                                  clusterCount)
+
+{
+  size_t triangleCount = indexCount / 3;
+  if (clusterCount) *clusterCount = 0;
+  if (triangleCount == 0 || vertexCount == 0) return;
+
+  IIOTipsifyState ts = {
+    .indices = indices,
+    .vertexCount = vertexCount,
+    .adjacencyOffsets = calloc(vertexCount + 1, sizeof(uint32_t)),
+    .adjacency = malloc(triangleCount * 3 * sizeof(uint32_t)),
+    .liveTriangles = calloc(vertexCount, sizeof(uint32_t)),
+    .cacheTime = calloc(vertexCount, sizeof(uint32_t)),
+    .deadEnds = malloc(triangleCount * 3 * sizeof(uint32_t)),
+    .candidates = malloc(triangleCount * 3 * sizeof(uint32_t)),
+    .time = IIO_VERTEX_CACHE_SIZE + 1,
+  };
+  bool * emitted = calloc(triangleCount, sizeof(bool));
+  if (!ts.adjacencyOffsets || !ts.adjacency || !ts.liveTriangles || !ts.cacheTime || !ts.deadEnds || !ts.candidates || !emitted) {
+    fprintf(stderr, "iio_optimize_vertex_cache: out of memory, keeping the original order\n");
+    memcpy(dst, indices, triangleCount * 3 * sizeof(uint32_t));
+    goto cleanup;
+  }
+
+  //  vertex to triangle adjacency in CSR form
+  for (size_t i = 0; i < triangleCount * 3; i++) ts.liveTriangles[indices[i]]++;
+  for (size_t v = 0; v < vertexCount; v++) ts.adjacencyOffsets[v + 1] = ts.adjacencyOffsets[v] + ts.liveTriangles[v];
+  uint32_t * fill = ts.cacheTime; // borrowed as a cursor, reset below
+  for (size_t i = 0; i < triangleCount * 3; i++) {
+    uint32_t v = indices[i];
+    ts.adjacency[ts.adjacencyOffsets[v] + fill[v]++] = (uint32_t) (i / 3);
+  }
+  memset(ts.cacheTime, 0, vertexCount * sizeof(uint32_t));
+
+  size_t written = 0;
+  bool restarted = true;
+  int64_t fan = iio_tipsify_skip_dead_end(&ts);
+  while (fan >= 0) {
+    if (restarted && clusters) clusters[(*clusterCount)++] = (uint32_t) written;
+    ts.candidateCount = 0;
+    for (uint32_t a = ts.adjacencyOffsets[fan]; a < ts.adjacencyOffsets[fan + 1]; a++) {
+      uint32_t t = ts.adjacency[a];
+      if (emitted[t]) continue;
+      emitted[t] = true;
+      for (int c = 0; c < 3; c++) {
+        uint32_t v = indices[t * 3 + c];
+        dst[written++] = v;
+        ts.deadEnds[ts.deadEndCount++] = v;
+        ts.candidates[ts.candidateCount++] = v;
+        ts.liveTriangles[v]--;
+        if (ts.time - ts.cacheTime[v] > IIO_VERTEX_CACHE_SIZE) ts.cacheTime[v] = ts.time++;
+      }
+    }
+    fan = iio_tipsify_next_vertex(&ts, &restarted);
+  }
+
+cleanup:
+  free(emitted);
+  free(ts.candidates);
+  free(ts.deadEnds);
+  free(ts.cacheTime);
+  free(ts.liveTriangles);
+  free(ts.adjacency);
+  free(ts.adjacencyOffsets);
+}
+
+/*****************************
+ *         overdraw          *
+ *****************************/
+
+typedef struct IIOClusterKey_S {
+  float                                     key;
+  uint32_t                                  cluster;
+} IIOClusterKey;
+
+static int iio_compare_cluster_keys(const void * a, const void * b) {
+  float ka = ((const IIOClusterKey *) a)->key;
+  float kb = ((const IIOClusterKey *) b)->key;
+  return ka > kb ? -1 : (ka < kb ? 1 : 0);
+}
+
+static const float * iio_vertex_position(const void * vertices, size_t vertexSize, uint32_t v) {
+  return (const float *) ((const uint8_t *) vertices + v * vertexSize);
+}
+
+void iio_optimize_overdraw(
+  uint32_t *                                dst,
+  const uint32_t *                          indices,
+  size_t                                    indexCount,
+  const uint32_t *                          clusters,
+  size_t                                    clusterCount,
+  const void *                              vertices,
+  size_t                                    vertexCount,
+  size_t                                    vertexSize)
+
+{
+  //  positions are read through the indices, so out of range ones leave the order as it is
+  bool indicesValid = true;
+  for (size_t i = 0; i < indexCount && indicesValid; i++) indicesValid = indices[i] < vertexCount;
+
+  IIOClusterKey * keys = indicesValid && clusterCount >= 2 ? malloc(clusterCount * sizeof(IIOClusterKey)) : NULL;
+  if (!keys) {
+    memcpy(dst, indices, indexCount * sizeof(uint32_t));
+    free(keys);
+    return;
+  }
+
+  //  mesh centroid, area weighted
+  float meshCentroid [3] = {0.0f, 0.0f, 0.0f};
+  float meshArea = 0.0f;
+  for (size_t i = 0; i + 2 < indexCount; i += 3) {
+    const float * p0 = iio_vertex_position(vertices, vertexSize, indices[i]);
+    const float * p1 = iio_vertex_position(vertices, vertexSize, indices[i + 1]);
+    const float * p2 = iio_vertex_position(vertices, vertexSize, indices[i + 2]);
+    float e1 [3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    float e2 [3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    float n [3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+    float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    for (int c = 0; c < 3; c++) meshCentroid[c] += (p0[c] + p1[c] + p2[c]) / 3.0f * area;
+    meshArea += area;
+  }
+  if (meshArea > 0.0f) {
+    for (int c = 0; c < 3; c++) meshCentroid[c] /= meshArea;
+  }
+
+  //  clusters whose surface points away from the centroid tend to occlude the others, draw them first
+  for (size_t k = 0; k < clusterCount; k++) {
+    size_t begin = clusters[k];
+    size_t end = k + 1 < clusterCount ? clusters[k + 1] : indexCount;
+    float centroid [3] = {0.0f, 0.0f, 0.0f};
+    float normal [3] = {0.0f, 0.0f, 0.0f};
+    float area = 0.0f;
+    for (size_t i = begin; i + 2 < end; i += 3) {
+      const float * p0 = iio_vertex_position(vertices, vertexSize, indices[i]);
+      const float * p1 = iio_vertex_position(vertices, vertexSize, indices[i + 1]);
+      const float * p2 = iio_vertex_position(vertices, vertexSize, indices[i + 2]);
+      float e1 [3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      float e2 [3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      float n [3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+      float a = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (int c = 0; c < 3; c++) {
+        centroid[c] += (p0[c] + p1[c] + p2[c]) / 3.0f * a;
+        normal[c] += n[c];
+      }
+      area += a;
+    }
+    float normalLength = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    float key = 0.0f;
+    if (area > 0.0f && normalLength > 0.0f) {
+      for (int c = 0; c < 3; c++) key += (centroid[c] / area - meshCentroid[c]) * normal[c] / normalLength;
+    }
+    keys[k] = (IIOClusterKey) {.key = key, .cluster = (uint32_t) k};
+  }
+
+  qsort(keys, clusterCount, sizeof(IIOClusterKey), iio_compare_cluster_keys);
+
+  size_t written = 0;
+  for (size_t k = 0; k < clusterCount; k++) {
+    uint32_t cluster = keys[k].cluster;
+    size_t begin = clusters[cluster];
+    size_t end = cluster + 1 < clusterCount ? clusters[cluster + 1] : indexCount;
+    memcpy(dst + written, indices + begin, (end - begin) * sizeof(uint32_t));
+    written += end - begin;
+  }
+  free(keys);
+}
+
+/*****************************
+ *       vertex fetch        *
+ *****************************/
+
+size_t iio_optimize_vertex_fetch_remap(
+  uint32_t *                                remap,
+  const uint32_t *                          indices,
+  size_t                                    indexCount,
+  size_t                                    vertexCount)
+
+{
+  memset(remap, 0xff, vertexCount * sizeof(uint32_t));
+  size_t next = 0;
+  for (size_t i = 0; i < indexCount; i++) {
+    uint32_t v = indices[i];
+    if (v < vertexCount && remap[v] == ~0u) remap[v] = (uint32_t) next++;
+  }
+  return next;
+}
+
+/*****************************
+ *         pipeline          *
+ *****************************/
+
+bool iio_optimize_mesh(
+  void **                                   pVertices,
+  uint32_t *                                pVertexCount,
+  size_t                                    vertexSize,
+  uint32_t **                               pIndices,
+  uint32_t *                                pIndexCount,
+  IIOMeshOptimizeFlags                      flags,
+  IIOMeshOptimizeStats *                    stats)
+
+{
+  void * vertices = *pVertices;
+  size_t vertexCount = *pVertexCount;
+  uint32_t * indices = *pIndices;
+  size_t indexCount = indices ? *pIndexCount : vertexCount;
+  indexCount -= indexCount % 3;
+  if (indices) {
+    for (size_t i = 0; i < indexCount; i++) {
+      if (indices[i] >= vertexCount) return false;
+    }
+  }
+
+  uint32_t * remap = malloc((vertexCount ? vertexCount : 1) * sizeof(uint32_t));
+  uint32_t * newIndices = malloc((indexCount ? indexCount : 1) * sizeof(uint32_t));
+  uint32_t * scratch = malloc((indexCount ? indexCount : 1) * sizeof(uint32_t));
+  uint32_t * clusters = malloc((indexCount / 3 + 1) * sizeof(uint32_t));
+  void * newVertices = malloc((vertexCount ? vertexCount : 1) * vertexSize);
+  if (!remap || !newIndices || !scratch || !clusters || !newVertices) {
+    free(remap);
+    free(newIndices);
+    free(scratch);
+    free(clusters);
+    free(newVertices);
+    return false;
+  }
+
+  if (indices) memcpy(newIndices, indices, indexCount * sizeof(uint32_t));
+  else         for (size_t i = 0; i < indexCount; i++) newIndices[i] = (uint32_t) i;
+  if (stats) iio_analyze_vertex_cache(newIndices, indexCount, vertexCount, &stats->before);
+
+  //  every pass below keeps newIndices and newVertices in sync
+  memcpy(newVertices, vertices, vertexCount * vertexSize);
+  size_t newVertexCount = vertexCount;
+  if (flags & IIO_MESH_OPTIMIZE_DEDUPLICATE_BIT) {
+    newVertexCount = iio_generate_vertex_remap(remap, newIndices, indexCount, vertices, vertexCount, vertexSize);
+    iio_remap_index_buffer(newIndices, newIndices, indexCount, remap);
+    iio_remap_vertex_buffer(newVertices, vertices, vertexCount, vertexSize, remap);
+  }
+
+  if (flags & (IIO_MESH_OPTIMIZE_VERTEX_CACHE_BIT | IIO_MESH_OPTIMIZE_OVERDRAW_BIT)) {
+    size_t clusterCount = 0;
+    iio_optimize_vertex_cache(scratch, newIndices, indexCount, newVertexCount, clusters, &clusterCount);
+    if (flags & IIO_MESH_OPTIMIZE_OVERDRAW_BIT) {
+      iio_optimize_overdraw(newIndices, scratch, indexCount, clusters, clusterCount, newVertices, newVertexCount, vertexSize);
+    } else {
+      memcpy(newIndices, scratch, indexCount * sizeof(uint32_t));
+    }
+  }
+
+  if (flags & IIO_MESH_OPTIMIZE_VERTEX_FETCH_BIT) {
+    size_t fetchVertexCount = iio_optimize_vertex_fetch_remap(remap, newIndices, indexCount, newVertexCount);
+    iio_remap_index_buffer(newIndices, newIndices, indexCount, remap);
+    //  the remap only permutes, so the previous contents can be staged in the original buffer
+    memcpy(vertices, newVertices, newVertexCount * vertexSize);
+    iio_remap_vertex_buffer(newVertices, vertices, newVertexCount, vertexSize, remap);
+    newVertexCount = fetchVertexCount;
+  }
+
+  if (stats) iio_analyze_vertex_cache(newIndices, indexCount, newVertexCount, &stats->after);
+
+  free(remap);
+  free(scratch);
+  free(clusters);
+  free(vertices);
+  free(indices);
+  void * shrunk = realloc(newVertices, (newVertexCount ? newVertexCount : 1) * vertexSize);
+  *pVertices = shrunk ? shrunk : newVertices;
+  *pVertexCount = (uint32_t) newVertexCount;
+  *pIndices = newIndices;
+  *pIndexCount = (uint32_t) indexCount;
+  return true;
+}
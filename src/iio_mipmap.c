@@ -0,0 +1,141 @@
+#include <math.h>
+#include "iio_mipmap.h"
+
+#define IIO_SRGB_ENCODE_TABLE_SIZE 4096
+
+/*****************************
+ *      helper functions     *
+ *****************************/
+
+static float iio_srgb_to_linear(float c) {
+  return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float iio_linear_to_srgb(float c) {
+  return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+//  source texels and weights that make up texel d of the next level along one axis. an odd extent
+//  2 * dstExtent + 1 is split over the smaller level with a 3 tap filter, so its last texel is not dropped
+static uint32_t iio_mip_taps(
+  uint32_t                                  srcExtent,
+  uint32_t                                  dstExtent,
+  uint32_t                                  d,
+  uint32_t                                  index [3],
+  float                                     weight [3])
+
+{
+  if (srcExtent == 1) {
+    index[0] = 0;
+    weight[0] = 1.0f;
+    return 1;
+  } else if (!(srcExtent & 1)) {
+    index[0] = 2 * d;
+    index[1] = 2 * d + 1;
+    weight[0] = weight[1] = 0.5f;
+    return 2;
+  }
+  float scale = 1.0f / srcExtent;
+  for (uint32_t t = 0; t < 3; t++) index[t] = 2 * d + t;
+  weight[0] = (dstExtent - d) * scale;
+  weight[1] = dstExtent * scale;
+  weight[2] = (d + 1) * scale;
+  return 3;
+}
+
+/*****************************
+ *        mip chains         *
+ *****************************/
+
+uint32_t iio_mip_level_count(
+  uint32_t                                  width,
+  uint32_t                                  height)
+
+{
+  uint32_t extent = width > height ? width : height;
+  uint32_t levels = 1;
+  while (extent > 1) {
+    extent >>= 1;
+    levels++;
+  }
+  return levels;
+}
+
+size_t iio_mip_chain_size(
+  uint32_t                                  width,
+  uint32_t                                  height,
+  uint32_t                                  levelCount,
+  size_t                                    texelSize)
+
+{
+  size_t size = 0;
+  for (uint32_t level = 0; level < levelCount; level++) {
+    size += (size_t) iio_mip_extent(width, level) * iio_mip_extent(height, level) * texelSize;
+  }
+  return size;
+}
+
+void iio_generate_mip_chain_unorm8(
+  uint8_t *                                 chain,
+  uint32_t                                  width,
+  uint32_t                                  height,
+  uint32_t                                  levelCount,
+  uint32_t                                  channelCount,
+  bool                                      srgb)
+
+{
+  //  decoding goes through a byte table, encoding through a table over the linear range fine enough
+  //  that every 8 bit value stays reachable
+  float toLinear [256];
+  uint8_t toEncoded [IIO_SRGB_ENCODE_TABLE_SIZE];
+  for (int i = 0; i < 256; i++) {
+    toLinear[i] = srgb ? iio_srgb_to_linear(i / 255.0f) : i / 255.0f;
+  }
+  for (int i = 0; i < IIO_SRGB_ENCODE_TABLE_SIZE; i++) {
+    float c = (float) i / (IIO_SRGB_ENCODE_TABLE_SIZE - 1);
+    toEncoded[i] = (uint8_t) (255.0f * (srgb ? iio_linear_to_srgb(c) : c) + 0.5f);
+  }
+
+  const uint8_t * src = chain;
+  uint32_t srcWidth = width;
+  uint32_t srcHeight = height;
+  const uint32_t n = channelCount;
+  const uint32_t colorChannels = n < 3 ? n : 3;
+  for (uint32_t level = 1; level < levelCount; level++) {
+    uint8_t * dst = (uint8_t *) src + (size_t) srcWidth * srcHeight * n;
+    uint32_t dstWidth = iio_mip_extent(width, level);
+    uint32_t dstHeight = iio_mip_extent(height, level);
+
+    for (uint32_t y = 0; y < dstHeight; y++) {
+      uint32_t rows [3];
+      float rowWeights [3];
+      uint32_t rowCount = iio_mip_taps(srcHeight, dstHeight, y, rows, rowWeights);
+      for (uint32_t x = 0; x < dstWidth; x++) {
+        uint32_t columns [3];
+        float columnWeights [3];
+        uint32_t columnCount = iio_mip_taps(srcWidth, dstWidth, x, columns, columnWeights);
+        float linear [4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (uint32_t ty = 0; ty < rowCount; ty++) {
+          const uint8_t * row = src + (size_t) rows[ty] * srcWidth * n;
+          for (uint32_t tx = 0; tx < columnCount; tx++) {
+            const uint8_t * sample = row + (size_t) columns[tx] * n;
+            float w = rowWeights[ty] * columnWeights[tx];
+            for (uint32_t c = 0; c < colorChannels; c++) linear[c] += toLinear[sample[c]] * w;
+            for (uint32_t c = colorChannels; c < n; c++) linear[c] += sample[c] * w;
+          }
+        }
+        uint8_t * texel = dst + ((size_t) y * dstWidth + x) * n;
+        for (uint32_t c = 0; c < colorChannels; c++) {
+          texel[c] = toEncoded[(int) (linear[c] * (IIO_SRGB_ENCODE_TABLE_SIZE - 1) + 0.5f)];
+        }
+        for (uint32_t c = colorChannels; c < n; c++) {
+          texel[c] = (uint8_t) (linear[c] + 0.5f);
+        }
+      }
+    }
+
+    src = dst;
+    srcWidth = dstWidth;
+    srcHeight = dstHeight;
+  }
+}
@@ -295,6 +295,29 @@ void iio_create_graphics_pipeline(
   vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &createInfo, NULL, &manager->pipeline);
 }
 
+void iio_create_compute_pipeline(
+  VkDevice                                  device,
+  IIOGraphicsPipelineManager *              manager,
+  VkShaderModule                            module)
+
+{
+  VkComputePipelineCreateInfo createInfo = {
+    .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+    .pNext = NULL,
+    .flags = 0,
+    .stage = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+      .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+      .module = module,
+      .pName = "main",
+    },
+    .layout = manager->layout,
+    .basePipelineHandle = VK_NULL_HANDLE,
+    .basePipelineIndex = 0};
+
+  vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &createInfo, NULL, &manager->pipeline);
+}
+
 void iio_destroy_graphics_pipeline(
   VkDevice                                  device,
   IIOGraphicsPipelineManager *              manager) 
@@ -1,2 +1,294 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <vulkan/vulkan.h>
 #include "iio_renderer.h"
+#include "iio_bindless.h"
 
+/*****************************
+ *         sort keys         *
+ *****************************/
+
+//  non negative floats order like their bit patterns, the top 16 bits keep sign, exponent and 7 bits of mantissa
+static uint64_t iio_quantize_depth(
+  float                                     depth)
+
+{
+  if (!(depth > 0.0f)) return 0;
+  uint32_t bits;
+  memcpy(&bits, &depth, sizeof(bits));
+  return bits >> 16;
+}
+
+//  equal handles get equal ids, a collision only weakens the grouping, recording compares the handles
+static uint64_t iio_handle_key(
+  const void *                              handle,
+  size_t                                    size)
+
+{
+  uint64_t value = 0;
+  memcpy(&value, handle, size);
+  return (value * 0x9e3779b97f4a7c15ull) >> 44;
+}
+
+//  bindless materials sort by their slot, fallback materials by their descriptor set
+static uint64_t iio_material_key(
+  const IIOMaterial *                       material)
+
+{
+  if (material->bindlessIndex != IIO_BINDLESS_INVALID_INDEX) return material->bindlessIndex;
+  return iio_handle_key(&material->descriptorSet, sizeof(material->descriptorSet));
+}
+
+static uint64_t iio_make_draw_key(
+  uint32_t                                  pipelineIndex,
+  const IIOPrimitive *                      primitive,
+  float                                     depth)
+
+{
+  uint64_t material = iio_material_key(&primitive->material) & IIO_DRAW_KEY_MATERIAL_MASK;
+  uint64_t vertexBuffer = iio_handle_key(&primitive->vertexBuffer, sizeof(primitive->vertexBuffer)) & IIO_DRAW_KEY_VERTEX_BUFFER_MASK;
+  uint64_t quantized = iio_quantize_depth(depth);
+  if (primitive->material.alphaMode == GLTF_AM_BLEND) {
+    //  blending needs back to front, so depth moves ahead of the state it would otherwise group by
+    return
+      (uint64_t) (pipelineIndex | IIO_DRAW_KEY_BLENDED_BIT) << IIO_DRAW_KEY_PIPELINE_SHIFT |
+      (~quantized & IIO_DRAW_KEY_DEPTH_MASK) << 40 |
+      material << 20 |
+      vertexBuffer;
+  }
+  return
+    (uint64_t) pipelineIndex << IIO_DRAW_KEY_PIPELINE_SHIFT |
+    material << IIO_DRAW_KEY_MATERIAL_SHIFT |
+    vertexBuffer << IIO_DRAW_KEY_VERTEX_BUFFER_SHIFT |
+    quantized;
+}
+
+static int iio_compare_draw_items(
+  const void *                              a,
+  const void *                              b)
+
+{
+  uint64_t keyA = ((const IIODrawItem *) a)->sortKey;
+  uint64_t keyB = ((const IIODrawItem *) b)->sortKey;
+  return (keyA > keyB) - (keyA < keyB);
+}
+
+/*****************************
+ *        draw lists         *
+ *****************************/
+
+void iio_create_draw_list(
+  IIODrawList *                             list)
+
+{
+  memset(list, 0, sizeof(IIODrawList));
+  list->items = vec_DrawItem_init();
+  list->transforms = vec_DrawTransform_init();
+  iio_create_culling_bounds(&list->bounds);
+  glm_mat4_identity(list->view);
+}
+
+void iio_destroy_draw_list(
+  IIODrawList *                             list)
+
+{
+  vec_DrawItem_drop(&list->items);
+  vec_DrawTransform_drop(&list->transforms);
+  iio_destroy_culling_bounds(&list->bounds);
+  memset(list, 0, sizeof(IIODrawList));
+}
+
+void iio_draw_list_begin(
+  IIODrawList *                             list,
+  mat4                                      view,
+  mat4                                      viewProjection)
+
+{
+  //  clearing keeps the capacity, after the first frames the list no longer allocates
+  vec_DrawItem_clear(&list->items);
+  vec_DrawTransform_clear(&list->transforms);
+  glm_mat4_copy(view, list->view);
+  glm_frustum_planes(viewProjection, list->frustumPlanes);
+  memset(&list->stats, 0, sizeof(IIODrawListStats));
+}
+
+bool iio_draw_list_add_model(
+  IIODrawList *                             list,
+  const IIOModel *                          model,
+  uint32_t                                  pipelineIndex)
+
+{
+  return iio_draw_list_add_instances(list, model, (const mat4 *) &model->modelMatrix, 1, pipelineIndex);
+}
+
+//  primitives whose geometry is missing or whose material has neither a bindless slot nor a set are skipped
+static bool iio_draw_list_accepts(
+  const IIOPrimitive *                      primitive)
+
+{
+  return primitive->vertexBuffer && (
+    primitive->material.bindlessIndex != IIO_BINDLESS_INVALID_INDEX || primitive->material.descriptorSet
+  );
+}
+
+bool iio_draw_list_add_instances(
+  IIODrawList *                             list,
+  const IIOModel *                          model,
+  const mat4 *                              transforms,
+  uint32_t                                  transformCount,
+  uint32_t                                  pipelineIndex)
+
+{
+  if (pipelineIndex >= IIO_MAX_DRAW_PIPELINES) {
+    fprintf(stderr, "Draw list pipeline index %u is out of range\n", pipelineIndex);
+    return false;
+  }
+
+  //  every primitive and transform pair becomes one volume, all of them are tested in a single batched pass
+  iio_culling_bounds_clear(&list->bounds);
+  for (uint32_t m = 0; m < model->meshCount; m++) {
+    const IIOMesh * mesh = &model->meshes[m];
+    for (uint32_t p = 0; p < mesh->primitiveCount; p++) {
+      const IIOPrimitive * primitive = &mesh->primitives[p];
+      if (!iio_draw_list_accepts(primitive)) continue;
+      for (uint32_t t = 0; t < transformCount; t++) {
+        if (!iio_culling_bounds_add(&list->bounds, (float *) primitive->boundsMin, (float *) primitive->boundsMax, primitive->sphereRadius, (vec4 *) transforms[t])) {
+          fprintf(stderr, "Draw list could not cull %u instances of a model, none of them are drawn\n", transformCount);
+          return false;
+        }
+      }
+    }
+  }
+  iio_cull_bounds(&list->bounds, list->frustumPlanes);
+
+  //  the second walk visits the volumes in the order they were added
+  uint32_t volume = 0;
+  for (uint32_t m = 0; m < model->meshCount; m++) {
+    const IIOMesh * mesh = &model->meshes[m];
+    for (uint32_t p = 0; p < mesh->primitiveCount; p++) {
+      const IIOPrimitive * primitive = &mesh->primitives[p];
+      if (!iio_draw_list_accepts(primitive)) continue;
+
+      //  the visible transforms are compacted, the nearest of them gives the draw its depth
+      uint32_t firstInstance = (uint32_t) vec_DrawTransform_size(&list->transforms);
+      float nearest = FLT_MAX;
+      for (uint32_t t = 0; t < transformCount; t++, volume++) {
+        if (!list->bounds.visible[volume]) {
+          list->stats.culled++;
+          continue;
+        }
+        IIODrawTransform * transform = vec_DrawTransform_push(&list->transforms, (IIODrawTransform) {0});
+        glm_mat4_copy((vec4 *) transforms[t], transform->matrix);
+
+        //  the view looks down -z, depth is the distance of the bounds center in front of the camera
+        vec3 center = {list->bounds.centerX[volume], list->bounds.centerY[volume], list->bounds.centerZ[volume]};
+        vec3 viewCenter;
+        glm_mat4_mulv3(list->view, center, 1.0f, viewCenter);
+        nearest = fminf(nearest, -viewCenter[2]);
+      }
+      uint32_t instanceCount = (uint32_t) vec_DrawTransform_size(&list->transforms) - firstInstance;
+      if (!instanceCount) continue;
+
+      vec_DrawItem_push(&list->items, (IIODrawItem) {
+        .sortKey = iio_make_draw_key(pipelineIndex, primitive, nearest),
+        .primitive = primitive,
+        .firstInstance = firstInstance,
+        .instanceCount = instanceCount,
+        .pipelineIndex = pipelineIndex,
+      });
+    }
+  }
+  return true;
+}
+
+void iio_draw_list_sort(
+  IIODrawList *                             list)
+
+{
+  isize count = vec_DrawItem_size(&list->items);
+  if (count > 1) qsort(list->items.data, (size_t) count, sizeof(IIODrawItem), iio_compare_draw_items);
+}
+
+void iio_record_draw_list(
+  VkCommandBuffer                           commandBuffer,
+  VkPipelineLayout                          layout,
+  const VkPipeline *                        pipelines,
+  VkBuffer                                  instanceBuffer,
+  VkDeviceSize                              instanceOffset,
+  IIODrawList *                             list)
+
+{
+  uint32_t boundPipeline = UINT32_MAX;
+  uint32_t pushedMaterial = IIO_BINDLESS_INVALID_INDEX;
+  VkDescriptorSet boundMaterialSet = VK_NULL_HANDLE;
+  VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+  VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+  VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+  IIODrawListStats * stats = &list->stats;
+
+  //  every item addresses its transforms through firstInstance, so the instance binding never changes
+  if (!vec_DrawItem_is_empty(&list->items)) {
+    vkCmdBindVertexBuffers(commandBuffer, IIO_INSTANCE_BINDING, 1, &instanceBuffer, &instanceOffset);
+  }
+
+  for (c_each(it, vec_DrawItem, list->items)) {
+    const IIODrawItem * item = it.ref;
+    const IIOPrimitive * primitive = item->primitive;
+
+    if (item->pipelineIndex != boundPipeline) {
+      vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[item->pipelineIndex]);
+      boundPipeline = item->pipelineIndex;
+      stats->pipelineBinds++;
+    } else {
+      stats->skippedBinds++;
+    }
+    if (primitive->material.bindlessIndex == IIO_BINDLESS_INVALID_INDEX) {
+      if (primitive->material.descriptorSet != boundMaterialSet) {
+        vkCmdBindDescriptorSets(
+          commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout,
+          IIO_DRAW_MATERIAL_SET, 1, &primitive->material.descriptorSet, 0, NULL
+        );
+        boundMaterialSet = primitive->material.descriptorSet;
+        stats->materialBinds++;
+      } else {
+        stats->skippedBinds++;
+      }
+    } else if (primitive->material.bindlessIndex != pushedMaterial) {
+      vkCmdPushConstants(
+        commandBuffer, layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        offsetof(IIOBindlessDrawConstants, materialIndex), sizeof(uint32_t), &primitive->material.bindlessIndex
+      );
+      pushedMaterial = primitive->material.bindlessIndex;
+      stats->materialPushes++;
+    } else {
+      stats->skippedBinds++;
+    }
+    if (primitive->vertexBuffer != boundVertexBuffer) {
+      VkDeviceSize offset = 0;
+      vkCmdBindVertexBuffers(commandBuffer, 0, 1, &primitive->vertexBuffer, &offset);
+      boundVertexBuffer = primitive->vertexBuffer;
+      stats->vertexBufferBinds++;
+    } else {
+      stats->skippedBinds++;
+    }
+
+    if (primitive->indexBuffer) {
+      if (primitive->indexBuffer != boundIndexBuffer || primitive->indexType != boundIndexType) {
+        vkCmdBindIndexBuffer(commandBuffer, primitive->indexBuffer, 0, primitive->indexType);
+        boundIndexBuffer = primitive->indexBuffer;
+        boundIndexType = primitive->indexType;
+        stats->indexBufferBinds++;
+      } else {
+        stats->skippedBinds++;
+      }
+      vkCmdDrawIndexed(commandBuffer, primitive->indexCount, item->instanceCount, primitive->firstIndex, primitive->vertexOffset, item->firstInstance);
+    } else {
+      vkCmdDraw(commandBuffer, primitive->vertexCount, item->instanceCount, (uint32_t) primitive->vertexOffset, item->firstInstance);
+    }
+    stats->draws++;
+    stats->instances += item->instanceCount;
+  }
+}
@@ -1,6 +1,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 #include <vulkan/vulkan.h>
 #include "cgltf.h"
@@ -9,6 +15,7 @@
 
 #include "iio_resource_loaders.h"
 #include "iio_string_wrapper.h"
+#include "iio_mesh_cache.h"
 // #include "iio_eng_typedef.h"
 
 /**
@@ -25,8 +32,10 @@ const VkSamplerCreateInfo defaultSamplerCreateInfo = {
   .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
   .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
   .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+  .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
   .anisotropyEnable = VK_FALSE,
   .maxAnisotropy = 1.0f,
+  .maxLod = VK_LOD_CLAMP_NONE,
   .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK
 };
 
@@ -39,11 +48,11 @@ const char * IIO_DEFAULT_TEXTURE_NAME = "IIO_DEFAULT_TEXTURE";
  */
 
 VkImage defaultRGBAImage = VK_NULL_HANDLE;
-VkDeviceMemory defaultRGBAImageMemory = VK_NULL_HANDLE;
+IIOAllocation defaultRGBAImageMemory = {0};
 VkImageView defaultRGBAImageView = VK_NULL_HANDLE;
 VkSampler defaultSampler = VK_NULL_HANDLE;
 VkImage defaultNormalImage = VK_NULL_HANDLE;
-VkDeviceMemory defaultNormalImageMemory = VK_NULL_HANDLE;
+IIOAllocation defaultNormalImageMemory = {0};
 VkImageView defaultNormalImageView = VK_NULL_HANDLE;
 
 /**
@@ -53,7 +62,11 @@ VkImageView defaultNormalImageView = VK_NULL_HANDLE;
 IIOCreateTextureImageFunc iioCreateTextureImageFunc = NULL;
 IIOCreateTextureImageFromMemoryFunc iioCreateTextureImageFromMemoryFunc = NULL;
 IIOCreateTextureImageFromPixelsFunc iioCreateTextureImageFromPixelsFunc = NULL;
+IIOCreateTextureImageFromCompressedFunc iioCreateTextureImageFromCompressedFunc = NULL;
 IIOCreateImageSamplerFunc iioCreateImageSamplerFunc = NULL;
+IIOFreeMemoryFunc iioFreeMemoryFunc = NULL;
+IIOCreateGeometryBufferFunc iioCreateGeometryBufferFunc = NULL;
+IIOAllocatePooledGeometryFunc iioAllocatePooledGeometryFunc = NULL;
 
 void iio_set_create_texture_image_func(
   IIOCreateTextureImageFunc                 func) 
@@ -76,6 +89,13 @@ void iio_set_create_texture_image_from_pixels_func(
   iioCreateTextureImageFromPixelsFunc = func;
 }
 
+void iio_set_create_texture_image_from_compressed_func(
+  IIOCreateTextureImageFromCompressedFunc   func)
+
+{
+  iioCreateTextureImageFromCompressedFunc = func;
+}
+
 void iio_set_create_image_sampler_func(
   IIOCreateImageSamplerFunc                 func) 
 
@@ -83,15 +103,102 @@ void iio_set_create_image_sampler_func(
   iioCreateImageSamplerFunc = func;
 }
 
+void iio_set_free_memory_func(
+  IIOFreeMemoryFunc                         func) 
+
+{
+  iioFreeMemoryFunc = func;
+}
+
+void iio_set_create_geometry_buffer_func(
+  IIOCreateGeometryBufferFunc               func) 
+
+{
+  iioCreateGeometryBufferFunc = func;
+}
+
+void iio_set_allocate_pooled_geometry_func(
+  IIOAllocatePooledGeometryFunc             func)
+
+{
+  iioAllocatePooledGeometryFunc = func;
+}
+
 /**
- *   descriptors   *
+ *   vertex layouts   *
  */
 
+static const IIOVertexFormat iioVertexFormats [iio_vertex_layout_maxenum] = {
+  [iio_vertex_layout_full] = {
+    .layout = iio_vertex_layout_full,
+    .stride = sizeof(IIOVertex),
+    .offsets = {
+      offsetof(IIOVertex, position),
+      offsetof(IIOVertex, normal),
+      offsetof(IIOVertex, tangent),
+      offsetof(IIOVertex, texCoord[0]),
+      offsetof(IIOVertex, texCoord[1]),
+      offsetof(IIOVertex, color),
+      offsetof(IIOVertex, joints),
+      offsetof(IIOVertex, weights)
+    },
+    .formats = {
+      VK_FORMAT_R32G32B32_SFLOAT,    // position
+      VK_FORMAT_R32G32B32_SFLOAT,    // normal
+      VK_FORMAT_R32G32B32A32_SFLOAT, // tangent
+      VK_FORMAT_R32G32_SFLOAT,       // texCoord 0
+      VK_FORMAT_R32G32_SFLOAT,       // texCoord 1
+      VK_FORMAT_R32G32B32A32_SFLOAT, // color
+      VK_FORMAT_R32G32B32A32_SFLOAT, // joints
+      VK_FORMAT_R32G32B32A32_SFLOAT  // weights
+    }
+  },
+  [iio_vertex_layout_packed] = {
+    .layout = iio_vertex_layout_packed,
+    .stride = IIO_PACKED_VERTEX_SIZE,
+    .offsets = {0, 12, 16, 24, 28, 32, 36, 44},
+    .formats = {
+      VK_FORMAT_R32G32B32_SFLOAT,    // position
+      VK_FORMAT_R16G16_SNORM,        // normal
+      VK_FORMAT_R16G16B16A16_SNORM,  // tangent
+      VK_FORMAT_R16G16_SFLOAT,       // texCoord 0
+      VK_FORMAT_R16G16_SFLOAT,       // texCoord 1
+      VK_FORMAT_R8G8B8A8_UNORM,      // color
+      VK_FORMAT_R16G16B16A16_UINT,   // joints
+      VK_FORMAT_R16G16B16A16_UNORM   // weights
+    }
+  }
+};
+
+IIOVertexLayout iioVertexLayout = iio_vertex_layout_full;
+IIOMeshOptimizeFlags iioMeshOptimizeFlags = 0;
+
+void iio_set_mesh_optimization(
+  IIOMeshOptimizeFlags                      flags)
+
+{
+  iioMeshOptimizeFlags = flags;
+}
+
+void iio_set_vertex_layout(
+  IIOVertexLayout                           layout)
+
+{
+  iioVertexLayout = layout < iio_vertex_layout_maxenum ? layout : iio_vertex_layout_full;
+}
+
+const IIOVertexFormat * iio_get_vertex_format(
+  IIOVertexLayout                           layout)
+
+{
+  return &iioVertexFormats[layout < iio_vertex_layout_maxenum ? layout : iio_vertex_layout_full];
+}
+
 VkVertexInputBindingDescription iio_get_iiovertex_binding_description() {
   VkVertexInputBindingDescription bindingDescription = {0};
 
   bindingDescription.binding = 0; // Binding index
-  bindingDescription.stride = sizeof(IIOVertex); // Size of each vertex
+  bindingDescription.stride = iioVertexFormats[iioVertexLayout].stride; // Size of each vertex
   bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // Each vertex is a separate instance
 
   return bindingDescription;
@@ -101,49 +208,204 @@ VkVertexInputAttributeDescription * iio_get_iiovertex_attribute_descriptions(
   int *                                     count) 
 
 {
-  *count = IIOVERTEX_ATTRIBUTE_COUNT;
   static VkVertexInputAttributeDescription attributeDescriptions[IIOVERTEX_ATTRIBUTE_COUNT];
+  const IIOVertexFormat * format = &iioVertexFormats[iioVertexLayout];
 
-  attributeDescriptions[0].binding = 0;
-  attributeDescriptions[0].location = 0;
-  attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT; // Position format
-  attributeDescriptions[0].offset = offsetof(IIOVertex, position);
+  for (uint32_t i = 0; i < IIOVERTEX_ATTRIBUTE_COUNT; i++) {
+    attributeDescriptions[i].binding = 0;
+    attributeDescriptions[i].location = i;
+    attributeDescriptions[i].format = format->formats[i];
+    attributeDescriptions[i].offset = format->offsets[i];
+  }
+  *count = IIOVERTEX_ATTRIBUTE_COUNT;
 
-  attributeDescriptions[1].binding = 0;
-  attributeDescriptions[1].location = 1;
-  attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT; // Normal format
-  attributeDescriptions[1].offset = offsetof(IIOVertex, normal);
+  return attributeDescriptions;
+}
 
-  attributeDescriptions[2].binding = 0;
-  attributeDescriptions[2].location = 2;
-  attributeDescriptions[2].format = VK_FORMAT_R32G32B32A32_SFLOAT; // Tangent format
-  attributeDescriptions[2].offset = offsetof(IIOVertex, tangent);
+VkVertexInputBindingDescription iio_get_instance_binding_description() {
+  VkVertexInputBindingDescription bindingDescription = {0};
 
-  for (int i = 0; i < 2; i++) {
-    attributeDescriptions[i + 3].binding = 0;
-    attributeDescriptions[i + 3].location = i + 3;
-    attributeDescriptions[i + 3].format = VK_FORMAT_R32G32_SFLOAT; // TexCoord format
-    attributeDescriptions[i + 3].offset = offsetof(IIOVertex, texCoord[i]);
-  }
+  bindingDescription.binding = IIO_INSTANCE_BINDING;
+  bindingDescription.stride = sizeof(mat4);
+  bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
-  attributeDescriptions[5].binding = 0;
-  attributeDescriptions[5].location = 5;
-  attributeDescriptions[5].format = VK_FORMAT_R32G32B32A32_SFLOAT; // Color format
-  attributeDescriptions[5].offset = offsetof(IIOVertex, color);
+  return bindingDescription;
+}
+
+VkVertexInputAttributeDescription * iio_get_instance_attribute_descriptions(
+  int *                                     count)
 
-  attributeDescriptions[6].binding = 0;
-  attributeDescriptions[6].location = 6;
-  attributeDescriptions[6].format = VK_FORMAT_R32G32B32A32_SFLOAT; // Joints format
-  attributeDescriptions[6].offset = offsetof(IIOVertex, joints);
+{
+  static VkVertexInputAttributeDescription attributeDescriptions[IIO_INSTANCE_ATTRIBUTE_COUNT];
 
-  attributeDescriptions[7].binding = 0;
-  attributeDescriptions[7].location = 7;
-  attributeDescriptions[7].format = VK_FORMAT_R32G32B32A32_SFLOAT; // Weights format
-  attributeDescriptions[7].offset = offsetof(IIOVertex, weights);
+  for (uint32_t i = 0; i < IIO_INSTANCE_ATTRIBUTE_COUNT; i++) {
+    attributeDescriptions[i].binding = IIO_INSTANCE_BINDING;
+    attributeDescriptions[i].location = IIO_INSTANCE_ATTRIBUTE_LOCATION + i;
+    attributeDescriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    attributeDescriptions[i].offset = i * sizeof(vec4);
+  }
+  *count = IIO_INSTANCE_ATTRIBUTE_COUNT;
 
   return attributeDescriptions;
 }
 
+/**
+ *   vertex packing   *
+ */
+
+static int16_t iio_pack_snorm16(float v) {
+  v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+  return (int16_t) roundf(v * 32767.0f);
+}
+
+static uint16_t iio_pack_unorm16(float v) {
+  v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+  return (uint16_t) roundf(v * 65535.0f);
+}
+
+static uint8_t iio_pack_unorm8(float v) {
+  v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+  return (uint8_t) roundf(v * 255.0f);
+}
+
+//  round to nearest even, overflow saturates to infinity
+static uint16_t iio_pack_half(float f) {
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  uint32_t sign = (x >> 16) & 0x8000u;
+  uint32_t biased = (x >> 23) & 0xffu;
+  uint32_t mantissa = x & 0x7fffffu;
+
+  if (biased == 0xffu) return (uint16_t) (sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+  int32_t exponent = (int32_t) biased - 127 + 15;
+  if (exponent >= 31) return (uint16_t) (sign | 0x7c00u);
+  if (exponent <= 0) {
+    if (exponent < -10) return (uint16_t) sign;
+    mantissa |= 0x800000u;
+    uint32_t shift = (uint32_t) (14 - exponent);
+    uint32_t half = mantissa >> shift;
+    uint32_t rest = mantissa & ((1u << shift) - 1u);
+    uint32_t midpoint = 1u << (shift - 1u);
+    if (rest > midpoint || (rest == midpoint && (half & 1u))) half++;
+    return (uint16_t) (sign | half);
+  }
+  uint32_t half = ((uint32_t) exponent << 10) | (mantissa >> 13);
+  uint32_t rest = mantissa & 0x1fffu;
+  if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) half++; // a carry correctly bumps the exponent
+  return (uint16_t) (sign | half);
+}
+
+static void iio_octahedral_encode(const float * n, float * out) {
+  float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+  if (l1 == 0.0f) {
+    out[0] = 0.0f;
+    out[1] = 0.0f;
+    return;
+  }
+  float x = n[0] / l1;
+  float y = n[1] / l1;
+  if (n[2] < 0.0f) {
+    float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = fx;
+    y = fy;
+  }
+  out[0] = x;
+  out[1] = y;
+}
+
+void iio_pack_vertices(
+  const IIOVertex *                         vertices,
+  uint32_t                                  vertexCount,
+  void *                                    dst)
+
+{
+  const IIOVertexFormat * format = &iioVertexFormats[iio_vertex_layout_packed];
+  for (uint32_t v = 0; v < vertexCount; v++) {
+    const IIOVertex * vertex = &vertices[v];
+    uint8_t * out = (uint8_t *) dst + (size_t) v * format->stride;
+    float oct [2];
+
+    memcpy(out + format->offsets[0], vertex->position, sizeof(vec3));
+
+    iio_octahedral_encode(vertex->normal, oct);
+    int16_t normal [2] = {iio_pack_snorm16(oct[0]), iio_pack_snorm16(oct[1])};
+    memcpy(out + format->offsets[1], normal, sizeof(normal));
+
+    iio_octahedral_encode(vertex->tangent, oct);
+    int16_t tangent [4] = {iio_pack_snorm16(oct[0]), iio_pack_snorm16(oct[1]), 0, vertex->tangent[3] < 0.0f ? -32767 : 32767};
+    memcpy(out + format->offsets[2], tangent, sizeof(tangent));
+
+    for (int t = 0; t < 2; t++) {
+      uint16_t texCoord [2] = {iio_pack_half(vertex->texCoord[t][0]), iio_pack_half(vertex->texCoord[t][1])};
+      memcpy(out + format->offsets[3 + t], texCoord, sizeof(texCoord));
+    }
+
+    uint8_t * color = out + format->offsets[5];
+    for (int c = 0; c < 4; c++) color[c] = iio_pack_unorm8(vertex->color[c]);
+
+    uint16_t joints [4];
+    uint16_t weights [4];
+    for (int c = 0; c < 4; c++) {
+      joints[c] = (uint16_t) vertex->joints[c];
+      weights[c] = iio_pack_unorm16(vertex->weights[c]);
+    }
+    memcpy(out + format->offsets[6], joints, sizeof(joints));
+    memcpy(out + format->offsets[7], weights, sizeof(weights));
+  }
+}
+
+/**
+ *   index widths   *
+ */
+
+bool iioIndexTypeUint8Supported = false;
+
+void iio_set_index_type_uint8_supported(
+  bool                                      supported)
+
+{
+  iioIndexTypeUint8Supported = supported;
+}
+
+VkIndexType iio_select_index_type(
+  uint32_t                                  vertexCount)
+
+{
+  if (iioIndexTypeUint8Supported && vertexCount < 0xffu) return VK_INDEX_TYPE_UINT8_EXT;
+  if (vertexCount < 0xffffu) return VK_INDEX_TYPE_UINT16;
+  return VK_INDEX_TYPE_UINT32;
+}
+
+size_t iio_index_type_size(
+  VkIndexType                               indexType)
+
+{
+  switch (indexType) {
+    case VK_INDEX_TYPE_UINT8_EXT: return sizeof(uint8_t);
+    case VK_INDEX_TYPE_UINT16:    return sizeof(uint16_t);
+    default:                      return sizeof(uint32_t);
+  }
+}
+
+void iio_narrow_indices(
+  const uint32_t *                          indices,
+  uint32_t                                  indexCount,
+  VkIndexType                               indexType,
+  void *                                    dst)
+
+{
+  if (indexType == VK_INDEX_TYPE_UINT8_EXT) {
+    uint8_t * out = dst;
+    for (uint32_t i = 0; i < indexCount; i++) out[i] = (uint8_t) indices[i];
+  } else if (indexType == VK_INDEX_TYPE_UINT16) {
+    uint16_t * out = dst;
+    for (uint32_t i = 0; i < indexCount; i++) out[i] = (uint16_t) indices[i];
+  } else {
+    memcpy(dst, indices, indexCount * sizeof(uint32_t));
+  }
+}
+
 /**
  *  Initialization Functions
  */
@@ -154,6 +416,8 @@ void iio_initialize_resource_manager(
 {
   manager->modelMap = hmap_strModel_init();
   manager->imageMap = hmap_strImg_init();
+  manager->samplerMap = hmap_Sampler_init();
+  iio_create_job_pool(0, &manager->jobPool);
 }
 
 void iio_initialize_default_texture_resources(
@@ -162,18 +426,19 @@ void iio_initialize_default_texture_resources(
 {
   fprintf(stdout, "initializing default texture resources\n");
   //  Load the default RGBA texture
-  iioCreateTextureImageFromPixelsFunc(defaultRGBAdat, 1, 1, &defaultRGBAImage, &defaultRGBAImageMemory, &defaultRGBAImageView);
+  iioCreateTextureImageFromPixelsFunc(defaultRGBAdat, 1, 1, VK_FORMAT_R8G8B8A8_SRGB, (VkComponentMapping) {0}, &defaultRGBAImage, &defaultRGBAImageMemory, &defaultRGBAImageView);
   
-  //  Load the default normal texture
-  iioCreateTextureImageFromPixelsFunc(defaultNormalDat, 1, 1, &defaultNormalImage, &defaultNormalImageMemory, &defaultNormalImageView);
+  //  Load the default normal texture, a vector has to stay linear
+  iioCreateTextureImageFromPixelsFunc(defaultNormalDat, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, (VkComponentMapping) {0}, &defaultNormalImage, &defaultNormalImageMemory, &defaultNormalImageView);
   
-  iioCreateImageSamplerFunc(&defaultSamplerCreateInfo, &defaultSampler);
+  defaultSampler = iio_acquire_sampler(manager, &defaultSamplerCreateInfo);
 
   IIOImageHandle image = {
     .data = defaultRGBAImage,
     .memory = defaultRGBAImageMemory,
     .view = defaultRGBAImageView,
-    .sampler = defaultSampler
+    .sampler = defaultSampler,
+    .refCount = 1
   };
 
   hmap_strImg_insert(&manager->imageMap, IIOStringWrapper_from(IIO_DEFAULT_TEXTURE_NAME), image);
@@ -182,12 +447,191 @@ void iio_initialize_default_texture_resources(
     .data = defaultNormalImage,
     .memory = defaultNormalImageMemory,
     .view = defaultNormalImageView,
-    .sampler = defaultSampler
+    .sampler = defaultSampler,
+    .refCount = 1
   };
 
   hmap_strImg_insert(&manager->imageMap, IIOStringWrapper_from(IIO_DEFAULT_NORMAL_NAME), normal);
 }
 
+/**
+ *   sampler cache
+ */
+
+float iioMaxSamplerAnisotropy = 1.0f;
+
+void iio_set_max_sampler_anisotropy(
+  float                                     maxAnisotropy)
+
+{
+  iioMaxSamplerAnisotropy = maxAnisotropy;
+}
+
+static IIOSamplerKey iio_sampler_key(
+  const VkSamplerCreateInfo *               samplerInfo)
+
+{
+  return (IIOSamplerKey) {
+    .flags = samplerInfo->flags,
+    .magFilter = samplerInfo->magFilter,
+    .minFilter = samplerInfo->minFilter,
+    .mipmapMode = samplerInfo->mipmapMode,
+    .addressModeU = samplerInfo->addressModeU,
+    .addressModeV = samplerInfo->addressModeV,
+    .addressModeW = samplerInfo->addressModeW,
+    .mipLodBias = samplerInfo->mipLodBias,
+    .anisotropyEnable = samplerInfo->anisotropyEnable,
+    .maxAnisotropy = samplerInfo->anisotropyEnable ? samplerInfo->maxAnisotropy : 1.0f, // ignored when disabled
+    .compareEnable = samplerInfo->compareEnable,
+    .compareOp = samplerInfo->compareEnable ? samplerInfo->compareOp : VK_COMPARE_OP_NEVER,
+    .minLod = samplerInfo->minLod,
+    .maxLod = samplerInfo->maxLod,
+    .borderColor = samplerInfo->borderColor,
+    .unnormalizedCoordinates = samplerInfo->unnormalizedCoordinates,
+  };
+}
+
+VkSampler iio_acquire_sampler(
+  IIOResourceManager *                      manager,
+  const VkSamplerCreateInfo *               samplerInfo)
+
+{
+  IIOSamplerKey key = iio_sampler_key(samplerInfo);
+  hmap_Sampler_value * entry = hmap_Sampler_get_mut(&manager->samplerMap, key);
+  if (entry) {
+    entry->second.refCount++;
+    return entry->second.sampler;
+  }
+
+  VkSampler sampler = VK_NULL_HANDLE;
+  iioCreateImageSamplerFunc(samplerInfo, &sampler);
+  if (sampler) hmap_Sampler_insert(&manager->samplerMap, key, (IIOCachedSampler) {.sampler = sampler, .refCount = 1});
+  return sampler;
+}
+
+void iio_release_sampler(
+  VkDevice                                  device,
+  IIOResourceManager *                      manager,
+  VkSampler                                 sampler)
+
+{
+  if (!sampler) return;
+  //  releases are rare and the cache holds a handful of samplers, a scan beats a second map
+  for (c_each(it, hmap_Sampler, manager->samplerMap)) {
+    if (it.ref->second.sampler != sampler) continue;
+    if (--it.ref->second.refCount == 0) {
+      vkDestroySampler(device, sampler, NULL);
+      hmap_Sampler_erase_at(&manager->samplerMap, it);
+    }
+    return;
+  }
+  fprintf(stderr, "iio_release_sampler : Sampler %p is not cached\n", (void *) sampler);
+}
+
+void iio_destroy_samplers(
+  VkDevice                                  device,
+  IIOResourceManager *                      manager)
+
+{
+  for (c_each_kv(key, value, hmap_Sampler, manager->samplerMap)) {
+    vkDestroySampler(device, value->sampler, NULL);
+  }
+  hmap_Sampler_clear(&manager->samplerMap);
+  defaultSampler = VK_NULL_HANDLE;
+}
+
+static VkSamplerAddressMode iio_gltf_address_mode(
+  int32_t                                   wrap)
+
+{
+  switch (wrap) {
+    case cgltf_wrap_mode_clamp_to_edge:   return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    case cgltf_wrap_mode_mirrored_repeat: return VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT;
+    default:                              return VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  }
+}
+
+void iio_sampler_create_info_from_gltf(
+  const IIOTextureSampler *                 textureSampler,
+  VkSamplerCreateInfo *                     samplerInfo)
+
+{
+  *samplerInfo = defaultSamplerCreateInfo;
+  samplerInfo->magFilter = textureSampler->magFilter == cgltf_filter_type_nearest ? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
+  samplerInfo->addressModeU = iio_gltf_address_mode(textureSampler->wrapS);
+  samplerInfo->addressModeV = iio_gltf_address_mode(textureSampler->wrapT);
+
+  //  the GL filters without a mipmap part sample level 0 only
+  switch (textureSampler->minFilter) {
+    case cgltf_filter_type_nearest:
+      samplerInfo->minFilter = VK_FILTER_NEAREST;
+      samplerInfo->mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+      samplerInfo->maxLod = 0.25f;
+      break;
+    case cgltf_filter_type_linear:
+      samplerInfo->minFilter = VK_FILTER_LINEAR;
+      samplerInfo->mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+      samplerInfo->maxLod = 0.25f;
+      break;
+    case cgltf_filter_type_nearest_mipmap_nearest:
+      samplerInfo->minFilter = VK_FILTER_NEAREST;
+      samplerInfo->mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+      break;
+    case cgltf_filter_type_linear_mipmap_nearest:
+      samplerInfo->minFilter = VK_FILTER_LINEAR;
+      samplerInfo->mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+      break;
+    case cgltf_filter_type_nearest_mipmap_linear:
+      samplerInfo->minFilter = VK_FILTER_NEAREST;
+      samplerInfo->mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+      break;
+    default: // linear mipmap linear or undefined
+      samplerInfo->minFilter = VK_FILTER_LINEAR;
+      samplerInfo->mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+      break;
+  }
+
+  if (iioMaxSamplerAnisotropy > 1.0f && samplerInfo->minFilter == VK_FILTER_LINEAR && samplerInfo->mipmapMode == VK_SAMPLER_MIPMAP_MODE_LINEAR) {
+    samplerInfo->anisotropyEnable = VK_TRUE;
+    samplerInfo->maxAnisotropy = iioMaxSamplerAnisotropy;
+  }
+}
+
+//  the model keeps one reference per distinct sampler, however many slots use it
+static VkSampler iio_acquire_model_sampler(
+  IIOResourceManager *                      manager,
+  IIOModel *                                model,
+  const IIOTextureSampler *                 textureSampler)
+
+{
+  VkSamplerCreateInfo samplerInfo;
+  iio_sampler_create_info_from_gltf(textureSampler, &samplerInfo);
+  const hmap_Sampler_value * entry = hmap_Sampler_get(&manager->samplerMap, iio_sampler_key(&samplerInfo));
+  for (uint32_t i = 0; i < model->samplerCount && entry; i++) {
+    if (model->samplers[i] == entry->second.sampler) return entry->second.sampler;
+  }
+
+  VkSampler * samplers = realloc(model->samplers, (model->samplerCount + 1) * sizeof(VkSampler));
+  if (!samplers) return VK_NULL_HANDLE; // the image keeps its own sampler
+  model->samplers = samplers;
+  VkSampler sampler = iio_acquire_sampler(manager, &samplerInfo);
+  if (sampler) model->samplers[model->samplerCount++] = sampler;
+  return sampler;
+}
+
+static void iio_acquire_material_samplers(
+  IIOResourceManager *                      manager,
+  IIOModel *                                model,
+  const int32_t *                           imageIndices,
+  const IIOTextureSampler *                 textureSamplers,
+  VkSampler *                               samplers)
+
+{
+  for (int i = 0; i < IIO_MATERIAL_TEXTURE_COUNT; i++) {
+    samplers[i] = imageIndices[i] >= 0 ? iio_acquire_model_sampler(manager, model, &textureSamplers[i]) : VK_NULL_HANDLE;
+  }
+}
+
 /*****************
  *    Loaders    *
  *****************/
@@ -201,6 +645,793 @@ void iio_load_model2(
   
 }
 
+static void iio_set_default_material(
+  IIOMaterial *                             material)
+
+{
+  material->alphaCutoff = 0.5f; // Default alpha cutoff
+  material->alphaMode = GLTF_AM_OPAQUE; // Default alpha mode
+  material->doubleSided = false; // Default double-sided property
+  material->bindlessIndex = UINT32_MAX; // Not registered with a bindless table
+  material->descriptorSet = VK_NULL_HANDLE; // No fallback material set written
+  
+  memcpy(material->emissiveFactor, (float [3]) {0.0f, 0.0f, 0.0f}, sizeof(float) * 3);
+  material->emissiveTexture.image = defaultRGBAImage; // Default emissive texture image
+  material->emissiveTexture.imageMemory = defaultRGBAImageMemory; // Default emissive texture image memory
+  material->emissiveTexture.imageView = defaultRGBAImageView; // Default emissive texture image view
+  material->emissiveTexture.texCoord = 0; // Default emissive texture texCoord
+  material->emissiveTexture.sampler = defaultSampler; // Default emissive texture sampler
+
+  material->normalTexture.scale = 1.0f; // Default normal texture scale
+  material->normalTexture.textureInfo.image = defaultNormalImage; // Default normal texture image
+  material->normalTexture.textureInfo.imageMemory = defaultNormalImageMemory; // Default normal texture image memory
+  material->normalTexture.textureInfo.imageView = defaultNormalImageView; // Default normal texture image view
+  material->normalTexture.textureInfo.texCoord = 0; // Default normal texture texCoord
+  material->normalTexture.textureInfo.sampler = defaultSampler; // Default normal texture sampler
+
+  material->occlusionTexture.strength = 1.0f; // Default occlusion texture strength
+  material->occlusionTexture.textureInfo.image = defaultRGBAImage; // Default occlusion texture image
+  material->occlusionTexture.textureInfo.imageMemory = defaultRGBAImageMemory; // Default occlusion texture image memory
+  material->occlusionTexture.textureInfo.imageView = defaultRGBAImageView; // Default occlusion texture image view
+  material->occlusionTexture.textureInfo.texCoord = 0; // Default occlusion texture texCoord
+  material->occlusionTexture.textureInfo.sampler = defaultSampler; // Default occlusion texture sampler
+
+  memcpy(material->pbrMetallicRoughness.baseColorFactor, (float [4]) {1.0f, 1.0f, 1.0f, 1.0f}, sizeof(float) * 4);
+  material->pbrMetallicRoughness.baseColorTextureInfo.image = defaultRGBAImage; // Default base color texture image
+  material->pbrMetallicRoughness.baseColorTextureInfo.imageMemory = defaultRGBAImageMemory; // Default base color texture image memory
+  material->pbrMetallicRoughness.baseColorTextureInfo.imageView = defaultRGBAImageView; // Default base color texture image view
+  material->pbrMetallicRoughness.baseColorTextureInfo.sampler = defaultSampler; // Default base color texture sampler
+  material->pbrMetallicRoughness.baseColorTextureInfo.texCoord = 0; // Default base color texture texCoord
+  material->pbrMetallicRoughness.metallicFactor = 1.0f; // Default metallic factor
+  material->pbrMetallicRoughness.metallicRoughnessTextureInfo.image = defaultRGBAImage; // Default metallic roughness texture image
+  material->pbrMetallicRoughness.metallicRoughnessTextureInfo.imageMemory = defaultRGBAImageMemory; // Default metallic roughness texture image memory
+  material->pbrMetallicRoughness.metallicRoughnessTextureInfo.imageView = defaultRGBAImageView; // Default metallic roughness texture image view
+  material->pbrMetallicRoughness.metallicRoughnessTextureInfo.sampler = defaultSampler; // Default metallic roughness texture sampler
+  material->pbrMetallicRoughness.metallicRoughnessTextureInfo.texCoord = 0; // Default metallic roughness texture texCoord
+  material->pbrMetallicRoughness.roughnessFactor = 1.0f; // Default roughness factor
+}
+
+/**
+ *   parallel model loading
+ */
+
+typedef struct IIODecodedImage_S {
+  IIOTextureUsageFlags                      usage;
+  IIOTextureFormat                          format;
+  stbi_uc *                                 pixels; // packed to format.channelCount channels
+  int                                       width;
+  int                                       height;
+  IIOCompressedTexture                      compressed; // used instead of pixels when its data is set
+  const uint8_t *                           bytes; // encoded source, NULL for images loaded from uri
+  size_t                                    size;
+  const char *                              uri;
+  uint64_t                                  contentHash; // of bytes
+  int32_t                                   sharedWith; // earlier image of the model with the same source, -1 for none
+  bool                                      mapped; // already loaded, the handle comes from the resource manager
+} IIODecodedImage;
+
+typedef struct IIOPrimitiveJob_S {
+  cgltf_primitive *                         cgltfPrimitive;
+  IIOPrimitive *                            iioPrimitive;
+  IIOMeshOptimizeStats                      optimizeStats;
+} IIOPrimitiveJob;
+
+typedef struct IIOModelLoadJobs_S {
+  cgltf_data *                              data;
+  const IIOMappedMeshCache *                cache; // set instead of data when loading a baked model
+  IIOPrimitiveJob *                         primitives;
+  IIODecodedImage *                         images;
+} IIOModelLoadJobs;
+
+static void iio_extract_primitive_job(
+  void *                                    userData,
+  uint32_t                                  index)
+
+{
+  IIOModelLoadJobs * jobs = userData;
+  iio_extract_cgltf_primitive(jobs->primitives[index].cgltfPrimitive, jobs->primitives[index].iioPrimitive);
+  iio_finalize_primitive_geometry(jobs->primitives[index].iioPrimitive, &jobs->primitives[index].optimizeStats);
+}
+
+static void iio_report_mesh_optimization(
+  const char *                              filename,
+  const IIOPrimitiveJob *                   primitives,
+  size_t                                    primitiveCount)
+
+{
+  IIOMeshOptimizeStats total = {0};
+  for (size_t i = 0; i < primitiveCount; i++) {
+    const IIOMeshOptimizeStats * stats = &primitives[i].optimizeStats;
+    total.before.triangleCount += stats->before.triangleCount;
+    total.before.vertexCount += stats->before.vertexCount;
+    total.before.cacheMisses += stats->before.cacheMisses;
+    total.after.triangleCount += stats->after.triangleCount;
+    total.after.vertexCount += stats->after.vertexCount;
+    total.after.cacheMisses += stats->after.cacheMisses;
+  }
+  fprintf(stdout, "Mesh optimization for %s: %u triangles, vertices %u -> %u, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+    filename,
+    total.after.triangleCount,
+    total.before.vertexCount, total.after.vertexCount,
+    iio_vertex_cache_acmr(&total.before), iio_vertex_cache_acmr(&total.after),
+    iio_vertex_cache_atvr(&total.before), iio_vertex_cache_atvr(&total.after));
+}
+
+/**
+ *   texture formats
+ */
+
+IIOTextureFormat iio_select_texture_format(
+  IIOTextureUsageFlags                      usage)
+
+{
+  const VkComponentMapping identity = {0};
+  switch (usage) {
+    case IIO_TEXTURE_USAGE_NORMAL_BIT:
+      return (IIOTextureFormat) {VK_FORMAT_R8G8_UNORM, VK_FORMAT_BC5_UNORM_BLOCK, 2, {0, 1}, identity, ".normal.ktx2"};
+    case IIO_TEXTURE_USAGE_METALLIC_ROUGHNESS_BIT: {
+      //  roughness is read from G and metallic from B
+      VkComponentMapping components = {VK_COMPONENT_SWIZZLE_ZERO, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_ONE};
+      return (IIOTextureFormat) {VK_FORMAT_R8G8_UNORM, VK_FORMAT_BC5_UNORM_BLOCK, 2, {1, 2}, components, ".mr.ktx2"};
+    }
+    case IIO_TEXTURE_USAGE_OCCLUSION_BIT:
+      return (IIOTextureFormat) {VK_FORMAT_R8_UNORM, VK_FORMAT_BC4_UNORM_BLOCK, 1, {0}, identity, ".occlusion.ktx2"};
+    default:
+      break;
+  }
+  //  unreferenced images are treated as color, like every image used to be
+  if (!usage || (usage & IIO_TEXTURE_USAGE_COLOR_BIT)) {
+    return (IIOTextureFormat) {VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_BC7_SRGB_BLOCK, 4, {0, 1, 2, 3}, identity, ".color.ktx2"};
+  }
+  return (IIOTextureFormat) {VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_BC7_UNORM_BLOCK, 4, {0, 1, 2, 3}, identity, ".linear.ktx2"};
+}
+
+//  moves the channels format stores to the front of every texel, in place. grey sources provide
+//  their value for R, G and B
+static void iio_pack_texture_channels(
+  uint8_t *                                 pixels,
+  size_t                                    texelCount,
+  uint32_t                                  srcChannels,
+  uint32_t                                  dstStride,
+  const IIOTextureFormat *                  format)
+
+{
+  bool identity = srcChannels == dstStride && srcChannels == format->channelCount;
+  for (uint32_t c = 0; c < format->channelCount && identity; c++) identity = format->sourceChannels[c] == c;
+  if (identity) return;
+
+  //  the destination never overtakes the source since dstStride <= srcChannels
+  for (size_t i = 0; i < texelCount; i++) {
+    const uint8_t * src = pixels + i * srcChannels;
+    uint8_t texel [4];
+    for (uint32_t c = 0; c < format->channelCount; c++) {
+      uint32_t channel = format->sourceChannels[c];
+      if (channel == 3)      texel[c] = srcChannels == 4 || srcChannels == 2 ? src[srcChannels - 1] : 0xff;
+      else if (srcChannels < 3) texel[c] = src[0];
+      else                   texel[c] = src[channel];
+    }
+    memcpy(pixels + i * dstStride, texel, format->channelCount);
+  }
+}
+
+/**
+ *   block compressed textures
+ */
+
+bool iioTextureCompressionEnabled = false;
+
+void iio_set_texture_compression_enabled(
+  bool                                      enabled)
+
+{
+  iioTextureCompressionEnabled = enabled;
+}
+
+//  KTX2 and DDS uris are loaded as they are. Other uris use their baked copy, which is encoded and
+//  written first when it is missing or older than the source image
+static bool iio_load_compressed_image_uri(
+  const char *                              uri,
+  const IIOTextureFormat *                  format,
+  IIOCompressedTexture *                    texture)
+
+{
+  char path [256];
+  int len = snprintf(path, sizeof(path), "%s%s", IIO_PATH_TO_TEXTURES, uri);
+  if (len < 0 || len >= sizeof(path)) return false;
+  if (iio_is_compressed_texture_path(uri)) return iio_load_compressed_texture(path, texture);
+  if (!iioTextureCompressionEnabled) return false;
+
+  char bakedPath [256];
+  struct stat source, baked;
+  if (!iio_cache_file_path(uri, format->bakedExtension, bakedPath, sizeof(bakedPath)) ||
+      stat(path, &source) != 0) {
+    return false;
+  }
+  bool bakedCurrent = stat(bakedPath, &baked) == 0 &&
+    (baked.st_mtim.tv_sec > source.st_mtim.tv_sec ||
+     (baked.st_mtim.tv_sec == source.st_mtim.tv_sec && baked.st_mtim.tv_nsec >= source.st_mtim.tv_nsec));
+  if (bakedCurrent && iio_load_compressed_texture(bakedPath, texture)) return true;
+
+  int width, height, channels;
+  stbi_uc * pixels = stbi_load(path, &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixels) return false;
+  iio_pack_texture_channels(pixels, (size_t) width * height, 4, 4, format); // the encoders read RGBA blocks
+  bool compressed = iio_compress_texture_rgba8(pixels, (uint32_t) width, (uint32_t) height, format->compressedFormat, texture);
+  stbi_image_free(pixels);
+  if (compressed && iio_create_cache_directory()) iio_write_ktx2(bakedPath, texture);
+  return compressed;
+}
+
+static void iio_decode_image_source(
+  const uint8_t *                           bytes, // encoded image, NULL to load uri instead
+  size_t                                    size,
+  const char *                              uri,
+  uint32_t                                  index,
+  IIODecodedImage *                         decoded)
+
+{
+  int channels = 0;
+  decoded->format = iio_select_texture_format(decoded->usage);
+  int channelCount = (int) decoded->format.channelCount;
+
+  //  images are decoded with the channels they have, stb_image can only add channels by going to RGBA
+  int request = 0;
+  if (bytes && iio_is_compressed_texture_container(bytes, size)) {
+    if (!iio_load_compressed_texture_from_memory(bytes, size, &decoded->compressed)) {
+      fprintf(stderr, "Failed to load compressed image %u\n", index);
+    }
+    return;
+  } else if (bytes) {
+    stbi_info_from_memory(bytes, (int) size, &decoded->width, &decoded->height, &channels);
+    request = channels >= channelCount ? 0 : STBI_rgb_alpha;
+    decoded->pixels = stbi_load_from_memory(bytes, (int) size, &decoded->width, &decoded->height, &channels, request);
+  } else if (uri) {
+    if (iio_load_compressed_image_uri(uri, &decoded->format, &decoded->compressed)) return;
+    char path [256];
+    int len = snprintf(path, sizeof(path), "%s%s", IIO_PATH_TO_TEXTURES, uri);
+    if (len < 0 || len >= sizeof(path)) {
+      fprintf(stderr, "Failed to create texture path for %s\n", uri);
+      return;
+    }
+    stbi_info(path, &decoded->width, &decoded->height, &channels);
+    request = channels >= channelCount ? 0 : STBI_rgb_alpha;
+    decoded->pixels = stbi_load(path, &decoded->width, &decoded->height, &channels, request);
+  } else {
+    fprintf(stderr, "No uri or buffer view present in image %u\n", index);
+    return;
+  }
+
+  if (!decoded->pixels) {
+    fprintf(stderr, "Failed to decode image %u: %s\n", index, stbi_failure_reason());
+    return;
+  }
+  if (request) channels = request;
+  iio_pack_texture_channels(decoded->pixels, (size_t) decoded->width * decoded->height, (uint32_t) channels, (uint32_t) channelCount, &decoded->format);
+}
+
+//  sources are resolved up front so repeated images are found before anything is decoded
+static void iio_resolve_cgltf_image_sources(
+  const cgltf_data *                        data,
+  IIODecodedImage *                         images)
+
+{
+  for (cgltf_size i = 0; i < data->images_count; i++) {
+    const cgltf_image * cgltfImage = &data->images[i];
+    if (cgltfImage->buffer_view) {
+      images[i].bytes = cgltf_buffer_view_data(cgltfImage->buffer_view);
+      images[i].size = cgltfImage->buffer_view->size;
+      if (!images[i].bytes) fprintf(stderr, "missing data in bufferview for image %u\n", (uint32_t) i);
+    } else if (cgltfImage->uri) {
+      images[i].uri = cgltfImage->uri;
+    } else {
+      fprintf(stderr, "No uri or buffer view present in image %u\n", (uint32_t) i);
+    }
+  }
+}
+
+static void iio_resolve_cached_image_sources(
+  const IIOMappedMeshCache *                cache,
+  IIODecodedImage *                         images)
+
+{
+  for (uint32_t i = 0; i < cache->header->imageCount; i++) {
+    const IIOMeshCacheImage * image = &cache->images[i];
+    switch (image->source) {
+      case iio_mesh_cache_image_embedded:
+        images[i].bytes = cache->base + image->dataOffset;
+        images[i].size = image->dataSize;
+        break;
+      case iio_mesh_cache_image_uri:
+        images[i].uri = (const char *) (cache->base + image->dataOffset);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+static void iio_hash_image_job(
+  void *                                    userData,
+  uint32_t                                  index)
+
+{
+  IIOModelLoadJobs * jobs = userData;
+  IIODecodedImage * decoded = &jobs->images[index];
+  if (decoded->bytes) decoded->contentHash = iio_hash_bytes(decoded->bytes, decoded->size);
+}
+
+static void iio_decode_image_job(
+  void *                                    userData,
+  uint32_t                                  index)
+
+{
+  IIOModelLoadJobs * jobs = userData;
+  IIODecodedImage * decoded = &jobs->images[index];
+  if (decoded->mapped || decoded->sharedWith >= 0) return;
+  if (!decoded->bytes && !decoded->uri) return;
+  iio_decode_image_source(decoded->bytes, decoded->size, decoded->uri, index, decoded);
+}
+
+//  key of an image in the resource manager. uri images are named by their path, embedded ones by content so
+//  the same bytes in another buffer view or model match. the usage is part of the key since it picks the format
+static char * iio_model_image_name(
+  const IIODecodedImage *                   decoded)
+
+{
+  char name [512];
+  int len;
+  if (decoded->bytes) {
+    len = snprintf(name, sizeof(name), "#%016llx-%zx@%x", (unsigned long long) decoded->contentHash, decoded->size, decoded->usage);
+  } else if (decoded->uri) {
+    len = snprintf(name, sizeof(name), "%s@%x", decoded->uri, decoded->usage);
+  } else {
+    return NULL;
+  }
+  if (len < 0 || len >= sizeof(name)) return NULL; // loaded without sharing
+  return strdup(name);
+}
+
+static void iio_share_model_images(
+  IIOResourceManager *                      manager,
+  IIOModel *                                model,
+  IIODecodedImage *                         images)
+
+{
+  for (uint32_t i = 0; i < model->imageCount; i++) {
+    IIODecodedImage * decoded = &images[i];
+    decoded->sharedWith = -1;
+    char * name = model->imageNames[i] = iio_model_image_name(decoded);
+    if (!name) continue;
+    if (hmap_strImg_contains(&manager->imageMap, name)) {
+      IIOImageHandle * mappedImage = hmap_strImg_at_mut(&manager->imageMap, name);
+      mappedImage->refCount++;
+      model->images[i] = *mappedImage;
+      decoded->mapped = true;
+      continue;
+    }
+    for (uint32_t j = 0; j < i; j++) {
+      if (model->imageNames[j] && strcmp(model->imageNames[j], name) == 0) {
+        decoded->sharedWith = (int32_t) j;
+        break;
+      }
+    }
+  }
+}
+
+//  GPU uploads are recorded from the loading thread only
+static void iio_upload_decoded_images(
+  IIOResourceManager *                      manager,
+  IIOModel *                                model,
+  IIODecodedImage *                         images)
+
+{
+  for (uint32_t i = 0; i < model->imageCount; i++) {
+    IIODecodedImage * decoded = &images[i];
+    IIOImageHandle * image = &model->images[i];
+    if (decoded->mapped || decoded->sharedWith >= 0) continue;
+    if (decoded->compressed.data) {
+      if (iioCreateTextureImageFromCompressedFunc) {
+        //  files that arrive compressed keep the channel layout they were authored with
+        VkComponentMapping components = decoded->compressed.format == decoded->format.compressedFormat ? decoded->format.components : (VkComponentMapping) {0};
+        iioCreateTextureImageFromCompressedFunc(&decoded->compressed, components, &image->data, &image->memory, &image->view);
+        image->sampler = defaultSampler;
+      }
+      iio_free_compressed_texture(&decoded->compressed);
+      continue;
+    }
+    if (!decoded->pixels) continue;
+    iioCreateTextureImageFromPixelsFunc(
+      decoded->pixels,
+      decoded->width,
+      decoded->height,
+      decoded->format.format,
+      decoded->format.components,
+      &image->data,
+      &image->memory,
+      &image->view
+    );
+    image->sampler = defaultSampler;
+    stbi_image_free(decoded->pixels);
+    decoded->pixels = NULL;
+  }
+
+  //  every model image holds one reference, repeats point at the upload of their first occurrence
+  for (uint32_t i = 0; i < model->imageCount; i++) {
+    IIODecodedImage * decoded = &images[i];
+    char * name = model->imageNames[i];
+    if (decoded->mapped) continue;
+    if (decoded->sharedWith >= 0) model->images[i] = model->images[decoded->sharedWith];
+    if (!model->images[i].data || !name) {
+      free(name);
+      model->imageNames[i] = NULL;
+      continue;
+    }
+    if (decoded->sharedWith >= 0) {
+      hmap_strImg_at_mut(&manager->imageMap, name)->refCount++;
+    } else {
+      model->images[i].sampler = iio_acquire_sampler(manager, &defaultSamplerCreateInfo);
+      model->images[i].refCount = 1;
+      hmap_strImg_insert(&manager->imageMap, IIOStringWrapper_make(name), model->images[i]);
+    }
+  }
+}
+
+//  the stream in the primitive's layout, NULL when it could not be built
+static const void * iio_primitive_upload_vertices(
+  const IIOPrimitive *                      iioPrimitive)
+
+{
+  return iioPrimitive->vertexLayout == iio_vertex_layout_packed ? iioPrimitive->vertexData : (const void *) iioPrimitive->vertices;
+}
+
+static void iio_upload_primitive_geometry(
+  IIOPrimitive *                            iioPrimitive,
+  const void *                              vertexData,
+  const void *                              indexData) // already narrowed to iioPrimitive->indexType
+
+{
+  if (iioAllocatePooledGeometryFunc && vertexData && iioPrimitive->vertexCount) {
+    iioPrimitive->pooledGeometry = iioAllocatePooledGeometryFunc(
+      vertexData, iioPrimitive->vertexCount, iioVertexFormats[iioPrimitive->vertexLayout].stride,
+      indexData, indexData ? iioPrimitive->indexCount : 0, iioPrimitive->indexType,
+      &iioPrimitive->vertexBuffer, &iioPrimitive->indexBuffer,
+      &iioPrimitive->vertexOffset, &iioPrimitive->firstIndex
+    );
+    if (iioPrimitive->pooledGeometry) return;
+  }
+  if (!iioCreateGeometryBufferFunc) return;
+  if (vertexData && iioPrimitive->vertexCount) {
+    iioCreateGeometryBufferFunc(
+      vertexData,
+      (size_t) iioPrimitive->vertexCount * iioVertexFormats[iioPrimitive->vertexLayout].stride,
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+      &iioPrimitive->vertexBuffer,
+      &iioPrimitive->vertexBufferMemory
+    );
+  }
+  if (indexData && iioPrimitive->indexCount) {
+    iioCreateGeometryBufferFunc(
+      indexData,
+      iioPrimitive->indexCount * iio_index_type_size(iioPrimitive->indexType),
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+      &iioPrimitive->indexBuffer,
+      &iioPrimitive->indexBufferMemory
+    );
+  }
+}
+
+//  index data as it is uploaded, free the result when it differs from iioPrimitive->indices.
+//  returns NULL when narrowing ran out of memory
+static void * iio_narrowed_primitive_indices(
+  const IIOPrimitive *                      iioPrimitive)
+
+{
+  if (!iioPrimitive->indices || iioPrimitive->indexType == VK_INDEX_TYPE_UINT32) return iioPrimitive->indices;
+  void * narrowed = malloc(iioPrimitive->indexCount * iio_index_type_size(iioPrimitive->indexType));
+  if (narrowed) iio_narrow_indices(iioPrimitive->indices, iioPrimitive->indexCount, iioPrimitive->indexType, narrowed);
+  return narrowed;
+}
+
+/**
+ *   baked model cache
+ */
+
+bool iioMeshCacheEnabled = true;
+
+void iio_set_mesh_cache_enabled(
+  bool                                      enabled)
+
+{
+  iioMeshCacheEnabled = enabled;
+}
+
+static void iio_mesh_cache_settings(
+  uint32_t *                                settings)
+
+{
+  settings[0] = (uint32_t) iioVertexLayout;
+  settings[1] = iioMeshOptimizeFlags;
+  settings[2] = iioIndexTypeUint8Supported;
+  settings[3] = sizeof(IIOVertex);
+}
+
+static bool iio_load_model_from_cache(
+  IIOResourceManager *                      manager,
+  const char *                              cachePath,
+  const IIOMeshCacheKey *                   key,
+  IIOModel *                                model)
+
+{
+  IIOMappedMeshCache cache;
+  if (!iio_map_mesh_cache(cachePath, key, &cache)) return false;
+
+  const IIOMeshCacheHeader * header = cache.header;
+  for (uint32_t i = 0; i < header->primitiveCount; i++) {
+    const IIOMeshCachePrimitive * cached = &cache.primitives[i];
+    if (cached->indexDataSize != (uint64_t) cached->indexCount * iio_index_type_size((VkIndexType) cached->indexType)) {
+      fprintf(stderr, "Mesh cache %s has inconsistent index data, ignoring it\n", cachePath);
+      iio_unmap_mesh_cache(&cache);
+      return false;
+    } else if (cached->vertexLayout >= iio_vertex_layout_maxenum || (cached->vertexCount && cached->vertexStride != iioVertexFormats[cached->vertexLayout].stride)) {
+      fprintf(stderr, "Mesh cache %s has an unknown vertex layout, ignoring it\n", cachePath);
+      iio_unmap_mesh_cache(&cache);
+      return false;
+    }
+  }
+
+  glm_mat4_identity(model->modelMatrix);
+  model->meshCount = header->meshCount;
+  model->meshes = calloc(model->meshCount, sizeof(IIOMesh));
+  model->imageCount = header->imageCount;
+  model->images = calloc(model->imageCount, sizeof(IIOImageHandle));
+  model->imageNames = calloc(model->imageCount, sizeof(char *));
+  IIOModelLoadJobs jobs = {
+    .cache = &cache,
+    .images = calloc(header->imageCount, sizeof(IIODecodedImage)),
+  };
+  if ((model->meshCount && !model->meshes) || (model->imageCount && (!model->images || !model->imageNames)) || (header->imageCount && !jobs.images)) {
+    fprintf(stderr, "Failed to allocate memory for cached model\n");
+    free(jobs.images);
+    iio_destroy_model(model);
+    iio_unmap_mesh_cache(&cache);
+    return false;
+  }
+
+  IIOTextureUsageFlags * imageUsages = calloc(header->imageCount ? header->imageCount : 1, sizeof(IIOTextureUsageFlags));
+  for (uint32_t i = 0; i < header->primitiveCount && imageUsages; i++) {
+    iio_accumulate_material_image_usages(cache.primitives[i].material.images, imageUsages);
+  }
+  for (uint32_t i = 0; i < header->imageCount && imageUsages; i++) jobs.images[i].usage = imageUsages[i];
+  free(imageUsages);
+  iio_resolve_cached_image_sources(&cache, jobs.images);
+  iio_job_pool_parallel_for(&manager->jobPool, header->imageCount, iio_hash_image_job, &jobs);
+  iio_share_model_images(manager, model, jobs.images);
+  iio_job_pool_parallel_for(&manager->jobPool, header->imageCount, iio_decode_image_job, &jobs);
+  iio_upload_decoded_images(manager, model, jobs.images);
+
+  //  geometry goes straight from the mapping into the staging ring
+  for (uint32_t i = 0; i < header->meshCount; i++) {
+    const IIOMeshCacheMesh * cachedMesh = &cache.meshes[i];
+    IIOMesh * iioMesh = &model->meshes[i];
+    iioMesh->primitives = calloc(cachedMesh->primitiveCount, sizeof(IIOPrimitive));
+    if (!iioMesh->primitives) {
+      fprintf(stderr, "Failed to allocate memory for IIOMesh primitives\n");
+      continue;
+    }
+    iioMesh->primitiveCount = cachedMesh->primitiveCount;
+    for (uint32_t j = 0; j < cachedMesh->primitiveCount; j++) {
+      const IIOMeshCachePrimitive * cached = &cache.primitives[cachedMesh->firstPrimitive + j];
+      IIOPrimitive * iioPrimitive = &iioMesh->primitives[j];
+
+      iioPrimitive->vertexCount = cached->vertexCount;
+      iioPrimitive->vertexAttributes = cached->vertexAttributes;
+      iioPrimitive->vertexLayout = (IIOVertexLayout) cached->vertexLayout;
+      iioPrimitive->indexCount = cached->indexCount;
+      iioPrimitive->indexType = (VkIndexType) cached->indexType;
+      iioPrimitive->mode = (uint8_t) cached->mode;
+      memcpy(iioPrimitive->boundsMin, cached->boundsMin, sizeof(vec3));
+      memcpy(iioPrimitive->boundsMax, cached->boundsMax, sizeof(vec3));
+      memcpy(iioPrimitive->sphereCenter, cached->boundsSphere, sizeof(vec3));
+      iioPrimitive->sphereRadius = cached->boundsSphere[3];
+
+      const IIOMeshCacheMaterial * material = &cached->material;
+      iio_set_default_material(&iioPrimitive->material);
+      memcpy(iioPrimitive->material.pbrMetallicRoughness.baseColorFactor, material->baseColorFactor, sizeof(float) * 4);
+      memcpy(iioPrimitive->material.emissiveFactor, material->emissiveFactor, sizeof(float) * 3);
+      iioPrimitive->material.pbrMetallicRoughness.metallicFactor = material->metallicFactor;
+      iioPrimitive->material.pbrMetallicRoughness.roughnessFactor = material->roughnessFactor;
+      iioPrimitive->material.normalTexture.scale = material->normalScale;
+      iioPrimitive->material.occlusionTexture.strength = material->occlusionStrength;
+      iioPrimitive->material.alphaCutoff = material->alphaCutoff;
+      iioPrimitive->material.alphaMode = (gltfAlphaMode) material->alphaMode;
+      iioPrimitive->material.doubleSided = material->doubleSided;
+      iioPrimitive->material.pbrMetallicRoughness.baseColorTextureInfo.texCoord = material->texCoords[iio_mesh_cache_texture_base_color];
+      iioPrimitive->material.pbrMetallicRoughness.metallicRoughnessTextureInfo.texCoord = material->texCoords[iio_mesh_cache_texture_metallic_roughness];
+      iioPrimitive->material.normalTexture.textureInfo.texCoord = material->texCoords[iio_mesh_cache_texture_normal];
+      iioPrimitive->material.occlusionTexture.textureInfo.texCoord = material->texCoords[iio_mesh_cache_texture_occlusion];
+      iioPrimitive->material.emissiveTexture.texCoord = material->texCoords[iio_mesh_cache_texture_emissive];
+      IIOTextureSampler textureSamplers [IIO_MATERIAL_TEXTURE_COUNT];
+      VkSampler samplers [IIO_MATERIAL_TEXTURE_COUNT];
+      for (int t = 0; t < IIO_MATERIAL_TEXTURE_COUNT; t++) {
+        textureSamplers[t] = (IIOTextureSampler) {
+          .magFilter = material->samplers[t][0],
+          .minFilter = material->samplers[t][1],
+          .wrapS = material->samplers[t][2],
+          .wrapT = material->samplers[t][3],
+        };
+      }
+      iio_acquire_material_samplers(manager, model, material->images, textureSamplers, samplers);
+      iio_bind_material_images(material->images, samplers, model->images, &iioPrimitive->material);
+
+      iio_upload_primitive_geometry(
+        iioPrimitive,
+        cached->vertexDataSize ? cache.base + cached->vertexDataOffset : NULL,
+        cached->indexDataSize ? cache.base + cached->indexDataOffset : NULL
+      );
+    }
+  }
+
+  free(jobs.images);
+  iio_unmap_mesh_cache(&cache);
+  return true;
+}
+
+static void iio_bake_model_cache(
+  const char *                              cachePath,
+  const IIOMeshCacheKey *                   key,
+  const cgltf_data *                        data,
+  const IIOModel *                          model)
+
+{
+  uint32_t primitiveCount = 0;
+  for (uint32_t i = 0; i < model->meshCount; i++) primitiveCount += model->meshes[i].primitiveCount;
+
+  IIOMeshCacheMesh * meshes = calloc(model->meshCount ? model->meshCount : 1, sizeof(IIOMeshCacheMesh));
+  IIOMeshCachePrimitive * primitives = calloc(primitiveCount ? primitiveCount : 1, sizeof(IIOMeshCachePrimitive));
+  IIOMeshCacheBlob * vertexBlobs = calloc(primitiveCount ? primitiveCount : 1, sizeof(IIOMeshCacheBlob));
+  IIOMeshCacheBlob * indexBlobs = calloc(primitiveCount ? primitiveCount : 1, sizeof(IIOMeshCacheBlob));
+  IIOMeshCacheImage * images = calloc(data->images_count ? data->images_count : 1, sizeof(IIOMeshCacheImage));
+  IIOMeshCacheBlob * imageBlobs = calloc(data->images_count ? data->images_count : 1, sizeof(IIOMeshCacheBlob));
+  bool ok = meshes && primitives && vertexBlobs && indexBlobs && images && imageBlobs;
+
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < model->meshCount && ok; i++) {
+    const IIOMesh * iioMesh = &model->meshes[i];
+    meshes[i].firstPrimitive = next;
+    meshes[i].primitiveCount = iioMesh->primitiveCount;
+    for (uint32_t j = 0; j < iioMesh->primitiveCount && ok; j++, next++) {
+      IIOPrimitive * iioPrimitive = &iioMesh->primitives[j];
+      IIOMeshCachePrimitive * cached = &primitives[next];
+      const cgltf_primitive * cgltfPrimitive = &data->meshes[i].primitives[j];
+      bool hasVertices = iio_primitive_upload_vertices(iioPrimitive) && iioPrimitive->vertexCount;
+      ok = hasVertices || !iioPrimitive->vertices || !iioPrimitive->vertexCount; // a failed packing is not baked
+
+      cached->vertexCount = hasVertices ? iioPrimitive->vertexCount : 0;
+      cached->vertexLayout = iioPrimitive->vertexLayout;
+      cached->vertexAttributes = iioPrimitive->vertexAttributes;
+      cached->vertexStride = iioVertexFormats[iioPrimitive->vertexLayout].stride;
+      cached->indexCount = iioPrimitive->indices ? iioPrimitive->indexCount : 0;
+      cached->mode = iioPrimitive->mode;
+      memcpy(cached->boundsMin, iioPrimitive->boundsMin, sizeof(vec3));
+      memcpy(cached->boundsMax, iioPrimitive->boundsMax, sizeof(vec3));
+      memcpy(cached->boundsSphere, iioPrimitive->sphereCenter, sizeof(vec3));
+      cached->boundsSphere[3] = iioPrimitive->sphereRadius;
+      vertexBlobs[next] = (IIOMeshCacheBlob) {
+        .data = (void *) iio_primitive_upload_vertices(iioPrimitive),
+        .size = (uint64_t) cached->vertexCount * cached->vertexStride,
+      };
+      if (cached->indexCount) {
+        void * narrowed = iio_narrowed_primitive_indices(iioPrimitive);
+        ok = narrowed != NULL;
+        cached->indexType = iioPrimitive->indexType;
+        indexBlobs[next] = (IIOMeshCacheBlob) {
+          .data = narrowed,
+          .size = (uint64_t) cached->indexCount * iio_index_type_size(iioPrimitive->indexType),
+        };
+      } else {
+        cached->indexType = VK_INDEX_TYPE_UINT32;
+      }
+
+      const IIOMaterial * material = &iioPrimitive->material;
+      memcpy(cached->material.baseColorFactor, material->pbrMetallicRoughness.baseColorFactor, sizeof(float) * 4);
+      memcpy(cached->material.emissiveFactor, material->emissiveFactor, sizeof(float) * 3);
+      cached->material.metallicFactor = material->pbrMetallicRoughness.metallicFactor;
+      cached->material.roughnessFactor = material->pbrMetallicRoughness.roughnessFactor;
+      cached->material.normalScale = material->normalTexture.scale;
+      cached->material.occlusionStrength = material->occlusionTexture.strength;
+      cached->material.alphaCutoff = material->alphaCutoff;
+      cached->material.alphaMode = material->alphaMode;
+      cached->material.doubleSided = material->doubleSided;
+      iio_cgltf_material_image_indices(data, cgltfPrimitive->material, cached->material.images);
+      cached->material.texCoords[iio_mesh_cache_texture_base_color] = material->pbrMetallicRoughness.baseColorTextureInfo.texCoord;
+      cached->material.texCoords[iio_mesh_cache_texture_metallic_roughness] = material->pbrMetallicRoughness.metallicRoughnessTextureInfo.texCoord;
+      cached->material.texCoords[iio_mesh_cache_texture_normal] = material->normalTexture.textureInfo.texCoord;
+      cached->material.texCoords[iio_mesh_cache_texture_occlusion] = material->occlusionTexture.textureInfo.texCoord;
+      cached->material.texCoords[iio_mesh_cache_texture_emissive] = material->emissiveTexture.texCoord;
+      IIOTextureSampler textureSamplers [IIO_MATERIAL_TEXTURE_COUNT];
+      iio_cgltf_material_samplers(cgltfPrimitive->material, textureSamplers);
+      for (int t = 0; t < IIO_MATERIAL_TEXTURE_COUNT; t++) {
+        cached->material.samplers[t][0] = textureSamplers[t].magFilter;
+        cached->material.samplers[t][1] = textureSamplers[t].minFilter;
+        cached->material.samplers[t][2] = textureSamplers[t].wrapS;
+        cached->material.samplers[t][3] = textureSamplers[t].wrapT;
+      }
+    }
+  }
+
+  for (cgltf_size i = 0; i < data->images_count && ok; i++) {
+    const cgltf_image * cgltfImage = &data->images[i];
+    const uint8_t * bytes = cgltfImage->buffer_view ? cgltf_buffer_view_data(cgltfImage->buffer_view) : NULL;
+    if (bytes) {
+      images[i].source = iio_mesh_cache_image_embedded;
+      imageBlobs[i] = (IIOMeshCacheBlob) {.data = bytes, .size = cgltfImage->buffer_view->size};
+    } else if (cgltfImage->uri) {
+      images[i].source = iio_mesh_cache_image_uri;
+      imageBlobs[i] = (IIOMeshCacheBlob) {.data = cgltfImage->uri, .size = strlen(cgltfImage->uri) + 1};
+    }
+  }
+
+  if (ok) {
+    ok = iio_write_mesh_cache(cachePath, key, meshes, model->meshCount, primitives, vertexBlobs, indexBlobs, primitiveCount, images, imageBlobs, (uint32_t) data->images_count);
+  }
+  if (ok) fprintf(stdout, "Baked mesh cache %s\n", cachePath);
+
+  //  narrowed index copies are the only blobs owned here
+  next = 0;
+  for (uint32_t i = 0; i < model->meshCount && indexBlobs; i++) {
+    for (uint32_t j = 0; j < model->meshes[i].primitiveCount; j++, next++) {
+      if (indexBlobs[next].data && indexBlobs[next].data != model->meshes[i].primitives[j].indices) free((void *) indexBlobs[next].data);
+    }
+  }
+  free(imageBlobs);
+  free(images);
+  free(indexBlobs);
+  free(vertexBlobs);
+  free(primitives);
+  free(meshes);
+}
+
+//  keys the cache on the source file and on every buffer it loads from a file next to it.
+//  embedded data URIs and GLB chunks are part of the source already
+static bool iio_compute_model_cache_key(
+  const char *                              path,
+  const cgltf_data *                        data,
+  const uint32_t *                          settings,
+  IIOMeshCacheKey *                         key)
+
+{
+  const char * separator = strrchr(path, '/');
+  size_t directoryLength = separator ? (size_t) (separator - path) + 1 : 0;
+  char (* bufferPaths) [512] = data->buffers_count ? malloc(data->buffers_count * sizeof(*bufferPaths)) : NULL;
+  const char ** dependencies = data->buffers_count ? malloc(data->buffers_count * sizeof(char *)) : NULL;
+  if (data->buffers_count && (!bufferPaths || !dependencies)) {
+    fprintf(stderr, "Failed to allocate the mesh cache dependencies of %s\n", path);
+    free(bufferPaths);
+    free(dependencies);
+    return false;
+  }
+
+  uint32_t dependencyCount = 0;
+  bool valid = true;
+  for (cgltf_size i = 0; i < data->buffers_count && valid; i++) {
+    const char * uri = data->buffers[i].uri;
+    if (!uri || strncmp(uri, "data:", 5) == 0) continue;
+    if (directoryLength + strlen(uri) >= sizeof(*bufferPaths)) {
+      valid = false;
+      break;
+    }
+    char * bufferPath = bufferPaths[dependencyCount];
+    memcpy(bufferPath, path, directoryLength);
+    strcpy(bufferPath + directoryLength, uri);
+    cgltf_decode_uri(bufferPath + directoryLength);
+    dependencies[dependencyCount++] = bufferPath;
+  }
+  valid = valid && iio_compute_mesh_cache_key(path, dependencies, dependencyCount, settings, key);
+  free(bufferPaths);
+  free(dependencies);
+  return valid;
+}
+
 void iio_load_model(
   IIOResourceManager *                      manager,
   const char *                              filename, 
@@ -220,6 +1451,8 @@ void iio_load_model(
   }
   char path [255] = IIO_PATH_TO_MODELS;
   strncat(path, filename, sizeof(path) - sizeof(IIO_PATH_TO_MODELS) - 1);
+
+  //  only the JSON is parsed up front, the cache key needs the external buffers it references
   cgltf_options options = {0};
   cgltf_data * data = NULL;
   cgltf_result result = cgltf_parse_file(&options, path, &data);
@@ -227,6 +1460,22 @@ void iio_load_model(
     fprintf(stderr, "Failed to parse model file: %s\n", path);
     return;
   }
+
+  //  warm start: a baked model matching the source and its buffers skips loading and extraction entirely
+  char cachePath [512];
+  IIOMeshCacheKey cacheKey;
+  bool cacheKeyValid = false;
+  if (iioMeshCacheEnabled && iio_mesh_cache_path(filename, cachePath, sizeof(cachePath))) {
+    uint32_t settings [IIO_MESH_CACHE_SETTING_COUNT];
+    iio_mesh_cache_settings(settings);
+    cacheKeyValid = iio_compute_model_cache_key(path, data, settings, &cacheKey);
+    if (cacheKeyValid && iio_load_model_from_cache(manager, cachePath, &cacheKey, model)) {
+      hmap_strModel_insert(&manager->modelMap, IIOStringWrapper_make(filename), model);
+      cgltf_free(data);
+      return;
+    }
+  }
+
   result = cgltf_load_buffers(&options, data, path);
   if (result != cgltf_result_success) {
     fprintf(stderr, "Failed to load buffers for model file: %s\n", path);
@@ -241,20 +1490,105 @@ void iio_load_model(
     return;
   }
   model->meshCount = (uint32_t) data->meshes_count;
-  model->meshes = malloc(model->meshCount * sizeof(IIOMesh));
-  if (!model->meshes) {
+  model->meshes = calloc(model->meshCount, sizeof(IIOMesh));
+  model->imageCount = (uint32_t) data->images_count;
+  model->images = calloc(model->imageCount, sizeof(IIOImageHandle));
+  model->imageNames = calloc(model->imageCount, sizeof(char *));
+  if (!model->meshes || (model->imageCount && (!model->images || !model->imageNames))) {
     fprintf(stderr, "Failed to allocate memory for model meshes\n");
+    free(model->meshes);
+    free(model->images);
+    free(model->imageNames);
+    model->meshes = NULL;
+    model->images = NULL;
+    model->imageNames = NULL;
     cgltf_free(data);
     return;
   }
-  //  Iterate through the meshes
 
-  IIOMesh * iioMesh = model->meshes;
-  cgltf_mesh * cgltfMesh = data->meshes;
-  for (int i = 0; i < data->meshes_count; i++) {
-    iio_extract_cgltf_mesh(&cgltfMesh[i], &iioMesh[i]);
+  //  flatten the primitives so the workers balance across meshes of very different sizes
+  cgltf_size primitiveCount = 0;
+  for (cgltf_size i = 0; i < data->meshes_count; i++) {
+    primitiveCount += data->meshes[i].primitives_count;
   }
-  
+  IIOModelLoadJobs jobs = {
+    .data = data,
+    .primitives = malloc(primitiveCount * sizeof(IIOPrimitiveJob)),
+    .images = calloc(data->images_count, sizeof(IIODecodedImage)),
+  };
+  if ((primitiveCount && !jobs.primitives) || (data->images_count && !jobs.images)) {
+    fprintf(stderr, "Failed to allocate memory for model load jobs\n");
+    free(jobs.primitives);
+    free(jobs.images);
+    iio_destroy_model(model);
+    cgltf_free(data);
+    return;
+  }
+
+  cgltf_size job = 0;
+  for (cgltf_size i = 0; i < data->meshes_count; i++) {
+    IIOMesh * iioMesh = &model->meshes[i];
+    iioMesh->primitiveCount = (uint32_t) data->meshes[i].primitives_count;
+    iioMesh->primitives = calloc(iioMesh->primitiveCount, sizeof(IIOPrimitive));
+    if (!iioMesh->primitives) {
+      fprintf(stderr, "Failed to allocate memory for IIOMesh primitives\n");
+      iioMesh->primitiveCount = 0;
+      continue;
+    }
+    for (cgltf_size j = 0; j < iioMesh->primitiveCount; j++) {
+      jobs.primitives[job].cgltfPrimitive = &data->meshes[i].primitives[j];
+      jobs.primitives[job].iioPrimitive = &iioMesh->primitives[j];
+      job++;
+    }
+  }
+
+  //  the materials decide which format every image is decoded to
+  IIOTextureUsageFlags * imageUsages = calloc(data->images_count ? data->images_count : 1, sizeof(IIOTextureUsageFlags));
+  for (cgltf_size i = 0; i < data->materials_count && imageUsages; i++) {
+    int32_t imageIndices [IIO_MATERIAL_TEXTURE_COUNT];
+    iio_cgltf_material_image_indices(data, &data->materials[i], imageIndices);
+    iio_accumulate_material_image_usages(imageIndices, imageUsages);
+  }
+  for (cgltf_size i = 0; i < data->images_count && imageUsages; i++) jobs.images[i].usage = imageUsages[i];
+  free(imageUsages);
+  iio_resolve_cgltf_image_sources(data, jobs.images);
+
+  //  CPU work runs on the pool: geometry extraction, image hashing and decoding of the images not loaded yet
+  iio_job_pool_parallel_for(&manager->jobPool, (uint32_t) job, iio_extract_primitive_job, &jobs);
+  iio_job_pool_parallel_for(&manager->jobPool, (uint32_t) data->images_count, iio_hash_image_job, &jobs);
+  iio_share_model_images(manager, model, jobs.images);
+  iio_job_pool_parallel_for(&manager->jobPool, (uint32_t) data->images_count, iio_decode_image_job, &jobs);
+  if (iioMeshOptimizeFlags) iio_report_mesh_optimization(filename, jobs.primitives, job);
+
+  //  GPU uploads are recorded from this thread only
+  iio_upload_decoded_images(manager, model, jobs.images);
+
+  for (cgltf_size i = 0; i < job; i++) {
+    IIOPrimitive * iioPrimitive = jobs.primitives[i].iioPrimitive;
+    const cgltf_material * cgltfMaterial = jobs.primitives[i].cgltfPrimitive->material;
+    if (cgltfMaterial) {
+      int32_t imageIndices [IIO_MATERIAL_TEXTURE_COUNT];
+      IIOTextureSampler textureSamplers [IIO_MATERIAL_TEXTURE_COUNT];
+      VkSampler samplers [IIO_MATERIAL_TEXTURE_COUNT];
+      iio_cgltf_material_image_indices(data, cgltfMaterial, imageIndices);
+      iio_cgltf_material_samplers(cgltfMaterial, textureSamplers);
+      iio_acquire_material_samplers(manager, model, imageIndices, textureSamplers, samplers);
+      iio_bind_material_images(imageIndices, samplers, model->images, &iioPrimitive->material);
+    }
+    if (!iioPrimitive->vertices) continue;
+    void * indexData = iio_narrowed_primitive_indices(iioPrimitive);
+    if (!indexData && iioPrimitive->indices) {
+      iioPrimitive->indexType = VK_INDEX_TYPE_UINT32;
+      indexData = iioPrimitive->indices;
+    }
+    iio_upload_primitive_geometry(iioPrimitive, iio_primitive_upload_vertices(iioPrimitive), indexData);
+    if (indexData != iioPrimitive->indices) free(indexData); // the data is already in the staging ring
+  }
+
+  if (iioMeshCacheEnabled && cacheKeyValid) iio_bake_model_cache(cachePath, &cacheKey, data, model);
+
+  free(jobs.primitives);
+  free(jobs.images);
   cgltf_free(data);
 
   hmap_strModel_insert(
@@ -273,6 +1607,7 @@ void iio_load_image(
 {
   if (hmap_strImg_contains(&manager->imageMap, filename)) {
     IIOImageHandle * mappedImage = hmap_strImg_at_mut(&manager->imageMap, filename);
+    mappedImage->refCount++;
     image->data = mappedImage->data;
     image->memory = mappedImage->memory;
     image->sampler = mappedImage->sampler;
@@ -281,7 +1616,7 @@ void iio_load_image(
     char path [255] = IIO_PATH_TO_TEXTURES;
     strncat(path, filename, sizeof(path) - sizeof(IIO_PATH_TO_TEXTURES) - 1);
     iioCreateTextureImageFunc(path, &image->data, &image->memory, &image->view);
-    iioCreateImageSamplerFunc(samplerInfo, &image->sampler);
+    image->sampler = iio_acquire_sampler(manager, samplerInfo);
     hmap_strImg_insert(
       &manager->imageMap, 
       IIOStringWrapper_make(filename), 
@@ -290,6 +1625,7 @@ void iio_load_image(
         .memory = image->memory, 
         .sampler = image->sampler, 
         .view = image->view, 
+        .refCount = 1,
       }
     );
   }
@@ -322,6 +1658,7 @@ void iio_extract_cgltf_mesh(
   IIOPrimitive * iioPrimitive = iioMesh->primitives;
   for (cgltf_size i = 0; i < cgltfMesh->primitives_count; i++) {
     iio_extract_cgltf_primitive(&cgltfPrimitive[i], &iioPrimitive[i]);
+    iio_finalize_primitive_geometry(&iioPrimitive[i], NULL);
     if (!iioPrimitive->vertices || iioPrimitive->vertexCount == 0) {
       fprintf(stderr, "Failed to extract vertices for primitive %zu in mesh %s\n", i, cgltfMesh->name);
     }
@@ -342,48 +1679,14 @@ void iio_extract_cgltf_primitive(
   
   iioPrimitive->vertexCount = 0;
   iioPrimitive->vertices = NULL;
+  iioPrimitive->vertexAttributes = 0;
+  iioPrimitive->vertexData = NULL;
   iioPrimitive->indexCount = 0;
   iioPrimitive->indices = NULL;
+  iioPrimitive->indexType = VK_INDEX_TYPE_UINT32;
   iioPrimitive->mode = 4; // Default to GL_TRIANGLES
 
-  iioPrimitive->material.alphaCutoff = 0.5f; // Default alpha cutoff
-  iioPrimitive->material.alphaMode = GLTF_AM_OPAQUE; // Default alpha mode
-  iioPrimitive->material.doubleSided = false; // Default double-sided property
-  
-  memcpy(iioPrimitive->material.emissiveFactor, (float [3]) {0.0f, 0.0f, 0.0f}, sizeof(float) * 3);
-  iioPrimitive->material.emissiveTexture.image = defaultRGBAImage; // Default emissive texture image
-  iioPrimitive->material.emissiveTexture.imageMemory = defaultRGBAImageMemory; // Default emissive texture image memory
-  iioPrimitive->material.emissiveTexture.imageView = defaultRGBAImageView; // Default emissive texture image view
-  iioPrimitive->material.emissiveTexture.texCoord = 0; // Default emissive texture texCoord
-  iioPrimitive->material.emissiveTexture.sampler = defaultSampler; // Default emissive texture sampler
-
-  iioPrimitive->material.normalTexture.scale = 1.0f; // Default normal texture scale
-  iioPrimitive->material.normalTexture.textureInfo.image = defaultNormalImage; // Default normal texture image
-  iioPrimitive->material.normalTexture.textureInfo.imageMemory = defaultNormalImageMemory; // Default normal texture image memory
-  iioPrimitive->material.normalTexture.textureInfo.imageView = defaultNormalImageView; // Default normal texture image view
-  iioPrimitive->material.normalTexture.textureInfo.texCoord = 0; // Default normal texture texCoord
-  iioPrimitive->material.normalTexture.textureInfo.sampler = defaultSampler; // Default normal texture sampler
-
-  iioPrimitive->material.occlusionTexture.strength = 1.0f; // Default occlusion texture strength
-  iioPrimitive->material.occlusionTexture.textureInfo.image = defaultRGBAImage; // Default occlusion texture image
-  iioPrimitive->material.occlusionTexture.textureInfo.imageMemory = defaultRGBAImageMemory; // Default occlusion texture image memory
-  iioPrimitive->material.occlusionTexture.textureInfo.imageView = defaultRGBAImageView; // Default occlusion texture image view
-  iioPrimitive->material.occlusionTexture.textureInfo.texCoord = 0; // Default occlusion texture texCoord
-  iioPrimitive->material.occlusionTexture.textureInfo.sampler = defaultSampler; // Default occlusion texture sampler
-
-  memcpy(iioPrimitive->material.pbrMetallicRoughness.baseColorFactor, (float [4]) {1.0f, 1.0f, 1.0f, 1.0f}, sizeof(float) * 4);
-  iioPrimitive->material.pbrMetallicRoughness.baseColorTextureInfo.image = defaultRGBAImage; // Default base color texture image
-  iioPrimitive->material.pbrMetallicRoughness.baseColorTextureInfo.imageMemory = defaultRGBAImageMemory; // Default base color texture image memory
-  iioPrimitive->material.pbrMetallicRoughness.baseColorTextureInfo.imageView = defaultRGBAImageView; // Default base color texture image view
-  iioPrimitive->material.pbrMetallicRoughness.baseColorTextureInfo.sampler = defaultSampler; // Default base color texture sampler
-  iioPrimitive->material.pbrMetallicRoughness.baseColorTextureInfo.texCoord = 0; // Default base color texture texCoord
-  iioPrimitive->material.pbrMetallicRoughness.metallicFactor = 1.0f; // Default metallic factor
-  iioPrimitive->material.pbrMetallicRoughness.metallicRoughnessTextureInfo.image = defaultRGBAImage; // Default metallic roughness texture image
-  iioPrimitive->material.pbrMetallicRoughness.metallicRoughnessTextureInfo.imageMemory = defaultRGBAImageMemory; // Default metallic roughness texture image memory
-  iioPrimitive->material.pbrMetallicRoughness.metallicRoughnessTextureInfo.imageView = defaultRGBAImageView; // Default metallic roughness texture image view
-  iioPrimitive->material.pbrMetallicRoughness.metallicRoughnessTextureInfo.sampler = defaultSampler; // Default metallic roughness texture sampler
-  iioPrimitive->material.pbrMetallicRoughness.metallicRoughnessTextureInfo.texCoord = 0; // Default metallic roughness texture texCoord
-  iioPrimitive->material.pbrMetallicRoughness.roughnessFactor = 1.0f; // Default roughness factor
+  iio_set_default_material(&iioPrimitive->material);
 
   
   if (!cgltfPrimitive) {
@@ -398,7 +1701,7 @@ void iio_extract_cgltf_primitive(
   }
   cgltf_attribute * cgltfAttributes = cgltfPrimitive->attributes;
   cgltf_size cgltfAttributeCount = cgltfPrimitive->attributes_count;
-  iio_extract_cgltf_vertices(cgltfAttributes, cgltfAttributeCount, &iioPrimitive->vertices, &iioPrimitive->vertexCount);
+  iio_extract_cgltf_vertices(cgltfAttributes, cgltfAttributeCount, &iioPrimitive->vertices, &iioPrimitive->vertexCount, &iioPrimitive->vertexAttributes);
   if (iioPrimitive->vertexCount == 0 || !iioPrimitive->vertices) {
     fprintf(stderr, "No vertices found in primitive\n");
     return;
@@ -452,11 +1755,202 @@ void iio_extract_cgltf_primitive(
   //  TODO: handle targets
 }
 
+void iio_finalize_primitive_geometry(
+  IIOPrimitive *                            iioPrimitive,
+  IIOMeshOptimizeStats *                    stats)
+
+{
+  if (stats) memset(stats, 0, sizeof(IIOMeshOptimizeStats));
+  if (!iioPrimitive || !iioPrimitive->vertices || iioPrimitive->vertexCount == 0) return;
+
+  //  optimizing has to happen first, it changes the vertex count and with it the index width
+  if (iioMeshOptimizeFlags && iioPrimitive->mode == 4) {
+    void * vertices = iioPrimitive->vertices;
+    if (iio_optimize_mesh(&vertices, &iioPrimitive->vertexCount, sizeof(IIOVertex), &iioPrimitive->indices, &iioPrimitive->indexCount, iioMeshOptimizeFlags, stats)) {
+      iioPrimitive->vertices = vertices;
+    } else {
+      fprintf(stderr, "Failed to optimize primitive, keeping the source order\n");
+    }
+  }
+  if (iioPrimitive->indices) {
+    iioPrimitive->indexType = iio_select_index_type(iioPrimitive->vertexCount);
+  }
+
+  glm_vec3_copy(iioPrimitive->vertices[0].position, iioPrimitive->boundsMin);
+  glm_vec3_copy(iioPrimitive->vertices[0].position, iioPrimitive->boundsMax);
+  for (uint32_t i = 1; i < iioPrimitive->vertexCount; i++) {
+    glm_vec3_minv(iioPrimitive->boundsMin, iioPrimitive->vertices[i].position, iioPrimitive->boundsMin);
+    glm_vec3_maxv(iioPrimitive->boundsMax, iioPrimitive->vertices[i].position, iioPrimitive->boundsMax);
+  }
+  //  the sphere shares the box center, its radius reaches the farthest vertex rather than the box corners
+  glm_vec3_center(iioPrimitive->boundsMin, iioPrimitive->boundsMax, iioPrimitive->sphereCenter);
+  float radiusSquared = 0.0f;
+  for (uint32_t i = 0; i < iioPrimitive->vertexCount; i++) {
+    radiusSquared = fmaxf(radiusSquared, glm_vec3_distance2(iioPrimitive->sphereCenter, iioPrimitive->vertices[i].position));
+  }
+  iioPrimitive->sphereRadius = sqrtf(radiusSquared);
+
+  //  the pipelines take the selected layout, a primitive that could not be packed is not uploaded
+  iioPrimitive->vertexLayout = iioVertexLayout;
+  if (iioVertexLayout == iio_vertex_layout_packed) {
+    iioPrimitive->vertexData = malloc((size_t) iioPrimitive->vertexCount * IIO_PACKED_VERTEX_SIZE);
+    if (iioPrimitive->vertexData) {
+      iio_pack_vertices(iioPrimitive->vertices, iioPrimitive->vertexCount, iioPrimitive->vertexData);
+    } else {
+      fprintf(stderr, "Failed to allocate packed vertices for %u vertices\n", iioPrimitive->vertexCount);
+    }
+  }
+}
+
+/*****************************
+ *   accessor bulk reading   *
+ *****************************/
+
+//  the fast paths convert a tightly packed component stream into a contiguous float array, which is
+//  then scattered into the interleaved vertices. Everything else goes through cgltf_accessor_read_float
+
+static void iio_convert_u8_scalar(const uint8_t * src, float * dst, size_t count, float scale) {
+  for (size_t i = 0; i < count; i++) dst[i] = (float) src[i] * scale;
+}
+
+static void iio_convert_u16_scalar(const uint16_t * src, float * dst, size_t count, float scale) {
+  for (size_t i = 0; i < count; i++) dst[i] = (float) src[i] * scale;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+static void iio_convert_u8_sse2(const uint8_t * src, float * dst, size_t count, float scale) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 vscale = _mm_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *) (src + i));
+    __m128i lo16 = _mm_unpacklo_epi8(bytes, zero);
+    __m128i hi16 = _mm_unpackhi_epi8(bytes, zero);
+    _mm_storeu_ps(dst + i,      _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo16, zero)), vscale));
+    _mm_storeu_ps(dst + i + 4,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo16, zero)), vscale));
+    _mm_storeu_ps(dst + i + 8,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi16, zero)), vscale));
+    _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi16, zero)), vscale));
+  }
+  iio_convert_u8_scalar(src + i, dst + i, count - i, scale);
+}
+
+static void iio_convert_u16_sse2(const uint16_t * src, float * dst, size_t count, float scale) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 vscale = _mm_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i words = _mm_loadu_si128((const __m128i *) (src + i));
+    _mm_storeu_ps(dst + i,     _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero)), vscale));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero)), vscale));
+  }
+  iio_convert_u16_scalar(src + i, dst + i, count - i, scale);
+}
+
+__attribute__((target("avx2")))
+static void iio_convert_u8_avx2(const uint8_t * src, float * dst, size_t count, float scale) {
+  const __m256 vscale = _mm256_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *) (src + i));
+    __m256i lo = _mm256_cvtepu8_epi32(bytes);
+    __m256i hi = _mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8));
+    _mm256_storeu_ps(dst + i,     _mm256_mul_ps(_mm256_cvtepi32_ps(lo), vscale));
+    _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), vscale));
+  }
+  iio_convert_u8_scalar(src + i, dst + i, count - i, scale);
+}
+
+__attribute__((target("avx2")))
+static void iio_convert_u16_avx2(const uint16_t * src, float * dst, size_t count, float scale) {
+  const __m256 vscale = _mm256_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i lo = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) (src + i)));
+    __m256i hi = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) (src + i + 8)));
+    _mm256_storeu_ps(dst + i,     _mm256_mul_ps(_mm256_cvtepi32_ps(lo), vscale));
+    _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), vscale));
+  }
+  iio_convert_u16_scalar(src + i, dst + i, count - i, scale);
+}
+
+static void iio_convert_u8(const uint8_t * src, float * dst, size_t count, float scale) {
+  if (__builtin_cpu_supports("avx2")) iio_convert_u8_avx2(src, dst, count, scale);
+  else                                iio_convert_u8_sse2(src, dst, count, scale);
+}
+
+static void iio_convert_u16(const uint16_t * src, float * dst, size_t count, float scale) {
+  if (__builtin_cpu_supports("avx2")) iio_convert_u16_avx2(src, dst, count, scale);
+  else                                iio_convert_u16_sse2(src, dst, count, scale);
+}
+
+#else
+
+static void iio_convert_u8(const uint8_t * src, float * dst, size_t count, float scale) {
+  iio_convert_u8_scalar(src, dst, count, scale);
+}
+
+static void iio_convert_u16(const uint16_t * src, float * dst, size_t count, float scale) {
+  iio_convert_u16_scalar(src, dst, count, scale);
+}
+
+#endif
+
+//  writes components floats per element to dst, advancing dstStride bytes per element.
+//  returns false when the accessor has no fast path and must be read element by element
+static bool iio_read_accessor_bulk(
+  const cgltf_accessor *                    accessor,
+  cgltf_size                                count,
+  cgltf_size                                components,
+  float *                                   dst,
+  size_t                                    dstStride)
+
+{
+  if (accessor->is_sparse || !accessor->buffer_view) return false;
+  if (cgltf_num_components(accessor->type) != components) return false;
+
+  const uint8_t * base = cgltf_buffer_view_data(accessor->buffer_view);
+  if (!base) return false;
+  base += accessor->offset;
+
+  cgltf_size componentSize = cgltf_component_size(accessor->component_type);
+  cgltf_size elementSize = componentSize * components;
+  cgltf_size srcStride = accessor->stride ? accessor->stride : elementSize;
+  uint8_t * out = (uint8_t *) dst;
+
+  if (accessor->component_type == cgltf_component_type_r_32f) {
+    for (cgltf_size v = 0; v < count; v++) {
+      memcpy(out + v * dstStride, base + v * srcStride, elementSize);
+    }
+    return true;
+  }
+
+  //  joints are plain integers, everything else in u8/u16 has to be normalized to be readable as float
+  float scale;
+  if      (accessor->component_type == cgltf_component_type_r_8u)  scale = accessor->normalized ? 1.0f / 255.0f : 1.0f;
+  else if (accessor->component_type == cgltf_component_type_r_16u) scale = accessor->normalized ? 1.0f / 65535.0f : 1.0f;
+  else return false;
+  if (srcStride != elementSize) return false;
+
+  size_t scalarCount = count * components;
+  float * converted = malloc(scalarCount * sizeof(float));
+  if (!converted) return false;
+  if (componentSize == 1) iio_convert_u8(base, converted, scalarCount, scale);
+  else                    iio_convert_u16((const uint16_t *) base, converted, scalarCount, scale);
+
+  for (cgltf_size v = 0; v < count; v++) {
+    memcpy(out + v * dstStride, converted + v * components, components * sizeof(float));
+  }
+  free(converted);
+  return true;
+}
+
 void iio_extract_cgltf_vertices(
   cgltf_attribute *                         cgltfAttributes, 
   cgltf_size                                cgltfAttributeCount, 
   IIOVertex **                              pVertices, 
-  uint32_t *                                pVertexCount) 
+  uint32_t *                                pVertexCount,
+  IIOVertexAttributeFlags *                 pAttributes) 
 
 {
   //  Check for NULL pointers and empty attributes
@@ -472,63 +1966,75 @@ void iio_extract_cgltf_vertices(
     *pVertexCount = 0;
     return;
   }
-  if (!pVertices || !pVertexCount) {
+  if (!pVertices || !pVertexCount || !pAttributes) {
     fprintf(stderr, "Tried to extract vertices to a NULL pointer\n");
     return;
   }
+  *pAttributes = 0;
 
   //  get the vertex count and allocate memory for the vertices
   *pVertexCount = cgltfAttributes[0].data->count;
-  *pVertices = malloc(*pVertexCount * sizeof(IIOVertex));
+  *pVertices = calloc(*pVertexCount, sizeof(IIOVertex));
   if (!*pVertices) {
     fprintf(stderr, "Failed to allocate memory for IIOVertex array\n");
     *pVertexCount = 0;
     return;
   }
 
-  //  
-  cgltf_attribute * attribute = cgltfAttributes;
   IIOVertex * vertices = *pVertices;
-  for (int i = 0; i < cgltfAttributeCount; i++) {
+  for (cgltf_size i = 0; i < cgltfAttributeCount; i++) {
+    cgltf_attribute * attribute = &cgltfAttributes[i];
     cgltf_accessor * accessor = attribute->data;
-    if        (attribute->type == cgltf_attribute_type_position) {
-      for (int v = 0; v < accessor->count; v++) {
-        cgltf_accessor_read_float(accessor, v, vertices[v].position, 3);
-      }
-    } else if (attribute->type == cgltf_attribute_type_normal) {
-      for (int v = 0; v < accessor->count; v++) {
-        cgltf_accessor_read_float(accessor, v, vertices[v].normal, 3);
-      }
-    } else if (attribute->type == cgltf_attribute_type_tangent) {
-      for (int v = 0; v < accessor->count; v++) {
-        cgltf_accessor_read_float(accessor, v, vertices[v].tangent, 4);
-      }
-    } else if (attribute->type == cgltf_attribute_type_texcoord) {
-      for (int v = 0; v < accessor->count; v++) {
+    cgltf_size count = accessor->count < *pVertexCount ? accessor->count : *pVertexCount;
+
+    //  resolve the destination once per attribute instead of once per vertex
+    float * dst = NULL;
+    cgltf_size components = 0;
+    IIOVertexAttributeFlags bit = 0;
+    bool opaqueColor = false;
+    switch (attribute->type) {
+      case cgltf_attribute_type_position:
+        dst = vertices[0].position; components = 3; bit = IIO_VERTEX_ATTRIBUTE_POSITION_BIT;
+        break;
+      case cgltf_attribute_type_normal:
+        dst = vertices[0].normal; components = 3; bit = IIO_VERTEX_ATTRIBUTE_NORMAL_BIT;
+        break;
+      case cgltf_attribute_type_tangent:
+        dst = vertices[0].tangent; components = 4; bit = IIO_VERTEX_ATTRIBUTE_TANGENT_BIT;
+        break;
+      case cgltf_attribute_type_texcoord:
         if (attribute->index >= 2) continue; // Only handle texcoord 0 and 1
-        cgltf_accessor_read_float(accessor, v, vertices[v].texCoord[attribute->index], 2);
-      }
-    } else if (attribute->type == cgltf_attribute_type_color) {
-      for (int v = 0; v < accessor->count; v++) {
+        dst = vertices[0].texCoord[attribute->index]; components = 2; bit = IIO_VERTEX_ATTRIBUTE_TEXCOORD0_BIT << attribute->index;
+        break;
+      case cgltf_attribute_type_color:
         if (attribute->index >= 1) continue; // Only handle color 0
-        cgltf_size element_size = accessor->type == cgltf_type_vec4 ? 4 : 3;
-        cgltf_accessor_read_float(accessor, v, vertices[v].color, element_size);
-        if (element_size == 3) vertices[v].color[3] = 1.0f; // Set alpha to 1.0 if not present
-      }
-    } else if (attribute->type == cgltf_attribute_type_joints) {
-      for (int v = 0; v < accessor->count; v++) {
+        components = accessor->type == cgltf_type_vec4 ? 4 : 3;
+        opaqueColor = components == 3;
+        dst = vertices[0].color; bit = IIO_VERTEX_ATTRIBUTE_COLOR_BIT;
+        break;
+      case cgltf_attribute_type_joints:
         if (attribute->index >= 1) continue; // Only handle joints 0
-        cgltf_accessor_read_float(accessor, v, vertices[v].joints, 4);
-      }
-    } else if (attribute->type == cgltf_attribute_type_weights) {
-      for (int v = 0; v < accessor->count; v++) {
+        dst = vertices[0].joints; components = 4; bit = IIO_VERTEX_ATTRIBUTE_JOINTS_BIT;
+        break;
+      case cgltf_attribute_type_weights:
         if (attribute->index >= 1) continue; // Only handle weights 0
-        cgltf_accessor_read_float(accessor, v, vertices[v].weights, 4);
+        dst = vertices[0].weights; components = 4; bit = IIO_VERTEX_ATTRIBUTE_WEIGHTS_BIT;
+        break;
+      default:
+        fprintf(stderr, "Unknown attribute type: %d\n", attribute->type);
+        continue;
+    }
+    *pAttributes |= bit;
+
+    if (!iio_read_accessor_bulk(accessor, count, components, dst, sizeof(IIOVertex))) {
+      //  sparse, strided normalized or exotic component types
+      for (cgltf_size v = 0; v < count; v++) {
+        cgltf_accessor_read_float(accessor, v, (float *) ((uint8_t *) dst + v * sizeof(IIOVertex)), components);
       }
-    } else {
-      fprintf(stderr, "Unknown attribute type: %d\n", attribute->type);
     }
-    attribute++;
+    if (opaqueColor) {
+      for (cgltf_size v = 0; v < count; v++) vertices[v].color[3] = 1.0f; // Set alpha to 1.0 if not present
+    }
   }
 }
 
@@ -544,19 +2050,13 @@ void iio_extract_cgltf_material(
     fprintf(stderr, "Tried to extract to a NULL IIOMaterial\n");
     return;
   }
+  //  textures are bound once their images are uploaded, see iio_bind_material_images
 
   //  Get PBR Metallic Roughness
   if (cgltfMaterial->has_pbr_metallic_roughness) {
     //  Base Color Factor float[4]:optional; default:{1.0f, 1.0f, 1.0f, 1.0f}
     memcpy(iioMaterial->pbrMetallicRoughness.baseColorFactor, cgltfMaterial->pbr_metallic_roughness.base_color_factor, sizeof(float) * 4);
 
-    //  Base Color Texture texture[1]:optional; default:RGBA, {1.0f, 1.0f, 1.0f, 1.0f}
-    iio_extract_cgltf_texture(
-      cgltfMaterial->pbr_metallic_roughness.base_color_texture.texture,
-      &iioMaterial->pbrMetallicRoughness.baseColorTextureInfo.image,
-      &iioMaterial->pbrMetallicRoughness.baseColorTextureInfo.imageMemory,
-      &iioMaterial->pbrMetallicRoughness.baseColorTextureInfo.imageView
-    );
     iioMaterial->pbrMetallicRoughness.baseColorTextureInfo.texCoord = cgltfMaterial->pbr_metallic_roughness.base_color_texture.texcoord;
 
     //  Metallic Factor float[1]:optional; default:1.0f
@@ -565,51 +2065,23 @@ void iio_extract_cgltf_material(
     //  Roughness Factor float[1]:optional; default:1.0f
     iioMaterial->pbrMetallicRoughness.roughnessFactor = cgltfMaterial->pbr_metallic_roughness.roughness_factor;
 
-    //  Metallic Roughness Texture texture[1]:optional; default:RGBA, {Xf, 1.0f, 1.0f, Xf}
-    iio_extract_cgltf_texture(
-      cgltfMaterial->pbr_metallic_roughness.metallic_roughness_texture.texture,
-      &iioMaterial->pbrMetallicRoughness.metallicRoughnessTextureInfo.image,
-      &iioMaterial->pbrMetallicRoughness.metallicRoughnessTextureInfo.imageMemory,
-      &iioMaterial->pbrMetallicRoughness.metallicRoughnessTextureInfo.imageView
-    );
     iioMaterial->pbrMetallicRoughness.metallicRoughnessTextureInfo.texCoord = cgltfMaterial->pbr_metallic_roughness.metallic_roughness_texture.texcoord;
   }
 
   //  Get Normal Texture
   if (cgltfMaterial->normal_texture.texture) {
-    //  Normal Texture texture[1]:optional; default:RGBA, {0.0f, 0.0f, 1.0f, 1.0f}
-    iio_extract_cgltf_texture(
-      cgltfMaterial->normal_texture.texture,
-      &iioMaterial->normalTexture.textureInfo.image,
-      &iioMaterial->normalTexture.textureInfo.imageMemory,
-      &iioMaterial->normalTexture.textureInfo.imageView
-    );
     iioMaterial->normalTexture.textureInfo.texCoord = cgltfMaterial->normal_texture.texcoord;
     iioMaterial->normalTexture.scale = cgltfMaterial->normal_texture.scale;
   }
 
   //  Get Occlusion Texture
   if (cgltfMaterial->occlusion_texture.texture) {
-    //  Occlusion Texture texture[1]:optional; default:RGBA, {1.0f, 1.0f, 1.0f, 1.0f}
-    iio_extract_cgltf_texture(
-      cgltfMaterial->occlusion_texture.texture,
-      &iioMaterial->occlusionTexture.textureInfo.image,
-      &iioMaterial->occlusionTexture.textureInfo.imageMemory,
-      &iioMaterial->occlusionTexture.textureInfo.imageView
-    );
     iioMaterial->occlusionTexture.textureInfo.texCoord = cgltfMaterial->occlusion_texture.texcoord;
     iioMaterial->occlusionTexture.strength = cgltfMaterial->occlusion_texture.scale;
   }
 
   //  Get Emissive Texture
   if (cgltfMaterial->emissive_texture.texture) {
-    //  Emissive Texture texture[1]:optional; default:RGBA, {1.0f, 1.0f, 1.0f, 1.0f}
-    iio_extract_cgltf_texture(
-      cgltfMaterial->emissive_texture.texture,
-      &iioMaterial->emissiveTexture.image,
-      &iioMaterial->emissiveTexture.imageMemory,
-      &iioMaterial->emissiveTexture.imageView
-    );
     iioMaterial->emissiveTexture.texCoord = cgltfMaterial->emissive_texture.texcoord;
   }
 
@@ -639,10 +2111,103 @@ void iio_extract_cgltf_material(
   iioMaterial->doubleSided = cgltfMaterial->double_sided;
 }
 
+void iio_cgltf_material_image_indices(
+  const cgltf_data *                        cgltfData,
+  const cgltf_material *                    cgltfMaterial,
+  int32_t *                                 imageIndices)
+
+{
+  for (int i = 0; i < IIO_MATERIAL_TEXTURE_COUNT; i++) imageIndices[i] = -1;
+  if (!cgltfMaterial) return;
+
+  const cgltf_texture * textures [IIO_MATERIAL_TEXTURE_COUNT] = {
+    cgltfMaterial->has_pbr_metallic_roughness ? cgltfMaterial->pbr_metallic_roughness.base_color_texture.texture : NULL,
+    cgltfMaterial->has_pbr_metallic_roughness ? cgltfMaterial->pbr_metallic_roughness.metallic_roughness_texture.texture : NULL,
+    cgltfMaterial->normal_texture.texture,
+    cgltfMaterial->occlusion_texture.texture,
+    cgltfMaterial->emissive_texture.texture,
+  };
+  for (int i = 0; i < IIO_MATERIAL_TEXTURE_COUNT; i++) {
+    if (textures[i] && textures[i]->image) imageIndices[i] = (int32_t) cgltf_image_index(cgltfData, textures[i]->image);
+  }
+}
+
+void iio_cgltf_material_samplers(
+  const cgltf_material *                    cgltfMaterial,
+  IIOTextureSampler *                       textureSamplers)
+
+{
+  memset(textureSamplers, 0, IIO_MATERIAL_TEXTURE_COUNT * sizeof(IIOTextureSampler));
+  if (!cgltfMaterial) return;
+
+  const cgltf_texture * textures [IIO_MATERIAL_TEXTURE_COUNT] = {
+    cgltfMaterial->has_pbr_metallic_roughness ? cgltfMaterial->pbr_metallic_roughness.base_color_texture.texture : NULL,
+    cgltfMaterial->has_pbr_metallic_roughness ? cgltfMaterial->pbr_metallic_roughness.metallic_roughness_texture.texture : NULL,
+    cgltfMaterial->normal_texture.texture,
+    cgltfMaterial->occlusion_texture.texture,
+    cgltfMaterial->emissive_texture.texture,
+  };
+  for (int i = 0; i < IIO_MATERIAL_TEXTURE_COUNT; i++) {
+    const cgltf_sampler * sampler = textures[i] ? textures[i]->sampler : NULL;
+    if (!sampler) continue; // repeat with filtering left to the loader
+    textureSamplers[i] = (IIOTextureSampler) {
+      .magFilter = sampler->mag_filter,
+      .minFilter = sampler->min_filter,
+      .wrapS = sampler->wrap_s,
+      .wrapT = sampler->wrap_t,
+    };
+  }
+}
+
+void iio_accumulate_material_image_usages(
+  const int32_t *                           imageIndices,
+  IIOTextureUsageFlags *                    imageUsages)
+
+{
+  static const IIOTextureUsageFlags slotUsages [IIO_MATERIAL_TEXTURE_COUNT] = {
+    IIO_TEXTURE_USAGE_COLOR_BIT,
+    IIO_TEXTURE_USAGE_METALLIC_ROUGHNESS_BIT,
+    IIO_TEXTURE_USAGE_NORMAL_BIT,
+    IIO_TEXTURE_USAGE_OCCLUSION_BIT,
+    IIO_TEXTURE_USAGE_COLOR_BIT,
+  };
+  for (int i = 0; i < IIO_MATERIAL_TEXTURE_COUNT; i++) {
+    if (imageIndices[i] >= 0) imageUsages[imageIndices[i]] |= slotUsages[i];
+  }
+}
+
+void iio_bind_material_images(
+  const int32_t *                           imageIndices,
+  const VkSampler *                         samplers,
+  const IIOImageHandle *                    images,
+  IIOMaterial *                             iioMaterial)
+
+{
+  if (!images) return;
+
+  IIOTextureInfo * infos [IIO_MATERIAL_TEXTURE_COUNT] = {
+    &iioMaterial->pbrMetallicRoughness.baseColorTextureInfo,
+    &iioMaterial->pbrMetallicRoughness.metallicRoughnessTextureInfo,
+    &iioMaterial->normalTexture.textureInfo,
+    &iioMaterial->occlusionTexture.textureInfo,
+    &iioMaterial->emissiveTexture,
+  };
+
+  for (int i = 0; i < IIO_MATERIAL_TEXTURE_COUNT; i++) {
+    if (imageIndices[i] < 0) continue; // keep the default texture
+    const IIOImageHandle * image = &images[imageIndices[i]];
+    if (!image->data) continue; // decode failed, keep the default texture
+    infos[i]->image = image->data;
+    infos[i]->imageView = image->view;
+    infos[i]->imageMemory = image->memory;
+    infos[i]->sampler = samplers && samplers[i] ? samplers[i] : image->sampler;
+  }
+}
+
 void iio_extract_cgltf_texture(
   cgltf_texture *                           cgltfTexture, 
   VkImage *                                 image, 
-  VkDeviceMemory *                          imageMemory, 
+  IIOAllocation *                           imageMemory, 
   VkImageView *                             imageView) 
 
 {
@@ -697,11 +2262,10 @@ void iio_destroy_resources(
   }
   if (defaultRGBAImageView) vkDestroyImageView(device, defaultRGBAImageView, NULL);
   if (defaultRGBAImage) vkDestroyImage(device, defaultRGBAImage, NULL);
-  if (defaultRGBAImageMemory) vkFreeMemory(device, defaultRGBAImageMemory, NULL);
+  if (defaultRGBAImageMemory.memory) iioFreeMemoryFunc(&defaultRGBAImageMemory);
   if (defaultNormalImageView) vkDestroyImageView(device, defaultNormalImageView, NULL);
   if (defaultNormalImage) vkDestroyImage(device, defaultNormalImage, NULL);
-  if (defaultNormalImageMemory) vkFreeMemory(device, defaultNormalImageMemory, NULL);
-  if (defaultSampler) vkDestroySampler(device, defaultSampler, NULL);
+  if (defaultNormalImageMemory.memory) iioFreeMemoryFunc(&defaultNormalImageMemory);
 }
 
 void iio_destroy_model(
@@ -714,11 +2278,23 @@ void iio_destroy_model(
     for (uint32_t j = 0; j < mesh->primitiveCount; j++) {
       IIOPrimitive * primitive = &mesh->primitives[j];
       free(primitive->vertices);
+      free(primitive->vertexData);
       free(primitive->indices);
     }
     free(mesh->primitives);
   }
   free(model->meshes);
+  free(model->images);
+  for (uint32_t i = 0; i < model->imageCount && model->imageNames; i++) free(model->imageNames[i]);
+  free(model->imageNames);
+  free(model->samplers);
+  model->meshes = NULL;
+  model->meshCount = 0;
+  model->images = NULL;
+  model->imageNames = NULL;
+  model->imageCount = 0;
+  model->samplers = NULL;
+  model->samplerCount = 0;
 }
 
 void iio_destroy_image(
@@ -729,21 +2305,48 @@ void iio_destroy_image(
 {
   if (hmap_strImg_contains(&manager->imageMap, name)) {
     IIOImageHandle * image = hmap_strImg_at_mut(&manager->imageMap, name);
+    if (image->refCount > 1) {
+      image->refCount--;
+      return;
+    }
     vkDestroyImage(device, image->data, NULL);
     vkDestroyImageView(device, image->view, NULL);
-    vkDestroySampler(device, image->sampler, NULL);
-    vkFreeMemory(device, image->memory, NULL);
+    iio_release_sampler(device, manager, image->sampler);
+    iioFreeMemoryFunc(&image->memory);
     hmap_strImg_erase(&manager->imageMap, name);
   } else {
     fprintf(stderr, "iio_destroy_image : Image with name %s was not found\n", name);
   }
 }
 
+void iio_release_model_resources(
+  VkDevice                                  device,
+  IIOModel *                                model,
+  IIOResourceManager *                      manager)
+
+{
+  if (!model) return;
+  for (uint32_t i = 0; i < model->samplerCount; i++) iio_release_sampler(device, manager, model->samplers[i]);
+  free(model->samplers);
+  model->samplers = NULL;
+  model->samplerCount = 0;
+  for (uint32_t i = 0; i < model->imageCount && model->imageNames; i++) {
+    if (!model->imageNames[i]) continue;
+    iio_destroy_image(device, model->imageNames[i], manager);
+    free(model->imageNames[i]);
+    model->imageNames[i] = NULL;
+    memset(&model->images[i], 0, sizeof(IIOImageHandle));
+  }
+}
+
 void iio_destroy_resource_manager(
   IIOResourceManager *                      manager) 
 
 {
-
+  iio_destroy_job_pool(&manager->jobPool);
+  hmap_strModel_drop(&manager->modelMap);
+  hmap_strImg_drop(&manager->imageMap);
+  hmap_Sampler_drop(&manager->samplerMap);
 }
 
 /**
@@ -7,9 +7,9 @@
 IIOStringWrapper IIOStringWrapper_make(const char * str) {
   IIOStringWrapper string = {0};
   size_t length = strlen(str);
-  string.str = malloc(length * sizeof(char));
+  string.str = malloc((length + 1) * sizeof(char));
   if (!string.str) exit(1);
-  strncpy(string.str, str, length);
+  memcpy(string.str, str, length + 1);
   string.view = zsview_from(string.str);
   return string;
 }
@@ -19,9 +19,9 @@ void IIOStringWrapper_drop(IIOStringWrapper * string) {
 }
 
 IIOStringWrapper IIOStringWrapper_clone(IIOStringWrapper string) {
-  char * str = malloc(string.view.size * sizeof(char));
+  char * str = malloc((string.view.size + 1) * sizeof(char));
   if (!str) exit(1);
-  strncpy(str, string.str, string.view.size);
+  memcpy(str, string.str, string.view.size + 1);
   string.str = str;
   string.view = zsview_from(str);
   return string;
@@ -0,0 +1,676 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include "iio_texture_compression.h"
+#include "iio_mipmap.h"
+
+#define IIO_KTX2_HEADER_SIZE 80
+#define IIO_KTX2_LEVEL_INDEX_SIZE 24
+#define IIO_DDS_HEADER_SIZE 128 // magic included
+#define IIO_DDS_DX10_HEADER_SIZE 20
+
+#define IIO_FOURCC(a, b, c, d) ((uint32_t) (a) | ((uint32_t) (b) << 8) | ((uint32_t) (c) << 16) | ((uint32_t) (d) << 24))
+
+static const uint8_t ktx2Identifier [12] = {0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a};
+
+//  interpolation weights of 4 bit BC7 indices, out of 64
+static const uint32_t bc7Weights4 [16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+/*****************************
+ *      helper functions     *
+ *****************************/
+
+static uint32_t iio_read_u32(const uint8_t * bytes) {
+  return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static uint64_t iio_read_u64(const uint8_t * bytes) {
+  return (uint64_t) iio_read_u32(bytes) | ((uint64_t) iio_read_u32(bytes + 4) << 32);
+}
+
+static void iio_write_u32(uint8_t * bytes, uint32_t value) {
+  for (int i = 0; i < 4; i++) bytes[i] = (uint8_t) (value >> (8 * i));
+}
+
+static void iio_write_u64(uint8_t * bytes, uint64_t value) {
+  iio_write_u32(bytes, (uint32_t) value);
+  iio_write_u32(bytes + 4, (uint32_t) (value >> 32));
+}
+
+static size_t iio_compressed_level_size(uint32_t width, uint32_t height, uint32_t level, uint32_t blockSize) {
+  size_t blocksX = (iio_mip_extent(width, level) + 3) / 4;
+  size_t blocksY = (iio_mip_extent(height, level) + 3) / 4;
+  return blocksX * blocksY * blockSize;
+}
+
+static bool iio_compressed_format_srgb(VkFormat format) {
+  return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK ||
+         format == VK_FORMAT_BC3_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+//  lays out levelCount tightly packed levels and copies them in from level 0 on
+static bool iio_init_compressed_texture(
+  IIOCompressedTexture *                    texture,
+  VkFormat                                  format,
+  uint32_t                                  width,
+  uint32_t                                  height,
+  uint32_t                                  levelCount)
+
+{
+  memset(texture, 0, sizeof(IIOCompressedTexture));
+  texture->blockSize = iio_compressed_format_block_size(format);
+  if (!texture->blockSize || !width || !height || levelCount == 0 || levelCount > IIO_MAX_TEXTURE_LEVELS ||
+      levelCount > iio_mip_level_count(width, height)) {
+    return false;
+  }
+  texture->format = format;
+  texture->width = width;
+  texture->height = height;
+  texture->levelCount = levelCount;
+  for (uint32_t level = 0; level < levelCount; level++) {
+    texture->levels[level].offset = texture->dataSize;
+    texture->levels[level].size = iio_compressed_level_size(width, height, level, texture->blockSize);
+    texture->dataSize += texture->levels[level].size;
+  }
+  texture->data = malloc(texture->dataSize);
+  return texture->data != NULL;
+}
+
+/*****************************
+ *        containers         *
+ *****************************/
+
+uint32_t iio_compressed_format_block_size(
+  VkFormat                                  format)
+
+{
+  switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+      return 8;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+bool iio_is_compressed_texture_path(
+  const char *                              path)
+
+{
+  const char * extension = strrchr(path, '.');
+  return extension && (strcasecmp(extension, ".ktx2") == 0 || strcasecmp(extension, ".dds") == 0);
+}
+
+bool iio_is_compressed_texture_container(
+  const uint8_t *                           bytes,
+  size_t                                    size)
+
+{
+  if (size >= sizeof(ktx2Identifier) && memcmp(bytes, ktx2Identifier, sizeof(ktx2Identifier)) == 0) return true;
+  return size >= 4 && iio_read_u32(bytes) == IIO_FOURCC('D', 'D', 'S', ' ');
+}
+
+static bool iio_load_ktx2(
+  const uint8_t *                           bytes,
+  size_t                                    size,
+  IIOCompressedTexture *                    texture)
+
+{
+  if (size < IIO_KTX2_HEADER_SIZE) return false;
+  VkFormat format = (VkFormat) iio_read_u32(bytes + 12);
+  uint32_t width = iio_read_u32(bytes + 20);
+  uint32_t height = iio_read_u32(bytes + 24);
+  uint32_t depth = iio_read_u32(bytes + 28);
+  uint32_t layerCount = iio_read_u32(bytes + 32);
+  uint32_t faceCount = iio_read_u32(bytes + 36);
+  uint32_t levelCount = iio_read_u32(bytes + 40);
+  uint32_t supercompression = iio_read_u32(bytes + 44);
+
+  //  only plain 2D block compressed textures, basis universal payloads (format 0) need a transcoder
+  if (depth > 1 || layerCount > 1 || faceCount != 1 || supercompression != 0) {
+    fprintf(stderr, "iio_load_ktx2: only single 2D images without supercompression are supported\n");
+    return false;
+  }
+  if (!iio_compressed_format_block_size(format)) {
+    fprintf(stderr, "iio_load_ktx2: unsupported vkFormat %u\n", (uint32_t) format);
+    return false;
+  }
+  if (levelCount == 0) levelCount = 1;
+  if (levelCount > IIO_MAX_TEXTURE_LEVELS || size < IIO_KTX2_HEADER_SIZE + (size_t) levelCount * IIO_KTX2_LEVEL_INDEX_SIZE) return false;
+  if (!iio_init_compressed_texture(texture, format, width, height, levelCount)) return false;
+
+  for (uint32_t level = 0; level < levelCount; level++) {
+    const uint8_t * entry = bytes + IIO_KTX2_HEADER_SIZE + (size_t) level * IIO_KTX2_LEVEL_INDEX_SIZE;
+    uint64_t offset = iio_read_u64(entry);
+    uint64_t length = iio_read_u64(entry + 8);
+    if (length != texture->levels[level].size || offset > size || length > size - offset) {
+      iio_free_compressed_texture(texture);
+      return false;
+    }
+    memcpy(texture->data + texture->levels[level].offset, bytes + offset, length);
+  }
+  return true;
+}
+
+static VkFormat iio_dds_format(
+  const uint8_t *                           bytes,
+  size_t                                    size,
+  size_t *                                  dataOffset)
+
+{
+  uint32_t fourCC = iio_read_u32(bytes + 84);
+  *dataOffset = IIO_DDS_HEADER_SIZE;
+  switch (fourCC) {
+    case IIO_FOURCC('D', 'X', 'T', '1'): return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case IIO_FOURCC('D', 'X', 'T', '5'): return VK_FORMAT_BC3_UNORM_BLOCK;
+    case IIO_FOURCC('A', 'T', 'I', '1'):
+    case IIO_FOURCC('B', 'C', '4', 'U'): return VK_FORMAT_BC4_UNORM_BLOCK;
+    case IIO_FOURCC('A', 'T', 'I', '2'):
+    case IIO_FOURCC('B', 'C', '5', 'U'): return VK_FORMAT_BC5_UNORM_BLOCK;
+    case IIO_FOURCC('D', 'X', '1', '0'): break;
+    default: return VK_FORMAT_UNDEFINED;
+  }
+
+  if (size < IIO_DDS_HEADER_SIZE + IIO_DDS_DX10_HEADER_SIZE) return VK_FORMAT_UNDEFINED;
+  const uint8_t * dx10 = bytes + IIO_DDS_HEADER_SIZE;
+  *dataOffset += IIO_DDS_DX10_HEADER_SIZE;
+  if (iio_read_u32(dx10 + 12) > 1) return VK_FORMAT_UNDEFINED; // texture arrays
+  switch (iio_read_u32(dx10)) { // DXGI_FORMAT
+    case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+    case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+    case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+    case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+    case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+    case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+    default: return VK_FORMAT_UNDEFINED;
+  }
+}
+
+static bool iio_load_dds(
+  const uint8_t *                           bytes,
+  size_t                                    size,
+  IIOCompressedTexture *                    texture)
+
+{
+  if (size < IIO_DDS_HEADER_SIZE || iio_read_u32(bytes + 4) != 124) return false;
+  uint32_t height = iio_read_u32(bytes + 12);
+  uint32_t width = iio_read_u32(bytes + 16);
+  uint32_t levelCount = iio_read_u32(bytes + 28);
+  uint32_t caps2 = iio_read_u32(bytes + 112);
+  if (levelCount == 0) levelCount = 1;
+  if (caps2 & 0x200u) { // DDSCAPS2_CUBEMAP
+    fprintf(stderr, "iio_load_dds: cube maps are not supported\n");
+    return false;
+  }
+
+  size_t dataOffset;
+  VkFormat format = iio_dds_format(bytes, size, &dataOffset);
+  if (format == VK_FORMAT_UNDEFINED) {
+    fprintf(stderr, "iio_load_dds: unsupported pixel format\n");
+    return false;
+  }
+  if (!iio_init_compressed_texture(texture, format, width, height, levelCount)) return false;
+
+  //  levels follow each other without padding, largest first
+  if (texture->dataSize > size - dataOffset) {
+    iio_free_compressed_texture(texture);
+    return false;
+  }
+  memcpy(texture->data, bytes + dataOffset, texture->dataSize);
+  return true;
+}
+
+bool iio_load_compressed_texture_from_memory(
+  const uint8_t *                           bytes,
+  size_t                                    size,
+  IIOCompressedTexture *                    texture)
+
+{
+  memset(texture, 0, sizeof(IIOCompressedTexture));
+  if (size >= sizeof(ktx2Identifier) && memcmp(bytes, ktx2Identifier, sizeof(ktx2Identifier)) == 0) {
+    return iio_load_ktx2(bytes, size, texture);
+  }
+  if (size >= 4 && iio_read_u32(bytes) == IIO_FOURCC('D', 'D', 'S', ' ')) {
+    return iio_load_dds(bytes, size, texture);
+  }
+  return false;
+}
+
+bool iio_load_compressed_texture(
+  const char *                              path,
+  IIOCompressedTexture *                    texture)
+
+{
+  memset(texture, 0, sizeof(IIOCompressedTexture));
+  FILE * file = fopen(path, "rb");
+  if (!file) return false;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t * bytes = size > 0 ? malloc((size_t) size) : NULL;
+  bool ok = bytes && fread(bytes, 1, (size_t) size, file) == (size_t) size;
+  fclose(file);
+
+  ok = ok && iio_load_compressed_texture_from_memory(bytes, (size_t) size, texture);
+  free(bytes);
+  if (!ok) fprintf(stderr, "iio_load_compressed_texture: could not load %s\n", path);
+  return ok;
+}
+
+//  basic data format descriptor, the KTX2 spec requires one for every vkFormat
+static uint32_t iio_ktx2_write_dfd(
+  uint8_t *                                 dfd, // 24 + 2 * 16 bytes after the total size
+  VkFormat                                  format,
+  uint32_t                                  blockSize)
+
+{
+  uint8_t model;
+  uint32_t sampleCount = 1;
+  uint8_t channels [2] = {0, 0};
+  uint16_t bitOffsets [2] = {0, 64};
+  switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:  model = 128; break; // KHR_DF_MODEL_BC1A
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: model = 128; channels[0] = 1; break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:      model = 130; sampleCount = 2; channels[0] = 15; bitOffsets[0] = 0; channels[1] = 0; break;
+    case VK_FORMAT_BC4_UNORM_BLOCK:     model = 131; break;
+    case VK_FORMAT_BC5_UNORM_BLOCK:     model = 132; sampleCount = 2; channels[1] = 1; break;
+    default:                            model = 134; break; // KHR_DF_MODEL_BC7
+  }
+  bool srgb = iio_compressed_format_srgb(format);
+
+  uint32_t blockBytes = 24 + 16 * sampleCount;
+  memset(dfd, 0, 4 + blockBytes);
+  iio_write_u32(dfd, 4 + blockBytes);
+  uint8_t * block = dfd + 4;
+  iio_write_u32(block + 4, 2u | (blockBytes << 16)); // version 2
+  block[8] = model;
+  block[9] = 1;             // BT709 primaries
+  block[10] = srgb ? 2 : 1; // sRGB or linear transfer
+  block[12] = 3;            // 4x4 texel blocks
+  block[13] = 3;
+  block[16] = (uint8_t) blockSize;
+  for (uint32_t i = 0; i < sampleCount; i++) {
+    uint8_t * sample = block + 24 + 16 * i;
+    bool alpha = channels[i] == 15 || (model == 128 && channels[i] == 1);
+    sample[0] = (uint8_t) bitOffsets[i];
+    sample[1] = (uint8_t) (bitOffsets[i] >> 8);
+    sample[2] = (uint8_t) (8 * blockSize / sampleCount - 1);
+    sample[3] = channels[i] | (srgb && alpha ? 0x10 : 0); // alpha stays linear
+    iio_write_u32(sample + 12, 0xffffffffu);
+  }
+  return 4 + blockBytes;
+}
+
+bool iio_write_ktx2(
+  const char *                              path,
+  const IIOCompressedTexture *              texture)
+
+{
+  static atomic_uint tempCounter = 0;
+
+  uint8_t header [IIO_KTX2_HEADER_SIZE + IIO_MAX_TEXTURE_LEVELS * IIO_KTX2_LEVEL_INDEX_SIZE] = {0};
+  uint8_t dfd [4 + 24 + 2 * 16];
+  uint32_t levelIndexSize = texture->levelCount * IIO_KTX2_LEVEL_INDEX_SIZE;
+  uint32_t dfdOffset = IIO_KTX2_HEADER_SIZE + levelIndexSize;
+  uint32_t dfdSize = iio_ktx2_write_dfd(dfd, texture->format, texture->blockSize);
+
+  memcpy(header, ktx2Identifier, sizeof(ktx2Identifier));
+  iio_write_u32(header + 12, (uint32_t) texture->format);
+  iio_write_u32(header + 16, 1); // typeSize of block compressed formats
+  iio_write_u32(header + 20, texture->width);
+  iio_write_u32(header + 24, texture->height);
+  iio_write_u32(header + 36, 1); // faceCount
+  iio_write_u32(header + 40, texture->levelCount);
+  iio_write_u32(header + 48, dfdOffset);
+  iio_write_u32(header + 52, dfdSize);
+
+  //  level data is stored smallest first, each level aligned to the block size
+  uint64_t offsets [IIO_MAX_TEXTURE_LEVELS];
+  uint64_t offset = dfdOffset + dfdSize;
+  for (int32_t level = (int32_t) texture->levelCount - 1; level >= 0; level--) {
+    offset = (offset + texture->blockSize - 1) / texture->blockSize * texture->blockSize;
+    offsets[level] = offset;
+    offset += texture->levels[level].size;
+  }
+  for (uint32_t level = 0; level < texture->levelCount; level++) {
+    uint8_t * entry = header + IIO_KTX2_HEADER_SIZE + level * IIO_KTX2_LEVEL_INDEX_SIZE;
+    iio_write_u64(entry, offsets[level]);
+    iio_write_u64(entry + 8, texture->levels[level].size);
+    iio_write_u64(entry + 16, texture->levels[level].size);
+  }
+
+  char tempPath [512];
+  int len = snprintf(tempPath, sizeof(tempPath), "%s.%ld.%u.tmp", path, (long) getpid(), atomic_fetch_add(&tempCounter, 1));
+  if (len < 0 || (size_t) len >= sizeof(tempPath)) return false;
+  FILE * file = fopen(tempPath, "wb");
+  if (!file) {
+    fprintf(stderr, "iio_write_ktx2: could not open %s\n", tempPath);
+    return false;
+  }
+
+  static const uint8_t zeros [16] = {0};
+  uint64_t position = dfdOffset + dfdSize;
+  bool ok = fwrite(header, 1, dfdOffset, file) == dfdOffset && fwrite(dfd, 1, dfdSize, file) == dfdSize;
+  for (int32_t level = (int32_t) texture->levelCount - 1; level >= 0 && ok; level--) {
+    size_t padding = (size_t) (offsets[level] - position);
+    const IIOCompressedTextureLevel * data = &texture->levels[level];
+    ok = (!padding || fwrite(zeros, 1, padding, file) == padding) &&
+         fwrite(texture->data + data->offset, 1, data->size, file) == data->size;
+    position = offsets[level] + data->size;
+  }
+  ok = fclose(file) == 0 && ok;
+
+  if (!ok || rename(tempPath, path) != 0) {
+    fprintf(stderr, "iio_write_ktx2: failed to write %s\n", path);
+    remove(tempPath);
+    return false;
+  }
+  return true;
+}
+
+void iio_free_compressed_texture(
+  IIOCompressedTexture *                    texture)
+
+{
+  free(texture->data);
+  memset(texture, 0, sizeof(IIOCompressedTexture));
+}
+
+/*****************************
+ *         encoding          *
+ *****************************/
+
+typedef struct IIOBitWriter_S {
+  uint8_t *                                 out;
+  uint32_t                                  position;
+} IIOBitWriter;
+
+static void iio_write_bits(IIOBitWriter * writer, uint32_t value, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++, writer->position++) {
+    writer->out[writer->position >> 3] |= (uint8_t) (((value >> i) & 1u) << (writer->position & 7));
+  }
+}
+
+//  BC4: two 8 bit endpoints and 3 bit indices, the endpoints are ordered for the eight value palette
+static void iio_encode_bc4_block(
+  const uint8_t *                           values,
+  uint32_t                                  stride,
+  uint8_t *                                 out)
+
+{
+  uint8_t lo = 255, hi = 0;
+  for (int i = 0; i < 16; i++) {
+    uint8_t v = values[i * stride];
+    if (v < lo) lo = v;
+    if (v > hi) hi = v;
+  }
+
+  memset(out, 0, 8);
+  out[0] = hi;
+  out[1] = lo;
+  if (hi == lo) return;
+
+  //  palette codes: 0 is hi, 1 is lo, 2..7 blend from hi to lo
+  int palette [8] = {hi, lo};
+  for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * hi + i * lo + 3) / 7;
+
+  IIOBitWriter writer = {out, 16};
+  for (int i = 0; i < 16; i++) {
+    int v = values[i * stride];
+    uint32_t best = 0;
+    int bestError = 256;
+    for (uint32_t code = 0; code < 8; code++) {
+      int error = abs(palette[code] - v);
+      if (error < bestError) {
+        bestError = error;
+        best = code;
+      }
+    }
+    iio_write_bits(&writer, best, 3);
+  }
+}
+
+void iio_encode_bc5_block(
+  const uint8_t *                           block,
+  uint8_t *                                 out)
+
+{
+  iio_encode_bc4_block(block, 4, out);
+  iio_encode_bc4_block(block + 1, 4, out + 8);
+}
+
+//  BC7 mode 6 endpoint: 7 bits per channel plus a shared low bit
+static void iio_bc7_quantize_endpoint(const float * endpoint, uint32_t * quantized, uint32_t * pBit) {
+  float bestError = INFINITY;
+  for (uint32_t p = 0; p < 2; p++) {
+    uint32_t candidate [4];
+    float error = 0.0f;
+    for (int c = 0; c < 4; c++) {
+      float q = roundf((endpoint[c] - (float) p) * 0.5f);
+      candidate[c] = q < 0.0f ? 0 : (q > 127.0f ? 127 : (uint32_t) q);
+      float d = (float) ((candidate[c] << 1) | p) - endpoint[c];
+      error += d * d;
+    }
+    if (error < bestError) {
+      bestError = error;
+      memcpy(quantized, candidate, sizeof(candidate));
+      *pBit = p;
+    }
+  }
+}
+
+//  picks the closest palette entry for every texel, returns the summed squared error
+static uint32_t iio_bc7_select_indices(
+  const uint8_t *                           block,
+  const uint32_t *                          q0,
+  uint32_t                                  p0,
+  const uint32_t *                          q1,
+  uint32_t                                  p1,
+  uint32_t *                                indices)
+
+{
+  int palette [16][4];
+  for (int i = 0; i < 16; i++) {
+    for (int c = 0; c < 4; c++) {
+      int e0 = (int) ((q0[c] << 1) | p0);
+      int e1 = (int) ((q1[c] << 1) | p1);
+      palette[i][c] = ((64 - (int) bc7Weights4[i]) * e0 + (int) bc7Weights4[i] * e1 + 32) >> 6;
+    }
+  }
+
+  uint32_t total = 0;
+  for (int t = 0; t < 16; t++) {
+    uint32_t bestError = UINT32_MAX;
+    for (uint32_t i = 0; i < 16; i++) {
+      uint32_t error = 0;
+      for (int c = 0; c < 4; c++) {
+        int d = palette[i][c] - block[t * 4 + c];
+        error += (uint32_t) (d * d);
+      }
+      if (error < bestError) {
+        bestError = error;
+        indices[t] = i;
+      }
+    }
+    total += bestError;
+  }
+  return total;
+}
+
+void iio_encode_bc7_block(
+  const uint8_t *                           block,
+  uint8_t *                                 out)
+
+{
+  //  endpoints start at the extremes of the texels along their principal axis
+  float mean [4] = {0};
+  for (int t = 0; t < 16; t++) {
+    for (int c = 0; c < 4; c++) mean[c] += block[t * 4 + c] / 16.0f;
+  }
+  float covariance [4][4] = {0};
+  for (int t = 0; t < 16; t++) {
+    float d [4];
+    for (int c = 0; c < 4; c++) d[c] = block[t * 4 + c] - mean[c];
+    for (int a = 0; a < 4; a++) {
+      for (int b = 0; b < 4; b++) covariance[a][b] += d[a] * d[b];
+    }
+  }
+  float axis [4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float next [4] = {0};
+    float length = 0.0f;
+    for (int a = 0; a < 4; a++) {
+      for (int b = 0; b < 4; b++) next[a] += covariance[a][b] * axis[b];
+      length = fmaxf(length, fabsf(next[a]));
+    }
+    if (length == 0.0f) break;
+    for (int a = 0; a < 4; a++) axis[a] = next[a] / length;
+  }
+  float minT = INFINITY, maxT = -INFINITY;
+  for (int t = 0; t < 16; t++) {
+    float projection = 0.0f;
+    for (int c = 0; c < 4; c++) projection += (block[t * 4 + c] - mean[c]) * axis[c];
+    minT = fminf(minT, projection);
+    maxT = fmaxf(maxT, projection);
+  }
+  float axisLength = 0.0f;
+  for (int c = 0; c < 4; c++) axisLength += axis[c] * axis[c];
+  if (axisLength > 0.0f) {
+    minT /= axisLength;
+    maxT /= axisLength;
+  } else {
+    minT = maxT = 0.0f;
+  }
+
+  float endpoints [2][4];
+  for (int c = 0; c < 4; c++) {
+    endpoints[0][c] = fminf(fmaxf(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+    endpoints[1][c] = fminf(fmaxf(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+  }
+
+  uint32_t q [2][4], p [2], indices [16];
+  iio_bc7_quantize_endpoint(endpoints[0], q[0], &p[0]);
+  iio_bc7_quantize_endpoint(endpoints[1], q[1], &p[1]);
+  uint32_t error = iio_bc7_select_indices(block, q[0], p[0], q[1], p[1], indices);
+
+  //  one least squares refit of the endpoints to the chosen indices
+  float a = 0.0f, b = 0.0f, d = 0.0f, rhs [2][4] = {0};
+  for (int t = 0; t < 16; t++) {
+    float w = bc7Weights4[indices[t]] / 64.0f;
+    a += (1.0f - w) * (1.0f - w);
+    b += (1.0f - w) * w;
+    d += w * w;
+    for (int c = 0; c < 4; c++) {
+      rhs[0][c] += (1.0f - w) * block[t * 4 + c];
+      rhs[1][c] += w * block[t * 4 + c];
+    }
+  }
+  float determinant = a * d - b * b;
+  if (fabsf(determinant) > 1e-6f) {
+    float refit [2][4];
+    for (int c = 0; c < 4; c++) {
+      refit[0][c] = fminf(fmaxf((d * rhs[0][c] - b * rhs[1][c]) / determinant, 0.0f), 255.0f);
+      refit[1][c] = fminf(fmaxf((a * rhs[1][c] - b * rhs[0][c]) / determinant, 0.0f), 255.0f);
+    }
+    uint32_t rq [2][4], rp [2], rIndices [16];
+    iio_bc7_quantize_endpoint(refit[0], rq[0], &rp[0]);
+    iio_bc7_quantize_endpoint(refit[1], rq[1], &rp[1]);
+    uint32_t refitError = iio_bc7_select_indices(block, rq[0], rp[0], rq[1], rp[1], rIndices);
+    if (refitError < error) {
+      memcpy(q, rq, sizeof(q));
+      memcpy(p, rp, sizeof(p));
+      memcpy(indices, rIndices, sizeof(indices));
+    }
+  }
+
+  //  the first index is stored without its high bit, so it has to be below 8
+  int e0 = 0, e1 = 1;
+  if (indices[0] >= 8) {
+    e0 = 1;
+    e1 = 0;
+    for (int t = 0; t < 16; t++) indices[t] = 15 - indices[t];
+  }
+
+  memset(out, 0, 16);
+  IIOBitWriter writer = {out, 0};
+  iio_write_bits(&writer, 1u << 6, 7); // mode 6
+  for (int c = 0; c < 4; c++) {
+    iio_write_bits(&writer, q[e0][c], 7);
+    iio_write_bits(&writer, q[e1][c], 7);
+  }
+  iio_write_bits(&writer, p[e0], 1);
+  iio_write_bits(&writer, p[e1], 1);
+  iio_write_bits(&writer, indices[0], 3);
+  for (int t = 1; t < 16; t++) iio_write_bits(&writer, indices[t], 4);
+}
+
+bool iio_compress_texture_rgba8(
+  const uint8_t *                           pixels,
+  uint32_t                                  width,
+  uint32_t                                  height,
+  VkFormat                                  format,
+  IIOCompressedTexture *                    texture)
+
+{
+  memset(texture, 0, sizeof(IIOCompressedTexture));
+  bool bc7 = format == VK_FORMAT_BC7_UNORM_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+  if (!bc7 && format != VK_FORMAT_BC5_UNORM_BLOCK && format != VK_FORMAT_BC4_UNORM_BLOCK) return false;
+
+  uint32_t levelCount = iio_mip_level_count(width, height);
+  if (levelCount > IIO_MAX_TEXTURE_LEVELS) levelCount = IIO_MAX_TEXTURE_LEVELS;
+  uint8_t * chain = malloc(iio_mip_chain_size(width, height, levelCount, 4));
+  if (!chain || !iio_init_compressed_texture(texture, format, width, height, levelCount)) {
+    free(chain);
+    iio_free_compressed_texture(texture);
+    return false;
+  }
+  memcpy(chain, pixels, (size_t) width * height * 4);
+  iio_generate_mip_chain_unorm8(chain, width, height, levelCount, 4, iio_compressed_format_srgb(format));
+
+  const uint8_t * src = chain;
+  for (uint32_t level = 0; level < levelCount; level++) {
+    uint32_t levelWidth = iio_mip_extent(width, level);
+    uint32_t levelHeight = iio_mip_extent(height, level);
+    uint8_t * dst = texture->data + texture->levels[level].offset;
+
+    //  partial blocks at the edges repeat the last row and column
+    for (uint32_t by = 0; by < levelHeight; by += 4) {
+      for (uint32_t bx = 0; bx < levelWidth; bx += 4) {
+        uint8_t block [64];
+        for (uint32_t y = 0; y < 4; y++) {
+          uint32_t sy = by + y < levelHeight ? by + y : levelHeight - 1;
+          for (uint32_t x = 0; x < 4; x++) {
+            uint32_t sx = bx + x < levelWidth ? bx + x : levelWidth - 1;
+            memcpy(block + (y * 4 + x) * 4, src + ((size_t) sy * levelWidth + sx) * 4, 4);
+          }
+        }
+        if (bc7)                                    iio_encode_bc7_block(block, dst);
+        else if (format == VK_FORMAT_BC5_UNORM_BLOCK) iio_encode_bc5_block(block, dst);
+        else                                        iio_encode_bc4_block(block, 4, dst);
+        dst += texture->blockSize;
+      }
+    }
+    src += (size_t) levelWidth * levelHeight * 4;
+  }
+
+  free(chain);
+  return true;
+}
@@ -0,0 +1,613 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+#include "iio_upload.h"
+#include "iio_eng_errors.h"
+
+/*****************************
+ *      helper functions     *
+ *****************************/
+
+static VkResult iio_create_host_buffer(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  VkDeviceSize                              size,
+  VkBuffer *                                buffer,
+  IIOAllocation *                           allocation)
+
+{
+  VkBufferCreateInfo bufferCreateInfo = {0};
+  bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCreateInfo.size = size;
+  bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  VkResult result = vkCreateBuffer(device, &bufferCreateInfo, NULL, buffer);
+  if (result != VK_SUCCESS) return result;
+
+  result = iio_allocate_buffer_memory(
+    device, allocator, *buffer,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    allocation
+  );
+  if (result != VK_SUCCESS) {
+    vkDestroyBuffer(device, *buffer, NULL);
+    *buffer = VK_NULL_HANDLE;
+  }
+  return result;
+}
+
+static void iio_staging_retire(IIOUploadContext * context, uint64_t completed) {
+  while (!deque_StagingRetire_is_empty(&context->stagingInFlight)) {
+    const IIOStagingRetirement * oldest = deque_StagingRetire_front(&context->stagingInFlight);
+    if (oldest->ticket > completed) break;
+    context->stagingUsed -= oldest->bytes;
+    deque_StagingRetire_pop_front(&context->stagingInFlight);
+  }
+  //  an idle ring restarts at the front so the next large payload does not have to wrap
+  if (context->stagingUsed == 0) {
+    context->stagingHead = 0;
+  }
+}
+
+/*****************************
+ *   context initialization  *
+ *****************************/
+
+void iio_create_upload_context(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  uint32_t                                  queueFamilyIndex,
+  VkQueue                                   queue,
+  uint32_t                                  dstQueueFamilyIndex,
+  VkQueue                                   dstQueue,
+  VkDeviceSize                              stagingSize,
+  IIOUploadContext *                        context)
+
+{
+  memset(context, 0, sizeof(IIOUploadContext));
+  context->queue = queue;
+  context->queueFamilyIndex = queueFamilyIndex;
+  context->dstQueue = dstQueue;
+  context->dstQueueFamilyIndex = dstQueueFamilyIndex;
+  context->ownershipTransfer = queueFamilyIndex != dstQueueFamilyIndex;
+  context->nextTicket = 1;
+
+  VkCommandPoolCreateInfo poolCreateInfo = {0};
+  poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  poolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+  VkResult result = vkCreateCommandPool(device, &poolCreateInfo, NULL, &context->commandPool);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    return;
+  }
+
+  VkCommandBuffer commandBuffers [IIO_UPLOAD_BATCH_COUNT];
+  VkCommandBufferAllocateInfo allocateInfo = {0};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocateInfo.commandPool = context->commandPool;
+  allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocateInfo.commandBufferCount = IIO_UPLOAD_BATCH_COUNT;
+
+  result = vkAllocateCommandBuffers(device, &allocateInfo, commandBuffers);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    vkDestroyCommandPool(device, context->commandPool, NULL);
+    context->commandPool = VK_NULL_HANDLE;
+    return;
+  }
+  for (uint32_t i = 0; i < IIO_UPLOAD_BATCH_COUNT; i++) {
+    context->batches[i].commandBuffer = commandBuffers[i];
+  }
+
+  VkSemaphoreTypeCreateInfo typeCreateInfo = {0};
+  typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+  typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  typeCreateInfo.initialValue = 0;
+
+  VkSemaphoreCreateInfo semaphoreCreateInfo = {0};
+  semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semaphoreCreateInfo.pNext = &typeCreateInfo;
+
+  result = vkCreateSemaphore(device, &semaphoreCreateInfo, NULL, &context->timeline);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    vkDestroyCommandPool(device, context->commandPool, NULL);
+    context->commandPool = VK_NULL_HANDLE;
+    return;
+  }
+
+  if (context->ownershipTransfer) {
+    poolCreateInfo.queueFamilyIndex = dstQueueFamilyIndex;
+    result = vkCreateCommandPool(device, &poolCreateInfo, NULL, &context->acquireCommandPool);
+    if (result == VK_SUCCESS) {
+      allocateInfo.commandPool = context->acquireCommandPool;
+      result = vkAllocateCommandBuffers(device, &allocateInfo, commandBuffers);
+    }
+    if (result == VK_SUCCESS) {
+      result = vkCreateSemaphore(device, &semaphoreCreateInfo, NULL, &context->transferTimeline);
+    }
+    if (result != VK_SUCCESS) {
+      iio_vk_error(result, __LINE__, __FILE__);
+      if (context->acquireCommandPool) vkDestroyCommandPool(device, context->acquireCommandPool, NULL);
+      vkDestroySemaphore(device, context->timeline, NULL);
+      vkDestroyCommandPool(device, context->commandPool, NULL);
+      memset(context, 0, sizeof(IIOUploadContext));
+      return;
+    }
+    for (uint32_t i = 0; i < IIO_UPLOAD_BATCH_COUNT; i++) {
+      context->batches[i].acquireCommandBuffer = commandBuffers[i];
+    }
+  }
+
+  context->stagingSize = stagingSize ? stagingSize : IIO_DEFAULT_STAGING_RING_SIZE;
+  result = iio_create_host_buffer(device, allocator, context->stagingSize, &context->stagingBuffer, &context->stagingMemory);
+  if (result != VK_SUCCESS || !context->stagingMemory.mapped) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    if (context->stagingBuffer) vkDestroyBuffer(device, context->stagingBuffer, NULL);
+    iio_free_memory(device, allocator, &context->stagingMemory);
+    if (context->ownershipTransfer) {
+      vkDestroySemaphore(device, context->transferTimeline, NULL);
+      vkDestroyCommandPool(device, context->acquireCommandPool, NULL);
+    }
+    vkDestroySemaphore(device, context->timeline, NULL);
+    vkDestroyCommandPool(device, context->commandPool, NULL);
+    memset(context, 0, sizeof(IIOUploadContext));
+    return;
+  }
+
+  context->pendingBufferAcquires = vec_BufferBarrier_init();
+  context->pendingImageAcquires = vec_ImageBarrier_init();
+  context->deferredBuffers = vec_UploadDeferred_init();
+  context->stagingInFlight = deque_StagingRetire_init();
+  context->isInitialized = true;
+}
+
+void iio_destroy_upload_context(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOUploadContext *                        context)
+
+{
+  if (!context->isInitialized) return;
+
+  //  anything still recording is flushed so deferred resources are not destroyed mid-copy
+  iio_upload_wait(device, context, iio_upload_submit(device, context));
+  iio_upload_collect(device, allocator, context);
+
+  if (context->stagingFallbackCount > 0) {
+    fprintf(stdout, "upload context: %u payloads exceeded the %llu byte staging ring\n",
+      context->stagingFallbackCount, (unsigned long long) context->stagingSize);
+  }
+
+  vkDestroyBuffer(device, context->stagingBuffer, NULL);
+  iio_free_memory(device, allocator, &context->stagingMemory);
+  if (context->ownershipTransfer) {
+    vkDestroySemaphore(device, context->transferTimeline, NULL);
+    vkDestroyCommandPool(device, context->acquireCommandPool, NULL);
+  }
+  vkDestroySemaphore(device, context->timeline, NULL);
+  vkDestroyCommandPool(device, context->commandPool, NULL);
+  vec_BufferBarrier_drop(&context->pendingBufferAcquires);
+  vec_ImageBarrier_drop(&context->pendingImageAcquires);
+  vec_UploadDeferred_drop(&context->deferredBuffers);
+  deque_StagingRetire_drop(&context->stagingInFlight);
+  memset(context, 0, sizeof(IIOUploadContext));
+}
+
+/*****************************
+ *     batch recording       *
+ *****************************/
+
+VkCommandBuffer iio_upload_begin(
+  VkDevice                                  device,
+  IIOUploadContext *                        context)
+
+{
+  IIOUploadBatch * batch = &context->batches[context->currentBatch];
+  if (batch->recording) {
+    context->recordedCommands++;
+    return batch->commandBuffer;
+  }
+
+  //  the ring wrapped around onto a buffer that may still be executing
+  iio_upload_wait(device, context, batch->ticket);
+  vkResetCommandBuffer(batch->commandBuffer, 0);
+
+  VkCommandBufferBeginInfo beginInfo = {0};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  VkResult result = vkBeginCommandBuffer(batch->commandBuffer, &beginInfo);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+  batch->recording = true;
+  context->recordedCommands = 1;
+  return batch->commandBuffer;
+}
+
+IIOUploadTicket iio_upload_current_ticket(
+  const IIOUploadContext *                  context)
+
+{
+  return context->nextTicket;
+}
+
+void iio_upload_defer_buffer_destroy(
+  IIOUploadContext *                        context,
+  VkBuffer                                  buffer,
+  IIOAllocation *                           allocation)
+
+{
+  IIOUploadDeferredBuffer deferred = {
+    .ticket = context->nextTicket,
+    .buffer = buffer,
+    .allocation = *allocation,
+  };
+  vec_UploadDeferred_push(&context->deferredBuffers, deferred);
+  memset(allocation, 0, sizeof(IIOAllocation));
+}
+
+void iio_upload_stage(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOUploadContext *                        context,
+  const void *                              data,
+  VkDeviceSize                              size,
+  VkDeviceSize                              alignment,
+  IIOStagingRegion *                        region)
+
+{
+  if (size > context->stagingSize / 2) {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    IIOAllocation allocation = {0};
+    VkResult result = iio_create_host_buffer(device, allocator, size, &buffer, &allocation);
+    if (result != VK_SUCCESS || !allocation.mapped) {
+      iio_vk_error(result, __LINE__, __FILE__);
+      exit(1);
+    }
+    region->buffer = buffer;
+    region->offset = 0;
+    region->size = size;
+    region->mapped = allocation.mapped;
+    if (data) memcpy(region->mapped, data, size);
+    iio_upload_defer_buffer_destroy(context, buffer, &allocation);
+    context->stagingFallbackCount++;
+    return;
+  }
+
+  VkDeviceSize offset;
+  VkDeviceSize needed;
+  for (;;) {
+    offset = iio_align_up(context->stagingHead, alignment);
+    if (offset + size > context->stagingSize) {
+      //  skip the tail of the ring, the padding retires with this batch
+      needed = context->stagingSize - context->stagingHead + size;
+      offset = 0;
+    } else {
+      needed = offset - context->stagingHead + size;
+    }
+    if (context->stagingUsed + needed <= context->stagingSize) break;
+
+    //  the ring is full, wait for the oldest batch still holding staging memory
+    IIOUploadTicket oldest = deque_StagingRetire_front(&context->stagingInFlight)->ticket;
+    if (oldest >= context->nextTicket) {
+      iio_upload_submit(device, context);
+    }
+    iio_upload_wait(device, context, oldest);
+    iio_staging_retire(context, oldest);
+  }
+
+  context->stagingHead = offset + size;
+  context->stagingUsed += needed;
+  IIOStagingRetirement * newest = deque_StagingRetire_is_empty(&context->stagingInFlight) ?
+    NULL : deque_StagingRetire_back_mut(&context->stagingInFlight);
+  if (newest && newest->ticket == context->nextTicket) {
+    newest->bytes += needed;
+  } else {
+    deque_StagingRetire_push_back(&context->stagingInFlight, (IIOStagingRetirement) {context->nextTicket, needed});
+  }
+
+  region->buffer = context->stagingBuffer;
+  region->offset = offset;
+  region->size = size;
+  region->mapped = (uint8_t *) context->stagingMemory.mapped + offset;
+  if (data) memcpy(region->mapped, data, size);
+}
+
+void iio_upload_release_buffer(
+  VkDevice                                  device,
+  IIOUploadContext *                        context,
+  VkBuffer                                  buffer,
+  VkAccessFlags                             dstAccessMask,
+  VkPipelineStageFlags                      dstStageMask)
+
+{
+  //  on a shared queue the barrier recorded at submit already covers buffers
+  if (!context->ownershipTransfer) return;
+
+  VkBufferMemoryBarrier barrier = {0};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.srcQueueFamilyIndex = context->queueFamilyIndex;
+  barrier.dstQueueFamilyIndex = context->dstQueueFamilyIndex;
+  barrier.buffer = buffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+
+  VkCommandBuffer commandBuffer = iio_upload_begin(device, context);
+  vkCmdPipelineBarrier(
+    commandBuffer,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+    0,
+    0, NULL,
+    1, &barrier,
+    0, NULL
+  );
+
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = dstAccessMask;
+  vec_BufferBarrier_push(&context->pendingBufferAcquires, barrier);
+  context->pendingAcquireStages |= dstStageMask;
+}
+
+void iio_upload_release_image(
+  VkDevice                                  device,
+  IIOUploadContext *                        context,
+  VkImage                                   image,
+  VkImageSubresourceRange                   subresourceRange,
+  VkImageLayout                             newLayout,
+  VkAccessFlags                             dstAccessMask,
+  VkPipelineStageFlags                      dstStageMask)
+
+{
+  VkImageMemoryBarrier barrier = {0};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = dstAccessMask;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = newLayout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange = subresourceRange;
+
+  VkCommandBuffer commandBuffer = iio_upload_begin(device, context);
+  if (!context->ownershipTransfer) {
+    vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      dstStageMask,
+      0,
+      0, NULL,
+      0, NULL,
+      1, &barrier
+    );
+    return;
+  }
+
+  //  the layout transition is part of the ownership transfer and must match on both halves
+  barrier.dstAccessMask = 0;
+  barrier.srcQueueFamilyIndex = context->queueFamilyIndex;
+  barrier.dstQueueFamilyIndex = context->dstQueueFamilyIndex;
+  vkCmdPipelineBarrier(
+    commandBuffer,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+    0,
+    0, NULL,
+    0, NULL,
+    1, &barrier
+  );
+
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = dstAccessMask;
+  vec_ImageBarrier_push(&context->pendingImageAcquires, barrier);
+  context->pendingAcquireStages |= dstStageMask;
+}
+
+static void iio_upload_submit_acquire(
+  IIOUploadContext *                        context,
+  IIOUploadBatch *                          batch,
+  IIOUploadTicket                           ticket)
+
+{
+  isize bufferCount = vec_BufferBarrier_size(&context->pendingBufferAcquires);
+  isize imageCount = vec_ImageBarrier_size(&context->pendingImageAcquires);
+  bool hasBarriers = bufferCount > 0 || imageCount > 0;
+
+  if (hasBarriers) {
+    VkCommandBufferBeginInfo beginInfo = {0};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkResetCommandBuffer(batch->acquireCommandBuffer, 0);
+    vkBeginCommandBuffer(batch->acquireCommandBuffer, &beginInfo);
+    vkCmdPipelineBarrier(
+      batch->acquireCommandBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      context->pendingAcquireStages,
+      0,
+      0, NULL,
+      (uint32_t) bufferCount, context->pendingBufferAcquires.data,
+      (uint32_t) imageCount, context->pendingImageAcquires.data
+    );
+    VkResult result = vkEndCommandBuffer(batch->acquireCommandBuffer);
+    if (result != VK_SUCCESS) {
+      iio_vk_error(result, __LINE__, __FILE__);
+      exit(1);
+    }
+  }
+
+  //  the acquire signals the public ticket, so ticket completion means the consumer queue owns everything
+  VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  VkTimelineSemaphoreSubmitInfo timelineInfo = {0};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.waitSemaphoreValueCount = 1;
+  timelineInfo.pWaitSemaphoreValues = &ticket;
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &ticket;
+
+  VkSubmitInfo submitInfo = {0};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.pNext = &timelineInfo;
+  submitInfo.waitSemaphoreCount = 1;
+  submitInfo.pWaitSemaphores = &context->transferTimeline;
+  submitInfo.pWaitDstStageMask = &waitStage;
+  submitInfo.commandBufferCount = hasBarriers ? 1 : 0;
+  submitInfo.pCommandBuffers = &batch->acquireCommandBuffer;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &context->timeline;
+
+  VkResult result = vkQueueSubmit(context->dstQueue, 1, &submitInfo, VK_NULL_HANDLE);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+
+  vec_BufferBarrier_clear(&context->pendingBufferAcquires);
+  vec_ImageBarrier_clear(&context->pendingImageAcquires);
+  context->pendingAcquireStages = 0;
+}
+
+IIOUploadTicket iio_upload_submit(
+  VkDevice                                  device,
+  IIOUploadContext *                        context)
+
+{
+  IIOUploadBatch * batch = &context->batches[context->currentBatch];
+  if (!batch->recording) {
+    return context->nextTicket - 1;
+  }
+
+  //  one global barrier makes every copy in the batch visible to whatever reads it next.
+  //  a transfer-only queue cannot name graphics stages, there the ownership barriers do this job
+  if (!context->ownershipTransfer) {
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                            VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(
+      batch->commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      0,
+      1, &barrier,
+      0, NULL,
+      0, NULL
+    );
+  }
+
+  VkResult result = vkEndCommandBuffer(batch->commandBuffer);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+
+  IIOUploadTicket ticket = context->nextTicket;
+  VkTimelineSemaphoreSubmitInfo timelineInfo = {0};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &ticket;
+
+  VkSubmitInfo submitInfo = {0};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.pNext = &timelineInfo;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &batch->commandBuffer;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = context->ownershipTransfer ? &context->transferTimeline : &context->timeline;
+
+  result = vkQueueSubmit(context->queue, 1, &submitInfo, VK_NULL_HANDLE);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+
+  if (context->ownershipTransfer) {
+    iio_upload_submit_acquire(context, batch, ticket);
+  }
+
+  batch->ticket = ticket;
+  batch->recording = false;
+  context->recordedCommands = 0;
+  context->nextTicket++;
+  context->currentBatch = (context->currentBatch + 1) % IIO_UPLOAD_BATCH_COUNT;
+  return ticket;
+}
+
+/*****************************
+ *     ticket completion     *
+ *****************************/
+
+bool iio_upload_poll(
+  VkDevice                                  device,
+  const IIOUploadContext *                  context,
+  IIOUploadTicket                           ticket)
+
+{
+  if (ticket == 0) return true;
+  uint64_t value = 0;
+  VkResult result = vkGetSemaphoreCounterValue(device, context->timeline, &value);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    return false;
+  }
+  return value >= ticket;
+}
+
+void iio_upload_wait(
+  VkDevice                                  device,
+  const IIOUploadContext *                  context,
+  IIOUploadTicket                           ticket)
+
+{
+  if (ticket == 0) return;
+  if (ticket >= context->nextTicket) {
+    fprintf(stderr, "iio_upload_wait: ticket %llu has not been submitted\n", (unsigned long long) ticket);
+    return;
+  }
+
+  VkSemaphoreWaitInfo waitInfo = {0};
+  waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+  waitInfo.semaphoreCount = 1;
+  waitInfo.pSemaphores = &context->timeline;
+  waitInfo.pValues = &ticket;
+
+  VkResult result = vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+  }
+}
+
+void iio_upload_collect(
+  VkDevice                                  device,
+  IIOMemoryAllocator *                      allocator,
+  IIOUploadContext *                        context)
+
+{
+  uint64_t completed = 0;
+  VkResult result = vkGetSemaphoreCounterValue(device, context->timeline, &completed);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    return;
+  }
+
+  iio_staging_retire(context, completed);
+
+  isize count = vec_UploadDeferred_size(&context->deferredBuffers);
+  for (isize i = count - 1; i >= 0; i--) {
+    IIOUploadDeferredBuffer * deferred = vec_UploadDeferred_at_mut(&context->deferredBuffers, i);
+    if (deferred->ticket > completed) continue;
+    vkDestroyBuffer(device, deferred->buffer, NULL);
+    iio_free_memory(device, allocator, &deferred->allocation);
+    vec_UploadDeferred_erase_n(&context->deferredBuffers, i, 1);
+  }
+}
@@ -21,6 +21,8 @@
 #include "iio_eng_errors.h"
 #include "iio_resource_loaders.h"
 #include "iio_pipeline.h"
+#include "iio_mipmap.h"
+#include "iio_bindless.h"
 
 
 
@@ -57,6 +59,7 @@ const char * validationLayers [] = {
 };
 
 const bool enableValidationLayers = true;
+const bool printMemoryStatsOnShutdown = false; // dumps the allocator's leftover blocks, for tracking leaks
 
 // int MAX_FRAMES_IN_FLIGHT = 2;
 
@@ -98,6 +101,18 @@ const char * testTextureFilename = "269670.png";
 const bool doTestTriangle = false;
 const bool doTestCube = !doTestTriangle;
 
+//  the application path draws through the bindless table when the device supports descriptor indexing,
+//  otherwise every material binds a descriptor set of its own
+const bool preferBindless = true;
+
+//  and culls and issues its draws on the GPU when the device can also draw indirect with a count
+const bool preferGpuDriven = true;
+
+//  loaded models are uploaded quantized, see IIO_PACKED_VERTEX_SIZE
+const bool preferPackedVertices = true;
+
+const char * applicationModelFilename = "Buggy.gltf";
+
 /****************************************************************************************************
  *                           Functions for initializing the Vulkan API                              *
  ****************************************************************************************************/
@@ -118,6 +133,9 @@ void iio_init_vulkan() {
   //  requires physical device
   iio_create_device();
   //  requires logical device
+  iio_create_memory_allocator_api();
+  iio_create_upload_context_api();
+  iio_create_frame_data_ring_api();
   iio_create_swapchain();
   iio_create_swapchain_image_views();
   iio_create_command_pool();
@@ -136,6 +154,8 @@ void iio_init_vulkan() {
   } else {
     iio_create_application_descriptor_pool_managers();
     iio_create_application_graphics_pipeline();
+    iio_initialize_camera();
+    iio_initialize_application_scene();
   }
 }
 
@@ -169,7 +189,7 @@ void iio_create_instance() {
 
   VkApplicationInfo appInfo = {0};
   appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-  appInfo.apiVersion = VK_MAKE_API_VERSION(0, 1, 3, 0);
+  appInfo.apiVersion = IIO_VULKAN_API_VERSION;
   appInfo.applicationVersion = VK_MAKE_API_VERSION(0, 0, 0, 1);
   appInfo.pEngineName = "IIO";
   appInfo.engineVersion = VK_MAKE_API_VERSION(0, 0, 0, 1);
@@ -257,6 +277,7 @@ void iio_select_physical_device() {
   VkPhysicalDeviceType preferredDeviceType = 0;
   uint32_t presentQueueIndexPerDevice [deviceCount];
   uint32_t graphicsQueueIndexPerDevice [deviceCount];
+  uint32_t transferQueueIndexPerDevice [deviceCount];
   VkSurfaceFormatKHR preferredSurfaceFormatPerDevice [deviceCount];
   VkPresentModeKHR preferredPresentModePerDevice [deviceCount];
   VkSurfaceCapabilitiesKHR surfaceCapabilitiesPerDevice [deviceCount];
@@ -271,6 +292,7 @@ void iio_select_physical_device() {
       &surfaceCapabilitiesPerDevice[i],
       &graphicsQueueIndexPerDevice[i],
       &presentQueueIndexPerDevice[i],
+      &transferQueueIndexPerDevice[i],
       &deviceTypePerDevice[i]
     );
 
@@ -304,19 +326,40 @@ void iio_select_physical_device() {
   state.surfaceCapabilities = surfaceCapabilitiesPerDevice[preferredDevice];
   state.graphicsQueueFamilyIndex = graphicsQueueIndexPerDevice[preferredDevice];
   state.presentQueueFamilyIndex = presentQueueIndexPerDevice[preferredDevice];
+  state.transferQueueFamilyIndex = transferQueueIndexPerDevice[preferredDevice];
+  if (state.transferQueueFamilyIndex != state.graphicsQueueFamilyIndex) {
+    fprintf(stdout, "Using dedicated transfer queue family %u.\n", state.transferQueueFamilyIndex);
+  }
   state.selectedDevice = state.physicalDevices[preferredDevice];
 }
 
+static bool iio_device_extension_supported(
+  VkPhysicalDevice                          physicalDevice,
+  const char *                              name)
+
+{
+  uint32_t extensionCount = 0;
+  vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &extensionCount, NULL);
+  if (extensionCount == 0) return false;
+  VkExtensionProperties extensions [extensionCount];
+  vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &extensionCount, extensions);
+  for (uint32_t i = 0; i < extensionCount; i++) {
+    if (strcmp(extensions[i].extensionName, name) == 0) return true;
+  }
+  return false;
+}
+
 void iio_create_device() {
   fprintf(stdout, "Creating logical device.\n");
-  uint32_t queueCreateFamilyCount = 2;
-  uint32_t queueFamilyIndices [queueCreateFamilyCount];
+  uint32_t queueCreateFamilyCount = 1;
+  uint32_t queueFamilyIndices [3];
   queueFamilyIndices[0] = state.graphicsQueueFamilyIndex;
-  if (state.graphicsQueueFamilyIndex == state.presentQueueFamilyIndex) {
-    queueCreateFamilyCount = 1;
+  if (state.presentQueueFamilyIndex != state.graphicsQueueFamilyIndex) {
+    queueFamilyIndices[queueCreateFamilyCount++] = state.presentQueueFamilyIndex;
   }
-  if (queueCreateFamilyCount == 2) {
-    queueFamilyIndices[1] = state.presentQueueFamilyIndex;
+  if (state.transferQueueFamilyIndex != state.graphicsQueueFamilyIndex &&
+      state.transferQueueFamilyIndex != state.presentQueueFamilyIndex) {
+    queueFamilyIndices[queueCreateFamilyCount++] = state.transferQueueFamilyIndex;
   }
   uint32_t queueCreateInfoCount = queueCreateFamilyCount;
 
@@ -337,8 +380,57 @@ void iio_create_device() {
   deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
   deviceCreateInfo.queueCreateInfoCount = queueCreateInfoCount;
   deviceCreateInfo.pQueueCreateInfos = queueCreateInfos;
-  deviceCreateInfo.enabledExtensionCount = 1;
-  deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions;
+  const char * enabledExtensions [2] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  uint32_t enabledExtensionCount = 1;
+
+  //  optional 8-bit indices, core in 1.4 and an extension before that. core features are limited by the
+  //  version the instance asked for as much as by the device
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(state.selectedDevice, &deviceProperties);
+  bool core14 = min(IIO_VULKAN_API_VERSION, deviceProperties.apiVersion) >= VK_API_VERSION_1_4;
+  const char * indexTypeUint8Extension = NULL;
+  if (!core14) {
+    if      (iio_device_extension_supported(state.selectedDevice, VK_KHR_INDEX_TYPE_UINT8_EXTENSION_NAME)) indexTypeUint8Extension = VK_KHR_INDEX_TYPE_UINT8_EXTENSION_NAME;
+    else if (iio_device_extension_supported(state.selectedDevice, VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME)) indexTypeUint8Extension = VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME;
+  }
+  VkPhysicalDeviceIndexTypeUint8FeaturesEXT indexTypeUint8Features = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INDEX_TYPE_UINT8_FEATURES_EXT,
+  };
+  VkPhysicalDeviceVulkan14Features supported14 = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES,
+  };
+  VkPhysicalDeviceVulkan12Features supported12 = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+    .pNext = core14 ? (void *) &supported14 : (indexTypeUint8Extension ? (void *) &indexTypeUint8Features : NULL),
+  };
+  VkPhysicalDeviceFeatures2 supportedFeatures = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+    .pNext = &supported12,
+  };
+  vkGetPhysicalDeviceFeatures2(state.selectedDevice, &supportedFeatures);
+  //  descriptor indexing, core in 1.2, backs the bindless material table
+  state.bindlessSupported =
+    supported12.runtimeDescriptorArray &&
+    supported12.descriptorBindingPartiallyBound &&
+    supported12.descriptorBindingSampledImageUpdateAfterBind &&
+    supported12.descriptorBindingUpdateUnusedWhilePending;
+  //  compacted draws are issued with a GPU written count and select their instance through firstInstance
+  state.gpuDrivenSupported =
+    state.bindlessSupported &&
+    supported12.drawIndirectCount &&
+    supportedFeatures.features.multiDrawIndirect &&
+    supportedFeatures.features.drawIndirectFirstInstance;
+  deviceFeatures.multiDrawIndirect = state.gpuDrivenSupported;
+  deviceFeatures.drawIndirectFirstInstance = state.gpuDrivenSupported;
+  state.indexTypeUint8Supported = core14 ? supported14.indexTypeUint8 : (indexTypeUint8Extension && indexTypeUint8Features.indexTypeUint8);
+  state.textureCompressionBCSupported = supportedFeatures.features.textureCompressionBC;
+  deviceFeatures.textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+  if (!core14 && state.indexTypeUint8Supported) {
+    enabledExtensions[enabledExtensionCount++] = indexTypeUint8Extension;
+  }
+
+  deviceCreateInfo.enabledExtensionCount = enabledExtensionCount;
+  deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions;
   deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 
   VkPhysicalDeviceVulkan11Features vk11features = {
@@ -348,6 +440,12 @@ void iio_create_device() {
   VkPhysicalDeviceVulkan12Features vk12features = {
     .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
     .pNext = &vk11features,
+    .timelineSemaphore = VK_TRUE,
+    .runtimeDescriptorArray = state.bindlessSupported,
+    .descriptorBindingPartiallyBound = state.bindlessSupported,
+    .descriptorBindingSampledImageUpdateAfterBind = state.bindlessSupported,
+    .descriptorBindingUpdateUnusedWhilePending = state.bindlessSupported,
+    .drawIndirectCount = state.gpuDrivenSupported,
   };
 
   VkPhysicalDeviceVulkan13Features vk13features = {
@@ -359,9 +457,18 @@ void iio_create_device() {
   VkPhysicalDeviceVulkan14Features vk14features = {
     .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES,
     .pNext = &vk13features,
+    .indexTypeUint8 = state.indexTypeUint8Supported,
   };
 
-  deviceCreateInfo.pNext = &vk14features;
+  //  the 1.4 struct and the extension struct must not be chained together, and below 1.4 only the latter exists
+  if (core14) {
+    deviceCreateInfo.pNext = &vk14features;
+  } else if (state.indexTypeUint8Supported) {
+    indexTypeUint8Features.pNext = &vk13features;
+    deviceCreateInfo.pNext = &indexTypeUint8Features;
+  } else {
+    deviceCreateInfo.pNext = &vk13features;
+  }
 
   VkResult result = vkCreateDevice(state.selectedDevice, &deviceCreateInfo, NULL, &state.device);
   if (result != VK_SUCCESS) {
@@ -370,11 +477,58 @@ void iio_create_device() {
   }
   vkGetDeviceQueue(state.device, state.graphicsQueueFamilyIndex, 0, &state.graphicsQueue);
   vkGetDeviceQueue(state.device, state.presentQueueFamilyIndex, 0, &state.presentQueue);
+  vkGetDeviceQueue(state.device, state.transferQueueFamilyIndex, 0, &state.transferQueue);
   uint32_t instanceVersion;
   vkEnumerateInstanceVersion(&instanceVersion);
   fprintf(stdout, "Vulkan version is %u.%u.%u\n", VK_VERSION_MAJOR(instanceVersion), VK_VERSION_MINOR(instanceVersion), VK_VERSION_PATCH(instanceVersion));
 }
 
+void iio_create_memory_allocator_api() {
+  fprintf(stdout, "Creating memory allocator.\n");
+  iio_create_memory_allocator(state.selectedDevice, IIO_DEFAULT_MEMORY_BLOCK_SIZE, &state.memoryAllocator);
+  if (!state.memoryAllocator.isInitialized) {
+    fprintf(stderr, "Failed to create memory allocator\n");
+    exit(1);
+  }
+}
+
+void iio_create_upload_context_api() {
+  fprintf(stdout, "Creating upload context.\n");
+  iio_create_upload_context(
+    state.device,
+    &state.memoryAllocator,
+    state.transferQueueFamilyIndex,
+    state.transferQueue,
+    state.graphicsQueueFamilyIndex,
+    state.graphicsQueue,
+    IIO_DEFAULT_STAGING_RING_SIZE,
+    &state.uploadContext
+  );
+  if (!state.uploadContext.isInitialized) {
+    fprintf(stderr, "Failed to create upload context\n");
+    exit(1);
+  }
+}
+
+void iio_create_frame_data_ring_api() {
+  fprintf(stdout, "Creating frame data ring.\n");
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(state.selectedDevice, &properties);
+  iio_create_frame_data_ring(
+    state.device,
+    &state.memoryAllocator,
+    max(properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment),
+    IIO_DEFAULT_FRAME_DATA_SIZE,
+    min(65536, properties.limits.maxUniformBufferRange),
+    MAX_FRAMES_IN_FLIGHT,
+    &state.frameDataRing
+  );
+  if (!state.frameDataRing.isInitialized) {
+    fprintf(stderr, "Failed to create frame data ring\n");
+    exit(1);
+  }
+}
+
 void iio_create_swapchain() {
   // fprintf(stdout, "Creating swapchain.\n");
   VkResult result;
@@ -467,14 +621,17 @@ void iio_create_swapchain_image_views() {
       state.swapChainImages[i],
       &state.swapChainImageViews[i],
       state.surfaceFormat.format,
-      VK_IMAGE_ASPECT_COLOR_BIT
+      VK_IMAGE_ASPECT_COLOR_BIT,
+      1
     );
   }
 }
 
 void iio_create_application_descriptor_pool_managers() {
   fprintf(stdout, "creating descriptor pool managers for application\n");
-  int descriptorPoolSetCount = 3;
+  //  materials live in the bindless table or in sets of their own, the model matrices arrive as instance data
+  state.useBindless = preferBindless && state.bindlessSupported;
+  int descriptorPoolSetCount = state.useBindless ? 1 : 2;
   state.descriptorPoolManagerCount = descriptorPoolSetCount;
   state.descriptorPoolMangers = malloc(sizeof(IIODescriptorPoolManager) * descriptorPoolSetCount);
 
@@ -487,28 +644,95 @@ void iio_create_application_descriptor_pool_managers() {
     &state.descriptorPoolMangers[0]
   );
 
+  //  the camera set is rewritten every frame, so it comes from the frame allocator
+  iio_create_frame_descriptor_allocator(&state.descriptorPoolMangers[0], MAX_FRAMES_IN_FLIGHT, 4, &state.frameDescriptorAllocator);
+  iio_create_descriptor_template_writer(&state.descriptorPoolMangers[0], &state.cameraTemplateWriter);
+
+  if (state.useBindless) {
+    iio_create_application_bindless_table();
+    state.useGpuDriven = preferGpuDriven && state.gpuDrivenSupported;
+    if (state.useGpuDriven) iio_create_application_gpu_culling();
+    return;
+  }
+
+  //  base color, metallic roughness, normal, occlusion and emissive textures, then the material factors
   iio_create_descriptor_pool_manager(
     state.device,
-    2, (IIODescriptorLayoutElement []) {
-      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 5, VK_SHADER_STAGE_VERTEX_BIT},
-      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT}
+    IIO_MATERIAL_TEXTURE_COUNT + 1, (IIODescriptorLayoutElement []) {
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT},
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT},
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT},
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT},
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT},
+      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT}
     },
-    MAX_FRAMES_IN_FLIGHT, 2,
+    MAX_FRAMES_IN_FLIGHT, 16,
     &state.descriptorPoolMangers[1]
   );
 
-  iio_create_descriptor_pool_manager(
-    state.device,
-    1, (IIODescriptorLayoutElement []) {
-      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT}
-    },
-    MAX_FRAMES_IN_FLIGHT, 2,
-    &state.descriptorPoolMangers[2]
+  //  material sets are written once at load, materials with the same contents share one from the cache
+  iio_create_descriptor_set_writer(&state.descriptorSetWriter);
+  iio_create_descriptor_cache(&state.descriptorCache);
+}
+
+void iio_create_application_bindless_table() {
+  fprintf(stdout, "creating bindless material table\n");
+  VkPhysicalDeviceVulkan12Properties properties12 = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES,
+  };
+  VkPhysicalDeviceProperties2 properties = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+    .pNext = &properties12,
+  };
+  vkGetPhysicalDeviceProperties2(state.selectedDevice, &properties);
+
+  //  the whole arrays count against the per stage limits even when partially bound
+  uint32_t textureCapacity = min(IIO_BINDLESS_DEFAULT_TEXTURE_CAPACITY, min(
+    properties12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+    properties12.maxDescriptorSetUpdateAfterBindSampledImages
+  ));
+  uint32_t samplerCapacity = min(IIO_BINDLESS_DEFAULT_SAMPLER_CAPACITY, min(
+    properties12.maxPerStageDescriptorUpdateAfterBindSamplers,
+    properties12.maxDescriptorSetUpdateAfterBindSamplers
+  ));
+  uint32_t materialCapacity = min(
+    IIO_BINDLESS_DEFAULT_MATERIAL_CAPACITY,
+    properties.properties.limits.maxStorageBufferRange / sizeof(MaterialUniformBufferData)
   );
 
-  // TODO remove this when the camera api is fully implemented
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    state.cameraDescriptorSets[i] = iio_allocate_descriptor_set(state.device, &state.descriptorPoolMangers[0]);
+  iio_create_bindless_table(
+    state.device, &state.memoryAllocator,
+    textureCapacity, samplerCapacity, materialCapacity, MAX_FRAMES_IN_FLIGHT,
+    &state.bindlessTable
+  );
+  if (!state.bindlessTable.isInitialized) {
+    fprintf(stderr, "Failed to create the bindless material table\n");
+    exit(1);
+  }
+}
+
+void iio_create_application_gpu_culling() {
+  fprintf(stdout, "creating gpu culling\n");
+  DataBuffer * cullShaderCode = iio_read_shader_file_to_buffer("src/shaders/gpucull.spv");
+  if (!cullShaderCode) {
+    fprintf(stderr, "Failed to read culling shader file\n");
+    exit(1);
+  }
+  VkShaderModule cullShaderModule = iio_create_shader_module(cullShaderCode);
+  free(cullShaderCode);
+  if (cullShaderModule == VK_NULL_HANDLE) {
+    fprintf(stderr, "Failed to create culling shader module\n");
+    exit(1);
+  }
+  iio_create_gpu_culling(
+    state.device, &state.memoryAllocator, cullShaderModule,
+    IIO_GPU_CULLING_DEFAULT_CAPACITY, 1, MAX_FRAMES_IN_FLIGHT,
+    &state.gpuCulling
+  );
+  vkDestroyShaderModule(state.device, cullShaderModule, NULL);
+  if (!state.gpuCulling.isInitialized) {
+    fprintf(stderr, "Failed to create gpu culling\n");
+    exit(1);
   }
 }
 
@@ -538,10 +762,11 @@ void iio_create_descriptor_pool_managers_testcube() {
   );
 
   fprintf(stdout, "creating descriptor pool 3\n");
+  //  per object model matrices, selected with a dynamic offset into the frame data ring
   iio_create_descriptor_pool_manager(
     state.device,
     1, (IIODescriptorLayoutElement []) {
-      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT}
+      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT}
     },
     MAX_FRAMES_IN_FLIGHT, 2,
     &state.descriptorPoolMangers[2]
@@ -551,23 +776,28 @@ void iio_create_descriptor_pool_managers_testcube() {
 
   fprintf(stdout, "creating descriptor set writer\n");
   iio_create_descriptor_set_writer(&state.descriptorSetWriter);
+  iio_create_descriptor_cache(&state.descriptorCache);
 
+  //  the texture sets are identical across frames and come from the descriptor cache
   fprintf(stdout, "allocating descriptor sets\n");
   for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     state.cameraDescriptorSets[i] = iio_allocate_descriptor_set(state.device, &state.descriptorPoolMangers[0]);
-    testCube.texSamplerDescriptorSets[i] = iio_allocate_descriptor_set(state.device, &state.descriptorPoolMangers[1]);
-    testCube.modelUniformBufferDescriptorSets[i] = iio_allocate_descriptor_set(state.device, &state.descriptorPoolMangers[2]);
   }
+  testCube.modelDescriptorSet = iio_allocate_descriptor_set(state.device, &state.descriptorPoolMangers[2]);
 }
 
 void iio_create_application_graphics_pipeline() {
   fprintf(stdout, "Creating shader pipeline for test cube\n");
-  DataBuffer * vertShaderCode = iio_read_shader_file_to_buffer("src/shaders/vertex.spv");
+  DataBuffer * vertShaderCode = iio_read_shader_file_to_buffer(
+    state.useGpuDriven ? "src/shaders/gpudrivenvertex.spv" :
+    state.useBindless ? "src/shaders/bindlessvertex.spv" :
+    "src/shaders/materialvertex.spv"
+  );
   if (!vertShaderCode) {
     fprintf(stderr, "Failed to read vertex shader file\n");
     exit(1);
   }
-  DataBuffer * fragShaderCode = iio_read_shader_file_to_buffer("src/shaders/fragment.spv");
+  DataBuffer * fragShaderCode = iio_read_shader_file_to_buffer(state.useBindless ? "src/shaders/bindlessfragment.spv" : "src/shaders/materialfragment.spv");
   if (!fragShaderCode) {
     fprintf(stderr, "Failed to read fragment shader file\n");
     free(vertShaderCode);
@@ -603,13 +833,23 @@ void iio_create_application_graphics_pipeline() {
     &pipelineState
   );
   
+  //  loaded models use the selected vertex layout, the draw list adds a model matrix per instance
+  int attributeCount = 0, instanceAttributeCount = 0;
+  VkVertexInputBindingDescription bindingDescriptions [2] = {
+    iio_get_iiovertex_binding_description(),
+    iio_get_instance_binding_description(),
+  };
+  VkVertexInputAttributeDescription attributeDescriptions [IIOVERTEX_ATTRIBUTE_COUNT + IIO_INSTANCE_ATTRIBUTE_COUNT];
+  memcpy(attributeDescriptions, iio_get_iiovertex_attribute_descriptions(&attributeCount), sizeof(VkVertexInputAttributeDescription) * IIOVERTEX_ATTRIBUTE_COUNT);
+  if (!state.useGpuDriven) {
+    memcpy(
+      attributeDescriptions + attributeCount, iio_get_instance_attribute_descriptions(&instanceAttributeCount),
+      sizeof(VkVertexInputAttributeDescription) * IIO_INSTANCE_ATTRIBUTE_COUNT
+    );
+  }
   iio_set_vertex_input_state_create_info(
-    1, &(VkVertexInputBindingDescription) {.binding = 0, .stride = sizeof(Vertex), .inputRate = VK_VERTEX_INPUT_RATE_VERTEX},
-    3, (VkVertexInputAttributeDescription [3]) {
-      {.binding = 0, .location = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(Vertex, position)},
-      {.binding = 0, .location = 1, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(Vertex, color)},
-      {.binding = 0, .location = 2, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(Vertex, texCoord)}
-    },
+    instanceAttributeCount ? 2 : 1, bindingDescriptions,
+    attributeCount + instanceAttributeCount, attributeDescriptions,
     &pipelineState
   );
 
@@ -642,17 +882,36 @@ void iio_create_application_graphics_pipeline() {
 
   
 
-  uint32_t setLayoutCount = state.descriptorPoolManagerCount;
-  VkDescriptorSetLayout setLayouts [setLayoutCount];
-  for (uint32_t i = 0; i < setLayoutCount; i++) {
-    setLayouts[i] = state.descriptorPoolMangers[i].descriptorSetLayout;
+  if (state.useBindless) {
+    //  set 0 camera, set 1 bindless table, the material index is pushed per draw
+    VkPushConstantRange pushConstantRange = {
+      .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+      .offset = 0,
+      .size = sizeof(IIOBindlessDrawConstants),
+    };
+    //  gpu driven draws read their model matrix and material index from the instances at set 2 instead
+    iio_create_graphics_pipeline_layout(
+      state.device,
+      state.useGpuDriven ? 3 : 2, (VkDescriptorSetLayout [3]) {
+        state.descriptorPoolMangers[0].descriptorSetLayout,
+        state.bindlessTable.poolManager.descriptorSetLayout,
+        state.gpuCulling.poolManager.descriptorSetLayout
+      },
+      1, &pushConstantRange,
+      &state.graphicsPipelineManger
+    );
+  } else {
+    //  set 0 camera, set IIO_DRAW_MATERIAL_SET the set of the material being drawn
+    iio_create_graphics_pipeline_layout(
+      state.device,
+      2, (VkDescriptorSetLayout [2]) {
+        state.descriptorPoolMangers[0].descriptorSetLayout,
+        state.descriptorPoolMangers[1].descriptorSetLayout
+      },
+      0, NULL,
+      &state.graphicsPipelineManger
+    );
   }
-  iio_create_graphics_pipeline_layout(
-    state.device, 
-    state.descriptorPoolManagerCount, setLayouts,
-    0, NULL,
-    &state.graphicsPipelineManger
-  );
 
   iio_create_graphics_pipeline(state.device, &state.graphicsPipelineManger, true, VK_NULL_HANDLE, 0, &pipelineState);
 
@@ -858,19 +1117,14 @@ void iio_initialize_testcube() {
   fprintf(stdout, "initiliazing testcube vaules\n");
   iio_create_vertex_buffer_testcube();
   iio_create_index_buffer_testcube();
-  size_t bufferSize = sizeof(ModelUniformBufferData);
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    fprintf(stdout, "creating uniform buffer for testcube model uniform buffer\n");
-    iio_create_uniform_buffer(state.device, bufferSize, &testCube.modelUniformBuffer[i], &testCube.modelUniformBufferMemory[i], &testCube.modelUniformBufferMapped[i]);
-    fprintf(stdout, "writing model uniform buffer to shader buffer\n");
-    iio_write_buffer_descriptor(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, testCube.modelUniformBuffer[i], 0, bufferSize, &state.descriptorSetWriter);
-    iio_update_set(state.device, testCube.modelUniformBufferDescriptorSets[i], &state.descriptorSetWriter);
-  }
+  fprintf(stdout, "writing frame data ring to testcube model descriptor\n");
+  iio_write_buffer_descriptor(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, state.frameDataRing.buffer, 0, sizeof(ModelUniformBufferData), &state.descriptorSetWriter);
+  iio_update_set(state.device, testCube.modelDescriptorSet, &state.descriptorSetWriter);
   iio_load_image(&state.resourceManager, testTextureFilename, &testCube.textureImage, &defaultSamplerCreateInfo);
   for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     fprintf(stdout, "writing testcube image sampler to shader sampler\n");
     iio_write_image_descriptor(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, testCube.textureImage.sampler, testCube.textureImage.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, &state.descriptorSetWriter);
-    iio_update_set(state.device, testCube.texSamplerDescriptorSets[i], &state.descriptorSetWriter);
+    testCube.texSamplerDescriptorSets[i] = iio_get_cached_descriptor_set(state.device, &state.descriptorPoolMangers[1], &state.descriptorSetWriter, &state.descriptorCache);
   }
   fprintf(stdout, "testcube initialized\n\n");
   fprintf(stdout, "size of image hashmap: %llu\n", state.resourceManager.imageMap.size);
@@ -881,12 +1135,114 @@ void iio_initialize_camera() {
   size_t bufferSize = sizeof(CameraUniformBufferData);
   for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     iio_create_uniform_buffer(state.device, bufferSize, &state.globalUniformBuffers[i], &state.globalUniformBuffersMemory[i], &state.globalUniformBuffersMapped[i]);
+    //  the application path writes a transient set per frame instead
+    if (!state.cameraDescriptorSets[i]) continue;
     iio_write_buffer_descriptor(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, state.globalUniformBuffers[i], 0, bufferSize, &state.descriptorSetWriter);
     iio_update_set(state.device, state.cameraDescriptorSets[i], &state.descriptorSetWriter);
   }
   fprintf(stdout, "camera initialized\n\n");
 }
 
+void iio_initialize_application_scene() {
+  fprintf(stdout, "loading application scene\n");
+  //  16 bit indices cover every primitive the loader would not narrow further, larger ones get their own buffers
+  iio_create_geometry_pool(
+    state.device, &state.memoryAllocator, &state.uploadContext,
+    IIO_DEFAULT_GEOMETRY_POOL_VERTEX_SIZE, IIO_DEFAULT_GEOMETRY_POOL_INDEX_SIZE, VK_INDEX_TYPE_UINT16,
+    &state.geometryPool
+  );
+  iio_load_model(&state.resourceManager, applicationModelFilename, &state.testModel);
+  if (state.useBindless) {
+    iio_bindless_acquire_model_materials(state.device, &state.bindlessTable, &state.testModel);
+  } else {
+    iio_create_application_material_sets();
+  }
+  iio_create_draw_list(&state.drawList);
+  if (state.useGpuDriven) {
+    iio_gpu_culling_clear(&state.gpuCulling);
+    uint32_t skipped = iio_gpu_culling_add_model(&state.gpuCulling, &state.testModel, 0);
+    if (skipped) fprintf(stderr, "%u primitives are not pooled and indexed, the gpu driven path skips them\n", skipped);
+  }
+  fprintf(stdout, "application scene loaded\n\n");
+}
+
+void iio_create_application_material_sets() {
+  fprintf(stdout, "creating material descriptor sets\n");
+  uint32_t primitiveCount = 0;
+  for (uint32_t m = 0; m < state.testModel.meshCount; m++) {
+    primitiveCount += state.testModel.meshes[m].primitiveCount;
+  }
+  if (!primitiveCount) return;
+
+  //  one slot per distinct material, each at an offset a uniform buffer descriptor can start at
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(state.selectedDevice, &properties);
+  VkDeviceSize stride = iio_align_up(sizeof(MaterialUniformBufferData), properties.limits.minUniformBufferOffsetAlignment);
+
+  VkBufferCreateInfo bufferCreateInfo = {0};
+  bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCreateInfo.size = stride * primitiveCount;
+  bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  VkResult result = vkCreateBuffer(state.device, &bufferCreateInfo, NULL, &state.materialUniformBuffer);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+  result = iio_allocate_buffer_memory(
+    state.device, &state.memoryAllocator, state.materialUniformBuffer,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    &state.materialUniformBufferMemory
+  );
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+  uint8_t * slots = state.materialUniformBufferMemory.mapped;
+  uint32_t slotCount = 0;
+
+  for (uint32_t m = 0; m < state.testModel.meshCount; m++) {
+    IIOMesh * mesh = &state.testModel.meshes[m];
+    for (uint32_t p = 0; p < mesh->primitiveCount; p++) {
+      IIOMaterial * material = &mesh->primitives[p].material;
+      MaterialUniformBufferData data;
+      iio_material_uniform_data(material, &data);
+
+      //  primitives copy their material, equal factors in the same slot let equal materials share a set
+      uint32_t slot = 0;
+      while (slot < slotCount && memcmp(slots + slot * stride, &data, sizeof(data)) != 0) slot++;
+      if (slot == slotCount) {
+        memcpy(slots + slot * stride, &data, sizeof(data));
+        slotCount++;
+      }
+
+      const IIOTextureInfo * infos [IIO_MATERIAL_TEXTURE_COUNT] = {
+        &material->pbrMetallicRoughness.baseColorTextureInfo,
+        &material->pbrMetallicRoughness.metallicRoughnessTextureInfo,
+        &material->normalTexture.textureInfo,
+        &material->occlusionTexture.textureInfo,
+        &material->emissiveTexture,
+      };
+      for (uint32_t i = 0; i < IIO_MATERIAL_TEXTURE_COUNT; i++) {
+        iio_write_image_descriptor(
+          i, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+          infos[i]->sampler, infos[i]->imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+          &state.descriptorSetWriter
+        );
+      }
+      iio_write_buffer_descriptor(
+        IIO_MATERIAL_TEXTURE_COUNT, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        state.materialUniformBuffer, (uint32_t) (slot * stride), sizeof(MaterialUniformBufferData),
+        &state.descriptorSetWriter
+      );
+      material->descriptorSet = iio_get_cached_descriptor_set(
+        state.device, &state.descriptorPoolMangers[1], &state.descriptorSetWriter, &state.descriptorCache
+      );
+    }
+  }
+}
+
 void iio_create_command_pool() {
   fprintf(stdout, "Creating command pool.\n");
   VkCommandPoolCreateInfo poolCreateInfo = {0};
@@ -912,6 +1268,7 @@ void iio_create_depth_resources() {
   iio_create_image(
     state.swapChainImageExtent.width,
     state.swapChainImageExtent.height,
+    1,
     &state.depthImage,
     &state.depthImageMemory,
     depthFormat,
@@ -920,7 +1277,7 @@ void iio_create_depth_resources() {
     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
   );
 
-  iio_create_image_view(state.depthImage, &state.depthImageView, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+  iio_create_image_view(state.depthImage, &state.depthImageView, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 }
 
 VkFormat iio_find_depth_format() {
@@ -934,29 +1291,7 @@ VkFormat iio_find_depth_format() {
 
 void iio_create_vertex_buffer_testcube() {
   VkDeviceSize bufferSize = sizeof(testCube.vertices);
-  
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  fprintf(stdout, "Creating staging buffer.\n");
-  iio_create_buffer(
-    bufferSize,
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    &stagingBuffer,
-    &stagingBufferMemory
-  );
-  fprintf(stdout, "Staging buffer created successfully.\n");
 
-  fprintf(stdout, "Mapping vertex buffer memory and copying data.\n");
-  void * data = NULL;
-  vkMapMemory(state.device, stagingBufferMemory, 0, bufferSize, 0, &data);
-  if (!data) {
-    fprintf(stderr, "Failed to map vertex buffer memory\n");
-    exit(1);
-  }
-  memcpy(data, testCube.vertices, sizeof(testCube.vertices));
-  vkUnmapMemory(state.device, stagingBufferMemory);
-  fprintf(stdout, "Data copied to staging buffer successfully.\n");
   fprintf(stdout, "Creating vertex buffer.\n");
   iio_create_buffer(
     bufferSize, 
@@ -966,38 +1301,15 @@ void iio_create_vertex_buffer_testcube() {
     &testCube.vertexBufferMemory
   );
   fprintf(stdout, "Vertex buffer created successfully.\n");
-  fprintf(stdout, "Copying data from staging buffer to vertex buffer.\n");
-  iio_copy_buffer(stagingBuffer, testCube.vertexBuffer, bufferSize);
-  fprintf(stdout, "Data copied successfully.\n");
-  vkDestroyBuffer(state.device, stagingBuffer, NULL);
-  vkFreeMemory(state.device, stagingBufferMemory, NULL);
+  iio_upload_buffer_data(testCube.vertices, bufferSize, testCube.vertexBuffer, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 }
 
 void iio_create_index_buffer_testcube() {
-  VkDeviceSize bufferSize = sizeof(testCube.indices);
-  
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  fprintf(stdout, "Creating staging buffer for index buffer.\n");
-  iio_create_buffer(
-    bufferSize,
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    &stagingBuffer,
-    &stagingBufferMemory
-  );
-  fprintf(stdout, "Staging buffer for index buffer created successfully.\n");
-
-  fprintf(stdout, "Mapping index buffer memory and copying data.\n");
-  void * data = NULL;
-  vkMapMemory(state.device, stagingBufferMemory, 0, bufferSize, 0, &data);
-  if (!data) {
-    fprintf(stderr, "Failed to map index buffer memory\n");
-    exit(1);
-  }
-  memcpy(data, testCube.indices, sizeof(testCube.indices));
-  vkUnmapMemory(state.device, stagingBufferMemory);
-  fprintf(stdout, "Data copied to staging buffer for index buffer successfully.\n");
+  uint32_t indexCount = sizeof(testCube.indices) / sizeof(uint32_t);
+  testCube.indexType = iio_select_index_type(sizeof(testCube.vertices) / sizeof(Vertex));
+  VkDeviceSize bufferSize = indexCount * iio_index_type_size(testCube.indexType);
+  uint8_t indexData [sizeof(testCube.indices)];
+  iio_narrow_indices(testCube.indices, indexCount, testCube.indexType, indexData);
 
   fprintf(stdout, "Creating index buffer.\n");
   iio_create_buffer(
@@ -1008,23 +1320,18 @@ void iio_create_index_buffer_testcube() {
     &testCube.indexBufferMemory
   );
   fprintf(stdout, "Index buffer created successfully.\n");
-
-  fprintf(stdout, "Copying data from staging buffer to index buffer.\n");
-  iio_copy_buffer(stagingBuffer, testCube.indexBuffer, bufferSize);
-  fprintf(stdout, "Data copied to index buffer successfully.\n");
-
-  vkDestroyBuffer(state.device, stagingBuffer, NULL);
-  vkFreeMemory(state.device, stagingBufferMemory, NULL);
+  iio_upload_buffer_data(indexData, bufferSize, testCube.indexBuffer, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 }
 
-void iio_create_uniform_buffer(VkDevice device, VkDeviceSize bufferSize, VkBuffer * buffer, VkDeviceMemory * bufferMemory, void ** bufferMapped) {
+void iio_create_uniform_buffer(VkDevice device, VkDeviceSize bufferSize, VkBuffer * buffer, IIOAllocation * bufferMemory, void ** bufferMapped) {
   iio_create_buffer(
     bufferSize,
     VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
     buffer, bufferMemory
   );
-  vkMapMemory(device, *bufferMemory, 0, bufferSize, 0, bufferMapped);
+  //  host visible allocations are persistently mapped by the allocator
+  *bufferMapped = bufferMemory->mapped;
 }
 
 void iio_create_command_buffers() {
@@ -1090,26 +1397,61 @@ void iio_initialize_resource_loader() {
   iio_set_create_texture_image_func(iio_create_texture_image_func);
   iio_set_create_texture_image_from_memory_func(iio_create_texture_image_from_memory_func);
   iio_set_create_texture_image_from_pixels_func(iio_create_texture_image_from_pixels_func);
+  iio_set_create_texture_image_from_compressed_func(iio_create_texture_image_from_compressed_func);
   iio_set_create_image_sampler_func(iio_create_image_sampler_func);
+  iio_set_free_memory_func(iio_free_memory_func);
+  iio_set_create_geometry_buffer_func(iio_create_geometry_buffer_func);
+  iio_set_allocate_pooled_geometry_func(iio_allocate_pooled_geometry_func);
+  iio_set_index_type_uint8_supported(state.indexTypeUint8Supported);
+  iio_set_vertex_layout(preferPackedVertices ? iio_vertex_layout_packed : iio_vertex_layout_full);
+  iio_set_texture_compression_enabled(
+    state.textureCompressionBCSupported &&
+    iio_texture_format_supported(VK_FORMAT_BC7_SRGB_BLOCK) &&
+    iio_texture_format_supported(VK_FORMAT_BC7_UNORM_BLOCK) &&
+    iio_texture_format_supported(VK_FORMAT_BC5_UNORM_BLOCK) &&
+    iio_texture_format_supported(VK_FORMAT_BC4_UNORM_BLOCK)
+  );
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(state.selectedDevice, &properties);
+  iio_set_max_sampler_anisotropy(properties.limits.maxSamplerAnisotropy);
 
   iio_initialize_resource_manager(&state.resourceManager);
 
   iio_initialize_default_texture_resources(&state.resourceManager);
 }
 
-void iio_create_texture_image_func(const char * path, VkImage * image, VkDeviceMemory * imageMemory, VkImageView * imageView) {
-  iio_create_texture_image(path, image, imageMemory);
-  iio_create_texture_image_view(*image, imageView);
+void iio_create_texture_image_func(const char * path, VkImage * image, IIOAllocation * imageMemory, VkImageView * imageView) {
+  if (iio_is_compressed_texture_path(path)) {
+    IIOCompressedTexture texture;
+    *image = VK_NULL_HANDLE;
+    if (!iio_load_compressed_texture(path, &texture)) return;
+    iio_create_texture_image_from_compressed_func(&texture, (VkComponentMapping) {0}, image, imageMemory, imageView);
+    iio_free_compressed_texture(&texture);
+    return;
+  }
+
+  uint32_t mipLevels = 1;
+  iio_create_texture_image(path, image, imageMemory, &mipLevels);
+  iio_create_texture_image_view(*image, imageView, VK_FORMAT_R8G8B8A8_SRGB, (VkComponentMapping) {0}, mipLevels);
+}
+
+void iio_create_texture_image_from_memory_func(const uint8_t * data, size_t dataSize, VkImage * image, IIOAllocation * imageMemory, VkImageView * imageView) {
+  uint32_t mipLevels = 1;
+  iio_create_texture_image_from_memory(data, dataSize, image, imageMemory, &mipLevels);
+  iio_create_texture_image_view(*image, imageView, VK_FORMAT_R8G8B8A8_SRGB, (VkComponentMapping) {0}, mipLevels);
 }
 
-void iio_create_texture_image_from_memory_func(const uint8_t * data, size_t dataSize, VkImage * image, VkDeviceMemory * imageMemory, VkImageView * imageView) {
-  iio_create_texture_image_from_memory(data, dataSize, image, imageMemory);
-  iio_create_texture_image_view(*image, imageView);
+void iio_create_texture_image_from_pixels_func(const uint8_t * pixels, size_t width, size_t height, VkFormat format, VkComponentMapping components, VkImage * image, IIOAllocation * imageMemory, VkImageView * imageView) {
+  uint32_t mipLevels = 1;
+  iio_create_texture_image_from_pixels(pixels, width, height, format, image, imageMemory, &mipLevels);
+  iio_create_texture_image_view(*image, imageView, format, components, mipLevels);
 }
 
-void iio_create_texture_image_from_pixels_func(const uint8_t * pixels, size_t width, size_t height, VkImage * image, VkDeviceMemory * imageMemory, VkImageView * imageView) {
-  iio_create_texture_image_from_pixels(pixels, width, height, image, imageMemory);
-  iio_create_texture_image_view(*image, imageView);
+void iio_create_texture_image_from_compressed_func(const IIOCompressedTexture * texture, VkComponentMapping components, VkImage * image, IIOAllocation * imageMemory, VkImageView * imageView) {
+  iio_create_texture_image_from_compressed(texture, image, imageMemory);
+  if (*image == VK_NULL_HANDLE) return;
+  iio_create_texture_image_view(*image, imageView, texture->format, components, texture->levelCount);
 }
 
 void iio_create_image_sampler_func(const VkSamplerCreateInfo * createInfo, VkSampler * sampler) {
@@ -1120,6 +1462,31 @@ void iio_create_image_sampler_func(const VkSamplerCreateInfo * createInfo, VkSam
   }
 }
 
+void iio_free_memory_func(IIOAllocation * allocation) {
+  iio_free_memory(state.device, &state.memoryAllocator, allocation);
+}
+
+void iio_create_geometry_buffer_func(const void * data, size_t size, VkBufferUsageFlags usage, VkBuffer * buffer, IIOAllocation * bufferMemory) {
+  iio_create_buffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
+  if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+    iio_upload_buffer_data(data, size, *buffer, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+  } else {
+    iio_upload_buffer_data(data, size, *buffer, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+  }
+}
+
+bool iio_allocate_pooled_geometry_func(const void * vertexData, uint32_t vertexCount, uint32_t vertexStride, const void * indexData, uint32_t indexCount, VkIndexType indexType, VkBuffer * vertexBuffer, VkBuffer * indexBuffer, int32_t * vertexOffset, uint32_t * firstIndex) {
+  //  the pool only exists on the application path, everything else keeps buffers per primitive
+  if (!iio_geometry_pool_add(
+    state.device, &state.memoryAllocator, &state.uploadContext, &state.geometryPool,
+    vertexData, vertexCount, vertexStride, indexData, indexCount, indexType,
+    vertexOffset, firstIndex
+  )) return false;
+  *vertexBuffer = state.geometryPool.vertexBuffer;
+  if (indexData && indexCount) *indexBuffer = state.geometryPool.indexBuffer;
+  return true;
+}
+
 /****************************************************************************************************
  *                                    Vulkan API Helper Functions                                   *
  ****************************************************************************************************/
@@ -1186,6 +1553,7 @@ void iio_select_physical_device_properties (
   VkSurfaceCapabilitiesKHR * surfaceCapabilities,
   uint32_t * graphicsQueueIndex,
   uint32_t * presentQueueIndex,
+  uint32_t * transferQueueIndex,
   VkPhysicalDeviceType * deviceType) 
 
 { //  iio_select_physical_device_properties
@@ -1195,6 +1563,7 @@ void iio_select_physical_device_properties (
   *surfaceCapabilities = (VkSurfaceCapabilitiesKHR) {0};
   *graphicsQueueIndex = 0;
   *presentQueueIndex = 0;
+  *transferQueueIndex = 0;
   *deviceType = VK_PHYSICAL_DEVICE_TYPE_OTHER; // Default to other. The system should test for this value and handle it accordingly
   uint32_t queueFamilyCount;
   vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, NULL);
@@ -1228,6 +1597,25 @@ void iio_select_physical_device_properties (
     return;
   }
 
+  //  prefer a transfer family without graphics or compute (a DMA engine), then any non graphics
+  //  family that can transfer. Without either, uploads share the graphics queue
+  *transferQueueIndex = *graphicsQueueIndex;
+  bool hasDedicatedTransferFamily = false;
+  for (int i = 0; i < queueFamilyCount; i++) {
+    VkQueueFlags flags = queueFamilies[i].queueFlags;
+    if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+      continue;
+    }
+    if (!(flags & VK_QUEUE_COMPUTE_BIT)) {
+      *transferQueueIndex = i;
+      hasDedicatedTransferFamily = true;
+      break;
+    } else if (!hasDedicatedTransferFamily) {
+      *transferQueueIndex = i;
+      hasDedicatedTransferFamily = true;
+    }
+  }
+
   //  check if the device supports the required device features
   VkPhysicalDeviceFeatures features;
   vkGetPhysicalDeviceFeatures(physicalDevice, &features);
@@ -1397,7 +1785,7 @@ void iio_create_buffer(
   VkBufferUsageFlags usage,
   VkMemoryPropertyFlags properties,
   VkBuffer * buffer,
-  VkDeviceMemory * bufferMemory)
+  IIOAllocation * bufferMemory)
 
 {
   VkBufferCreateInfo bufferCreateInfo = {0};
@@ -1412,63 +1800,38 @@ void iio_create_buffer(
     exit(1);
   }
 
-  VkMemoryRequirements memoryRequirements;
-  vkGetBufferMemoryRequirements(state.device, *buffer, &memoryRequirements);
-
-  VkMemoryAllocateInfo allocInfo = {0};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memoryRequirements.size;
-  allocInfo.memoryTypeIndex = iio_find_memory_type(memoryRequirements.memoryTypeBits, properties);
-
-  result = vkAllocateMemory(state.device, &allocInfo, NULL, bufferMemory);
+  result = iio_allocate_buffer_memory(state.device, &state.memoryAllocator, *buffer, properties, bufferMemory);
   if (result != VK_SUCCESS) {
     iio_vk_error(result, __LINE__, __FILE__);
     exit(1);
   }
-
-  vkBindBufferMemory(state.device, *buffer, *bufferMemory, 0);
 }
 
-void iio_copy_buffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-  VkCommandBuffer commandBuffer = iio_begin_single_time_commands();
+void iio_copy_buffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize size) {
+  VkCommandBuffer commandBuffer = iio_upload_begin(state.device, &state.uploadContext);
   VkBufferCopy copyRegion = {0};
-  copyRegion.srcOffset = 0; // Optional
+  copyRegion.srcOffset = srcOffset;
   copyRegion.dstOffset = 0; // Optional
   copyRegion.size = size;
   vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-  iio_end_single_time_commands(commandBuffer);
 }
 
-VkCommandBuffer iio_begin_single_time_commands() {
-  VkCommandBufferAllocateInfo allocInfo = {0};
-  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocInfo.commandPool = state.commandPool;
-  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandBufferCount = 1;
-  VkCommandBuffer commandBuffer;
-  vkAllocateCommandBuffers(state.device, &allocInfo, &commandBuffer);
-
-  VkCommandBufferBeginInfo beginInfo = {0};
-  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+void iio_upload_buffer_data(const void * data, VkDeviceSize size, VkBuffer dstBuffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask) {
+  IIOStagingRegion region;
+  iio_upload_stage(state.device, &state.memoryAllocator, &state.uploadContext, data, size, 4, &region);
+  iio_copy_buffer(region.buffer, region.offset, dstBuffer, size);
+  iio_upload_release_buffer(state.device, &state.uploadContext, dstBuffer, dstAccessMask, dstStageMask);
+}
 
-  vkBeginCommandBuffer(commandBuffer, &beginInfo);
-  
-  return commandBuffer;
+//  records into the current upload batch. Only needed when the caller must block on the result,
+//  regular uploads are flushed with the next frame
+VkCommandBuffer iio_begin_single_time_commands() {
+  return iio_upload_begin(state.device, &state.uploadContext);
 }
 
 void iio_end_single_time_commands(VkCommandBuffer commandBuffer) {
-  vkEndCommandBuffer(commandBuffer);
-
-  VkSubmitInfo submitInfo = {0};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &commandBuffer;
-
-  vkQueueSubmit(state.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(state.graphicsQueue);
-
-  vkFreeCommandBuffers(state.device, state.commandPool, 1, &commandBuffer);
+  IIOUploadTicket ticket = iio_upload_submit(state.device, &state.uploadContext);
+  iio_upload_wait(state.device, &state.uploadContext, ticket);
 }
 
 void iio_update_camera_uniform_buffer(uint32_t currentFrame) {
@@ -1485,145 +1848,239 @@ void iio_update_camera_uniform_buffer(uint32_t currentFrame) {
   glm_perspective(fovy, (float) state.swapChainImageExtent.width / (float) state.swapChainImageExtent.height, 0.1f, 10.0f, ubo.projection);
   ubo.projection[1][1] *= -1.0f; // Invert Y axis for Vulkan
   memcpy(state.globalUniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
+  state.cameraData = ubo;
 }
 
-void iio_create_texture_image(const char * path, VkImage * textureImage, VkDeviceMemory * textureImageMemory) {
+void iio_create_texture_image(const char * path, VkImage * textureImage, IIOAllocation * textureImageMemory, uint32_t * mipLevels) {
   int width, height, channels;
   stbi_uc * pixels = stbi_load(path, &width, &height, &channels, STBI_rgb_alpha);
-  VkDeviceSize imageSize = width * height * 4; // Assuming 4 bytes per pixel (RGBA)
 
   if (!pixels) {
     fprintf(stderr, "Failed to load texture image: %s\n", path);
     *textureImage = VK_NULL_HANDLE;
-    *textureImageMemory = VK_NULL_HANDLE;
+    *textureImageMemory = (IIOAllocation) {0};
     return;
   }
 
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  fprintf(stdout, "Creating staging buffer for texture image.\n");
-  iio_create_buffer(
-    imageSize,
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    &stagingBuffer,
-    &stagingBufferMemory
-  );
-  fprintf(stdout, "Staging buffer for texture image created successfully.\n");
-  fprintf(stdout, "Mapping texture image memory and copying data.\n");
-  void * data = NULL;
-  vkMapMemory(state.device, stagingBufferMemory, 0, imageSize, 0, &data);
-  memcpy(data, pixels, imageSize);
-  vkUnmapMemory(state.device, stagingBufferMemory);
-  fprintf(stdout, "Data copied to staging buffer for texture image successfully.\n");
+  iio_create_texture_image_from_pixels(pixels, width, height, VK_FORMAT_R8G8B8A8_SRGB, textureImage, textureImageMemory, mipLevels);
   stbi_image_free(pixels);
-  fprintf(stdout, "Creating texture image.\n");
-  iio_create_image(
-    (uint32_t) width,
-    (uint32_t) height,
-    textureImage,
-    textureImageMemory,
-    VK_FORMAT_R8G8B8A8_SRGB, // Assuming RGBA format
-    VK_IMAGE_TILING_OPTIMAL,
-    VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-  );
-  iio_transition_image_layout(*textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  iio_copy_buffer_to_image(stagingBuffer, *textureImage, (uint32_t) width, (uint32_t) height);
-  iio_transition_image_layout(*textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-  vkDestroyBuffer(state.device, stagingBuffer, NULL);
-  vkFreeMemory(state.device, stagingBufferMemory, NULL);
 }
 
-void iio_create_texture_image_from_memory(const uint8_t * pData, int size, VkImage * textureImage, VkDeviceMemory * textureImageMemory) {
+void iio_create_texture_image_from_memory(const uint8_t * pData, int size, VkImage * textureImage, IIOAllocation * textureImageMemory, uint32_t * mipLevels) {
   int width, height, channels;
   stbi_uc * pixels = stbi_load_from_memory(pData, size, &width, &height, &channels, STBI_rgb_alpha);
-  VkDeviceSize imageSize = width * height * 4;
 
   if (!pixels) {
     fprintf(stderr, "Failed to load texture image from memory: ptr 0x%08x %08x\n", (uint64_t) pData >> 32, (uint64_t) pData | 0x00000000ffffffff);
     *textureImage = VK_NULL_HANDLE;
-    *textureImageMemory = VK_NULL_HANDLE;
+    *textureImageMemory = (IIOAllocation) {0};
     return;
   }
 
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  fprintf(stdout, "Creating staging buffer for texture image.\n");
-  iio_create_buffer(
-    imageSize,
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    &stagingBuffer,
-    &stagingBufferMemory
-  );
-  fprintf(stdout, "Staging buffer for texture image created successfully.\n");
-  fprintf(stdout, "Mapping texture image memory and copying data.\n");
-  void * data = NULL;
-  vkMapMemory(state.device, stagingBufferMemory, 0, imageSize, 0, &data);
-  memcpy(data, pixels, imageSize);
-  vkUnmapMemory(state.device, stagingBufferMemory);
-  fprintf(stdout, "Data copied to staging buffer for texture image successfully.\n");
+  iio_create_texture_image_from_pixels(pixels, width, height, VK_FORMAT_R8G8B8A8_SRGB, textureImage, textureImageMemory, mipLevels);
   stbi_image_free(pixels);
+}
+
+static uint32_t iio_texture_texel_size(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_R8_UNORM:   return 1;
+    case VK_FORMAT_R8G8_UNORM: return 2;
+    default:                   return 4;
+  }
+}
+
+void iio_create_texture_image_from_pixels(const uint8_t * pixels, int width, int height, VkFormat format, VkImage * textureImage, IIOAllocation * textureImageMemory, uint32_t * mipLevels) {
+  uint32_t texelSize = iio_texture_texel_size(format);
+  VkDeviceSize imageSize = (VkDeviceSize) width * height * texelSize;
+  uint32_t levelCount = iio_mip_level_count((uint32_t) width, (uint32_t) height);
+
+  //  blits need a graphics capable queue, uploads on a dedicated transfer queue build the chain on the CPU
+  bool blit = levelCount > 1 && !state.uploadContext.ownershipTransfer && iio_find_supported_format(
+    &format,
+    1,
+    VK_IMAGE_TILING_OPTIMAL,
+    VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
+  ) != VK_FORMAT_UNDEFINED;
+
   fprintf(stdout, "Creating texture image.\n");
   iio_create_image(
     (uint32_t) width,
     (uint32_t) height,
+    levelCount,
     textureImage,
     textureImageMemory,
-    VK_FORMAT_R8G8B8A8_SRGB, // Assuming RGBA format
+    format,
     VK_IMAGE_TILING_OPTIMAL,
-    VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+    VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (blit ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0),
     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
   );
-  iio_transition_image_layout(*textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  iio_copy_buffer_to_image(stagingBuffer, *textureImage, (uint32_t) width, (uint32_t) height);
-  iio_transition_image_layout(*textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-  vkDestroyBuffer(state.device, stagingBuffer, NULL);
-  vkFreeMemory(state.device, stagingBufferMemory, NULL);
+  iio_transition_image_layout(*textureImage, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount);
+  *mipLevels = levelCount;
+
+  //  buffer to image copies need the offset aligned to the texel size, 16 covers every format we upload
+  IIOStagingRegion region;
+  if (blit) {
+    iio_upload_stage(state.device, &state.memoryAllocator, &state.uploadContext, pixels, imageSize, 16, &region);
+    iio_copy_buffer_to_image(region.buffer, region.offset, *textureImage, 0, (uint32_t) width, (uint32_t) height);
+    iio_generate_mipmaps(*textureImage, (uint32_t) width, (uint32_t) height, levelCount);
+    return;
+  }
+
+  size_t chainSize = iio_mip_chain_size((uint32_t) width, (uint32_t) height, levelCount, texelSize);
+  uint8_t * chain = malloc(chainSize);
+  if (!chain) {
+    iio_oom_error(NULL, __LINE__, __FILE__);
+    exit(1);
+  }
+  memcpy(chain, pixels, imageSize);
+  iio_generate_mip_chain_unorm8(chain, (uint32_t) width, (uint32_t) height, levelCount, texelSize, format == VK_FORMAT_R8G8B8A8_SRGB);
+
+  //  the chain is packed back to back, but copies on a transfer only queue need offsets aligned to 4.
+  //  texel sizes are 1, 2 or 4, so rounding every level up to 4 keeps them texel aligned as well
+  VkDeviceSize stagedSize = 0;
+  for (uint32_t level = 0; level < levelCount; level++) {
+    VkDeviceSize levelSize = (VkDeviceSize) iio_mip_extent((uint32_t) width, level) * iio_mip_extent((uint32_t) height, level) * texelSize;
+    stagedSize += iio_align_up(levelSize, 4);
+  }
+  iio_upload_stage(state.device, &state.memoryAllocator, &state.uploadContext, NULL, stagedSize, 16, &region);
+
+  size_t chainOffset = 0;
+  VkDeviceSize stagedOffset = 0;
+  for (uint32_t level = 0; level < levelCount; level++) {
+    uint32_t levelWidth = iio_mip_extent((uint32_t) width, level);
+    uint32_t levelHeight = iio_mip_extent((uint32_t) height, level);
+    size_t levelSize = (size_t) levelWidth * levelHeight * texelSize;
+    memcpy((uint8_t *) region.mapped + stagedOffset, chain + chainOffset, levelSize);
+    iio_copy_buffer_to_image(region.buffer, region.offset + stagedOffset, *textureImage, level, levelWidth, levelHeight);
+    chainOffset += levelSize;
+    stagedOffset += iio_align_up(levelSize, 4);
+  }
+  free(chain);
+  iio_upload_release_image(
+    state.device,
+    &state.uploadContext,
+    *textureImage,
+    (VkImageSubresourceRange) {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1},
+    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    VK_ACCESS_SHADER_READ_BIT,
+    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+  );
 }
 
-void iio_create_texture_image_from_pixels(const uint8_t * pixels, int width, int height, VkImage * textureImage, VkDeviceMemory * textureImageMemory) {
-  // TODO : adjust this to take a modular amount of channels
-  VkDeviceSize imageSize = width * height * 4;
+bool iio_texture_format_supported(VkFormat format) {
+  VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  return iio_find_supported_format(&format, 1, VK_IMAGE_TILING_OPTIMAL, features) != VK_FORMAT_UNDEFINED;
+}
+
+void iio_create_texture_image_from_compressed(const IIOCompressedTexture * texture, VkImage * textureImage, IIOAllocation * textureImageMemory) {
+  if (!iio_texture_format_supported(texture->format)) {
+    fprintf(stderr, "Compressed texture format %u is not supported by the device\n", (uint32_t) texture->format);
+    *textureImage = VK_NULL_HANDLE;
+    *textureImageMemory = (IIOAllocation) {0};
+    return;
+  }
 
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  fprintf(stdout, "Creating staging buffer for texture image.\n");
-  iio_create_buffer(
-    imageSize,
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    &stagingBuffer,
-    &stagingBufferMemory
-  );
-  fprintf(stdout, "Staging buffer for texture image created successfully.\n");
-  fprintf(stdout, "Mapping texture image memory and copying data.\n");
-  void * data = NULL;
-  vkMapMemory(state.device, stagingBufferMemory, 0, imageSize, 0, &data);
-  memcpy(data, pixels, imageSize);
-  vkUnmapMemory(state.device, stagingBufferMemory);
-  fprintf(stdout, "Data copied to staging buffer for texture image successfully.\n");
-  fprintf(stdout, "Creating texture image.\n");
   iio_create_image(
-    (uint32_t) width,
-    (uint32_t) height,
+    texture->width,
+    texture->height,
+    texture->levelCount,
     textureImage,
     textureImageMemory,
-    VK_FORMAT_R8G8B8A8_SRGB, // Assuming RGBA format
+    texture->format,
     VK_IMAGE_TILING_OPTIMAL,
     VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
   );
-  iio_transition_image_layout(*textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  iio_copy_buffer_to_image(stagingBuffer, *textureImage, (uint32_t) width, (uint32_t) height);
-  iio_transition_image_layout(*textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-  vkDestroyBuffer(state.device, stagingBuffer, NULL);
-  vkFreeMemory(state.device, stagingBufferMemory, NULL);
+  iio_transition_image_layout(*textureImage, texture->format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture->levelCount);
+
+  //  every level offset is a multiple of the block size, which is what the copies require
+  IIOStagingRegion region;
+  iio_upload_stage(state.device, &state.memoryAllocator, &state.uploadContext, texture->data, texture->dataSize, 16, &region);
+  for (uint32_t level = 0; level < texture->levelCount; level++) {
+    iio_copy_buffer_to_image(
+      region.buffer,
+      region.offset + texture->levels[level].offset,
+      *textureImage,
+      level,
+      iio_mip_extent(texture->width, level),
+      iio_mip_extent(texture->height, level)
+    );
+  }
+  iio_upload_release_image(
+    state.device,
+    &state.uploadContext,
+    *textureImage,
+    (VkImageSubresourceRange) {VK_IMAGE_ASPECT_COLOR_BIT, 0, texture->levelCount, 0, 1},
+    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    VK_ACCESS_SHADER_READ_BIT,
+    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+  );
+}
+
+void iio_generate_mipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels) {
+  VkCommandBuffer commandBuffer = iio_upload_begin(state.device, &state.uploadContext);
+
+  VkImageMemoryBarrier barrier = {0};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+
+  //  every level is blitted from the one above it, which is done with once the blit is recorded
+  for (uint32_t level = 1; level < mipLevels; level++) {
+    barrier.subresourceRange.baseMipLevel = level - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+    VkImageBlit blit = {0};
+    blit.srcSubresource = (VkImageSubresourceLayers) {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+    blit.srcOffsets[1] = (VkOffset3D) {(int32_t) iio_mip_extent(width, level - 1), (int32_t) iio_mip_extent(height, level - 1), 1};
+    blit.dstSubresource = (VkImageSubresourceLayers) {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+    blit.dstOffsets[1] = (VkOffset3D) {(int32_t) iio_mip_extent(width, level), (int32_t) iio_mip_extent(height, level), 1};
+    vkCmdBlitImage(
+      commandBuffer,
+      image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      1, &blit,
+      VK_FILTER_LINEAR
+    );
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+  }
+
+  barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
 }
 
-void iio_create_texture_image_view(VkImage textureImage, VkImageView * textureImageView) {
-  iio_create_image_view(textureImage, textureImageView, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+void iio_create_texture_image_view(VkImage textureImage, VkImageView * textureImageView, VkFormat format, VkComponentMapping components, uint32_t mipLevels) {
+  VkImageViewCreateInfo viewCreateInfo = {0};
+  viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewCreateInfo.image = textureImage;
+  viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewCreateInfo.format = format;
+  viewCreateInfo.components = components;
+  viewCreateInfo.subresourceRange = (VkImageSubresourceRange) {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1};
+
+  VkResult result = vkCreateImageView(state.device, &viewCreateInfo, NULL, textureImageView);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
 }
 
 void iio_create_texture_sampler(VkSampler * textureSampler) {
@@ -1633,8 +2090,9 @@ void iio_create_texture_sampler(VkSampler * textureSampler) {
 void iio_create_image(
   uint32_t                                  width,
   uint32_t                                  height,
+  uint32_t                                  mipLevels,
   VkImage *                                 textureImage,
-  VkDeviceMemory *                          textureImageMemory,
+  IIOAllocation *                           textureImageMemory,
   VkFormat                                  format,
   VkImageTiling                             tiling,
   VkImageUsageFlags                         usage,
@@ -1648,7 +2106,7 @@ void iio_create_image(
   imageCreateInfo.extent.width = width;
   imageCreateInfo.extent.height = height;
   imageCreateInfo.extent.depth = 1;
-  imageCreateInfo.mipLevels = 1;
+  imageCreateInfo.mipLevels = mipLevels;
   imageCreateInfo.arrayLayers = 1;
   imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
   imageCreateInfo.tiling = tiling;
@@ -1662,24 +2120,14 @@ void iio_create_image(
     exit(1);
   }
 
-  VkMemoryRequirements memoryRequirements;
-  vkGetImageMemoryRequirements(state.device, *textureImage, &memoryRequirements);
-
-  VkMemoryAllocateInfo allocInfo = {0};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memoryRequirements.size;
-  allocInfo.memoryTypeIndex = iio_find_memory_type(memoryRequirements.memoryTypeBits, properties);
-
-  result = vkAllocateMemory(state.device, &allocInfo, NULL, textureImageMemory);
+  result = iio_allocate_image_memory(state.device, &state.memoryAllocator, *textureImage, tiling, properties, textureImageMemory);
   if (result != VK_SUCCESS) {
     iio_vk_error(result, __LINE__, __FILE__);
     exit(1);
   }
-
-  vkBindImageMemory(state.device, *textureImage, *textureImageMemory, 0);
 }
 
-void iio_create_image_view(VkImage image, VkImageView * imageView, VkFormat format, VkImageAspectFlags aspectMask) {
+void iio_create_image_view(VkImage image, VkImageView * imageView, VkFormat format, VkImageAspectFlags aspectMask, uint32_t mipLevels) {
   VkImageViewCreateInfo viewCreateInfo = {0};
   viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   viewCreateInfo.image = image;
@@ -1691,7 +2139,7 @@ void iio_create_image_view(VkImage image, VkImageView * imageView, VkFormat form
   viewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
   viewCreateInfo.subresourceRange.aspectMask = aspectMask;
   viewCreateInfo.subresourceRange.baseMipLevel = 0;
-  viewCreateInfo.subresourceRange.levelCount = 1;
+  viewCreateInfo.subresourceRange.levelCount = mipLevels;
   viewCreateInfo.subresourceRange.baseArrayLayer = 0;
   viewCreateInfo.subresourceRange.layerCount = 1;
 
@@ -1720,7 +2168,7 @@ void iio_create_image_sampler(VkSampler * sampler) {
   samplerCreateInfo.compareOp = VK_COMPARE_OP_ALWAYS;
   samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
   samplerCreateInfo.minLod = 0.0f;
-  samplerCreateInfo.maxLod = 0.0f; // No mipmaps
+  samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE; // views limit the levels
   samplerCreateInfo.mipLodBias = 0.0f;
 
   VkResult result = vkCreateSampler(state.device, &samplerCreateInfo, NULL, sampler);
@@ -1730,8 +2178,8 @@ void iio_create_image_sampler(VkSampler * sampler) {
   }
 }
 
-void iio_transition_image_layout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
-  VkCommandBuffer commandBuffer = iio_begin_single_time_commands();
+void iio_transition_image_layout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
+  VkCommandBuffer commandBuffer = iio_upload_begin(state.device, &state.uploadContext);
 
   VkImageMemoryBarrier barrier = {0};
   barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -1742,7 +2190,7 @@ void iio_transition_image_layout(VkImage image, VkFormat format, VkImageLayout o
   barrier.image = image;
   barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.levelCount = mipLevels;
   barrier.subresourceRange.baseArrayLayer = 0;
   barrier.subresourceRange.layerCount = 1;
 
@@ -1779,8 +2227,6 @@ void iio_transition_image_layout(VkImage image, VkFormat format, VkImageLayout o
     0, NULL,
     1, &barrier
   );
-
-  iio_end_single_time_commands(commandBuffer);
 }
 
 void iio_transition_swapchain_image_layout(
@@ -1836,15 +2282,15 @@ VkFormat iio_find_supported_format(const VkFormat * candidates, uint32_t count,
   return VK_FORMAT_UNDEFINED; // No suitable format found
 }
 
-void iio_copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-  VkCommandBuffer commandBuffer = iio_begin_single_time_commands();
+void iio_copy_buffer_to_image(VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, uint32_t mipLevel, uint32_t width, uint32_t height) {
+  VkCommandBuffer commandBuffer = iio_upload_begin(state.device, &state.uploadContext);
 
   VkBufferImageCopy region = {0};
-  region.bufferOffset = 0;
+  region.bufferOffset = bufferOffset;
   region.bufferRowLength = 0;
   region.bufferImageHeight = 0;
   region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.mipLevel = mipLevel;
   region.imageSubresource.baseArrayLayer = 0;
   region.imageSubresource.layerCount = 1;
   region.imageOffset = (VkOffset3D) {0, 0, 0};
@@ -1858,8 +2304,6 @@ void iio_copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, ui
     1,
     &region
   );
-
-  iio_end_single_time_commands(commandBuffer);
 }
 
 void iio_sleep(double ms) {
@@ -2008,6 +2452,20 @@ void draw_frame() {
   if (!doTestTriangle) {
     iio_update_camera_uniform_buffer(state.currentFrame);
   }
+
+  //  this frame slot's previous commands have retired, its transient sets and per draw data can be
+  //  reset and its released bindless slots can age
+  if (state.frameDescriptorAllocator.isInitialized) {
+    iio_reset_frame_descriptor_allocator(state.device, &state.frameDescriptorAllocator, state.currentFrame);
+  }
+  iio_frame_data_ring_begin_frame(&state.frameDataRing, state.currentFrame);
+  if (state.useBindless) {
+    iio_bindless_begin_frame(&state.bindlessTable);
+  }
+
+  //  uploads recorded since the last frame go ahead of it on the same queue
+  iio_upload_submit(state.device, &state.uploadContext);
+  iio_upload_collect(state.device, &state.memoryAllocator, &state.uploadContext);
   
   vkResetFences(state.device, 1, &state.inFlightFences[state.currentFrame]);
   vkResetCommandBuffer(state.commandBuffers[state.currentFrame], 0);
@@ -2069,6 +2527,13 @@ void iio_record_render_to_command_buffer(VkCommandBuffer commandBuffer, uint32_t
     exit(1);
   }
 
+  mat4 viewProjection;
+  glm_mat4_mul(state.cameraData.projection, state.cameraData.view, viewProjection);
+  if (state.useGpuDriven) {
+    //  the draws of this frame are decided before rendering starts
+    iio_record_gpu_culling(commandBuffer, &state.gpuCulling, currentFrame, viewProjection);
+  }
+
   iio_transition_swapchain_image_layout(
     commandBuffer,
     imageIndex,
@@ -2111,8 +2576,7 @@ void iio_record_render_to_command_buffer(VkCommandBuffer commandBuffer, uint32_t
   //record the draw commands here
   
   // for each pipeline, bind the pipelines, set the dynamic state, and draw the associated objects
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state.graphicsPipelineManger.pipeline);
-
+  //  the draw list binds its own pipelines, dynamic state set ahead of them carries over
   VkViewport viewport = {0};
   viewport.x = 0.0f;
   viewport.y = 0.0f;
@@ -2127,9 +2591,50 @@ void iio_record_render_to_command_buffer(VkCommandBuffer commandBuffer, uint32_t
   scissor.extent = state.swapChainImageExtent;
   vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-  // for each render target group by texture, bind the texture descriptor sets
+  VkDescriptorSet cameraSet = VK_NULL_HANDLE;
+  result = iio_allocate_frame_descriptor_sets(state.device, &state.frameDescriptorAllocator, currentFrame, 1, &cameraSet);
+  if (result != VK_SUCCESS) {
+    iio_vk_error(result, __LINE__, __FILE__);
+    exit(1);
+  }
+  iio_template_write_buffer(0, 0, state.globalUniformBuffers[currentFrame], 0, sizeof(CameraUniformBufferData), &state.cameraTemplateWriter);
+  iio_update_set_with_template(state.device, cameraSet, &state.cameraTemplateWriter);
 
-  
+  if (state.useBindless) {
+    //  camera and bindless table are bound once, draws only push their material index
+    vkCmdBindDescriptorSets(
+      commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state.graphicsPipelineManger.layout,
+      0, 2, (VkDescriptorSet [2]) {cameraSet, state.bindlessTable.descriptorSet},
+      0, NULL
+    );
+  } else {
+    //  only the camera is bound here, the draw list binds each material's set as it changes
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state.graphicsPipelineManger.layout, 0, 1, &cameraSet, 0, NULL);
+  }
+  if (state.useGpuDriven) {
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &state.geometryPool.vertexBuffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, state.geometryPool.indexBuffer, 0, state.geometryPool.indexType);
+    iio_record_gpu_culled_draws(commandBuffer, &state.gpuCulling, currentFrame, state.graphicsPipelineManger.layout, 2, &state.graphicsPipelineManger.pipeline);
+  } else {
+    //  visible primitives sorted by pipeline, material, vertex buffer and depth, so recording can skip
+    //  every bind and push that repeats the previous draw's. each primitive is one instanced draw
+    iio_draw_list_begin(&state.drawList, state.cameraData.view, viewProjection);
+    iio_draw_list_add_model(&state.drawList, &state.testModel, 0);
+    iio_draw_list_sort(&state.drawList);
+
+    //  the visible model matrices go through this frame's ring region as instance vertex data
+    VkDeviceSize instanceOffset = 0;
+    isize transformCount = vec_DrawTransform_size(&state.drawList.transforms);
+    if (transformCount && iio_frame_data_ring_write(
+      &state.frameDataRing, state.drawList.transforms.data, transformCount * sizeof(IIODrawTransform), &instanceOffset
+    )) {
+      iio_record_draw_list(
+        commandBuffer, state.graphicsPipelineManger.layout, &state.graphicsPipelineManger.pipeline,
+        state.frameDataRing.buffer, instanceOffset, &state.drawList
+      );
+    }
+  }
 
   //end of recording draw commands
 
@@ -2331,21 +2836,25 @@ void iio_record_testcube_command_buffer(VkCommandBuffer commandBuffer, uint32_t
   VkBuffer vertexBuffers[] = {testCube.vertexBuffer};
   VkDeviceSize offsets[] = {0};
   vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-  vkCmdBindIndexBuffer(commandBuffer, testCube.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+  vkCmdBindIndexBuffer(commandBuffer, testCube.indexBuffer, 0, testCube.indexType);
   uint32_t vertexCount = sizeof(testCube.vertices) / sizeof(Vertex);
   uint32_t indexCount = sizeof(testCube.indices) / sizeof(uint32_t);
 
-  glm_mat4_identity(testCube.modelUniformBufferData[currentFrame].position);
-  glm_rotate(testCube.modelUniformBufferData[currentFrame].position, glm_rad(sin(glfwGetTime() *  5.0)), (vec3){1.0, 0.0, 0.0});
-  glm_rotate(testCube.modelUniformBufferData[currentFrame].position, glm_rad(sin(glfwGetTime() *  7.0)), (vec3){0.0, 1.0, 0.0});
-  glm_rotate(testCube.modelUniformBufferData[currentFrame].position, glm_rad(sin(glfwGetTime() * 19.0)), (vec3){0.0, 0.0, 1.0});
+  ModelUniformBufferData modelData;
+  glm_mat4_identity(modelData.position);
+  glm_rotate(modelData.position, glm_rad(sin(glfwGetTime() *  5.0)), (vec3){1.0, 0.0, 0.0});
+  glm_rotate(modelData.position, glm_rad(sin(glfwGetTime() *  7.0)), (vec3){0.0, 1.0, 0.0});
+  glm_rotate(modelData.position, glm_rad(sin(glfwGetTime() * 19.0)), (vec3){0.0, 0.0, 1.0});
 
-  memcpy(testCube.modelUniformBufferMapped[currentFrame], &testCube.modelUniformBufferData[currentFrame], sizeof(ModelUniformBufferData));
+  uint32_t modelOffset = 0;
+  if (!iio_frame_data_ring_push(&state.frameDataRing, &modelData, sizeof(modelData), &modelOffset)) {
+    exit(1);
+  }
 
   VkDescriptorSet descriptorSets [3] = {
     state.cameraDescriptorSets[currentFrame],
     testCube.texSamplerDescriptorSets[currentFrame],
-    testCube.modelUniformBufferDescriptorSets[currentFrame]
+    testCube.modelDescriptorSet
   };
   vkCmdBindDescriptorSets(
     commandBuffer, 
@@ -2354,8 +2863,8 @@ void iio_record_testcube_command_buffer(VkCommandBuffer commandBuffer, uint32_t
     0, 
     3, 
     descriptorSets, 
-    0, 
-    NULL
+    1, 
+    &modelOffset
   );
   vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
 
@@ -2380,10 +2889,6 @@ void iio_record_testcube_command_buffer(VkCommandBuffer commandBuffer, uint32_t
   }
 }
 
-void iio_record_primitive_command_buffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame, IIOPrimitive * primitive) {
-
-}
-
 void iio_change_physical_device(VkPhysicalDevice physicalDevice) {
 
 }
@@ -2415,20 +2920,25 @@ void iio_cleanup() {
   //  Clean up the default textures
   iio_destroy_resources(state.device);
 
+  iio_evict_cached_descriptor_image_view(&state.descriptorCache, testCube.textureImage.view);
   iio_destroy_image(state.device, testTextureFilename, &state.resourceManager);
+  if (state.useBindless) {
+    iio_bindless_release_model_materials(&state.bindlessTable, &state.testModel);
+    iio_destroy_bindless_table(state.device, &state.memoryAllocator, &state.bindlessTable);
+  }
+  iio_destroy_application_scene();
+  iio_destroy_samplers(state.device, &state.resourceManager);
+  iio_destroy_resource_manager(&state.resourceManager);
   for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     if (state.globalUniformBuffers) vkDestroyBuffer(state.device, state.globalUniformBuffers[i], NULL);
-    if (state.globalUniformBuffersMemory) vkFreeMemory(state.device, state.globalUniformBuffersMemory[i], NULL);
+    iio_free_memory(state.device, &state.memoryAllocator, &state.globalUniformBuffersMemory[i]);
   }
 
   if (testCube.indexBuffer) vkDestroyBuffer(state.device, testCube.indexBuffer, NULL);
-  if (testCube.indexBufferMemory) vkFreeMemory(state.device, testCube.indexBufferMemory, NULL);
+  iio_free_memory(state.device, &state.memoryAllocator, &testCube.indexBufferMemory);
   if (testCube.vertexBuffer) vkDestroyBuffer(state.device, testCube.vertexBuffer, NULL);
-  if (testCube.vertexBufferMemory) vkFreeMemory(state.device, testCube.vertexBufferMemory, NULL);
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    if (testCube.modelUniformBuffer[i]) vkDestroyBuffer(state.device, testCube.modelUniformBuffer[i], NULL);
-    if (testCube.modelUniformBufferMemory[i]) vkFreeMemory(state.device, testCube.modelUniformBufferMemory[i], NULL);
-  }
+  iio_free_memory(state.device, &state.memoryAllocator, &testCube.vertexBufferMemory);
+  iio_destroy_frame_data_ring(state.device, &state.memoryAllocator, &state.frameDataRing);
 
   for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     if (state.imageAvailableSemaphores) vkDestroySemaphore(state.device, state.imageAvailableSemaphores[i], NULL);
@@ -2437,6 +2947,9 @@ void iio_cleanup() {
   for (int i = 0; i < state.swapChainImageCount; i++) {
     if (state.renderFinishedSemaphores) vkDestroySemaphore(state.device, state.renderFinishedSemaphores[i], NULL);
   }
+  iio_destroy_frame_descriptor_allocator(state.device, &state.frameDescriptorAllocator);
+  iio_destroy_descriptor_template_writer(&state.cameraTemplateWriter);
+  iio_destroy_descriptor_cache(&state.descriptorCache);
   if (state.descriptorPoolMangers) {
     for (uint32_t i = 0; i < state.descriptorPoolManagerCount; i++) {
       iio_destroy_descriptor_pool_manager(state.device, &state.descriptorPoolMangers[i]);
@@ -2447,6 +2960,9 @@ void iio_cleanup() {
   if (state.inFlightFences) free(state.inFlightFences);
   if (state.commandPool) vkDestroyCommandPool(state.device, state.commandPool, NULL);
   iio_destroy_graphics_pipeline(state.device, &state.graphicsPipelineManger);
+  iio_destroy_upload_context(state.device, &state.memoryAllocator, &state.uploadContext);
+  if (printMemoryStatsOnShutdown) iio_print_memory_stats(&state.memoryAllocator);
+  iio_destroy_memory_allocator(state.device, &state.memoryAllocator);
   if (state.device) vkDestroyDevice(state.device, NULL);
   if (state.physicalDevices) free(state.physicalDevices);
   if (state.surface) vkDestroySurfaceKHR(state.instance, state.surface, NULL);
@@ -2455,6 +2971,31 @@ void iio_cleanup() {
   glfwTerminate();
 }
 
+void iio_destroy_application_scene() {
+  for (uint32_t m = 0; m < state.testModel.meshCount; m++) {
+    IIOMesh * mesh = &state.testModel.meshes[m];
+    for (uint32_t p = 0; p < mesh->primitiveCount; p++) {
+      IIOPrimitive * primitive = &mesh->primitives[p];
+      if (primitive->pooledGeometry) continue;
+      if (primitive->vertexBuffer) vkDestroyBuffer(state.device, primitive->vertexBuffer, NULL);
+      iio_free_memory(state.device, &state.memoryAllocator, &primitive->vertexBufferMemory);
+      if (primitive->indexBuffer) vkDestroyBuffer(state.device, primitive->indexBuffer, NULL);
+      iio_free_memory(state.device, &state.memoryAllocator, &primitive->indexBufferMemory);
+    }
+  }
+  if (state.materialUniformBuffer) {
+    //  the material sets reference the buffer and the model's textures
+    iio_evict_cached_descriptor_layout(&state.descriptorCache, state.descriptorPoolMangers[1].descriptorSetLayout);
+    vkDestroyBuffer(state.device, state.materialUniformBuffer, NULL);
+    iio_free_memory(state.device, &state.memoryAllocator, &state.materialUniformBufferMemory);
+  }
+  iio_release_model_resources(state.device, &state.testModel, &state.resourceManager);
+  iio_destroy_model(&state.testModel);
+  iio_destroy_geometry_pool(state.device, &state.memoryAllocator, &state.geometryPool);
+  iio_destroy_gpu_culling(state.device, &state.memoryAllocator, &state.gpuCulling);
+  iio_destroy_draw_list(&state.drawList);
+}
+
 void iio_cleanup_device() {
   
   iio_cleanup_swapchain();
@@ -2464,7 +3005,7 @@ void iio_cleanup_device() {
 void iio_cleanup_swapchain() {
   if (state.depthImageView) vkDestroyImageView(state.device, state.depthImageView, NULL);
   if (state.depthImage) vkDestroyImage(state.device, state.depthImage, NULL);
-  if (state.depthImageMemory) vkFreeMemory(state.device, state.depthImageMemory, NULL);
+  iio_free_memory(state.device, &state.memoryAllocator, &state.depthImageMemory);
   if (state.swapChainImageViews) {
     for (uint32_t i = 0; i < state.swapChainImageCount; i++) {
       vkDestroyImageView(state.device, state.swapChainImageViews[i], NULL);
@@ -0,0 +1,46 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+#pragma shader_stage(fragment)
+
+//  mirrors MaterialUniformBufferData, std430
+struct Material {
+  vec4 baseColorFactor;
+  vec4 emissiveFactor;
+  vec4 metallicRoughnessNormalOcclusionScale;
+  float alphaCutoff;
+  float alphaCutoffPadding[3];
+  int texCoordIndex;
+  uint textureIndices[5];
+  uint samplerIndices[5];
+};
+
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) uniform sampler samplers[];
+layout(set = 1, binding = 2) readonly buffer MaterialBuffer {
+  Material materials[];
+};
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) flat in uint fragMaterialIndex;
+layout(location = 3) in vec2 fragTexCoord[2];
+
+layout(location = 0) out vec4 outColor;
+
+//  the material index is a push constant, or on the GPU driven path read from the draw's instance. each
+//  indirect draw is a draw of its own, so either way every index below is uniform across the draw
+vec4 sampleMaterialTexture(Material material, uint slot, vec2 texCoord) {
+  return texture(sampler2D(textures[material.textureIndices[slot]], samplers[material.samplerIndices[slot]]), texCoord);
+}
+
+void main() {
+  Material material = materials[fragMaterialIndex];
+  vec2 texCoord = fragTexCoord[clamp(material.texCoordIndex, 0, 1)];
+
+  vec4 baseColor = sampleMaterialTexture(material, 0, texCoord) * material.baseColorFactor * fragColor;
+  if (baseColor.a < material.alphaCutoff) {
+    discard;
+  }
+  vec3 emissive = sampleMaterialTexture(material, 4, texCoord).rgb * material.emissiveFactor.rgb;
+
+  outColor = vec4(baseColor.rgb + emissive, baseColor.a);
+}
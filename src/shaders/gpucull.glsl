@@ -0,0 +1,66 @@
+#version 450
+#pragma shader_stage(compute)
+
+layout(local_size_x = 64) in;
+
+struct Instance {
+  mat4 model;
+  vec4 boundsMin;
+  vec4 boundsMax;
+  uint indexCount;
+  uint firstIndex;
+  int vertexOffset;
+  uint materialIndex;
+  uint pipelineIndex;
+};
+
+struct DrawIndexedIndirectCommand {
+  uint indexCount;
+  uint instanceCount;
+  uint firstIndex;
+  int vertexOffset;
+  uint firstInstance;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+  Instance instances[];
+};
+
+layout(std430, set = 0, binding = 1) writeonly buffer Draws {
+  DrawIndexedIndirectCommand draws[];
+};
+
+layout(std430, set = 0, binding = 2) buffer Counts {
+  uint counts[];
+};
+
+layout(push_constant) uniform CullConstants {
+  vec4 frustumPlanes[6];
+  uint instanceCount;
+  uint drawCapacity;
+} cull;
+
+//  world space box of the transformed object space box, then the corner furthest along each plane normal
+bool isVisible(Instance instance) {
+  vec3 center = (instance.boundsMin.xyz + instance.boundsMax.xyz) * 0.5;
+  vec3 extent = (instance.boundsMax.xyz - instance.boundsMin.xyz) * 0.5;
+  vec3 worldCenter = (instance.model * vec4(center, 1.0)).xyz;
+  vec3 worldExtent = abs(mat3(instance.model)) * extent;
+  for (int i = 0; i < 6; i++) {
+    vec4 plane = cull.frustumPlanes[i];
+    if (dot(plane.xyz, worldCenter) + dot(abs(plane.xyz), worldExtent) < -plane.w) return false;
+  }
+  return true;
+}
+
+void main() {
+  uint index = gl_GlobalInvocationID.x;
+  if (index >= cull.instanceCount) return;
+  Instance instance = instances[index];
+  if (!isVisible(instance)) return;
+
+  uint slot = atomicAdd(counts[instance.pipelineIndex], 1);
+  draws[instance.pipelineIndex * cull.drawCapacity + slot] = DrawIndexedIndirectCommand(
+    instance.indexCount, 1, instance.firstIndex, instance.vertexOffset, index
+  );
+}
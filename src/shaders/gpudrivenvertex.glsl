@@ -0,0 +1,40 @@
+#version 450
+#pragma shader_stage(vertex)
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+  mat4 view;
+  mat4 projection;
+} ubo;
+
+struct Instance {
+  mat4 model;
+  vec4 boundsMin;
+  vec4 boundsMax;
+  uint indexCount;
+  uint firstIndex;
+  int vertexOffset;
+  uint materialIndex;
+  uint pipelineIndex;
+};
+
+//  culled draws carry their instance index as firstInstance
+layout(std430, set = 2, binding = 0) readonly buffer Instances {
+  Instance instances[];
+};
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 3) in vec2 inTexCoord[2];
+layout(location = 5) in vec4 inColor;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) flat out uint fragMaterialIndex;
+layout(location = 3) out vec2 fragTexCoord[2];
+
+void main() {
+  Instance instance = instances[gl_InstanceIndex];
+  gl_Position = ubo.projection * ubo.view * instance.model * vec4(inPosition, 1.0);
+  fragColor = inColor;
+  fragMaterialIndex = instance.materialIndex;
+  fragTexCoord[0] = inTexCoord[0];
+  fragTexCoord[1] = inTexCoord[1];
+}
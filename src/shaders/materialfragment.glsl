@@ -0,0 +1,36 @@
+#version 450
+#pragma shader_stage(fragment)
+
+layout(set = 1, binding = 0) uniform sampler2D baseColorSampler;
+layout(set = 1, binding = 1) uniform sampler2D metallicRoughnessSampler;
+layout(set = 1, binding = 2) uniform sampler2D normalSampler;
+layout(set = 1, binding = 3) uniform sampler2D occlusionSampler;
+layout(set = 1, binding = 4) uniform sampler2D emissiveSampler;
+//  mirrors MaterialUniformBufferData up to texCoordIndex, std140
+layout(set = 1, binding = 5) uniform MaterialUBO {
+  vec4 baseColorFactor;
+  vec4 emissiveFactor;
+  vec4 metallicRoughnessNormalOcclusionScale;
+  float alphaCutoff;
+  float alphaCutoffPadding0;
+  float alphaCutoffPadding1;
+  float alphaCutoffPadding2;
+  int texCoordIndex;
+} material;
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 3) in vec2 fragTexCoord[2];
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+  vec2 texCoord = fragTexCoord[clamp(material.texCoordIndex, 0, 1)];
+
+  vec4 baseColor = texture(baseColorSampler, texCoord) * material.baseColorFactor * fragColor;
+  if (baseColor.a < material.alphaCutoff) {
+    discard;
+  }
+  vec3 emissive = texture(emissiveSampler, texCoord).rgb * material.emissiveFactor.rgb;
+
+  outColor = vec4(baseColor.rgb + emissive, baseColor.a);
+}
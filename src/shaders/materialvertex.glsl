@@ -0,0 +1,22 @@
+#version 450
+#pragma shader_stage(vertex)
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+  mat4 view;
+  mat4 projection;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 3) in vec2 inTexCoord[2];
+layout(location = 5) in vec4 inColor;
+layout(location = 8) in mat4 inModel;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 3) out vec2 fragTexCoord[2];
+
+void main() {
+  gl_Position = ubo.projection * ubo.view * inModel * vec4(inPosition, 1.0);
+  fragColor = inColor;
+  fragTexCoord[0] = inTexCoord[0];
+  fragTexCoord[1] = inTexCoord[1];
+}